@@ -35,20 +35,19 @@ int main()
     auto n_neurons = 10u;
     auto n_in = 2u;
     auto n_out = 1u;
-    unsigned offset_w_names = 1000u;
 
-    // System state (letter a is used to make sure the state comes before the weights w)
+    // System state
     std::vector<expression> x;
     for (auto i = 0u; i < 4u; ++i) {
         x.emplace_back(variable{"a" + std::to_string(i)});
     }
 
-    // Network paramterers: weights and biases (w0001-w0002... guarantees correct alphabetical order up to
-    // offset_w_names - 1) parameters)
+    // Network parameters: weights and biases (as runtime parameters, so that
+    // they do not need to be added to the state vector)
     auto n_w = (n_in + 1) * n_neurons + (n_neurons + 1) * n_out;
     std::vector<expression> w;
     for (auto i = 0u; i < n_w; ++i) {
-        w.emplace_back(variable{"w" + std::to_string(i + offset_w_names)});
+        w.push_back(par[i]);
     }
 
     // We compute the outputs of the first (and only) layer of neurons
@@ -86,7 +85,7 @@ int main()
         out[i] = sigmoid(out[i]);
     }
 
-    // Assembling the dynamics (weights and biases derivatives are zero)
+    // Assembling the dynamics
     std::vector<expression> dynamics;
     // kinematics
     dynamics.push_back(x[2]);
@@ -96,22 +95,20 @@ int main()
     auto f1 = diff(out[0] + 1_dbl / (pow(x[0] * x[0] + x[1] * x[1], 0.5_dbl)), "a1");
     dynamics.push_back(f0);
     dynamics.push_back(f1);
-    // parameters are constants -> derivative to zero
-    for (decltype(w.size()) i = 0u; i < w.size(); ++i) {
-        dynamics.push_back(0_dbl);
-    }
 
-    // Setting the initial conditions (random weights and biases initialization)
+    // Setting the initial conditions and the values
+    // of the parameters (random weights and biases initialization)
     splitmix64 engine(123u);
     std::vector<double> ic = {1., 0., 0., 1.};
+    std::vector<double> weights;
     for (decltype(w.size()) i = 0u; i < w.size(); ++i) {
-        ic.push_back(std::normal_distribution<>(0., 1.)(engine));
+        weights.push_back(std::normal_distribution<>(0., 1.)(engine));
     }
 
     // Defining the integrator
     std::cout << "\nCompiling the Taylor Integrator (" << std::to_string(w.size()) << " parameters)." << std::endl;
     auto start = high_resolution_clock::now();
-    taylor_adaptive_dbl neural_network_ode{dynamics, ic};
+    taylor_adaptive_dbl neural_network_ode{dynamics, ic, kw::pars = weights};
     auto stop = high_resolution_clock::now();
     auto duration = duration_cast<microseconds>(stop - start);
     std::cout << "Microseconds: " << duration.count() << std::endl;
@@ -123,12 +120,11 @@ int main()
     auto state = neural_network_ode.get_state();
 
     // Uncomment these lines to print the state on screen during the first steps
+    // NOTE: eval_dbl() cannot evaluate runtime parameters, the weights
+    // must be replaced by their numerical values in out[0] beforehand.
     // std::unordered_map<std::string, double> eval_map;
     // eval_map["a0"] = state[0];
     // eval_map["a1"] = state[1];
-    // for (decltype(w.size()) i = 0u; i < w.size(); ++i) {
-    //    eval_map["w" + std::to_string(i + offset_w_names)] = ic[4 + i];
-    //}
     // auto V = eval_dbl(-out[0] - 1_dbl / pow(x[0] * x[0] + x[1] * x[1], 0.5_dbl), eval_map);
     // auto E0 = V + 0.5 * (state[2] * state[2] + state[3] * state[3]);
     // for (auto i = 0u; i < 100; ++i) {
@@ -0,0 +1,135 @@
+// Copyright 2020 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef HEYOKA_DETAIL_DFLOAT_HPP
+#define HEYOKA_DETAIL_DFLOAT_HPP
+
+#include <utility>
+
+namespace heyoka::detail
+{
+
+// A double-length floating-point number, represented as
+// the unevaluated sum of hi and lo, where (after normalisation)
+// |lo| is not greater than half an ulp of hi. This is used
+// to keep track of the time coordinate in the Taylor integrators,
+// so that the accumulation of the timesteps does not lose
+// accuracy in long-term integrations.
+template <typename F>
+struct dfloat {
+    F hi, lo;
+
+    dfloat() : hi(0), lo(0) {}
+    explicit dfloat(F x) : hi(x), lo(0) {}
+    explicit dfloat(F h, F l) : hi(h), lo(l) {}
+
+    // NOTE: for a normalised number,
+    // hi is the sum rounded to nearest.
+    explicit operator F() const
+    {
+        return hi;
+    }
+};
+
+// Error-free transformation of the sum of two floating-point numbers
+// (Knuth's TwoSum). The return values x and y are such that
+// x = fl(a + b) and a + b = x + y exactly.
+template <typename F>
+inline std::pair<F, F> eft_add_knuth(F a, F b)
+{
+    auto x = a + b;
+    auto z = x - a;
+    auto y = (a - (x - z)) + (b - z);
+
+    return std::pair{x, y};
+}
+
+// Same as eft_add_knuth(), but requires |a| >= |b| (Dekker's FastTwoSum).
+template <typename F>
+inline std::pair<F, F> eft_add_dekker(F a, F b)
+{
+    auto x = a + b;
+    auto y = (a - x) + b;
+
+    return std::pair{x, y};
+}
+
+template <typename F>
+inline dfloat<F> normalise(const dfloat<F> &x)
+{
+    auto [h, l] = eft_add_dekker(x.hi, x.lo);
+
+    return dfloat<F>(h, l);
+}
+
+// NOTE: this is the double-length addition with a relative
+// error bounded by a small multiple of the squared unit roundoff
+// when the operands have the same sign.
+template <typename F>
+inline dfloat<F> operator+(const dfloat<F> &x, const dfloat<F> &y)
+{
+    auto [s, e] = eft_add_knuth(x.hi, y.hi);
+
+    e += x.lo + y.lo;
+
+    return normalise(dfloat<F>(s, e));
+}
+
+template <typename F>
+inline dfloat<F> operator-(const dfloat<F> &x)
+{
+    return dfloat<F>(-x.hi, -x.lo);
+}
+
+template <typename F>
+inline dfloat<F> operator-(const dfloat<F> &x, const dfloat<F> &y)
+{
+    return x + -y;
+}
+
+// NOTE: the comparison operators assume
+// normalised operands.
+template <typename F>
+inline bool operator==(const dfloat<F> &x, const dfloat<F> &y)
+{
+    return x.hi == y.hi && x.lo == y.lo;
+}
+
+template <typename F>
+inline bool operator!=(const dfloat<F> &x, const dfloat<F> &y)
+{
+    return !(x == y);
+}
+
+template <typename F>
+inline bool operator<(const dfloat<F> &x, const dfloat<F> &y)
+{
+    return (x.hi < y.hi) || (x.hi == y.hi && x.lo < y.lo);
+}
+
+template <typename F>
+inline bool operator>(const dfloat<F> &x, const dfloat<F> &y)
+{
+    return y < x;
+}
+
+template <typename F>
+inline bool operator<=(const dfloat<F> &x, const dfloat<F> &y)
+{
+    return !(y < x);
+}
+
+template <typename F>
+inline bool operator>=(const dfloat<F> &x, const dfloat<F> &y)
+{
+    return !(x < y);
+}
+
+} // namespace heyoka::detail
+
+#endif
@@ -81,8 +81,9 @@ inline llvm::Type *to_llvm_type(llvm::LLVMContext &c)
     }
 }
 
-HEYOKA_DLL_PUBLIC llvm::Value *load_vector_from_memory(llvm::IRBuilder<> &, llvm::Value *, std::uint32_t);
-HEYOKA_DLL_PUBLIC void store_vector_to_memory(llvm::IRBuilder<> &, llvm::Value *, llvm::Value *);
+HEYOKA_DLL_PUBLIC llvm::Value *load_vector_from_memory(llvm::IRBuilder<> &, llvm::Value *, std::uint32_t,
+                                                       std::uint32_t = 1);
+HEYOKA_DLL_PUBLIC void store_vector_to_memory(llvm::IRBuilder<> &, llvm::Value *, llvm::Value *, std::uint32_t = 1);
 
 HEYOKA_DLL_PUBLIC llvm::Value *vector_splat(llvm::IRBuilder<> &, llvm::Value *, std::uint32_t);
 
@@ -104,7 +105,11 @@ HEYOKA_DLL_PUBLIC llvm::Value *llvm_invoke_internal(llvm_state &, const std::str
                                                     const std::vector<llvm::Value *> &);
 
 HEYOKA_DLL_PUBLIC void llvm_loop_u32(llvm_state &, llvm::Value *, llvm::Value *,
-                                     const std::function<void(llvm::Value *)> &);
+                                     const std::function<void(llvm::Value *)> &,
+                                     const std::function<llvm::Value *(llvm::Value *)> & = {});
+
+HEYOKA_DLL_PUBLIC void llvm_if_then_else(llvm_state &, llvm::Value *, const std::function<void()> &,
+                                         const std::function<void()> &);
 
 HEYOKA_DLL_PUBLIC llvm::Type *pointee_type(llvm::Value *);
 
@@ -20,6 +20,15 @@ using uncvref_t = std::remove_cv_t<std::remove_reference_t<T>>;
 template <typename, typename...>
 inline constexpr bool always_false_v = false;
 
+// NOTE: std::type_identity is available only since C++20.
+template <typename T>
+struct type_identity {
+    using type = T;
+};
+
+template <typename T>
+using type_identity_t = typename type_identity<T>::type;
+
 } // namespace heyoka::detail
 
 #endif
@@ -0,0 +1,156 @@
+// Copyright 2020 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef HEYOKA_ENSEMBLE_PROPAGATE_HPP
+#define HEYOKA_ENSEMBLE_PROPAGATE_HPP
+
+#include <heyoka/config.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+#include <mp++/real128.hpp>
+
+#endif
+
+#include <heyoka/detail/type_traits.hpp>
+#include <heyoka/detail/visibility.hpp>
+#include <heyoka/taylor.hpp>
+
+namespace heyoka
+{
+
+// The generator of the initial conditions for an ensemble propagation.
+// It is invoked with the index of an instance, a pointer to the state
+// vector and a pointer to the parameter values of the instance.
+// The parameter values are pre-filled with the values
+// from the template integrator.
+// NOTE: the generator is invoked concurrently from multiple threads.
+template <typename T>
+using ensemble_generator_t = std::function<void(std::size_t, T *, T *)>;
+
+// The result of an ensemble propagation: the final states
+// of the instances, laid out as [instance_idx][var_idx], and,
+// for each instance, the outcome of the integration, the min/max
+// absolute values of the timesteps and the number of steps taken.
+template <typename T>
+using ensemble_res_t = std::tuple<std::vector<T>, std::vector<std::tuple<taylor_outcome, T, T, std::size_t>>>;
+
+HEYOKA_DLL_PUBLIC ensemble_res_t<double> ensemble_propagate_until_dbl(const taylor_adaptive_dbl &, double,
+                                                                      std::size_t, const ensemble_generator_t<double> &,
+                                                                      unsigned, std::size_t);
+HEYOKA_DLL_PUBLIC ensemble_res_t<long double>
+ensemble_propagate_until_ldbl(const taylor_adaptive_ldbl &, long double, std::size_t,
+                              const ensemble_generator_t<long double> &, unsigned, std::size_t);
+
+HEYOKA_DLL_PUBLIC ensemble_res_t<double> ensemble_propagate_until_dbl(const taylor_adaptive_batch_dbl &, double,
+                                                                      std::size_t, const ensemble_generator_t<double> &,
+                                                                      unsigned, std::size_t);
+HEYOKA_DLL_PUBLIC ensemble_res_t<long double>
+ensemble_propagate_until_ldbl(const taylor_adaptive_batch_ldbl &, long double, std::size_t,
+                              const ensemble_generator_t<long double> &, unsigned, std::size_t);
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+HEYOKA_DLL_PUBLIC ensemble_res_t<mppp::real128>
+ensemble_propagate_until_f128(const taylor_adaptive_f128 &, mppp::real128, std::size_t,
+                              const ensemble_generator_t<mppp::real128> &, unsigned, std::size_t);
+HEYOKA_DLL_PUBLIC ensemble_res_t<mppp::real128>
+ensemble_propagate_until_f128(const taylor_adaptive_batch_f128 &, mppp::real128, std::size_t,
+                              const ensemble_generator_t<mppp::real128> &, unsigned, std::size_t);
+
+#endif
+
+// Propagate up to the time t n_iter instances of the ODE system
+// of the template integrator ta, whose initial conditions are set up
+// by the generator gen. All the instances start from the time of ta.
+// The instances are distributed over n_threads worker threads
+// (n_threads == 0 means as many threads as the hardware supports), each
+// operating on its own copy of ta. The compiled code is shared among the copies.
+// The workers claim the pending work one unit at a time from a shared
+// counter (rather than from per-worker queues, as in a work-stealing pool),
+// so that the load stays balanced even if the propagation times differ widely.
+// If ta is a batch integrator, the instances are packed into the
+// batch elements, and a batch element which completes its propagation
+// is immediately refilled with the next pending instance. max_steps
+// has the same meaning as in the propagate_until() function of
+// the scalar integrator, and it applies to each instance separately.
+template <typename TA, typename T>
+inline ensemble_res_t<T> ensemble_propagate_until(const TA &ta, T t, std::size_t n_iter,
+                                                  const detail::type_identity_t<ensemble_generator_t<T>> &gen,
+                                                  unsigned n_threads = 0, std::size_t max_steps = 0)
+{
+    if constexpr (std::is_same_v<T, double>) {
+        return ensemble_propagate_until_dbl(ta, t, n_iter, gen, n_threads, max_steps);
+    } else if constexpr (std::is_same_v<T, long double>) {
+        return ensemble_propagate_until_ldbl(ta, t, n_iter, gen, n_threads, max_steps);
+#if defined(HEYOKA_HAVE_REAL128)
+    } else if constexpr (std::is_same_v<T, mppp::real128>) {
+        return ensemble_propagate_until_f128(ta, t, n_iter, gen, n_threads, max_steps);
+#endif
+    } else {
+        static_assert(detail::always_false_v<T>, "Unhandled type.");
+    }
+}
+
+// Overload taking the initial conditions from arrays. The initial states
+// are laid out as [instance_idx][var_idx], the parameter values
+// as [instance_idx][par_idx]. If pars is empty, the parameter values
+// of the template integrator are used for all the instances.
+template <typename TA, typename T>
+inline ensemble_res_t<T> ensemble_propagate_until(const TA &ta, T t, const std::vector<T> &states,
+                                                  const std::vector<T> &pars, unsigned n_threads = 0,
+                                                  std::size_t max_steps = 0)
+{
+    const auto n_eq = ta.get_dim();
+    std::size_t n_pars;
+    if constexpr (std::is_same_v<TA, taylor_adaptive<T>>) {
+        n_pars = ta.get_pars().size();
+    } else {
+        n_pars = ta.get_pars().size() / ta.get_batch_size();
+    }
+
+    if (states.size() % n_eq != 0u) {
+        throw std::invalid_argument("The size of the array of initial states passed to ensemble_propagate_until() ("
+                                    + std::to_string(states.size())
+                                    + ") is not a multiple of the number of variables ("
+                                    + std::to_string(n_eq) + ")");
+    }
+
+    const auto n_iter = states.size() / n_eq;
+
+    if (!pars.empty() && pars.size() != n_iter * n_pars) {
+        throw std::invalid_argument("The size of the array of parameter values passed to ensemble_propagate_until() ("
+                                    + std::to_string(pars.size())
+                                    + ") is inconsistent with the number of instances and of parameters ("
+                                    + std::to_string(n_iter) + " and " + std::to_string(n_pars) + ")");
+    }
+
+    return ensemble_propagate_until(
+        ta, t, n_iter,
+        ensemble_generator_t<T>([&states, &pars, n_eq, n_pars](std::size_t i, T *s, T *p) {
+            std::copy(states.data() + i * n_eq, states.data() + (i + 1u) * n_eq, s);
+
+            if (!pars.empty()) {
+                std::copy(pars.data() + i * n_pars, pars.data() + (i + 1u) * n_pars, p);
+            }
+        }),
+        n_threads, max_steps);
+}
+
+} // namespace heyoka
+
+#endif
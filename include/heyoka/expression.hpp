@@ -38,6 +38,7 @@
 #include <heyoka/function.hpp>
 #include <heyoka/llvm_state.hpp>
 #include <heyoka/number.hpp>
+#include <heyoka/param.hpp>
 #include <heyoka/variable.hpp>
 
 namespace heyoka
@@ -46,7 +47,7 @@ namespace heyoka
 class HEYOKA_DLL_PUBLIC expression
 {
 public:
-    using value_type = std::variant<number, variable, binary_operator, function>;
+    using value_type = std::variant<number, variable, binary_operator, function, param>;
 
 private:
     value_type m_value;
@@ -56,6 +57,7 @@ public:
     explicit expression(variable);
     explicit expression(binary_operator);
     explicit expression(function);
+    explicit expression(param);
     expression(const expression &);
     expression(expression &&) noexcept;
     ~expression();
@@ -93,6 +95,19 @@ HEYOKA_DLL_PUBLIC expression operator""_var(const char *, std::size_t);
 namespace detail
 {
 
+struct HEYOKA_DLL_PUBLIC par_impl {
+    expression operator[](std::uint32_t) const;
+};
+
+} // namespace detail
+
+// Helper to create runtime parameters
+// with the syntax par[idx].
+inline constexpr detail::par_impl par;
+
+namespace detail
+{
+
 struct HEYOKA_DLL_PUBLIC prime_wrapper {
     std::string m_str;
 
@@ -126,6 +141,8 @@ HEYOKA_DLL_PUBLIC std::ostream &operator<<(std::ostream &, const expression &);
 HEYOKA_DLL_PUBLIC std::vector<std::string> get_variables(const expression &);
 HEYOKA_DLL_PUBLIC void rename_variables(expression &, const std::unordered_map<std::string, std::string> &);
 
+HEYOKA_DLL_PUBLIC std::uint32_t get_param_size(const expression &);
+
 HEYOKA_DLL_PUBLIC expression operator+(expression);
 HEYOKA_DLL_PUBLIC expression operator-(expression);
 
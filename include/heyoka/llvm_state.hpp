@@ -46,6 +46,8 @@
 namespace heyoka
 {
 
+class llvm_state;
+
 namespace detail
 {
 
@@ -60,6 +62,12 @@ struct target_features {
 
 HEYOKA_DLL_PUBLIC const target_features &get_target_features();
 
+struct llvm_state_mem_cache;
+
+// Process-wide cache of compiled llvm_state objects.
+HEYOKA_DLL_PUBLIC bool llvm_state_mem_cache_lookup(llvm_state &, const std::string &);
+HEYOKA_DLL_PUBLIC void llvm_state_mem_cache_store(const llvm_state &, const std::string &);
+
 } // namespace detail
 
 namespace kw
@@ -70,20 +78,48 @@ IGOR_MAKE_NAMED_ARGUMENT(opt_level);
 IGOR_MAKE_NAMED_ARGUMENT(fast_math);
 IGOR_MAKE_NAMED_ARGUMENT(save_object_code);
 IGOR_MAKE_NAMED_ARGUMENT(ls_vectorize);
+IGOR_MAKE_NAMED_ARGUMENT(cache_dir);
+IGOR_MAKE_NAMED_ARGUMENT(parjit);
+IGOR_MAKE_NAMED_ARGUMENT(lazy);
+IGOR_MAKE_NAMED_ARGUMENT(vector_width);
+IGOR_MAKE_NAMED_ARGUMENT(mv_targets);
+IGOR_MAKE_NAMED_ARGUMENT(opt_pipeline);
+IGOR_MAKE_NAMED_ARGUMENT(shared_session);
 
 } // namespace kw
 
-class llvm_state;
+// Report on the optimisation and compilation of an llvm_state.
+struct llvm_compile_report {
+    // Wall-clock time (in seconds) spent in the optimisation
+    // passes, accumulated over all the optimisation runs.
+    // NOTE: in parjit mode, this is the wall-clock time elapsed
+    // until all the partitions have been optimised.
+    double opt_time = 0;
+    // Wall-clock time (in seconds) spent in compile(), including
+    // the deferred optimisation (if any), the codegen and the linking.
+    double compile_time = 0;
+    // Number of IR instructions in the module before
+    // and after the most recent optimisation run.
+    std::uint64_t n_insts_pre_opt = 0;
+    std::uint64_t n_insts_post_opt = 0;
+    // Number of function definitions in the module at compile time.
+    std::uint64_t n_funcs = 0;
+    // Total size (in bytes) of the object code linked by the jit.
+    std::uint64_t obj_size = 0;
+};
+
+HEYOKA_DLL_PUBLIC std::ostream &operator<<(std::ostream &, const llvm_compile_report &);
 
 HEYOKA_DLL_PUBLIC std::ostream &operator<<(std::ostream &, const llvm_state &);
 
 class HEYOKA_DLL_PUBLIC llvm_state
 {
     friend std::ostream &operator<<(std::ostream &, const llvm_state &);
+    friend struct detail::llvm_state_mem_cache;
 
     struct jit;
 
-    std::unique_ptr<jit> m_jitter;
+    std::shared_ptr<jit> m_jitter;
     std::unique_ptr<llvm::Module> m_module;
     std::unique_ptr<llvm::IRBuilder<>> m_builder;
     std::unordered_map<std::string, llvm::Value *> m_named_values;
@@ -95,6 +131,16 @@ class HEYOKA_DLL_PUBLIC llvm_state
     bool m_save_object_code;
     std::string m_object_code;
     bool m_ls_vectorize;
+    std::string m_cache_dir;
+    bool m_parjit;
+    bool m_lazy;
+    unsigned m_vector_width;
+    std::vector<std::string> m_mv_targets;
+    std::string m_opt_pipeline;
+    bool m_shared_session;
+    std::vector<std::pair<std::string, double>> m_pass_timings;
+    llvm_compile_report m_compile_report;
+    bool m_opt_requested = false;
 
     // Check functions and verification.
     HEYOKA_DLL_LOCAL void check_uncompiled(const char *) const;
@@ -112,6 +158,13 @@ class HEYOKA_DLL_PUBLIC llvm_state
     template <typename T>
     HEYOKA_DLL_LOCAL void add_batch_expression_impl(const std::string &, const expression &, std::uint32_t);
 
+    // Implementation details for optimisation and compilation.
+    HEYOKA_DLL_LOCAL bool defer_optimise() const;
+    HEYOKA_DLL_LOCAL void optimise_impl();
+    HEYOKA_DLL_LOCAL std::string emit_object_code();
+    HEYOKA_DLL_LOCAL std::string get_cache_key(const std::string &) const;
+    HEYOKA_DLL_LOCAL void load_objects(const std::vector<std::string> &);
+
     // Implementation details for the variadic constructor.
     template <typename... KwArgs>
     static auto kw_args_ctor_impl(KwArgs &&... kw_args)
@@ -168,10 +221,92 @@ class HEYOKA_DLL_PUBLIC llvm_state
                 }
             }();
 
-            return std::tuple{std::move(mod_name), opt_level, fmath, socode, ls_vectorize};
+            // Directory for the on-disk object cache (defaults to empty
+            // string, which means that the cache is disabled).
+            auto cache_dir = [&p]() -> std::string {
+                if constexpr (p.has(kw::cache_dir)) {
+                    return std::forward<decltype(p(kw::cache_dir))>(p(kw::cache_dir));
+                } else {
+                    return "";
+                }
+            }();
+
+            // Parallel optimisation and codegen (defaults to false).
+            auto parjit = [&p]() -> bool {
+                if constexpr (p.has(kw::parjit)) {
+                    return std::forward<decltype(p(kw::parjit))>(p(kw::parjit));
+                } else {
+                    return false;
+                }
+            }();
+
+            // Lazy compilation (defaults to false).
+            auto lazy = [&p]() -> bool {
+                if constexpr (p.has(kw::lazy)) {
+                    return std::forward<decltype(p(kw::lazy))>(p(kw::lazy));
+                } else {
+                    return false;
+                }
+            }();
+
+            // Preferred vector width in bits (defaults to zero, which
+            // means that the vector width is selected automatically).
+            auto vector_width = [&p]() -> unsigned {
+                if constexpr (p.has(kw::vector_width)) {
+                    return std::forward<decltype(p(kw::vector_width))>(p(kw::vector_width));
+                } else {
+                    return 0;
+                }
+            }();
+
+            // List of sets of target features for the multiversioning
+            // of the compiled functions (defaults to empty list, which
+            // means that the functions are compiled only for the host).
+            auto mv_targets = [&p]() -> std::vector<std::string> {
+                if constexpr (p.has(kw::mv_targets)) {
+                    return std::forward<decltype(p(kw::mv_targets))>(p(kw::mv_targets));
+                } else {
+                    return {};
+                }
+            }();
+
+            // Optimisation pipeline (defaults to "default"). This can be
+            // either one of the presets "default", "fast_compile" and "vectorize",
+            // or a textual pipeline description.
+            auto opt_pipeline = [&p]() -> std::string {
+                if constexpr (p.has(kw::opt_pipeline)) {
+                    return std::forward<decltype(p(kw::opt_pipeline))>(p(kw::opt_pipeline));
+                } else {
+                    return "default";
+                }
+            }();
+
+            // Share the jit session and the target machine with the other
+            // llvm_state objects created with this option (defaults to false).
+            auto shared_session = [&p]() -> bool {
+                if constexpr (p.has(kw::shared_session)) {
+                    return std::forward<decltype(p(kw::shared_session))>(p(kw::shared_session));
+                } else {
+                    return false;
+                }
+            }();
+
+            return std::tuple{std::move(mod_name),
+                              opt_level,
+                              fmath,
+                              socode,
+                              ls_vectorize,
+                              std::move(cache_dir),
+                              parjit,
+                              lazy,
+                              vector_width,
+                              std::move(mv_targets),
+                              std::move(opt_pipeline),
+                              shared_session};
         }
     }
-    explicit llvm_state(std::tuple<std::string, unsigned, bool, bool, bool> &&);
+    explicit llvm_state(std::tuple<std::string, unsigned, bool, bool, bool, std::string, bool, bool, unsigned,
+                                   std::vector<std::string>, std::string, bool> &&);
 
 public:
     llvm_state();
@@ -206,9 +341,33 @@ public:
     const unsigned &opt_level() const;
     const bool &ls_vectorize() const;
     const std::unordered_map<std::string, llvm::Value *> &named_values() const;
+    const std::string &cache_dir() const;
+    bool parjit() const;
+    bool lazy() const;
+    unsigned vector_width() const;
+    const std::vector<std::string> &mv_targets() const;
+    const std::string &opt_pipeline() const;
+    bool shared_session() const;
+    bool fast_math() const;
+
+    // NOTE: the description of the target
+    // for which the code is compiled.
+    std::string target_triple() const;
+    std::string target_cpu() const;
+    std::string target_features() const;
+
+    using pass_timings_t = std::vector<std::pair<std::string, double>>;
+    const pass_timings_t &get_pass_timings() const;
+    const llvm_compile_report &get_compile_report() const;
 
     std::string get_ir() const;
     void dump_object_code(const std::string &) const;
+    void dump_static_library(const std::string &) const;
+    void dump_c_header(const std::string &) const;
+    const std::string &get_object_code() const;
+
+    void load_object_file(const std::string &);
+    void load_object_code(const std::string &);
 
     void verify_function(const std::string &);
     void verify_function(llvm::Function *);
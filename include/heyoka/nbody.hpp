@@ -56,7 +56,8 @@ HEYOKA_DLL_PUBLIC std::vector<std::pair<expression, expression>> make_nbody_sys_
 // n is the number of bodies (>= 2), while the following optional kwargs
 // can be passed:
 //
-// - 'masses', which can either contain the numerical values of the masses
+// - 'masses', which can either contain the values of the masses (as numbers
+//   or as expressions, e.g., runtime parameters created via par[i])
 //   or be the special value parametric_masses (see above), in which case the masses
 //   are added at the end of the state vector for each body as variables
 //   with null derivative;
@@ -110,7 +111,11 @@ inline std::vector<std::pair<expression, expression>> make_nbody_sys(std::uint32
                 std::vector<expression> masses_vec;
 
                 for (const auto &mass_value : p(kw::masses)) {
-                    masses_vec.emplace_back(number{mass_value});
+                    if constexpr (std::is_same_v<detail::uncvref_t<decltype(mass_value)>, expression>) {
+                        masses_vec.push_back(mass_value);
+                    } else {
+                        masses_vec.emplace_back(number{mass_value});
+                    }
                 }
 
                 return detail::make_nbody_sys_fixed_masses(n, std::move(G_const), std::move(masses_vec));
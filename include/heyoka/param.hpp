@@ -0,0 +1,175 @@
+// Copyright 2020 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef HEYOKA_PARAM_HPP
+#define HEYOKA_PARAM_HPP
+
+#include <heyoka/config.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+#include <llvm/IR/Value.h>
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+#include <mp++/real128.hpp>
+
+#endif
+
+#include <heyoka/detail/fwd_decl.hpp>
+#include <heyoka/detail/type_traits.hpp>
+#include <heyoka/detail/visibility.hpp>
+#include <heyoka/llvm_state.hpp>
+
+namespace heyoka
+{
+
+// A runtime parameter. The value of a parameter
+// is not known at compile time, and it is instead
+// read at runtime from an array of parameter values
+// (at the index m_index).
+class HEYOKA_DLL_PUBLIC param
+{
+    std::uint32_t m_index;
+
+public:
+    explicit param(std::uint32_t);
+    param(const param &);
+    param(param &&) noexcept;
+    ~param();
+
+    param &operator=(const param &);
+    param &operator=(param &&) noexcept;
+
+    std::uint32_t &idx();
+    const std::uint32_t &idx() const;
+};
+
+HEYOKA_DLL_PUBLIC void swap(param &, param &) noexcept;
+
+HEYOKA_DLL_PUBLIC std::size_t hash(const param &);
+
+HEYOKA_DLL_PUBLIC std::ostream &operator<<(std::ostream &, const param &);
+
+HEYOKA_DLL_PUBLIC std::vector<std::string> get_variables(const param &);
+HEYOKA_DLL_PUBLIC void rename_variables(param &, const std::unordered_map<std::string, std::string> &);
+
+HEYOKA_DLL_PUBLIC bool operator==(const param &, const param &);
+HEYOKA_DLL_PUBLIC bool operator!=(const param &, const param &);
+
+HEYOKA_DLL_PUBLIC expression subs(const param &, const std::unordered_map<std::string, expression> &);
+
+HEYOKA_DLL_PUBLIC expression diff(const param &, const std::string &);
+
+[[noreturn]] HEYOKA_DLL_PUBLIC double eval_dbl(const param &, const std::unordered_map<std::string, double> &);
+
+[[noreturn]] HEYOKA_DLL_PUBLIC void eval_batch_dbl(std::vector<double> &, const param &,
+                                                   const std::unordered_map<std::string, std::vector<double>> &);
+
+HEYOKA_DLL_PUBLIC void update_connections(std::vector<std::vector<std::size_t>> &, const param &, std::size_t &);
+[[noreturn]] HEYOKA_DLL_PUBLIC void update_node_values_dbl(std::vector<double> &, const param &,
+                                                           const std::unordered_map<std::string, double> &,
+                                                           const std::vector<std::vector<std::size_t>> &,
+                                                           std::size_t &);
+HEYOKA_DLL_PUBLIC void update_grad_dbl(std::unordered_map<std::string, double> &, const param &,
+                                       const std::unordered_map<std::string, double> &, const std::vector<double> &,
+                                       const std::vector<std::vector<std::size_t>> &, std::size_t &, double);
+
+[[noreturn]] HEYOKA_DLL_PUBLIC llvm::Value *codegen_dbl(llvm_state &, const param &);
+[[noreturn]] HEYOKA_DLL_PUBLIC llvm::Value *codegen_ldbl(llvm_state &, const param &);
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+[[noreturn]] HEYOKA_DLL_PUBLIC llvm::Value *codegen_f128(llvm_state &, const param &);
+
+#endif
+
+template <typename T>
+inline llvm::Value *codegen(llvm_state &s, const param &p)
+{
+    if constexpr (std::is_same_v<T, double>) {
+        return codegen_dbl(s, p);
+    } else if constexpr (std::is_same_v<T, long double>) {
+        return codegen_ldbl(s, p);
+#if defined(HEYOKA_HAVE_REAL128)
+    } else if constexpr (std::is_same_v<T, mppp::real128>) {
+        return codegen_f128(s, p);
+#endif
+    } else {
+        static_assert(detail::always_false_v<T>, "Unhandled type.");
+    }
+}
+
+HEYOKA_DLL_PUBLIC std::vector<expression>::size_type taylor_decompose_in_place(param &&, std::vector<expression> &);
+
+[[noreturn]] HEYOKA_DLL_PUBLIC llvm::Value *taylor_u_init_dbl(llvm_state &, const param &,
+                                                              const std::vector<llvm::Value *> &, std::uint32_t);
+[[noreturn]] HEYOKA_DLL_PUBLIC llvm::Value *taylor_u_init_ldbl(llvm_state &, const param &,
+                                                               const std::vector<llvm::Value *> &, std::uint32_t);
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+[[noreturn]] HEYOKA_DLL_PUBLIC llvm::Value *taylor_u_init_f128(llvm_state &, const param &,
+                                                               const std::vector<llvm::Value *> &, std::uint32_t);
+
+#endif
+
+template <typename T>
+inline llvm::Value *taylor_u_init(llvm_state &s, const param &p, const std::vector<llvm::Value *> &arr,
+                                  std::uint32_t batch_size)
+{
+    if constexpr (std::is_same_v<T, double>) {
+        return taylor_u_init_dbl(s, p, arr, batch_size);
+    } else if constexpr (std::is_same_v<T, long double>) {
+        return taylor_u_init_ldbl(s, p, arr, batch_size);
+#if defined(HEYOKA_HAVE_REAL128)
+    } else if constexpr (std::is_same_v<T, mppp::real128>) {
+        return taylor_u_init_f128(s, p, arr, batch_size);
+#endif
+    } else {
+        static_assert(detail::always_false_v<T>, "Unhandled type.");
+    }
+}
+
+[[noreturn]] HEYOKA_DLL_PUBLIC llvm::Value *taylor_c_u_init_dbl(llvm_state &, const param &, llvm::Value *,
+                                                                std::uint32_t);
+[[noreturn]] HEYOKA_DLL_PUBLIC llvm::Value *taylor_c_u_init_ldbl(llvm_state &, const param &, llvm::Value *,
+                                                                 std::uint32_t);
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+[[noreturn]] HEYOKA_DLL_PUBLIC llvm::Value *taylor_c_u_init_f128(llvm_state &, const param &, llvm::Value *,
+                                                                 std::uint32_t);
+
+#endif
+
+template <typename T>
+inline llvm::Value *taylor_c_u_init(llvm_state &s, const param &p, llvm::Value *arr, std::uint32_t batch_size)
+{
+    if constexpr (std::is_same_v<T, double>) {
+        return taylor_c_u_init_dbl(s, p, arr, batch_size);
+    } else if constexpr (std::is_same_v<T, long double>) {
+        return taylor_c_u_init_ldbl(s, p, arr, batch_size);
+#if defined(HEYOKA_HAVE_REAL128)
+    } else if constexpr (std::is_same_v<T, mppp::real128>) {
+        return taylor_c_u_init_f128(s, p, arr, batch_size);
+#endif
+    } else {
+        static_assert(detail::always_false_v<T>, "Unhandled type.");
+    }
+}
+
+} // namespace heyoka
+
+#endif
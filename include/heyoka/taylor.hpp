@@ -14,7 +14,12 @@
 #include <cassert>
 #include <cstddef>
 #include <cstdint>
+#include <functional>
+#include <istream>
 #include <limits>
+#include <optional>
+#include <ostream>
+#include <stdexcept>
 #include <string>
 #include <tuple>
 #include <utility>
@@ -29,6 +34,7 @@
 
 #endif
 
+#include <heyoka/detail/dfloat.hpp>
 #include <heyoka/detail/igor.hpp>
 #include <heyoka/detail/type_traits.hpp>
 #include <heyoka/detail/visibility.hpp>
@@ -55,32 +61,41 @@ HEYOKA_DLL_PUBLIC std::string taylor_mangle_suffix(llvm::Type *);
 HEYOKA_DLL_PUBLIC std::vector<expression> taylor_decompose(std::vector<expression>);
 HEYOKA_DLL_PUBLIC std::vector<expression> taylor_decompose(std::vector<std::pair<expression, expression>>);
 
+// Memory layout of the batch data exchanged with the compiled functions.
+// In the soa layout (the default), the values of a variable for all
+// the batch elements are contiguous (i.e., [var_idx][batch_idx]). In the
+// aos layout, the values of all the variables of a batch element are
+// contiguous (i.e., [batch_idx][var_idx]), and the compiled functions
+// gather/scatter the batch elements while loading/storing them.
+enum class taylor_layout { soa, aos };
+
 HEYOKA_DLL_PUBLIC std::vector<expression> taylor_add_jet_dbl(llvm_state &, const std::string &, std::vector<expression>,
-                                                             std::uint32_t, std::uint32_t, bool, bool);
+                                                             std::uint32_t, std::uint32_t, bool, bool,
+                                                             taylor_layout = taylor_layout::soa);
 HEYOKA_DLL_PUBLIC std::vector<expression> taylor_add_jet_ldbl(llvm_state &, const std::string &,
                                                               std::vector<expression>, std::uint32_t, std::uint32_t,
-                                                              bool, bool);
+                                                              bool, bool, taylor_layout = taylor_layout::soa);
 
 #if defined(HEYOKA_HAVE_REAL128)
 
 HEYOKA_DLL_PUBLIC std::vector<expression> taylor_add_jet_f128(llvm_state &, const std::string &,
                                                               std::vector<expression>, std::uint32_t, std::uint32_t,
-                                                              bool, bool);
+                                                              bool, bool, taylor_layout = taylor_layout::soa);
 
 #endif
 
 template <typename T>
 std::vector<expression> taylor_add_jet(llvm_state &s, const std::string &name, std::vector<expression> sys,
                                        std::uint32_t order, std::uint32_t batch_size, bool high_accuracy,
-                                       bool compact_mode)
+                                       bool compact_mode, taylor_layout layout = taylor_layout::soa)
 {
     if constexpr (std::is_same_v<T, double>) {
-        return taylor_add_jet_dbl(s, name, std::move(sys), order, batch_size, high_accuracy, compact_mode);
+        return taylor_add_jet_dbl(s, name, std::move(sys), order, batch_size, high_accuracy, compact_mode, layout);
     } else if constexpr (std::is_same_v<T, long double>) {
-        return taylor_add_jet_ldbl(s, name, std::move(sys), order, batch_size, high_accuracy, compact_mode);
+        return taylor_add_jet_ldbl(s, name, std::move(sys), order, batch_size, high_accuracy, compact_mode, layout);
 #if defined(HEYOKA_HAVE_REAL128)
     } else if constexpr (std::is_same_v<T, mppp::real128>) {
-        return taylor_add_jet_f128(s, name, std::move(sys), order, batch_size, high_accuracy, compact_mode);
+        return taylor_add_jet_f128(s, name, std::move(sys), order, batch_size, high_accuracy, compact_mode, layout);
 #endif
     } else {
         static_assert(detail::always_false_v<T>, "Unhandled type.");
@@ -89,31 +104,35 @@ std::vector<expression> taylor_add_jet(llvm_state &s, const std::string &name, s
 
 HEYOKA_DLL_PUBLIC std::vector<expression> taylor_add_jet_dbl(llvm_state &, const std::string &,
                                                              std::vector<std::pair<expression, expression>>,
-                                                             std::uint32_t, std::uint32_t, bool, bool);
+                                                             std::uint32_t, std::uint32_t, bool, bool,
+                                                             taylor_layout = taylor_layout::soa);
 HEYOKA_DLL_PUBLIC std::vector<expression> taylor_add_jet_ldbl(llvm_state &, const std::string &,
                                                               std::vector<std::pair<expression, expression>>,
-                                                              std::uint32_t, std::uint32_t, bool, bool);
+                                                              std::uint32_t, std::uint32_t, bool, bool,
+                                                              taylor_layout = taylor_layout::soa);
 
 #if defined(HEYOKA_HAVE_REAL128)
 
 HEYOKA_DLL_PUBLIC std::vector<expression> taylor_add_jet_f128(llvm_state &, const std::string &,
                                                               std::vector<std::pair<expression, expression>>,
-                                                              std::uint32_t, std::uint32_t, bool, bool);
+                                                              std::uint32_t, std::uint32_t, bool, bool,
+                                                              taylor_layout = taylor_layout::soa);
 
 #endif
 
 template <typename T>
 std::vector<expression> taylor_add_jet(llvm_state &s, const std::string &name,
                                        std::vector<std::pair<expression, expression>> sys, std::uint32_t order,
-                                       std::uint32_t batch_size, bool high_accuracy, bool compact_mode)
+                                       std::uint32_t batch_size, bool high_accuracy, bool compact_mode,
+                                       taylor_layout layout = taylor_layout::soa)
 {
     if constexpr (std::is_same_v<T, double>) {
-        return taylor_add_jet_dbl(s, name, std::move(sys), order, batch_size, high_accuracy, compact_mode);
+        return taylor_add_jet_dbl(s, name, std::move(sys), order, batch_size, high_accuracy, compact_mode, layout);
     } else if constexpr (std::is_same_v<T, long double>) {
-        return taylor_add_jet_ldbl(s, name, std::move(sys), order, batch_size, high_accuracy, compact_mode);
+        return taylor_add_jet_ldbl(s, name, std::move(sys), order, batch_size, high_accuracy, compact_mode, layout);
 #if defined(HEYOKA_HAVE_REAL128)
     } else if constexpr (std::is_same_v<T, mppp::real128>) {
-        return taylor_add_jet_f128(s, name, std::move(sys), order, batch_size, high_accuracy, compact_mode);
+        return taylor_add_jet_f128(s, name, std::move(sys), order, batch_size, high_accuracy, compact_mode, layout);
 #endif
     } else {
         static_assert(detail::always_false_v<T>, "Unhandled type.");
@@ -188,23 +207,239 @@ std::vector<expression> taylor_add_adaptive_step(llvm_state &s, const std::strin
 // Enum to represnt the outcome of a Taylor integration
 // stepping function.
 enum class taylor_outcome {
-    success,     // Integration step was successful, no time/step limits were reached.
-    step_limit,  // Maximum number of steps reached.
-    time_limit,  // Time limit reached.
-    interrupted, // Interrupted by user-provided stopping criterion.
-    err_nf_state // Non-finite initial state detected.
+    success,        // Integration step was successful, no time/step limits were reached.
+    step_limit,     // Maximum number of steps reached.
+    time_limit,     // Time limit reached.
+    interrupted,    // Interrupted by user-provided stopping criterion.
+    err_nf_state,   // Non-finite initial state detected.
+    terminal_event  // The step was truncated by a terminal event.
 };
 
+// Direction of the zero crossing of an event function
+// (i.e., the sign of the time derivative of the event function
+// at the crossing).
+enum class event_direction { negative = -1, any = 0, positive = 1 };
+
 namespace kw
 {
 
 IGOR_MAKE_NAMED_ARGUMENT(time);
 IGOR_MAKE_NAMED_ARGUMENT(tol);
+IGOR_MAKE_NAMED_ARGUMENT(lane_tols);
+IGOR_MAKE_NAMED_ARGUMENT(layout);
+IGOR_MAKE_NAMED_ARGUMENT(atol);
+IGOR_MAKE_NAMED_ARGUMENT(rtol);
+IGOR_MAKE_NAMED_ARGUMENT(tol_exclude);
+IGOR_MAKE_NAMED_ARGUMENT(variable_order);
 IGOR_MAKE_NAMED_ARGUMENT(high_accuracy);
 IGOR_MAKE_NAMED_ARGUMENT(compact_mode);
+IGOR_MAKE_NAMED_ARGUMENT(object_file);
+IGOR_MAKE_NAMED_ARGUMENT(dense_output);
+IGOR_MAKE_NAMED_ARGUMENT(pars);
+IGOR_MAKE_NAMED_ARGUMENT(t_events);
+IGOR_MAKE_NAMED_ARGUMENT(nt_events);
+IGOR_MAKE_NAMED_ARGUMENT(callback);
+IGOR_MAKE_NAMED_ARGUMENT(direction);
+IGOR_MAKE_NAMED_ARGUMENT(cooldown);
 
 } // namespace kw
 
+// Report on the construction of an adaptive Taylor integrator.
+struct taylor_compile_report {
+    // Wall-clock times (in seconds) spent in the decomposition
+    // of the system (including the common subexpression elimination
+    // and the sorting of the decomposition) and in the emission
+    // of the LLVM IR of the stepper (excluding the optimisation).
+    double decomposition_time = 0;
+    double ir_time = 0;
+    // Number of u variables in the decomposition.
+    std::uint32_t n_uvars = 0;
+    // Flag signalling that the compiled stepper was fetched from
+    // the in-process cache or loaded from an object file. In such
+    // case, the IR emission time and the llvm report are zero.
+    // NOTE: the flag is set also in an integrator restored from a
+    // checkpoint, whose report is otherwise the one of the integrator
+    // which wrote the checkpoint.
+    bool cached = false;
+    // The report of the llvm_state.
+    llvm_compile_report llvm;
+};
+
+HEYOKA_DLL_PUBLIC std::ostream &operator<<(std::ostream &, const taylor_compile_report &);
+
+namespace detail
+{
+
+template <typename T>
+class taylor_adaptive_impl;
+
+// Helper to check the direction of an event.
+inline event_direction taylor_check_ev_direction(event_direction dir)
+{
+    if (dir < event_direction::negative || dir > event_direction::positive) {
+        throw std::invalid_argument("Invalid value selected for the direction of an event: "
+                                    + std::to_string(static_cast<int>(dir)));
+    }
+
+    return dir;
+}
+
+// Terminal event. When a zero crossing of the event function
+// is detected within a timestep, the timestep is truncated
+// at the time of the crossing and the optional callback is
+// invoked with the integrator (whose state and time have been
+// updated to the time of the crossing) and the direction of the
+// crossing.
+// NOTE: the cooldown is a time interval following a crossing
+// during which further crossings of the same event are ignored
+// (so that the event does not trigger again immediately after the
+// truncated timestep). A negative cooldown (the default) means that
+// the cooldown will be estimated automatically.
+template <typename T>
+class t_event_impl
+{
+public:
+    using callback_t = std::function<void(taylor_adaptive_impl<T> &, event_direction)>;
+
+private:
+    expression m_eq;
+    callback_t m_callback;
+    T m_cooldown;
+    event_direction m_dir;
+
+public:
+    template <typename... KwArgs>
+    explicit t_event_impl(expression e, KwArgs &&... kw_args) : m_eq(std::move(e))
+    {
+        igor::parser p{kw_args...};
+
+        if constexpr (p.has_unnamed_arguments()) {
+            static_assert(detail::always_false_v<KwArgs...>,
+                          "The variadic arguments in the construction of a terminal event contain "
+                          "unnamed arguments.");
+        } else {
+            // Callback (defaults to empty).
+            if constexpr (p.has(kw::callback)) {
+                m_callback = std::forward<decltype(p(kw::callback))>(p(kw::callback));
+            }
+
+            // Cooldown (defaults to automatic).
+            m_cooldown = [&p]() -> T {
+                if constexpr (p.has(kw::cooldown)) {
+                    return std::forward<decltype(p(kw::cooldown))>(p(kw::cooldown));
+                } else {
+                    return T(-1);
+                }
+            }();
+
+            // Direction (defaults to any).
+            m_dir = [&p]() -> event_direction {
+                if constexpr (p.has(kw::direction)) {
+                    return taylor_check_ev_direction(std::forward<decltype(p(kw::direction))>(p(kw::direction)));
+                } else {
+                    return event_direction::any;
+                }
+            }();
+        }
+    }
+
+    const expression &get_expression() const
+    {
+        return m_eq;
+    }
+    const callback_t &get_callback() const
+    {
+        return m_callback;
+    }
+    T get_cooldown() const
+    {
+        return m_cooldown;
+    }
+    event_direction get_direction() const
+    {
+        return m_dir;
+    }
+};
+
+// Non-terminal event. The zero crossings of the event function
+// detected within a timestep are reported, in chronological order,
+// at the end of the timestep by invoking the callback with the
+// integrator, the time of the crossing and the direction of
+// the crossing. The state of the integrator at the time of the crossing
+// can be computed via the dense output.
+// NOTE: the callback must not step the integrator.
+template <typename T>
+class nt_event_impl
+{
+public:
+    using callback_t = std::function<void(taylor_adaptive_impl<T> &, T, event_direction)>;
+
+private:
+    expression m_eq;
+    callback_t m_callback;
+    event_direction m_dir;
+
+public:
+    template <typename... KwArgs>
+    explicit nt_event_impl(expression e, callback_t cb, KwArgs &&... kw_args)
+        : m_eq(std::move(e)), m_callback(std::move(cb))
+    {
+        igor::parser p{kw_args...};
+
+        if constexpr (p.has_unnamed_arguments()) {
+            static_assert(detail::always_false_v<KwArgs...>,
+                          "The variadic arguments in the construction of a non-terminal event contain "
+                          "unnamed arguments.");
+        } else {
+            if (!m_callback) {
+                throw std::invalid_argument("Cannot construct a non-terminal event with an empty callback");
+            }
+
+            // Direction (defaults to any).
+            m_dir = [&p]() -> event_direction {
+                if constexpr (p.has(kw::direction)) {
+                    return taylor_check_ev_direction(std::forward<decltype(p(kw::direction))>(p(kw::direction)));
+                } else {
+                    return event_direction::any;
+                }
+            }();
+        }
+    }
+
+    const expression &get_expression() const
+    {
+        return m_eq;
+    }
+    const callback_t &get_callback() const
+    {
+        return m_callback;
+    }
+    event_direction get_direction() const
+    {
+        return m_dir;
+    }
+};
+
+} // namespace detail
+
+using t_event_dbl = detail::t_event_impl<double>;
+using t_event_ldbl = detail::t_event_impl<long double>;
+using nt_event_dbl = detail::nt_event_impl<double>;
+using nt_event_ldbl = detail::nt_event_impl<long double>;
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+using t_event_f128 = detail::t_event_impl<mppp::real128>;
+using nt_event_f128 = detail::nt_event_impl<mppp::real128>;
+
+#endif
+
+template <typename T>
+using t_event = detail::t_event_impl<T>;
+
+template <typename T>
+using nt_event = detail::nt_event_impl<T>;
+
 namespace detail
 {
 
@@ -253,7 +488,87 @@ inline auto taylor_adaptive_common_ops(KwArgs &&... kw_args)
         }
     }();
 
-    return std::tuple{high_accuracy, tol, compact_mode};
+    // Object file from which the compiled stepper
+    // will be loaded (defaults to empty string,
+    // meaning that the stepper will be compiled).
+    auto object_file = [&p]() -> std::string {
+        if constexpr (p.has(kw::object_file)) {
+            return std::forward<decltype(p(kw::object_file))>(p(kw::object_file));
+        } else {
+            return "";
+        }
+    }();
+
+    // Dense output (defaults to false). If enabled, the Taylor
+    // coefficients of the last step are stored in the integrator
+    // and they can be used to compute the solution at any time
+    // within the last step.
+    auto dense_output = [&p]() -> bool {
+        if constexpr (p.has(kw::dense_output)) {
+            return std::forward<decltype(p(kw::dense_output))>(p(kw::dense_output));
+        } else {
+            return false;
+        }
+    }();
+
+    // The values of the runtime parameters (defaults to empty,
+    // meaning that all the parameters appearing in the system
+    // will be initialised to zero).
+    auto pars = [&p]() -> std::vector<T> {
+        if constexpr (p.has(kw::pars)) {
+            return std::forward<decltype(p(kw::pars))>(p(kw::pars));
+        } else {
+            return {};
+        }
+    }();
+
+    // Per-variable absolute and relative tolerances (default to empty).
+    // If provided, the step size is chosen so that the local error
+    // estimate of each state variable x_i does not exceed
+    // max(atol_i, rtol_i * |x_i|), while tol still determines
+    // the Taylor order. If only one of the two vectors
+    // is provided, the other one defaults to tol.
+    auto atol = [&p]() -> std::vector<T> {
+        if constexpr (p.has(kw::atol)) {
+            return std::forward<decltype(p(kw::atol))>(p(kw::atol));
+        } else {
+            return {};
+        }
+    }();
+
+    auto rtol = [&p]() -> std::vector<T> {
+        if constexpr (p.has(kw::rtol)) {
+            return std::forward<decltype(p(kw::rtol))>(p(kw::rtol));
+        } else {
+            return {};
+        }
+    }();
+
+    // The indices of the state variables to be excluded from the
+    // step-size control (defaults to empty). This is useful for variables,
+    // such as quadratures, which do not feed back into the dynamics.
+    auto tol_exclude = [&p]() -> std::vector<std::uint32_t> {
+        if constexpr (p.has(kw::tol_exclude)) {
+            return std::forward<decltype(p(kw::tol_exclude))>(p(kw::tol_exclude));
+        } else {
+            return {};
+        }
+    }();
+
+    // Variable order (defaults to false). If enabled, the stepper
+    // may truncate the Taylor series at an order lower than
+    // the order determined by tol when the timestep is limited by the
+    // caller. Requires compact mode.
+    auto variable_order = [&p]() -> bool {
+        if constexpr (p.has(kw::variable_order)) {
+            return std::forward<decltype(p(kw::variable_order))>(p(kw::variable_order));
+        } else {
+            return false;
+        }
+    }();
+
+    return std::tuple{high_accuracy, tol, compact_mode, std::move(object_file), dense_output, std::move(pars),
+                      std::move(atol), std::move(rtol), std::move(tol_exclude), variable_order};
 }
 
 template <typename T>
@@ -261,21 +576,66 @@ class HEYOKA_DLL_PUBLIC taylor_adaptive_impl
 {
     // State vector.
     std::vector<T> m_state;
-    // Time.
-    T m_time;
+    // The external state buffer
+    // (null if not attached).
+    T *m_ext_state = nullptr;
+    // Time (in double-length format).
+    detail::dfloat<T> m_time;
     // The LLVM machinery.
     llvm_state m_llvm;
     // Taylor decomposition.
     std::vector<expression> m_dc;
+    // The values of the runtime parameters.
+    std::vector<T> m_pars;
     // The stepper.
-    using step_f_t = void (*)(T *, T *);
+    // NOTE: the stepper returns the Taylor order used in the step.
+    using step_f_t = std::uint32_t (*)(T *, const T *, T *, T *);
     step_f_t m_step_f;
+    // The compile report.
+    taylor_compile_report m_compile_report;
+    // The tolerance.
+    T m_tol;
+    // The Taylor order.
+    std::uint32_t m_order;
+    // The Taylor order used in the last step
+    // (zero if no step was taken yet).
+    std::uint32_t m_last_order = 0;
+    // The Taylor coefficients of the last step
+    // (empty if dense output is disabled).
+    std::vector<T> m_tc;
+    // The last timestep.
+    T m_last_h = T(0);
+    // The dense output.
+    using d_out_f_t = void (*)(T *, const T *, const T *);
+    d_out_f_t m_d_out_f;
+    std::vector<T> m_d_out;
+    // The terminal and non-terminal events.
+    std::vector<t_event_impl<T>> m_tes;
+    std::vector<nt_event_impl<T>> m_ntes;
+    // The remaining cooldown times of the terminal
+    // events (non-positive if the cooldown is not active).
+    std::vector<T> m_te_cooldowns;
+    // The index of the last triggered terminal event.
+    std::optional<std::uint32_t> m_last_te_idx;
+    // The events detected in the last step: index, time
+    // offset from the beginning of the step and direction
+    // (plus the cooldown for the terminal events).
+    std::vector<std::tuple<std::uint32_t, T, event_direction, T>> m_d_tes;
+    std::vector<std::tuple<std::uint32_t, T, event_direction>> m_d_ntes;
+    // Workspace for the root finding.
+    std::vector<T> m_ev_poly, m_ev_ws, m_ev_roots;
+    std::vector<std::pair<T, T>> m_ev_wl;
 
     HEYOKA_DLL_LOCAL std::tuple<taylor_outcome, T> step_impl(T);
+    HEYOKA_DLL_LOCAL void detect_events(T);
+    HEYOKA_DLL_LOCAL std::tuple<taylor_outcome, T, T, std::size_t> propagate_until_impl(const detail::dfloat<T> &,
+                                                                                        std::size_t);
 
     // Private implementation-detail constructor machinery.
     template <typename U>
-    void finalise_ctor_impl(U, std::vector<T>, T, T, bool, bool);
+    void finalise_ctor_impl(U, std::vector<T>, T, T, bool, bool, const std::string &, bool, std::vector<T>,
+                            std::vector<t_event_impl<T>>, std::vector<nt_event_impl<T>>, std::vector<T>,
+                            std::vector<T>, const std::vector<std::uint32_t> &, bool);
     template <typename U, typename... KwArgs>
     void finalise_ctor(U sys, std::vector<T> state, KwArgs &&... kw_args)
     {
@@ -295,10 +655,31 @@ class HEYOKA_DLL_PUBLIC taylor_adaptive_impl
                 }
             }();
 
-            const auto [high_accuracy, tol, compact_mode]
+            auto [high_accuracy, tol, compact_mode, object_file, dense_output, pars, atol, rtol, tol_exclude,
+                  variable_order]
                 = taylor_adaptive_common_ops<T>(std::forward<KwArgs>(kw_args)...);
 
-            finalise_ctor_impl(std::move(sys), std::move(state), time, tol, high_accuracy, compact_mode);
+            // Terminal events (defaults to empty).
+            auto tes = [&p]() -> std::vector<t_event_impl<T>> {
+                if constexpr (p.has(kw::t_events)) {
+                    return std::forward<decltype(p(kw::t_events))>(p(kw::t_events));
+                } else {
+                    return {};
+                }
+            }();
+
+            // Non-terminal events (defaults to empty).
+            auto ntes = [&p]() -> std::vector<nt_event_impl<T>> {
+                if constexpr (p.has(kw::nt_events)) {
+                    return std::forward<decltype(p(kw::nt_events))>(p(kw::nt_events));
+                } else {
+                    return {};
+                }
+            }();
+
+            finalise_ctor_impl(std::move(sys), std::move(state), time, tol, high_accuracy, compact_mode, object_file,
+                               dense_output, std::move(pars), std::move(tes), std::move(ntes), std::move(atol),
+                               std::move(rtol), tol_exclude, variable_order);
         }
     }
 
@@ -316,6 +697,13 @@ public:
     {
         finalise_ctor(std::move(sys), std::move(state), std::forward<KwArgs>(kw_args)...);
     }
+    // Restore an integrator from a checkpoint written by save().
+    // NOTE: the restore involves neither the decomposition of the
+    // system nor the optimisation and codegen of the stepper, whose
+    // object code is stored in the checkpoint. Thus, the checkpoint
+    // can be restored only on a target (triple, CPU and CPU features)
+    // identical to the one on which it was written.
+    explicit taylor_adaptive_impl(std::istream &);
 
     taylor_adaptive_impl(const taylor_adaptive_impl &);
     taylor_adaptive_impl(taylor_adaptive_impl &&) noexcept;
@@ -325,29 +713,126 @@ public:
 
     ~taylor_adaptive_impl();
 
+    // Write a binary checkpoint of the integrator (state, time, tolerance,
+    // runtime parameters, decomposition and compiled code) to a stream.
+    // NOTE: this requires the 'save_object_code' option of the llvm_state.
+    // Integrators with events cannot be checkpointed.
+    void save(std::ostream &) const;
+
     const llvm_state &get_llvm_state() const;
 
     const std::vector<expression> &get_decomposition() const;
 
+    const taylor_compile_report &get_compile_report() const;
+
     T get_time() const
     {
-        return m_time;
+        return static_cast<T>(m_time);
+    }
+    // NOTE: the time is internally kept in double-length
+    // format, as the unevaluated sum of the two returned values.
+    std::pair<T, T> get_dtime() const
+    {
+        return std::pair{m_time.hi, m_time.lo};
+    }
+    // NOTE: the number of state variables.
+    std::size_t get_dim() const
+    {
+        return m_state.size();
     }
     const std::vector<T> &get_state() const
     {
+        if (m_ext_state != nullptr) {
+            throw std::invalid_argument("Cannot fetch the state vector of an adaptive Taylor integrator while an "
+                                        "external state buffer is attached (use get_state_data() instead)");
+        }
+
         return m_state;
     }
+    // NOTE: if an external state buffer is attached,
+    // these return a pointer to it.
     const T *get_state_data() const
     {
-        return m_state.data();
+        return m_ext_state == nullptr ? m_state.data() : m_ext_state;
     }
     T *get_state_data()
     {
-        return m_state.data();
+        return m_ext_state == nullptr ? m_state.data() : m_ext_state;
+    }
+    // NOTE: the values of the runtime parameters
+    // can be changed freely between steps.
+    const std::vector<T> &get_pars() const
+    {
+        return m_pars;
+    }
+    const T *get_pars_data() const
+    {
+        return m_pars.data();
+    }
+    T *get_pars_data()
+    {
+        return m_pars.data();
     }
 
     void set_state(const std::vector<T> &);
     void set_time(T);
+    // NOTE: set the time in double-length format, as
+    // the unevaluated sum of the two arguments (e.g., as
+    // returned by get_dtime()).
+    void set_dtime(T, T);
+
+    // NOTE: when an external state buffer is attached, the integrator
+    // operates directly on it, without any copy. The buffer must contain
+    // get_dim() values and it must outlive the attachment. Detaching
+    // copies the current content of the buffer into the internal state vector.
+    void attach_state(T *);
+    void detach_state();
+    bool has_ext_state() const
+    {
+        return m_ext_state != nullptr;
+    }
+
+    T get_tol() const
+    {
+        return m_tol;
+    }
+    std::uint32_t get_order() const
+    {
+        return m_order;
+    }
+    // NOTE: this may be lower than get_order()
+    // if variable order is enabled.
+    std::uint32_t get_last_order() const
+    {
+        return m_last_order;
+    }
+    // NOTE: the Taylor coefficients are laid out
+    // as [var_idx][order]. The Taylor coefficients of the
+    // event functions (terminal first) follow the Taylor
+    // coefficients of the state variables.
+    const std::vector<T> &get_tc() const
+    {
+        return m_tc;
+    }
+    const std::vector<t_event_impl<T>> &get_t_events() const
+    {
+        return m_tes;
+    }
+    const std::vector<nt_event_impl<T>> &get_nt_events() const
+    {
+        return m_ntes;
+    }
+    // NOTE: the index of the last triggered terminal
+    // event is reset at the beginning of each step.
+    const std::optional<std::uint32_t> &get_last_te_idx() const
+    {
+        return m_last_te_idx;
+    }
+    const std::vector<T> &get_d_output() const
+    {
+        return m_d_out;
+    }
+    const std::vector<T> &update_d_output(T);
 
     std::tuple<taylor_outcome, T> step();
     std::tuple<taylor_outcome, T> step_backward();
@@ -484,28 +969,79 @@ class HEYOKA_DLL_PUBLIC taylor_adaptive_batch_impl
 {
     // The batch size.
     std::uint32_t m_batch_size;
+    // The memory layout of the state vectors
+    // (and of the dense output).
+    taylor_layout m_layout;
     // State vectors.
     std::vector<T> m_states;
-    // Times.
+    // The external state buffer
+    // (null if not attached).
+    T *m_ext_states = nullptr;
+    // Times. In order to avoid accumulating rounding errors,
+    // the times are kept in double-length format, as the
+    // unevaluated sums of m_times and m_times_lo.
     std::vector<T> m_times;
+    std::vector<T> m_times_lo;
     // The LLVM machinery.
     llvm_state m_llvm;
     // Taylor decomposition.
     std::vector<expression> m_dc;
+    // The values of the runtime parameters.
+    std::vector<T> m_pars;
     // The stepper.
-    using step_f_t = void (*)(T *, T *);
+    // NOTE: the stepper returns the Taylor order used in the step.
+    using step_f_t = std::uint32_t (*)(T *, const T *, T *, T *);
     step_f_t m_step_f;
+    // The compile report.
+    taylor_compile_report m_compile_report;
+    // The tolerance (with per-lane tolerances, the
+    // minimum among the tolerances of the batch elements).
+    T m_tol;
+    // The per-lane tolerances (empty if not provided).
+    std::vector<T> m_lane_tols;
+    // The Taylor order.
+    std::uint32_t m_order;
+    // The Taylor orders of the batch elements.
+    std::vector<std::uint32_t> m_lane_orders;
+    // The Taylor order used in the last step
+    // (zero if no step was taken yet).
+    std::uint32_t m_last_order = 0;
+    // The Taylor coefficients of the last step
+    // (empty if dense output is disabled).
+    std::vector<T> m_tc;
+    // The last timesteps.
+    std::vector<T> m_last_hs;
+    // The dense output.
+    using d_out_f_t = void (*)(T *, const T *, const T *);
+    d_out_f_t m_d_out_f;
+    std::vector<T> m_d_out;
     // Temporary vectors for use
     // in the timestepping functions.
     std::vector<T> m_pinf;
     std::vector<T> m_minf;
     std::vector<T> m_delta_ts;
+    // Temporary vector for use in the
+    // dense output functions.
+    std::vector<T> m_d_out_hs;
+    // Temporary vectors for use
+    // in the propagate functions.
+    std::vector<T> m_prop_max_delta_ts;
+    std::vector<std::tuple<taylor_outcome, T>> m_prop_step_res;
 
     HEYOKA_DLL_LOCAL void step_impl(std::vector<std::tuple<taylor_outcome, T>> &, const std::vector<T> &);
+    template <typename F>
+    HEYOKA_DLL_LOCAL void propagate_until_impl(std::vector<std::tuple<taylor_outcome, T, T, std::size_t>> &,
+                                               const std::vector<detail::dfloat<T>> &, std::size_t, const F &);
+    detail::dfloat<T> get_dtime(std::uint32_t i) const
+    {
+        return detail::dfloat<T>(m_times[i], m_times_lo[i]);
+    }
 
     // Private implementation-detail constructor machinery.
     template <typename U>
-    void finalise_ctor_impl(U, std::vector<T>, std::uint32_t, std::vector<T>, T, bool, bool);
+    void finalise_ctor_impl(U, std::vector<T>, std::uint32_t, std::vector<T>, T, bool, bool, const std::string &,
+                            bool, std::vector<T>, std::vector<T>, std::vector<T>, const std::vector<std::uint32_t> &,
+                            bool, std::vector<T>, taylor_layout);
     template <typename U, typename... KwArgs>
     void finalise_ctor(U sys, std::vector<T> states, std::uint32_t batch_size, KwArgs &&... kw_args)
     {
@@ -515,6 +1051,9 @@ class HEYOKA_DLL_PUBLIC taylor_adaptive_batch_impl
             static_assert(detail::always_false_v<KwArgs...>,
                           "The variadic arguments in the construction of an adaptive batch Taylor integrator contain "
                           "unnamed arguments.");
+        } else if constexpr (p.has(kw::t_events) || p.has(kw::nt_events)) {
+            static_assert(detail::always_false_v<KwArgs...>,
+                          "Events are not supported in the adaptive batch Taylor integrator.");
         } else {
             // Initial times (defaults to a vector of zeroes).
             auto times = [&p, batch_size]() -> std::vector<T> {
@@ -525,11 +1064,37 @@ class HEYOKA_DLL_PUBLIC taylor_adaptive_batch_impl
                 }
             }();
 
-            const auto [high_accuracy, tol, compact_mode]
+            auto [high_accuracy, tol, compact_mode, object_file, dense_output, pars, atol, rtol, tol_exclude,
+                  variable_order]
                 = taylor_adaptive_common_ops<T>(std::forward<KwArgs>(kw_args)...);
 
+            // Per-lane tolerances (defaults to empty, meaning that
+            // tol is used for all the batch elements). If provided,
+            // each batch element uses the Taylor order determined by
+            // its own tolerance, while the jet is computed at the
+            // maximum order, and tol is ignored.
+            auto lane_tols = [&p]() -> std::vector<T> {
+                if constexpr (p.has(kw::lane_tols)) {
+                    return std::forward<decltype(p(kw::lane_tols))>(p(kw::lane_tols));
+                } else {
+                    return {};
+                }
+            }();
+
+            // Memory layout of the state vectors (defaults to soa).
+            // In the aos layout, the stepper and the dense output function
+            // operate in place on [batch_idx][var_idx] data.
+            auto layout = [&p]() -> taylor_layout {
+                if constexpr (p.has(kw::layout)) {
+                    return p(kw::layout);
+                } else {
+                    return taylor_layout::soa;
+                }
+            }();
+
             finalise_ctor_impl(std::move(sys), std::move(states), batch_size, std::move(times), tol, high_accuracy,
-                               compact_mode);
+                               compact_mode, object_file, dense_output, std::move(pars), std::move(atol),
+                               std::move(rtol), tol_exclude, variable_order, std::move(lane_tols), layout);
         }
     }
 
@@ -548,6 +1113,9 @@ public:
     {
         finalise_ctor(std::move(sys), std::move(states), batch_size, std::forward<KwArgs>(kw_args)...);
     }
+    // Restore an integrator from a checkpoint written by save()
+    // (see the scalar integrator).
+    explicit taylor_adaptive_batch_impl(std::istream &);
 
     taylor_adaptive_batch_impl(const taylor_adaptive_batch_impl &);
     taylor_adaptive_batch_impl(taylor_adaptive_batch_impl &&) noexcept;
@@ -557,10 +1125,22 @@ public:
 
     ~taylor_adaptive_batch_impl();
 
+    void save(std::ostream &) const;
+
     const llvm_state &get_llvm_state() const;
 
     const std::vector<expression> &get_decomposition() const;
 
+    const taylor_compile_report &get_compile_report() const;
+
+    std::uint32_t get_batch_size() const
+    {
+        return m_batch_size;
+    }
+    taylor_layout get_layout() const
+    {
+        return m_layout;
+    }
     const std::vector<T> &get_times() const
     {
         return m_times;
@@ -569,29 +1149,124 @@ public:
     {
         return m_times.data();
     }
-    T *get_times_data()
+    std::pair<const std::vector<T> &, const std::vector<T> &> get_dtimes() const
     {
-        return m_times.data();
+        return {m_times, m_times_lo};
+    }
+    // NOTE: the number of state variables
+    // (for each batch element).
+    std::size_t get_dim() const
+    {
+        return m_states.size() / m_batch_size;
     }
     const std::vector<T> &get_states() const
     {
+        if (m_ext_states != nullptr) {
+            throw std::invalid_argument("Cannot fetch the state vectors of an adaptive batch Taylor integrator while "
+                                        "an external state buffer is attached (use get_states_data() instead)");
+        }
+
         return m_states;
     }
+    // NOTE: if an external state buffer is attached,
+    // these return a pointer to it.
     const T *get_states_data() const
     {
-        return m_states.data();
+        return m_ext_states == nullptr ? m_states.data() : m_ext_states;
     }
     T *get_states_data()
     {
-        return m_states.data();
+        return m_ext_states == nullptr ? m_states.data() : m_ext_states;
+    }
+    // NOTE: the values of the runtime parameters
+    // are laid out as [par_idx][batch_idx].
+    const std::vector<T> &get_pars() const
+    {
+        return m_pars;
+    }
+    const T *get_pars_data() const
+    {
+        return m_pars.data();
+    }
+    T *get_pars_data()
+    {
+        return m_pars.data();
     }
 
     void set_states(const std::vector<T> &);
     void set_times(const std::vector<T> &);
+    // NOTE: these set the state and the time of a single batch
+    // element, leaving the other batch elements untouched.
+    void set_lane_state(std::uint32_t, const std::vector<T> &);
+    void set_lane_time(std::uint32_t, T);
+    // NOTE: set the time of a single batch element in double-length
+    // format, as the unevaluated sum of the last two arguments.
+    void set_lane_dtime(std::uint32_t, T, T);
+
+    // NOTE: the external state buffer is laid out
+    // like the internal state vectors, that is, as [var_idx][batch_idx]
+    // in the soa layout and as [batch_idx][var_idx] in the aos layout.
+    void attach_states(T *);
+    void detach_states();
+    bool has_ext_states() const
+    {
+        return m_ext_states != nullptr;
+    }
+
+    T get_tol() const
+    {
+        return m_tol;
+    }
+    // NOTE: with per-lane tolerances, this is
+    // the maximum among the orders of the batch elements.
+    std::uint32_t get_order() const
+    {
+        return m_order;
+    }
+    const std::vector<std::uint32_t> &get_lane_orders() const
+    {
+        return m_lane_orders;
+    }
+    const std::vector<T> &get_lane_tols() const
+    {
+        return m_lane_tols;
+    }
+    // NOTE: this may be lower than get_order()
+    // if variable order is enabled.
+    std::uint32_t get_last_order() const
+    {
+        return m_last_order;
+    }
+    // NOTE: the Taylor coefficients are laid out
+    // as [var_idx][order][batch_idx].
+    const std::vector<T> &get_tc() const
+    {
+        return m_tc;
+    }
+    // NOTE: the dense output is laid
+    // out like the state vectors.
+    const std::vector<T> &get_d_output() const
+    {
+        return m_d_out;
+    }
+    const std::vector<T> &update_d_output(const std::vector<T> &);
 
     void step(std::vector<std::tuple<taylor_outcome, T>> &);
     void step_backward(std::vector<std::tuple<taylor_outcome, T>> &);
     void step(std::vector<std::tuple<taylor_outcome, T>> &, const std::vector<T> &);
+
+    // NOTE: the propagate functions write to the first argument,
+    // for each batch element, the outcome of the integration, the min/max
+    // absolute values of the timesteps and the number of steps taken.
+    void propagate_for(std::vector<std::tuple<taylor_outcome, T, T, std::size_t>> &, const std::vector<T> &,
+                       std::size_t = 0);
+    void propagate_until(std::vector<std::tuple<taylor_outcome, T, T, std::size_t>> &, const std::vector<T> &,
+                         std::size_t = 0);
+    // NOTE: the time grid is laid out as [point_idx][batch_idx],
+    // the return value as [point_idx][var_idx][batch_idx]
+    // (or [point_idx][batch_idx][var_idx] in the aos layout).
+    std::vector<T> propagate_grid(std::vector<std::tuple<taylor_outcome, T, T, std::size_t>> &, const std::vector<T> &,
+                                  std::size_t = 0);
 };
 
 } // namespace detail
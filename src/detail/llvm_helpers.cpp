@@ -40,7 +40,8 @@ namespace heyoka::detail
 
 // Helper to load the data from pointer ptr as a vector of size vector_size. If vector_size is
 // 1, a scalar is loaded instead.
-llvm::Value *load_vector_from_memory(llvm::IRBuilder<> &builder, llvm::Value *ptr, std::uint32_t vector_size)
+llvm::Value *load_vector_from_memory(llvm::IRBuilder<> &builder, llvm::Value *ptr, std::uint32_t vector_size,
+                                     std::uint32_t stride)
 {
     assert(vector_size > 0u);
     assert(llvm::isa<llvm::PointerType>(ptr->getType()));
@@ -72,17 +73,20 @@ llvm::Value *load_vector_from_memory(llvm::IRBuilder<> &builder, llvm::Value *pt
     auto ret = static_cast<llvm::Value *>(llvm::UndefValue::get(vector_t));
 
     // Fill it.
+    // NOTE: with a stride greater than one, this is a gather
+    // (which the backend may turn into wide loads and shuffles).
     for (std::uint32_t i = 0; i < vector_size; ++i) {
-        ret = builder.CreateInsertElement(ret,
-                                          builder.CreateLoad(builder.CreateInBoundsGEP(ptr, {builder.getInt32(i)})), i);
+        ret = builder.CreateInsertElement(
+            ret, builder.CreateLoad(builder.CreateInBoundsGEP(ptr, {builder.getInt32(i * stride)})), i);
     }
 
     return ret;
 }
 
 // Helper to store the content of vector vec to the pointer ptr. If vec is not a vector,
-// a plain store will be performed.
-void store_vector_to_memory(llvm::IRBuilder<> &builder, llvm::Value *ptr, llvm::Value *vec)
+// a plain store will be performed. The elements of vec are stored
+// stride elements apart from each other (i.e., a scatter if stride > 1).
+void store_vector_to_memory(llvm::IRBuilder<> &builder, llvm::Value *ptr, llvm::Value *vec, std::uint32_t stride)
 {
     if (auto v_ptr_t = llvm::dyn_cast<llvm::VectorType>(vec->getType())) {
         // Determine the vector size.
@@ -90,7 +94,7 @@ void store_vector_to_memory(llvm::IRBuilder<> &builder, llvm::Value *ptr, llvm::
 
         for (std::uint32_t i = 0; i < vector_size; ++i) {
             builder.CreateStore(builder.CreateExtractElement(vec, i),
-                                builder.CreateInBoundsGEP(ptr, {builder.getInt32(i)}));
+                                builder.CreateInBoundsGEP(ptr, {builder.getInt32(i * stride)}));
         }
     } else {
         // Not a vector, store vec directly.
@@ -349,10 +353,15 @@ llvm::Value *llvm_invoke_internal(llvm_state &s, const std::string &name, const
 //
 // for (auto i = begin; i < end; ++i) {
 //   body(i);
+//   if (!cont(i)) {
+//     break;
+//   }
 // }
 //
-// begin/end must be 32-bit unsigned integer values.
-void llvm_loop_u32(llvm_state &s, llvm::Value *begin, llvm::Value *end, const std::function<void(llvm::Value *)> &body)
+// begin/end must be 32-bit unsigned integer values. cont is optional,
+// and, if provided, it must return a boolean value.
+void llvm_loop_u32(llvm_state &s, llvm::Value *begin, llvm::Value *end, const std::function<void(llvm::Value *)> &body,
+                   const std::function<llvm::Value *(llvm::Value *)> &cont)
 {
     assert(begin->getType() == end->getType());
     assert(begin->getType() == s.builder().getInt32Ty());
@@ -389,9 +398,16 @@ void llvm_loop_u32(llvm_state &s, llvm::Value *begin, llvm::Value *end, const st
     auto cur = builder.CreatePHI(builder.getInt32Ty(), 2);
     cur->addIncoming(begin, preheader_bb);
 
-    // Execute the loop body.
+    // Execute the loop body and, if needed,
+    // compute the early exit condition.
+    llvm::Value *cont_cond = nullptr;
     try {
         body(cur);
+
+        if (cont) {
+            cont_cond = cont(cur);
+            assert(cont_cond->getType() == builder.getInt1Ty());
+        }
     } catch (...) {
         // NOTE: at this point after_bb has not been
         // inserted into any parent, and thus it will not
@@ -408,6 +424,9 @@ void llvm_loop_u32(llvm_state &s, llvm::Value *begin, llvm::Value *end, const st
     // Compute the end condition.
     // NOTE: we use the unsigned less-than predicate.
     auto end_cond = builder.CreateICmp(llvm::CmpInst::ICMP_ULT, next, end);
+    if (cont_cond != nullptr) {
+        end_cond = builder.CreateAnd(end_cond, cont_cond);
+    }
 
     // Get a reference to the current block for later use,
     // and insert the "after loop" block.
@@ -424,6 +443,72 @@ void llvm_loop_u32(llvm_state &s, llvm::Value *begin, llvm::Value *end, const st
     cur->addIncoming(next, loop_end_bb);
 }
 
+// Create an LLVM if statement in the form:
+//
+// if (cond) {
+//   then_f();
+// } else {
+//   else_f();
+// }
+//
+// cond must be a boolean value.
+void llvm_if_then_else(llvm_state &s, llvm::Value *cond, const std::function<void()> &then_f,
+                       const std::function<void()> &else_f)
+{
+    auto &context = s.context();
+    auto &builder = s.builder();
+
+    assert(cond->getType() == builder.getInt1Ty());
+
+    // Fetch the current function.
+    assert(builder.GetInsertBlock() != nullptr);
+    auto f = builder.GetInsertBlock()->getParent();
+    assert(f != nullptr);
+
+    // Create and insert the "then" block, and pre-create
+    // the "else" and merge blocks.
+    auto *then_bb = llvm::BasicBlock::Create(context, "", f);
+    auto *else_bb = llvm::BasicBlock::Create(context);
+    auto *merge_bb = llvm::BasicBlock::Create(context);
+
+    // Create the conditional jump.
+    builder.CreateCondBr(cond, then_bb, else_bb);
+
+    // Emit the code for the "then" branch.
+    builder.SetInsertPoint(then_bb);
+    try {
+        then_f();
+    } catch (...) {
+        // NOTE: the blocks which have not been inserted
+        // yet need to be cleaned up manually.
+        else_bb->deleteValue();
+        merge_bb->deleteValue();
+
+        throw;
+    }
+
+    // Jump to the merge block.
+    builder.CreateBr(merge_bb);
+
+    // Emit the code for the "else" branch.
+    f->getBasicBlockList().push_back(else_bb);
+    builder.SetInsertPoint(else_bb);
+    try {
+        else_f();
+    } catch (...) {
+        merge_bb->deleteValue();
+
+        throw;
+    }
+
+    // Jump to the merge block.
+    builder.CreateBr(merge_bb);
+
+    // Any new code will be inserted in merge_bb.
+    f->getBasicBlockList().push_back(merge_bb);
+    builder.SetInsertPoint(merge_bb);
+}
+
 // Given an input pointer value, return the
 // pointed-to type.
 llvm::Type *pointee_type(llvm::Value *ptr)
@@ -0,0 +1,418 @@
+// Copyright 2020 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <heyoka/config.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <future>
+#include <limits>
+#include <stdexcept>
+#include <thread>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+#include <mp++/real128.hpp>
+
+#endif
+
+#include <heyoka/detail/dfloat.hpp>
+#include <heyoka/detail/math_wrappers.hpp>
+#include <heyoka/ensemble_propagate.hpp>
+#include <heyoka/taylor.hpp>
+
+namespace heyoka
+{
+
+namespace detail
+{
+
+namespace
+{
+
+// Determine the number of worker threads
+// to be used for the processing of n_chunks
+// chunks of work.
+unsigned ensemble_n_workers(unsigned n_threads, std::size_t n_chunks)
+{
+    if (n_threads == 0u) {
+        n_threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    return static_cast<unsigned>(std::min(static_cast<std::size_t>(n_threads), n_chunks));
+}
+
+// Process the chunks of work [0, n_chunks) with n_workers worker threads.
+// The workers pull the index of the next chunk from a shared atomic
+// counter, so that the load is balanced dynamically even if the
+// propagation times of the chunks differ widely. f will be invoked
+// as f(worker_idx, chunk_idx).
+// NOTE: this is used in place of a work-stealing thread pool. As the
+// chunks are claimed one at a time from a single shared counter, a worker
+// never holds a backlog of chunks that the other workers would need to
+// steal, and the balancing is the same without per-worker queues. The
+// worker threads are spawned anew (via std::async()) in each call.
+template <typename F>
+void ensemble_run(unsigned n_workers, std::size_t n_chunks, const F &f)
+{
+    std::atomic<std::size_t> counter{0};
+    // NOTE: the stop flag is used to terminate
+    // the other workers early if a worker throws.
+    std::atomic<bool> stop{false};
+
+    auto worker = [&counter, &stop, &f, n_chunks](unsigned w) {
+        try {
+            while (!stop.load(std::memory_order_relaxed)) {
+                const auto c = counter.fetch_add(1, std::memory_order_relaxed);
+                if (c >= n_chunks) {
+                    break;
+                }
+
+                f(w, c);
+            }
+        } catch (...) {
+            stop.store(true, std::memory_order_relaxed);
+            throw;
+        }
+    };
+
+    std::vector<std::future<void>> futs;
+    futs.reserve(n_workers);
+
+    try {
+        for (unsigned w = 0; w < n_workers; ++w) {
+            futs.push_back(std::async(std::launch::async, worker, w));
+        }
+    } catch (...) {
+        // NOTE: if the creation of a worker fails, stop
+        // the workers already running and wait for them
+        // before re-throwing.
+        stop.store(true, std::memory_order_relaxed);
+        for (auto &fut : futs) {
+            fut.wait();
+        }
+
+        throw;
+    }
+
+    // NOTE: wait for all the workers to finish before
+    // re-throwing the first exception (if any).
+    for (auto &fut : futs) {
+        fut.wait();
+    }
+    for (auto &fut : futs) {
+        fut.get();
+    }
+}
+
+template <typename T>
+void ensemble_check_args(T t, const ensemble_generator_t<T> &gen)
+{
+    if (!detail::isfinite(t)) {
+        throw std::invalid_argument("A non-finite time was passed to ensemble_propagate_until()");
+    }
+
+    if (!gen) {
+        throw std::invalid_argument("An empty generator was passed to ensemble_propagate_until()");
+    }
+}
+
+template <typename T>
+ensemble_res_t<T> ensemble_propagate_until_impl(const taylor_adaptive<T> &ta, T t, std::size_t n_iter,
+                                                const ensemble_generator_t<T> &gen, unsigned n_threads,
+                                                std::size_t max_steps)
+{
+    ensemble_check_args(t, gen);
+
+    const auto n_eq = ta.get_dim();
+    if (n_iter > std::numeric_limits<std::size_t>::max() / n_eq) {
+        throw std::overflow_error("Overflow detected in the number of instances of an ensemble propagation");
+    }
+
+    std::vector<T> states(n_iter * n_eq);
+    std::vector<std::tuple<taylor_outcome, T, T, std::size_t>> stats(n_iter);
+
+    if (n_iter == 0u) {
+        return ensemble_res_t<T>{std::move(states), std::move(stats)};
+    }
+
+    const auto n_workers = ensemble_n_workers(n_threads, n_iter);
+
+    // NOTE: each worker operates on its own copy of ta, created
+    // here in the calling thread. The copies share the compiled code
+    // with ta (see the copy constructor of llvm_state).
+    std::vector<taylor_adaptive<T>> tas(n_workers, ta);
+    std::vector<std::vector<T>> bufs(n_workers, std::vector<T>(n_eq));
+
+    // NOTE: with events, each instance restarts from a copy of ta, so that
+    // the internal state of the events (e.g., the cooldowns) is reset.
+    const auto has_events = !ta.get_t_events().empty() || !ta.get_nt_events().empty();
+
+    ensemble_run(n_workers, n_iter, [&](unsigned w, std::size_t i) {
+        auto &ta_w = tas[w];
+        auto &buf = bufs[w];
+
+        if (has_events) {
+            ta_w = ta;
+        } else {
+            // NOTE: copy the time in double-length format,
+            // so that the instances start exactly at the time of ta.
+            const auto [t_hi, t_lo] = ta.get_dtime();
+            ta_w.set_dtime(t_hi, t_lo);
+            std::copy(ta.get_pars().begin(), ta.get_pars().end(), ta_w.get_pars_data());
+        }
+
+        gen(i, buf.data(), ta_w.get_pars_data());
+        ta_w.set_state(buf);
+
+        stats[i] = ta_w.propagate_until(t, max_steps);
+
+        std::copy(ta_w.get_state_data(), ta_w.get_state_data() + n_eq, states.data() + i * n_eq);
+    });
+
+    return ensemble_res_t<T>{std::move(states), std::move(stats)};
+}
+
+template <typename T>
+ensemble_res_t<T> ensemble_propagate_until_impl(const taylor_adaptive_batch<T> &ta, T t, std::size_t n_iter,
+                                                const ensemble_generator_t<T> &gen, unsigned n_threads,
+                                                std::size_t max_steps)
+{
+    ensemble_check_args(t, gen);
+
+    const auto batch_size = ta.get_batch_size();
+    const auto n_eq = ta.get_dim();
+    const auto n_pars = ta.get_pars().size() / batch_size;
+    const auto &times = ta.get_times();
+    const auto &times_lo = ta.get_dtimes().second;
+
+    if (std::any_of(times.begin(), times.end(), [&times](const auto &x) { return x != times[0]; })
+        || std::any_of(times_lo.begin(), times_lo.end(), [&times_lo](const auto &x) { return x != times_lo[0]; })) {
+        throw std::invalid_argument("The batch elements of the template integrator passed to "
+                                    "ensemble_propagate_until() must all be at the same time");
+    }
+
+    if (n_iter > std::numeric_limits<std::size_t>::max() / n_eq) {
+        throw std::overflow_error("Overflow detected in the number of instances of an ensemble propagation");
+    }
+
+    std::vector<T> states(n_iter * n_eq);
+    std::vector<std::tuple<taylor_outcome, T, T, std::size_t>> stats(n_iter);
+
+    if (n_iter == 0u) {
+        return ensemble_res_t<T>{std::move(states), std::move(stats)};
+    }
+
+    // NOTE: the instances are not statically packed into chunks of batch_size
+    // instances. Rather, each worker keeps a queue of pending instances (shared
+    // among the workers), and as soon as a batch element finishes its propagation
+    // (because it reached the final time, the max number of steps or a non-finite
+    // state), it is refilled with the next pending instance. This way, all the batch
+    // elements are kept busy until the queue drains, even if the propagation
+    // times of the instances differ widely.
+    const auto n_batches = n_iter / batch_size + static_cast<std::size_t>(n_iter % batch_size != 0u);
+    const auto n_workers = ensemble_n_workers(n_threads, n_batches);
+
+    std::vector<taylor_adaptive_batch<T>> tas(n_workers, ta);
+
+    // The queue of pending instances.
+    std::atomic<std::size_t> next_inst{0};
+    // NOTE: this flag is used to drain the queue
+    // early if a worker throws.
+    std::atomic<bool> failed{false};
+
+    const detail::dfloat<T> d_t(t);
+    // NOTE: the instances start from the
+    // double-length time of ta.
+    const detail::dfloat<T> d_t0(times[0], times_lo[0]);
+
+    ensemble_run(n_workers, n_workers, [&](unsigned w, std::size_t) {
+        auto &ta_w = tas[w];
+
+        std::vector<T> s_buf(n_eq), p_buf(n_pars), max_delta_ts(batch_size);
+        std::vector<std::tuple<taylor_outcome, T>> step_res;
+
+        // The instance assigned to each batch element
+        // (n_iter if the batch element is idle) and its stats.
+        std::vector<std::size_t> lane_inst(batch_size, n_iter);
+        std::vector<std::tuple<taylor_outcome, T, T, std::size_t>> lane_stats(batch_size);
+
+        auto *p_ptr = ta_w.get_pars_data();
+
+        // Record the result of the instance in the batch element j
+        // and refill the batch element with the next pending instance.
+        // NOTE: if the final time coincides with the initial time,
+        // an instance completes immediately.
+        auto finish = [&](std::uint32_t j) {
+            while (true) {
+                if (lane_inst[j] != n_iter) {
+                    const auto i = lane_inst[j];
+                    const auto *s_ptr = ta_w.get_states_data();
+
+                    for (decltype(s_buf.size()) k = 0; k < n_eq; ++k) {
+                        states[i * n_eq + k] = ta_w.get_layout() == taylor_layout::aos ? s_ptr[j * n_eq + k]
+                                                                                         : s_ptr[k * batch_size + j];
+                    }
+                    stats[i] = lane_stats[j];
+                }
+
+                const auto i = failed.load(std::memory_order_relaxed)
+                                   ? n_iter
+                                   : std::min(next_inst.fetch_add(1, std::memory_order_relaxed), n_iter);
+                lane_inst[j] = i;
+
+                if (i == n_iter) {
+                    break;
+                }
+
+                for (decltype(p_buf.size()) k = 0; k < n_pars; ++k) {
+                    p_buf[k] = ta.get_pars()[k * batch_size + j];
+                }
+
+                gen(i, s_buf.data(), p_buf.data());
+
+                for (decltype(p_buf.size()) k = 0; k < n_pars; ++k) {
+                    p_ptr[k * batch_size + j] = p_buf[k];
+                }
+
+                ta_w.set_lane_state(j, s_buf);
+                ta_w.set_lane_dtime(j, d_t0.hi, d_t0.lo);
+
+                if (d_t != d_t0) {
+                    lane_stats[j] = std::tuple{taylor_outcome::success, std::numeric_limits<T>::infinity(), T(0),
+                                               std::size_t(0)};
+                    break;
+                }
+
+                lane_stats[j] = std::tuple{taylor_outcome::time_limit, std::numeric_limits<T>::infinity(), T(0),
+                                           std::size_t(0)};
+            }
+        };
+
+        try {
+            for (std::uint32_t j = 0; j < batch_size; ++j) {
+                finish(j);
+            }
+
+            while (std::any_of(lane_inst.begin(), lane_inst.end(), [n_iter](auto i) { return i != n_iter; })) {
+                // Setup the max timesteps.
+                // NOTE: the idle batch elements are
+                // stepped with a max timestep of zero.
+                const auto &[hi, lo] = ta_w.get_dtimes();
+                for (std::uint32_t j = 0; j < batch_size; ++j) {
+                    max_delta_ts[j] = lane_inst[j] == n_iter
+                                          ? T(0)
+                                          : static_cast<T>(d_t - detail::dfloat<T>(hi[j], lo[j]));
+                }
+
+                ta_w.step(step_res, max_delta_ts);
+
+                for (std::uint32_t j = 0; j < batch_size; ++j) {
+                    if (lane_inst[j] == n_iter) {
+                        continue;
+                    }
+
+                    auto &[oc, min_h, max_h, n_steps] = lane_stats[j];
+                    const auto [s_oc, h] = step_res[j];
+
+                    if (s_oc == taylor_outcome::err_nf_state) {
+                        oc = taylor_outcome::err_nf_state;
+                        finish(j);
+                        continue;
+                    }
+
+                    ++n_steps;
+
+                    if (s_oc == taylor_outcome::time_limit) {
+                        // The final time was reached. The last
+                        // timestep is not used to update min_h/max_h.
+                        oc = taylor_outcome::time_limit;
+                        finish(j);
+                        continue;
+                    }
+
+                    using std::abs;
+
+                    min_h = std::min(min_h, abs(h));
+                    max_h = std::max(max_h, abs(h));
+
+                    if (max_steps != 0u && n_steps == max_steps) {
+                        oc = taylor_outcome::step_limit;
+                        finish(j);
+                    }
+                }
+            }
+        } catch (...) {
+            failed.store(true, std::memory_order_relaxed);
+            throw;
+        }
+    });
+
+    return ensemble_res_t<T>{std::move(states), std::move(stats)};
+}
+
+} // namespace
+
+} // namespace detail
+
+ensemble_res_t<double> ensemble_propagate_until_dbl(const taylor_adaptive_dbl &ta, double t, std::size_t n_iter,
+                                                    const ensemble_generator_t<double> &gen, unsigned n_threads,
+                                                    std::size_t max_steps)
+{
+    return detail::ensemble_propagate_until_impl<double>(ta, t, n_iter, gen, n_threads, max_steps);
+}
+
+ensemble_res_t<long double> ensemble_propagate_until_ldbl(const taylor_adaptive_ldbl &ta, long double t,
+                                                          std::size_t n_iter,
+                                                          const ensemble_generator_t<long double> &gen,
+                                                          unsigned n_threads, std::size_t max_steps)
+{
+    return detail::ensemble_propagate_until_impl<long double>(ta, t, n_iter, gen, n_threads, max_steps);
+}
+
+ensemble_res_t<double> ensemble_propagate_until_dbl(const taylor_adaptive_batch_dbl &ta, double t,
+                                                    std::size_t n_iter, const ensemble_generator_t<double> &gen,
+                                                    unsigned n_threads, std::size_t max_steps)
+{
+    return detail::ensemble_propagate_until_impl<double>(ta, t, n_iter, gen, n_threads, max_steps);
+}
+
+ensemble_res_t<long double> ensemble_propagate_until_ldbl(const taylor_adaptive_batch_ldbl &ta, long double t,
+                                                          std::size_t n_iter,
+                                                          const ensemble_generator_t<long double> &gen,
+                                                          unsigned n_threads, std::size_t max_steps)
+{
+    return detail::ensemble_propagate_until_impl<long double>(ta, t, n_iter, gen, n_threads, max_steps);
+}
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+ensemble_res_t<mppp::real128> ensemble_propagate_until_f128(const taylor_adaptive_f128 &ta, mppp::real128 t,
+                                                            std::size_t n_iter,
+                                                            const ensemble_generator_t<mppp::real128> &gen,
+                                                            unsigned n_threads, std::size_t max_steps)
+{
+    return detail::ensemble_propagate_until_impl<mppp::real128>(ta, t, n_iter, gen, n_threads, max_steps);
+}
+
+ensemble_res_t<mppp::real128> ensemble_propagate_until_f128(const taylor_adaptive_batch_f128 &ta, mppp::real128 t,
+                                                            std::size_t n_iter,
+                                                            const ensemble_generator_t<mppp::real128> &gen,
+                                                            unsigned n_threads, std::size_t max_steps)
+{
+    return detail::ensemble_propagate_until_impl<mppp::real128>(ta, t, n_iter, gen, n_threads, max_steps);
+}
+
+#endif
+
+} // namespace heyoka
@@ -8,9 +8,12 @@
 
 #include <heyoka/config.hpp>
 
+#include <algorithm>
+#include <cassert>
 #include <cmath>
 #include <cstddef>
 #include <cstdint>
+#include <limits>
 #include <ostream>
 #include <sstream>
 #include <stdexcept>
@@ -30,12 +33,14 @@
 #endif
 
 #include <heyoka/binary_operator.hpp>
+#include <heyoka/detail/llvm_helpers.hpp>
 #include <heyoka/detail/math_wrappers.hpp>
 #include <heyoka/detail/type_traits.hpp>
 #include <heyoka/expression.hpp>
 #include <heyoka/function.hpp>
 #include <heyoka/llvm_state.hpp>
 #include <heyoka/number.hpp>
+#include <heyoka/param.hpp>
 #include <heyoka/variable.hpp>
 
 namespace heyoka
@@ -49,6 +54,8 @@ expression::expression(binary_operator bo) : m_value(std::move(bo)) {}
 
 expression::expression(function f) : m_value(std::move(f)) {}
 
+expression::expression(param p) : m_value(std::move(p)) {}
+
 expression::expression(const expression &) = default;
 
 expression::expression(expression &&) noexcept = default;
@@ -102,6 +109,16 @@ expression operator""_var(const char *s, std::size_t n)
 namespace detail
 {
 
+expression par_impl::operator[](std::uint32_t idx) const
+{
+    return expression{param{idx}};
+}
+
+} // namespace detail
+
+namespace detail
+{
+
 prime_wrapper::prime_wrapper(std::string s) : m_str(std::move(s)) {}
 
 prime_wrapper::prime_wrapper(const prime_wrapper &) = default;
@@ -158,6 +175,39 @@ void rename_variables(expression &e, const std::unordered_map<std::string, std::
     std::visit([&repl_map](auto &arg) { rename_variables(arg, repl_map); }, e.value());
 }
 
+// Determine the size of the array of parameter values
+// needed to evaluate the expression e (i.e., the largest
+// parameter index appearing in e plus one, or zero if
+// e does not contain any parameter).
+std::uint32_t get_param_size(const expression &e)
+{
+    return std::visit(
+        [](const auto &v) -> std::uint32_t {
+            using type = detail::uncvref_t<decltype(v)>;
+
+            if constexpr (std::is_same_v<type, param>) {
+                if (v.idx() == std::numeric_limits<std::uint32_t>::max()) {
+                    throw std::overflow_error("Overflow detected in the computation of the size of a parameter array");
+                }
+
+                return v.idx() + 1u;
+            } else if constexpr (std::is_same_v<type, binary_operator>) {
+                return std::max(get_param_size(v.lhs()), get_param_size(v.rhs()));
+            } else if constexpr (std::is_same_v<type, function>) {
+                std::uint32_t retval = 0;
+
+                for (const auto &arg : v.args()) {
+                    retval = std::max(retval, get_param_size(arg));
+                }
+
+                return retval;
+            } else {
+                return 0;
+            }
+        },
+        e.value());
+}
+
 void swap(expression &ex0, expression &ex1) noexcept
 {
     std::swap(ex0.value(), ex1.value());
@@ -565,6 +615,11 @@ llvm::Value *taylor_diff_impl(llvm_state &s, const expression &ex, const std::ve
 
             if constexpr (std::is_same_v<type, binary_operator> || std::is_same_v<type, function>) {
                 return taylor_diff<T>(s, v, arr, n_uvars, order, idx, batch_size);
+            } else if constexpr (std::is_same_v<type, param>) {
+                // NOTE: parameters are constant, all their
+                // derivatives of order >= 1 are zero.
+                assert(order > 0u);
+                return vector_splat(s.builder(), codegen<T>(s, number{0.}), batch_size);
             } else {
                 throw std::invalid_argument(
                     "Taylor derivatives can be computed only for binary operators or functions");
@@ -635,6 +690,10 @@ llvm::Value *taylor_c_diff_impl(llvm_state &s, const expression &ex, llvm::Value
 
             if constexpr (std::is_same_v<type, binary_operator> || std::is_same_v<type, function>) {
                 return taylor_c_diff<T>(s, v, arr, n_uvars, order, idx, batch_size);
+            } else if constexpr (std::is_same_v<type, param>) {
+                // NOTE: the order is a runtime value in compact mode,
+                // but it is guaranteed to be at least one here.
+                return vector_splat(s.builder(), codegen<T>(s, number{0.}), batch_size);
             } else {
                 throw std::invalid_argument(
                     "Taylor derivatives in compact mode can be computed only for binary operators or functions");
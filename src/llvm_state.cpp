@@ -9,10 +9,13 @@
 #include <heyoka/config.hpp>
 
 #include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <chrono>
 #include <cstdint>
 #include <fstream>
 #include <functional>
+#include <future>
 #include <initializer_list>
 #include <ios>
 #include <iterator>
@@ -24,10 +27,12 @@
 #include <stdexcept>
 #include <string>
 #include <system_error>
+#include <thread>
 #include <tuple>
 #include <type_traits>
 #include <typeindex>
 #include <typeinfo>
+#include <unordered_map>
 #include <utility>
 #include <variant>
 #include <vector>
@@ -35,16 +40,23 @@
 #include <boost/filesystem.hpp>
 
 #include <llvm/ADT/SmallString.h>
+#include <llvm/ADT/StringExtras.h>
 #include <llvm/ADT/Triple.h>
+#include <llvm/BinaryFormat/Magic.h>
 #include <llvm/Analysis/TargetLibraryInfo.h>
 #include <llvm/Analysis/TargetTransformInfo.h>
-#include <llvm/CodeGen/TargetPassConfig.h>
+#include <llvm/Bitcode/BitcodeReader.h>
+#include <llvm/Bitcode/BitcodeWriter.h>
 #include <llvm/Config/llvm-config.h>
 #include <llvm/ExecutionEngine/JITSymbol.h>
+#include <llvm/ExecutionEngine/Orc/CompileOnDemandLayer.h>
 #include <llvm/ExecutionEngine/Orc/CompileUtils.h>
 #include <llvm/ExecutionEngine/Orc/Core.h>
 #include <llvm/ExecutionEngine/Orc/ExecutionUtils.h>
 #include <llvm/ExecutionEngine/Orc/IRCompileLayer.h>
+#include <llvm/ExecutionEngine/Orc/IRTransformLayer.h>
+#include <llvm/ExecutionEngine/Orc/IndirectionUtils.h>
+#include <llvm/ExecutionEngine/Orc/LazyReexports.h>
 #include <llvm/ExecutionEngine/Orc/JITTargetMachineBuilder.h>
 #include <llvm/ExecutionEngine/Orc/RTDyldObjectLinkingLayer.h>
 #include <llvm/ExecutionEngine/Orc/ThreadSafeModule.h>
@@ -54,31 +66,38 @@
 #include <llvm/IR/DataLayout.h>
 #include <llvm/IR/DerivedTypes.h>
 #include <llvm/IR/Function.h>
+#include <llvm/IR/GlobalValue.h>
 #include <llvm/IR/IRBuilder.h>
 #include <llvm/IR/InstrTypes.h>
+#include <llvm/IR/Instructions.h>
+#include <llvm/IR/Intrinsics.h>
 #include <llvm/IR/LLVMContext.h>
 #include <llvm/IR/LegacyPassManager.h>
 #include <llvm/IR/Module.h>
 #include <llvm/IR/Operator.h>
+#include <llvm/IR/PassInstrumentation.h>
+#include <llvm/IR/PassManager.h>
 #include <llvm/IR/Type.h>
 #include <llvm/IR/Value.h>
 #include <llvm/IR/Verifier.h>
 #include <llvm/IRReader/IRReader.h>
+#include <llvm/Object/Archive.h>
+#include <llvm/Object/ArchiveWriter.h>
+#include <llvm/Passes/PassBuilder.h>
 #include <llvm/Support/CodeGen.h>
+#include <llvm/Support/Error.h>
 #include <llvm/Support/FileSystem.h>
 #include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/SHA1.h>
 #include <llvm/Support/SourceMgr.h>
 #include <llvm/Support/TargetRegistry.h>
 #include <llvm/Support/TargetSelect.h>
 #include <llvm/Support/raw_ostream.h>
 #include <llvm/Target/TargetMachine.h>
-#include <llvm/Transforms/IPO.h>
-#include <llvm/Transforms/IPO/PassManagerBuilder.h>
 #include <llvm/Transforms/InstCombine/InstCombine.h>
-#include <llvm/Transforms/Scalar.h>
-#include <llvm/Transforms/Scalar/GVN.h>
-#include <llvm/Transforms/Utils.h>
-#include <llvm/Transforms/Vectorize.h>
+#include <llvm/Transforms/Utils/Cloning.h>
+#include <llvm/Transforms/Utils/SplitModule.h>
+#include <llvm/Transforms/Vectorize/LoadStoreVectorizer.h>
 
 #if LLVM_VERSION_MAJOR == 10
 
@@ -98,6 +117,7 @@
 
 #include <heyoka/detail/llvm_helpers.hpp>
 #include <heyoka/detail/string_conv.hpp>
+#include <heyoka/detail/type_traits.hpp>
 #include <heyoka/expression.hpp>
 #include <heyoka/llvm_state.hpp>
 #include <heyoka/number.hpp>
@@ -192,12 +212,10 @@ namespace
 
 std::once_flag nt_inited;
 
-} // namespace
-
-} // namespace detail
-
-// Implementation of the jit class.
-struct llvm_state::jit {
+// The components of the jit which can be shared among
+// multiple llvm_state objects: the execution session, the
+// linking and compile layers and the target machine of the host.
+struct jit_session {
     llvm::orc::ExecutionSession m_es;
     llvm::orc::RTDyldObjectLinkingLayer m_object_layer;
     std::unique_ptr<llvm::orc::IRCompileLayer> m_compile_layer;
@@ -205,20 +223,20 @@ struct llvm_state::jit {
     std::unique_ptr<llvm::Triple> m_triple;
     std::unique_ptr<llvm::TargetMachine> m_tm;
     std::unique_ptr<llvm::orc::MangleAndInterner> m_mangle;
-    llvm::orc::ThreadSafeContext m_ctx;
-    llvm::orc::JITDylib &m_main_jd;
-
-    jit()
-        : m_object_layer(m_es, []() { return std::make_unique<llvm::SectionMemoryManager>(); }),
-          m_ctx(std::make_unique<llvm::LLVMContext>()),
-#if LLVM_VERSION_MAJOR == 10
-          m_main_jd(m_es.createJITDylib("<main>"))
-#else
-          m_main_jd(*m_es.createJITDylib("<main>"))
-#endif
+    // NOTE: the target machine is not thread-safe (e.g., it caches
+    // the subtargets lazily), thus its usage in the optimisation and
+    // codegen must be serialised across the users of the session.
+    std::mutex m_tm_mutex;
+    // Counter used to generate unique dylib names.
+    std::atomic<unsigned long long> m_dylib_counter{0};
+    // Registry of the object code size counters of the dylibs.
+    std::mutex m_obj_size_mutex;
+    std::unordered_map<const llvm::orc::JITDylib *, std::atomic<std::uint64_t> *> m_obj_size_map;
+
+    jit_session() : m_object_layer(m_es, []() { return std::make_unique<llvm::SectionMemoryManager>(); })
     {
         // NOTE: the native target initialization needs to be done only once
-        std::call_once(detail::nt_inited, []() {
+        std::call_once(nt_inited, []() {
             llvm::InitializeNativeTarget();
             llvm::InitializeNativeTargetAsmPrinter();
             llvm::InitializeNativeTargetAsmParser();
@@ -254,12 +272,129 @@ struct llvm_state::jit {
 
         m_mangle = std::make_unique<llvm::orc::MangleAndInterner>(m_es, *m_dl);
 
+        // Keep track of the size of the object code linked
+        // by the jit in each dylib.
+        // NOTE: the type of the first argument of the callback
+        // differs across LLVM versions. In older versions, the
+        // dylib cannot be identified and the size is recorded only
+        // if the session contains a single dylib.
+        m_object_layer.setNotifyEmitted([this](auto &&r, std::unique_ptr<llvm::MemoryBuffer> obj) {
+            const auto size = static_cast<std::uint64_t>(obj->getBufferSize());
+
+            std::lock_guard lock(m_obj_size_mutex);
+
+            if constexpr (std::is_same_v<uncvref_t<decltype(r)>, llvm::orc::MaterializationResponsibility>) {
+                if (const auto it = m_obj_size_map.find(&r.getTargetJITDylib()); it != m_obj_size_map.end()) {
+                    *it->second += size;
+                }
+            } else if (m_obj_size_map.size() == 1u) {
+                *m_obj_size_map.begin()->second += size;
+            }
+        });
+    }
+
+    jit_session(const jit_session &) = delete;
+    jit_session(jit_session &&) = delete;
+    jit_session &operator=(const jit_session &) = delete;
+    jit_session &operator=(jit_session &&) = delete;
+
+    ~jit_session() = default;
+
+    // Create a new dylib, registering the counter for
+    // the size of the object code linked into it.
+    llvm::orc::JITDylib &create_dylib(std::atomic<std::uint64_t> &obj_size)
+    {
+        const auto name = "<main_" + std::to_string(m_dylib_counter++) + ">";
+
+#if LLVM_VERSION_MAJOR == 10
+        auto &jd = m_es.createJITDylib(name);
+#else
+        auto ejd = m_es.createJITDylib(name);
+        if (!ejd) {
+            throw std::invalid_argument("Could not create a new dylib. The full error message:\n"
+                                        + llvm::toString(ejd.takeError()));
+        }
+        auto &jd = *ejd;
+#endif
+
         auto dlsg = llvm::orc::DynamicLibrarySearchGenerator::GetForCurrentProcess(m_dl->getGlobalPrefix());
         if (!dlsg) {
             throw std::invalid_argument("Could not create the dynamic library search generator");
         }
 
-        m_main_jd.addGenerator(std::move(*dlsg));
+        jd.addGenerator(std::move(*dlsg));
+
+        std::lock_guard lock(m_obj_size_mutex);
+        m_obj_size_map.emplace(&jd, &obj_size);
+
+        return jd;
+    }
+
+    // Remove a dylib created via create_dylib().
+    void remove_dylib(llvm::orc::JITDylib &jd) noexcept
+    {
+        {
+            std::lock_guard lock(m_obj_size_mutex);
+            m_obj_size_map.erase(&jd);
+        }
+
+        // NOTE: removing the dylib frees the resources (e.g., the
+        // memory containing the compiled code) associated to it. Before
+        // LLVM 12, dylibs cannot be removed from a session and their
+        // resources are freed only when the session is destroyed.
+#if LLVM_VERSION_MAJOR >= 13
+        llvm::consumeError(m_es.removeJITDylib(jd));
+#elif LLVM_VERSION_MAJOR == 12
+        llvm::consumeError(jd.clear());
+#else
+        (void)jd;
+#endif
+    }
+};
+
+// Fetch the process-wide shared session.
+// NOTE: the shared session is kept alive by the
+// jit objects using it, and it is re-created on demand.
+std::shared_ptr<jit_session> get_shared_jit_session()
+{
+    static std::mutex mut;
+    static std::weak_ptr<jit_session> wp;
+
+    std::lock_guard lock(mut);
+
+    auto retval = wp.lock();
+    if (!retval) {
+        retval = std::make_shared<jit_session>();
+        wp = retval;
+    }
+
+    return retval;
+}
+
+} // namespace
+
+} // namespace detail
+
+// Implementation of the jit class.
+// NOTE: each jit has its own context and dylib, while the
+// session may be either private or shared with other jits.
+struct llvm_state::jit {
+    std::shared_ptr<detail::jit_session> m_session;
+    bool m_shared;
+    // NOTE: the layers for lazy compilation are created
+    // on demand by add_module_lazy().
+    std::unique_ptr<llvm::orc::LazyCallThroughManager> m_lctm;
+    std::unique_ptr<llvm::orc::IRTransformLayer> m_transform_layer;
+    std::unique_ptr<llvm::orc::CompileOnDemandLayer> m_cod_layer;
+    // Total size of the object code linked by the jit.
+    std::atomic<std::uint64_t> m_obj_size{0};
+    llvm::orc::ThreadSafeContext m_ctx;
+    llvm::orc::JITDylib &m_main_jd;
+
+    explicit jit(bool shared)
+        : m_session(shared ? detail::get_shared_jit_session() : std::make_shared<detail::jit_session>()),
+          m_shared(shared), m_ctx(std::make_unique<llvm::LLVMContext>()), m_main_jd(m_session->create_dylib(m_obj_size))
+    {
     }
 
     jit(const jit &) = delete;
@@ -267,7 +402,14 @@ struct llvm_state::jit {
     jit &operator=(const jit &) = delete;
     jit &operator=(jit &&) = delete;
 
-    ~jit() = default;
+    ~jit()
+    {
+        // NOTE: a private session is destroyed together
+        // with the jit, no need to remove the dylib.
+        if (m_shared) {
+            m_session->remove_dylib(m_main_jd);
+        }
+    }
 
     // Accessors.
     llvm::LLVMContext &get_context()
@@ -278,22 +420,36 @@ struct llvm_state::jit {
     {
         return *m_ctx.getContext();
     }
+    const llvm::DataLayout &get_data_layout() const
+    {
+        return *m_session->m_dl;
+    }
+    const llvm::Triple &get_triple() const
+    {
+        return *m_session->m_triple;
+    }
     std::string get_target_cpu() const
     {
-        return std::string{m_tm->getTargetCPU()};
+        return std::string{m_session->m_tm->getTargetCPU()};
     }
     std::string get_target_features() const
     {
-        return std::string{m_tm->getTargetFeatureString()};
+        return std::string{m_session->m_tm->getTargetFeatureString()};
     }
-    llvm::TargetIRAnalysis get_target_ir_analysis() const
+
+    // Invoke f with exclusive access to the target machine.
+    template <typename F>
+    decltype(auto) with_tm(F &&f)
     {
-        return m_tm->getTargetIRAnalysis();
+        std::lock_guard lock(m_session->m_tm_mutex);
+
+        return std::forward<F>(f)(*m_session->m_tm);
     }
 
     void add_module(std::unique_ptr<llvm::Module> &&m)
     {
-        auto handle = m_compile_layer->add(m_main_jd, llvm::orc::ThreadSafeModule(std::move(m), m_ctx));
+        auto handle
+            = m_session->m_compile_layer->add(m_main_jd, llvm::orc::ThreadSafeModule(std::move(m), m_ctx));
 
         if (handle) {
             std::string err_report;
@@ -306,22 +462,114 @@ struct llvm_state::jit {
         }
     }
 
+    // Add a module to the jit for lazy compilation: each function
+    // in the module will be transformed via opt and compiled only when
+    // it is called for the first time.
+    void add_module_lazy(std::unique_ptr<llvm::Module> &&m, std::function<void(llvm::Module &)> opt)
+    {
+        assert(!m_cod_layer);
+
+        auto &es = m_session->m_es;
+        const auto &triple = *m_session->m_triple;
+
+        auto lctm = llvm::orc::createLocalLazyCallThroughManager(triple, es, 0);
+        if (!lctm) {
+            throw std::invalid_argument("Could not create the lazy call-through manager. The full error message:\n"
+                                        + llvm::toString(lctm.takeError()));
+        }
+        m_lctm = std::move(*lctm);
+
+        // NOTE: the transform may be invoked concurrently if
+        // functions are called for the first time from multiple threads,
+        // thus opt must be thread-safe.
+        m_transform_layer = std::make_unique<llvm::orc::IRTransformLayer>(
+            es, *m_session->m_compile_layer,
+            [opt = std::move(opt)](llvm::orc::ThreadSafeModule tsm,
+                                   auto &) -> llvm::Expected<llvm::orc::ThreadSafeModule> {
+                tsm.withModuleDo([&opt](llvm::Module &md) { opt(md); });
+
+                return tsm;
+            });
+
+        // NOTE: by default, the compile-on-demand layer
+        // puts each function in its own partition.
+        m_cod_layer = std::make_unique<llvm::orc::CompileOnDemandLayer>(
+            es, *m_transform_layer, *m_lctm, llvm::orc::createLocalIndirectStubsManagerBuilder(triple));
+
+        if (auto err = m_cod_layer->add(m_main_jd, llvm::orc::ThreadSafeModule(std::move(m), m_ctx))) {
+            throw std::invalid_argument("The function for lazily adding a module to the jit failed. The full error "
+                                        "message:\n"
+                                        + llvm::toString(std::move(err)));
+        }
+    }
+
+    // Add an object file (in the form of a string containing
+    // the binary object code) to the jit.
+    void add_object(const std::string &obj)
+    {
+        auto err = m_session->m_object_layer.add(m_main_jd, llvm::MemoryBuffer::getMemBufferCopy(obj));
+
+        if (err) {
+            std::string err_report;
+            llvm::raw_string_ostream ostr(err_report);
+
+            ostr << err;
+
+            throw std::invalid_argument("The function for adding an object file to the jit failed. The full error "
+                                        "message:\n"
+                                        + ostr.str());
+        }
+    }
+
     // Symbol lookup.
     llvm::Expected<llvm::JITEvaluatedSymbol> lookup(const std::string &name)
     {
-        return m_es.lookup({&m_main_jd}, (*m_mangle)(name));
+        return m_session->m_es.lookup({&m_main_jd}, (*m_session->m_mangle)(name));
     }
 };
 
-llvm_state::llvm_state(std::tuple<std::string, unsigned, bool, bool, bool> &&tup)
-    : m_jitter(std::make_unique<jit>()), m_opt_level(std::get<1>(tup)), m_use_fast_math(std::get<2>(tup)),
-      m_module_name(std::move(std::get<0>(tup))), m_save_object_code(std::get<3>(tup)), m_ls_vectorize(std::get<4>(tup))
+llvm_state::llvm_state(std::tuple<std::string, unsigned, bool, bool, bool, std::string, bool, bool, unsigned,
+                                  std::vector<std::string>, std::string, bool> &&tup)
+    : m_jitter(std::make_shared<jit>(std::get<11>(tup))), m_opt_level(std::get<1>(tup)),
+      m_use_fast_math(std::get<2>(tup)), m_module_name(std::move(std::get<0>(tup))),
+      m_save_object_code(std::get<3>(tup)), m_ls_vectorize(std::get<4>(tup)),
+      m_cache_dir(std::move(std::get<5>(tup))), m_parjit(std::get<6>(tup)), m_lazy(std::get<7>(tup)),
+      m_vector_width(std::get<8>(tup)), m_mv_targets(std::move(std::get<9>(tup))),
+      m_opt_pipeline(std::move(std::get<10>(tup))), m_shared_session(std::get<11>(tup))
 {
+    if (m_parjit && m_save_object_code) {
+        throw std::invalid_argument("The 'parjit' and 'save_object_code' options of an llvm_state are incompatible");
+    }
+
+    if (m_parjit && !m_cache_dir.empty()) {
+        throw std::invalid_argument("The 'parjit' and 'cache_dir' options of an llvm_state are incompatible");
+    }
+
+    if (m_lazy && (m_save_object_code || !m_cache_dir.empty() || m_parjit)) {
+        throw std::invalid_argument("The 'lazy' option of an llvm_state is incompatible with the 'save_object_code', "
+                                    "'cache_dir' and 'parjit' options");
+    }
+
+    if (std::any_of(m_mv_targets.begin(), m_mv_targets.end(), [](const auto &t) { return t.empty(); })) {
+        throw std::invalid_argument("The list of target features for multiversioning cannot contain empty strings");
+    }
+
+    // Validate the optimisation pipeline.
+    if (m_opt_pipeline != "default" && m_opt_pipeline != "fast_compile" && m_opt_pipeline != "vectorize") {
+        llvm::PassBuilder pb;
+        llvm::ModulePassManager mpm;
+
+        if (auto err = pb.parsePassPipeline(mpm, m_opt_pipeline)) {
+            throw std::invalid_argument("Invalid optimisation pipeline '" + m_opt_pipeline
+                                        + "'. The full error message:\n" + llvm::toString(std::move(err)));
+        }
+    }
+
     // Create the module.
     m_module = std::make_unique<llvm::Module>(m_module_name, context());
     // Setup the data layout and the target triple.
-    m_module->setDataLayout(*m_jitter->m_dl);
-    m_module->setTargetTriple(m_jitter->m_triple->str());
+    m_module->setDataLayout(m_jitter->get_data_layout());
+    m_module->setTargetTriple(m_jitter->get_triple().str());
 
     // Create a new builder for the module.
     m_builder = std::make_unique<llvm::IRBuilder<>>(context());
@@ -340,28 +588,38 @@ llvm_state::llvm_state(std::tuple<std::string, unsigned, bool, bool, bool> &&tup
 llvm_state::llvm_state() : llvm_state(kw_args_ctor_impl()) {}
 
 llvm_state::llvm_state(const llvm_state &other)
-    : m_jitter(std::make_unique<jit>()), m_sig_map(other.m_sig_map), m_opt_level(other.m_opt_level),
+    // NOTE: if other has been compiled, the jit (which contains
+    // the immutable compiled code) is shared with other, otherwise
+    // a new jit is created.
+    : m_jitter(other.is_compiled() ? other.m_jitter : std::make_shared<jit>(other.m_shared_session)),
+      m_sig_map(other.m_sig_map), m_opt_level(other.m_opt_level), m_ir_snapshot(other.m_ir_snapshot),
       m_use_fast_math(other.m_use_fast_math), m_module_name(other.m_module_name),
       m_save_object_code(other.m_save_object_code), m_object_code(other.m_object_code),
-      m_ls_vectorize(other.m_ls_vectorize)
+      m_ls_vectorize(other.m_ls_vectorize), m_cache_dir(other.m_cache_dir), m_parjit(other.m_parjit),
+      m_lazy(other.m_lazy), m_vector_width(other.m_vector_width), m_mv_targets(other.m_mv_targets),
+      m_opt_pipeline(other.m_opt_pipeline), m_shared_session(other.m_shared_session),
+      m_pass_timings(other.m_pass_timings), m_compile_report(other.m_compile_report),
+      m_opt_requested(other.m_opt_requested)
 {
-    // Get the IR of other.
-    auto other_ir = other.get_ir();
+    if (!other.is_compiled()) {
+        // Get the IR of other.
+        auto other_ir = other.get_ir();
 
-    // Create the corresponding memory buffer.
-    auto mb = llvm::MemoryBuffer::getMemBuffer(std::move(other_ir));
+        // Create the corresponding memory buffer.
+        auto mb = llvm::MemoryBuffer::getMemBuffer(std::move(other_ir));
 
-    // Construct a new module from the parsed IR.
-    llvm::SMDiagnostic err;
-    m_module = llvm::parseIR(*mb, err, context());
-    if (!m_module) {
-        std::string err_report;
-        llvm::raw_string_ostream ostr(err_report);
+        // Construct a new module from the parsed IR.
+        llvm::SMDiagnostic err;
+        m_module = llvm::parseIR(*mb, err, context());
+        if (!m_module) {
+            std::string err_report;
+            llvm::raw_string_ostream ostr(err_report);
 
-        err.print("", ostr);
+            err.print("", ostr);
 
-        throw std::invalid_argument("Error parsing the IR while copying an llvm_state. The full error message:\n"
-                                    + ostr.str());
+            throw std::invalid_argument("Error parsing the IR while copying an llvm_state. The full error message:\n"
+                                        + ostr.str());
+        }
     }
 
     // Create a new builder for the module.
@@ -374,11 +632,6 @@ llvm_state::llvm_state(const llvm_state &other)
         fmf.setFast();
         m_builder->setFastMathFlags(fmf);
     }
-
-    // Run the compilation if other was compiled.
-    if (!other.m_module) {
-        compile();
-    }
 }
 
 llvm_state::llvm_state(llvm_state &&) noexcept = default;
@@ -460,6 +713,73 @@ const std::unordered_map<std::string, llvm::Value *> &llvm_state::named_values()
     return m_named_values;
 }
 
+const std::string &llvm_state::cache_dir() const
+{
+    return m_cache_dir;
+}
+
+bool llvm_state::parjit() const
+{
+    return m_parjit;
+}
+
+bool llvm_state::lazy() const
+{
+    return m_lazy;
+}
+
+unsigned llvm_state::vector_width() const
+{
+    return m_vector_width;
+}
+
+const std::vector<std::string> &llvm_state::mv_targets() const
+{
+    return m_mv_targets;
+}
+
+const std::string &llvm_state::opt_pipeline() const
+{
+    return m_opt_pipeline;
+}
+
+bool llvm_state::shared_session() const
+{
+    return m_shared_session;
+}
+
+bool llvm_state::fast_math() const
+{
+    return m_use_fast_math;
+}
+
+std::string llvm_state::target_triple() const
+{
+    return m_jitter->get_triple().str();
+}
+
+std::string llvm_state::target_cpu() const
+{
+    return m_jitter->get_target_cpu();
+}
+
+std::string llvm_state::target_features() const
+{
+    return m_jitter->get_target_features();
+}
+
+// NOTE: the timings are accumulated over all the
+// invocations of the optimisation passes.
+const llvm_state::pass_timings_t &llvm_state::get_pass_timings() const
+{
+    return m_pass_timings;
+}
+
+const llvm_compile_report &llvm_state::get_compile_report() const
+{
+    return m_compile_report;
+}
+
 void llvm_state::check_uncompiled(const char *f) const
 {
     if (!m_module) {
@@ -508,214 +828,920 @@ void llvm_state::verify_function(llvm::Function *f)
     }
 }
 
-void llvm_state::verify_function(const std::string &name)
+void llvm_state::verify_function(const std::string &name)
+{
+    check_uncompiled(__func__);
+
+    // Lookup the function in the module.
+    auto f = m_module->getFunction(name);
+    if (f == nullptr) {
+        throw std::invalid_argument("The function '" + name + "' does not exist in the module");
+    }
+
+    // Run the actual check.
+    verify_function(f);
+}
+
+namespace detail
+{
+
+namespace
+{
+
+// Name of the string function attribute used to mark
+// the multiversioned clones of a function. The value of the
+// attribute is the set of target features of the clone.
+constexpr auto mv_attr = "heyoka-mv-features";
+
+// Helper to check if all the features enabled in the comma-separated
+// list 'features' (e.g., "+avx2,+fma") are enabled also in the
+// comma-separated list 'avail' (e.g., as returned by
+// TargetMachine::getTargetFeatureString()).
+bool features_available(const std::string &features, const std::string &avail)
+{
+    llvm::SmallVector<llvm::StringRef, 16> f_list, a_list;
+    llvm::StringRef(features).split(f_list, ',', -1, false);
+    llvm::StringRef(avail).split(a_list, ',', -1, false);
+
+    return std::all_of(f_list.begin(), f_list.end(), [&a_list](llvm::StringRef f) {
+        f = f.trim();
+
+        // NOTE: disabled features are always available.
+        return !f.startswith("+") || std::find(a_list.begin(), a_list.end(), f) != a_list.end();
+    });
+}
+
+// Name of the multiversioned clone of index i of the function called name.
+std::string mv_name(const std::string &name, std::size_t i)
+{
+    return name + ".mv" + std::to_string(i);
+}
+
+// Generic CPU name for the target triple t, used in the multiversioned
+// clones so that the available features are determined only by the
+// target features attribute.
+std::string mv_cpu(const llvm::Triple &t)
+{
+    switch (t.getArch()) {
+        case llvm::Triple::x86_64:
+            return "x86-64";
+        case llvm::Triple::x86:
+            return "i686";
+        default:
+            return "generic";
+    }
+}
+
+// Replace in f the calls to sleef functions which require
+// instruction sets not available in the target features
+// 'features' with calls to the corresponding LLVM intrinsics.
+// NOTE: the sleef function names are selected at codegen time
+// based on the features of the host (see sleef.cpp), and they
+// have the form "Sleef_<func>d<width>_u10<isa>".
+void mv_replace_sleef_calls(llvm::Function &f, const std::string &features)
+{
+    std::vector<llvm::CallInst *> calls;
+    for (auto &bb : f) {
+        for (auto &inst : bb) {
+            auto *call = llvm::dyn_cast<llvm::CallInst>(&inst);
+            if (call == nullptr) {
+                continue;
+            }
+
+            if (auto *callee = call->getCalledFunction(); callee != nullptr && callee->getName().startswith("Sleef_")) {
+                calls.push_back(call);
+            }
+        }
+    }
+
+    for (auto *call : calls) {
+        const auto cname = std::string{call->getCalledFunction()->getName()};
+
+        // Determine the instruction set required by the function.
+        const auto isa_pos = cname.find("_u10");
+        assert(isa_pos != std::string::npos);
+        const auto isa = cname.substr(isa_pos + 4u);
+
+        std::string req;
+        if (isa == "avx512f") {
+            req = "+avx512f";
+        } else if (isa == "avx2" || isa == "avx2128") {
+            req = "+avx2";
+        } else if (isa == "avx") {
+            req = "+avx";
+        } else if (isa == "sse4") {
+            req = "+sse4.1";
+        } else {
+            req = "+sse2";
+        }
+
+        if (features_available(req, features)) {
+            continue;
+        }
+
+        // Determine the corresponding intrinsic.
+        const auto fname = cname.substr(6, cname.find('d', 6) - 6u);
+
+        llvm::Intrinsic::ID id;
+        if (fname == "sin") {
+            id = llvm::Intrinsic::sin;
+        } else if (fname == "cos") {
+            id = llvm::Intrinsic::cos;
+        } else if (fname == "log") {
+            id = llvm::Intrinsic::log;
+        } else if (fname == "exp") {
+            id = llvm::Intrinsic::exp;
+        } else if (fname == "pow") {
+            id = llvm::Intrinsic::pow;
+        } else {
+            throw std::invalid_argument("Cannot replace the sleef function '" + cname
+                                        + "' in a multiversioned function");
+        }
+
+        llvm::IRBuilder<> builder(call);
+        const llvm::SmallVector<llvm::Value *, 2> args(call->arg_begin(), call->arg_end());
+        auto *ret = builder.CreateCall(llvm::Intrinsic::getDeclaration(f.getParent(), id, {call->getType()}), args);
+        if (llvm::isa<llvm::FPMathOperator>(call)) {
+            ret->copyFastMathFlags(call);
+        }
+
+        call->replaceAllUsesWith(ret);
+        call->eraseFromParent();
+    }
+}
+
+// Add to the module m, for each set of target features in targets,
+// a clone of all the function definitions in m. The clones of index
+// i are named via mv_name() and they are compiled for the target
+// features targets[i].
+void multiversion_module(llvm::Module &m, const llvm::Triple &triple, const std::vector<std::string> &targets)
+{
+    // Fetch the list of function definitions.
+    std::vector<llvm::Function *> funcs;
+    for (auto &f : m) {
+        if (!f.isDeclaration()) {
+            funcs.push_back(&f);
+        }
+    }
+
+    const auto cpu = mv_cpu(triple);
+
+    for (decltype(targets.size()) i = 0; i < targets.size(); ++i) {
+        // NOTE: the value map is used to redirect the calls
+        // between the original functions to the clones.
+        llvm::ValueToValueMapTy vmap;
+
+        std::vector<llvm::Function *> clones;
+        for (auto *f : funcs) {
+            auto *cf = llvm::Function::Create(f->getFunctionType(), f->getLinkage(),
+                                              mv_name(std::string{f->getName()}, i), &m);
+            vmap[f] = cf;
+            clones.push_back(cf);
+        }
+
+        for (decltype(funcs.size()) j = 0; j < funcs.size(); ++j) {
+            auto *f = funcs[j];
+            auto *cf = clones[j];
+
+            auto cf_arg = cf->arg_begin();
+            for (const auto &arg : f->args()) {
+                cf_arg->setName(arg.getName());
+                vmap[&arg] = &*cf_arg++;
+            }
+
+            llvm::SmallVector<llvm::ReturnInst *, 8> returns;
+#if LLVM_VERSION_MAJOR >= 13
+            llvm::CloneFunctionInto(cf, f, vmap, llvm::CloneFunctionChangeType::LocalChangesOnly, returns);
+#else
+            llvm::CloneFunctionInto(cf, f, vmap, false, returns);
+#endif
+
+            // Set up the target attributes.
+            cf->removeFnAttr("target-cpu");
+            cf->removeFnAttr("target-features");
+            cf->addFnAttr("target-cpu", cpu);
+            cf->addFnAttr("target-features", targets[i]);
+            cf->addFnAttr(mv_attr, targets[i]);
+
+            mv_replace_sleef_calls(*cf, targets[i]);
+        }
+    }
+}
+
+// Helper to count the number of IR instructions in the module m.
+std::uint64_t count_insts(const llvm::Module &m)
+{
+    std::uint64_t retval = 0;
+
+    for (const auto &f : m) {
+        retval += f.getInstructionCount();
+    }
+
+    return retval;
+}
+
+// Helper to accumulate the timing t (in seconds)
+// of the pass called name into timings.
+void add_pass_timing(llvm_state::pass_timings_t &timings, const std::string &name, double t)
+{
+    const auto it
+        = std::find_if(timings.begin(), timings.end(), [&name](const auto &p) { return p.first == name; });
+
+    if (it == timings.end()) {
+        timings.emplace_back(name, t);
+    } else {
+        it->second += t;
+    }
+}
+
+// The textual representation of the "fast_compile" optimisation pipeline.
+// NOTE: this pipeline is meant for the large straight-line functions
+// produced in non-compact mode, for which most of the passes of the
+// default pipelines (e.g., the loop passes) do not do anything useful.
+std::string fast_compile_pipeline(bool ls_vectorize)
+{
+    return std::string{"cgscc(inline),function("} + (ls_vectorize ? "load-store-vectorizer," : "")
+           + "sroa,early-cse,instcombine,simplifycfg,reassociate,early-cse,dse,adce)";
+}
+
+// Run the optimisation passes on the module m using the target machine tm.
+// The pipeline can be one of the presets "default", "fast_compile" and
+// "vectorize", or a textual pipeline description in the format accepted
+// by LLVM's 'opt' tool. If timings is not null, the per-pass timings
+// will be accumulated into it.
+void optimise_module(llvm::Module &m, llvm::TargetMachine &tm, unsigned opt_level, bool ls_vectorize,
+                     unsigned vector_width, const std::string &pipeline, llvm_state::pass_timings_t *timings)
+{
+    if (opt_level > 0u) {
+        // NOTE: the logic here largely mimics (with a lot of simplifications)
+        // the implementation of the 'opt' tool. See:
+        // https://github.com/llvm/llvm-project/blob/release/10.x/llvm/tools/opt/opt.cpp
+
+        // For every function in the module, setup its attributes
+        // so that the codegen uses all the features available on
+        // the host CPU.
+#if LLVM_VERSION_MAJOR == 10
+        ::setFunctionAttributes(std::string{tm.getTargetCPU()}, std::string{tm.getTargetFeatureString()}, m);
+#else
+        // NOTE: in LLVM > 10, the setFunctionAttributes() function is gone in favour of another
+        // function in another namespace, which however does not seem to work out of the box
+        // because (I think) it might be reading some non-existent command-line options. See:
+        // https://llvm.org/doxygen/CommandFlags_8cpp_source.html#l00552
+        // Here we are reproducing a trimmed-down version of the same function.
+        const auto cpu = std::string{tm.getTargetCPU()};
+        const auto features = std::string{tm.getTargetFeatureString()};
+
+        for (auto &f : m) {
+            auto attrs = f.getAttributes();
+            llvm::AttrBuilder new_attrs;
+
+            if (!cpu.empty() && !f.hasFnAttribute("target-cpu")) {
+                new_attrs.addAttribute("target-cpu", cpu);
+            }
+
+            if (!features.empty()) {
+                auto old_features = f.getFnAttribute("target-features").getValueAsString();
+
+                if (old_features.empty()) {
+                    new_attrs.addAttribute("target-features", features);
+                } else {
+                    llvm::SmallString<256> appended(old_features);
+                    appended.push_back(',');
+                    appended.append(features);
+                    new_attrs.addAttribute("target-features", appended);
+                }
+            }
+
+            f.setAttributes(attrs.addAttributes(m.getContext(), llvm::AttributeList::FunctionIndex, new_attrs));
+        }
+#endif
+
+        // Restore the target attributes of the multiversioned
+        // clones, which were overwritten above.
+        for (auto &f : m) {
+            if (f.hasFnAttribute(mv_attr)) {
+                const auto features = std::string{f.getFnAttribute(mv_attr).getValueAsString()};
+
+                f.removeFnAttr("target-cpu");
+                f.removeFnAttr("target-features");
+                f.addFnAttr("target-cpu", mv_cpu(tm.getTargetTriple()));
+                f.addFnAttr("target-features", features);
+            }
+        }
+
+        // Set the preferred vector width.
+        for (auto &f : m) {
+            auto width = vector_width;
+
+            if (width == 0u) {
+                // NOTE: currently LLVM forces 256-bit vector
+                // width when AVX-512 is available, due to clock
+                // frequency scaling concerns. It seems like for
+                // our purposes 512-bit vectors work fine,
+                // thus, unless the user selected a specific width,
+                // we force their use via a specific function attribute.
+                const auto avx512f
+                    = f.hasFnAttribute(mv_attr)
+                          ? features_available("+avx512f", std::string{f.getFnAttribute(mv_attr).getValueAsString()})
+                          : detail::get_target_features().avx512f;
+
+                if (avx512f) {
+                    width = 512;
+                }
+            }
+
+            if (width != 0u) {
+                f.addFnAttr("prefer-vector-width", std::to_string(width));
+            }
+        }
+
+        // Set up the instrumentation for timing the passes.
+        // NOTE: the passes are nested (e.g., the function passes
+        // run within a module-to-function adaptor), thus we keep
+        // a stack of starting times. The timings are inclusive of
+        // the nested passes.
+        llvm::PassInstrumentationCallbacks pic;
+        std::vector<std::chrono::steady_clock::time_point> t_stack;
+        if (timings != nullptr) {
+#if LLVM_VERSION_MAJOR >= 12
+            pic.registerBeforeNonSkippedPassCallback(
+                [&t_stack](llvm::StringRef, llvm::Any) { t_stack.push_back(std::chrono::steady_clock::now()); });
+#else
+            pic.registerBeforePassCallback([&t_stack](llvm::StringRef, llvm::Any) {
+                t_stack.push_back(std::chrono::steady_clock::now());
+                return true;
+            });
+#endif
+
+            // NOTE: the signatures of the after-pass callbacks
+            // differ across LLVM versions, use a variadic lambda.
+            auto after_cb = [&t_stack, timings](llvm::StringRef name, const auto &...) {
+                assert(!t_stack.empty());
+
+                const auto t = std::chrono::duration<double>(std::chrono::steady_clock::now() - t_stack.back());
+                t_stack.pop_back();
+
+                add_pass_timing(*timings, std::string{name}, t.count());
+            };
+
+            pic.registerAfterPassCallback(after_cb);
+            pic.registerAfterPassInvalidatedCallback(after_cb);
+        }
+
+        // Set up the pass builder.
+        llvm::PipelineTuningOptions pto;
+        // NOTE: the loop vectorizer and (unless requested via the
+        // "vectorize" preset) the SLP vectorizer are disabled
+        // in favour of explicit vectorization.
+        pto.LoopVectorization = false;
+        pto.SLPVectorization = (pipeline == "vectorize");
+
+#if LLVM_VERSION_MAJOR == 11 || LLVM_VERSION_MAJOR == 12
+        llvm::PassBuilder pb(false, &tm, pto, llvm::None, &pic);
+#else
+        llvm::PassBuilder pb(&tm, pto, llvm::None, &pic);
+#endif
+
+        // Set up the analysis managers.
+        llvm::LoopAnalysisManager lam;
+        llvm::FunctionAnalysisManager fam;
+        llvm::CGSCCAnalysisManager cgam;
+        llvm::ModuleAnalysisManager mam;
+
+        // NOTE: register the target library info before
+        // the default analyses, so that it takes precedence.
+        llvm::TargetLibraryInfoImpl tlii(tm.getTargetTriple());
+        fam.registerPass([&tlii]() { return llvm::TargetLibraryAnalysis(tlii); });
+
+        pb.registerModuleAnalyses(mam);
+        pb.registerCGSCCAnalyses(cgam);
+        pb.registerFunctionAnalyses(fam);
+        pb.registerLoopAnalyses(lam);
+        pb.crossRegisterProxies(lam, fam, cgam, mam);
+
+        // Build the pipeline.
+        llvm::ModulePassManager mpm;
+
+        if (pipeline == "default" || pipeline == "vectorize") {
+            // Add a pass to vectorize load/stores, if requested.
+            // This is useful to ensure that the
+            // pattern adopted in load_vector_from_memory() and
+            // store_vector_to_memory() is translated to
+            // vectorized store/load instructions.
+            if (ls_vectorize) {
+                mpm.addPass(llvm::createModuleToFunctionPassAdaptor(llvm::LoadStoreVectorizerPass()));
+            }
+
+#if LLVM_VERSION_MAJOR >= 14
+            using ol_t = llvm::OptimizationLevel;
+#else
+            using ol_t = llvm::PassBuilder::OptimizationLevel;
+#endif
+            mpm.addPass(pb.buildPerModuleDefaultPipeline(opt_level == 1u ? ol_t::O1
+                                                                         : (opt_level == 2u ? ol_t::O2 : ol_t::O3)));
+
+            if (pipeline == "vectorize") {
+                // Clean up the code produced by the SLP vectorizer.
+                mpm.addPass(llvm::createModuleToFunctionPassAdaptor(llvm::InstCombinePass()));
+            }
+        } else {
+            const auto text = (pipeline == "fast_compile") ? fast_compile_pipeline(ls_vectorize) : pipeline;
+
+            if (auto err = pb.parsePassPipeline(mpm, text)) {
+                throw std::invalid_argument("Error parsing the optimisation pipeline '" + text
+                                            + "'. The full error message:\n" + llvm::toString(std::move(err)));
+            }
+        }
+
+        // Run the pipeline.
+        mpm.run(m, mam);
+    }
+}
+
+// Emit the object code for the module m
+// using the target machine tm.
+std::string emit_object(llvm::Module &m, llvm::TargetMachine &tm)
+{
+    // Create a name model for the llvm temporary file machinery.
+    const auto model = (boost::filesystem::temp_directory_path() / "heyoka-%%-%%-%%-%%-%%.o").string();
+
+    // Create a unique file.
+    // NOTE: this will also open the file. fd is the file
+    // descriptor, res_path will be the full path to the file.
+    int fd;
+    llvm::SmallString<128> res_path;
+    const auto res = llvm::sys::fs::createUniqueFile(model, fd, res_path);
+
+    if (res) {
+        throw std::invalid_argument(
+            "The function to create a unique temporary file failed. The full error message:\n" + res.message());
+    }
+
+    // RAII helper to remove the unique file that was
+    // created above.
+    struct file_remover {
+        llvm::SmallString<128> &path;
+
+        ~file_remover()
+        {
+            boost::filesystem::remove(boost::filesystem::path{path.c_str()});
+        }
+    } fr{res_path};
+
+    // Create a stream from the file descriptor.
+    // The 'false' parameter indicates not to close
+    // the file upon destruction of dest (we will be
+    // closing the file manually).
+    llvm::raw_fd_ostream dest(fd, false);
+
+    // Setup the machinery for dumping the object code.
+    llvm::legacy::PassManager pass;
+
+    if (tm.addPassesToEmitFile(pass, dest, nullptr, llvm::CGFT_ObjectFile)) {
+        // Make sure to close the file before throwing.
+        // NOTE: the file will be removed by the fr object
+        // destructor.
+        llvm::sys::fs::closeFile(fd);
+
+        throw std::invalid_argument("The target machine can't emit a file of this type");
+    }
+
+    // Dump the object code.
+    pass.run(m);
+
+    // Close the file.
+    llvm::sys::fs::closeFile(fd);
+
+    // Re-open it for reading in binary mode.
+    std::ifstream ifile(res_path.c_str(), std::ios::binary);
+    if (!ifile.good()) {
+        throw std::invalid_argument("Could not open the temporary file '" + std::string(res_path.c_str())
+                                    + "' for writing");
+    }
+    // Enable exceptions on ifile.
+    ifile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
+
+    // Dump into a stringstream.
+    std::ostringstream oss;
+    oss << ifile.rdbuf();
+
+    return oss.str();
+}
+
+} // namespace
+
+} // namespace detail
+
+void llvm_state::optimise()
+{
+    check_uncompiled(__func__);
+
+    if (defer_optimise()) {
+        m_opt_requested = true;
+    } else {
+        optimise_impl();
+    }
+}
+
+// Helper to determine if the optimisation of the
+// module must be deferred to compile().
+bool llvm_state::defer_optimise() const
+{
+    // NOTE: if the object cache is enabled, the optimisation
+    // is deferred to compile(). This allows us to compute the cache
+    // key from the unoptimised IR, and to skip the optimisation
+    // altogether in case of a cache hit.
+    // In parallel mode, the optimisation is run separately
+    // on each partition of the module.
+    // NOTE: the multiversioned clones are added at compile time,
+    // thus the optimisation must run afterwards.
+    return !m_cache_dir.empty() || m_parjit || m_lazy || !m_mv_targets.empty();
+}
+
+void llvm_state::optimise_impl()
+{
+    assert(m_module);
+
+    const auto start = std::chrono::steady_clock::now();
+
+    m_compile_report.n_insts_pre_opt = detail::count_insts(*m_module);
+
+    m_jitter->with_tm([this](llvm::TargetMachine &tm) {
+        detail::optimise_module(*m_module, tm, m_opt_level, m_ls_vectorize, m_vector_width, m_opt_pipeline,
+                                &m_pass_timings);
+    });
+
+    m_compile_report.n_insts_post_opt = detail::count_insts(*m_module);
+    m_compile_report.opt_time += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Helper to emit the object code for the current module.
+std::string llvm_state::emit_object_code()
+{
+    assert(m_module);
+
+    return m_jitter->with_tm([this](llvm::TargetMachine &tm) { return detail::emit_object(*m_module, tm); });
+}
+
+// Helper to compute the key identifying the compiled object
+// corresponding to the IR 'ir' in the on-disk object cache.
+std::string llvm_state::get_cache_key(const std::string &ir) const
+{
+    // NOTE: in addition to the IR, the key needs to take into
+    // account all the settings influencing optimisation and
+    // codegen, the host machine and the LLVM version.
+    std::ostringstream oss;
+    oss << ir << '\n';
+    oss << m_opt_requested << ' ' << m_opt_level << ' ' << m_use_fast_math << ' ' << m_ls_vectorize << ' '
+        << m_vector_width << '\n';
+    oss << m_opt_pipeline << '\n';
+    for (const auto &t : m_mv_targets) {
+        oss << t << '\n';
+    }
+    oss << m_jitter->get_triple().str() << '\n';
+    oss << m_jitter->get_target_cpu() << '\n';
+    oss << m_jitter->get_target_features() << '\n';
+    oss << LLVM_VERSION_STRING;
+
+    return llvm::toHex(llvm::SHA1::hash(llvm::arrayRefFromStringRef(oss.str())), true);
+}
+
+namespace detail
+{
+
+namespace
+{
+
+// Helper to read the object file at the path 'p' from the
+// on-disk object cache. An empty string will be returned
+// if the object file does not exist.
+std::string obj_cache_fetch(const boost::filesystem::path &p)
+{
+    if (!boost::filesystem::exists(p)) {
+        return "";
+    }
+
+    std::ifstream ifile(p.string(), std::ios::binary);
+    if (!ifile.good()) {
+        throw std::invalid_argument("Could not open the object cache file '" + p.string() + "' for reading");
+    }
+    // Enable exceptions on ifile.
+    ifile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
+
+    std::ostringstream oss;
+    oss << ifile.rdbuf();
+
+    return oss.str();
+}
+
+// Helper to store the object code 'obj' at the path 'p'
+// in the on-disk object cache.
+void obj_cache_store(const boost::filesystem::path &p, const std::string &obj)
+{
+    const auto dir = p.parent_path();
+
+    boost::filesystem::create_directories(dir);
+
+    // NOTE: the object code is first written into a uniquely-named
+    // temporary file in the cache directory, which is then
+    // renamed to its final name. This ensures that other
+    // processes sharing the same cache will never see
+    // partially-written object files.
+    const auto tmp_path = dir / boost::filesystem::unique_path("heyoka-%%%%-%%%%-%%%%-%%%%.tmp");
+
+    try {
+        {
+            std::ofstream ofile(tmp_path.string(), std::ios::binary);
+            if (!ofile.good()) {
+                throw std::invalid_argument("Could not open the file '" + tmp_path.string() + "' for writing");
+            }
+            // Enable exceptions on ofile.
+            ofile.exceptions(std::ofstream::failbit | std::ofstream::badbit);
+
+            ofile.write(obj.data(), static_cast<std::streamsize>(obj.size()));
+        }
+
+        boost::filesystem::rename(tmp_path, p);
+    } catch (...) {
+        boost::system::error_code ec;
+        boost::filesystem::remove(tmp_path, ec);
+
+        throw;
+    }
+}
+
+} // namespace
+
+} // namespace detail
+
+namespace detail
+{
+
+namespace
+{
+
+// Helper to create a target machine for the host system.
+std::unique_ptr<llvm::TargetMachine> create_host_tm()
 {
-    check_uncompiled(__func__);
+    auto jtmb = llvm::orc::JITTargetMachineBuilder::detectHost();
+    if (!jtmb) {
+        throw std::invalid_argument("Error creating a JITTargetMachineBuilder for the host system");
+    }
+    // NOTE: use the same codegen optimisation level as the jit.
+    jtmb->setCodeGenOptLevel(llvm::CodeGenOpt::Aggressive);
 
-    // Lookup the function in the module.
-    auto f = m_module->getFunction(name);
-    if (f == nullptr) {
-        throw std::invalid_argument("The function '" + name + "' does not exist in the module");
+    auto tm = jtmb->createTargetMachine();
+    if (!tm) {
+        throw std::invalid_argument("Error creating the target machine");
     }
 
-    // Run the actual check.
-    verify_function(f);
+    return std::move(*tm);
 }
 
-void llvm_state::optimise()
+// Split the module m into partitions, then optimise and codegen
+// the partitions concurrently. The object files resulting from the
+// compilation of the partitions will be returned. The per-pass timings
+// of the optimisation of all the partitions are accumulated into timings,
+// the optimisation statistics into report.
+std::vector<std::string> parallel_codegen(std::unique_ptr<llvm::Module> m, unsigned opt_level, bool ls_vectorize,
+                                          unsigned vector_width, const std::string &pipeline,
+                                          llvm_state::pass_timings_t &timings, llvm_compile_report &report)
 {
-    check_uncompiled(__func__);
-
-    if (m_opt_level > 0u) {
-        // NOTE: the logic here largely mimics (with a lot of simplifications)
-        // the implementation of the 'opt' tool. See:
-        // https://github.com/llvm/llvm-project/blob/release/10.x/llvm/tools/opt/opt.cpp
-
-        // For every function in the module, setup its attributes
-        // so that the codegen uses all the features available on
-        // the host CPU.
-#if LLVM_VERSION_MAJOR == 10
-        ::setFunctionAttributes(m_jitter->get_target_cpu(), m_jitter->get_target_features(), *m_module);
+    // Count the number of function definitions in the module.
+    const auto n_funcs = static_cast<unsigned>(
+        std::count_if(m->begin(), m->end(), [](const llvm::Function &f) { return !f.isDeclaration(); }));
+
+    // Determine the number of partitions.
+    const auto n_parts = std::max(1u, std::min(std::thread::hardware_concurrency(), n_funcs));
+
+    // Split the module and serialise the partitions into bitcode.
+    // NOTE: the partitions share the context of the original module,
+    // which cannot be used concurrently from multiple threads. Thus, we
+    // serialise the partitions so that they can be loaded in the worker
+    // threads into separate contexts.
+    // NOTE: with PreserveLocals set to false, functions with internal
+    // linkage (e.g., the compact mode AD helpers) are externalised and
+    // can thus be placed in different partitions. This increases parallelism,
+    // at the price of preventing inlining across partitions.
+    std::vector<llvm::SmallVector<char, 0>> bcs;
+    auto split_cb = [&bcs](std::unique_ptr<llvm::Module> part) {
+        auto &bc = bcs.emplace_back();
+        llvm::raw_svector_ostream ostr(bc);
+        llvm::WriteBitcodeToFile(*part, ostr);
+    };
+#if LLVM_VERSION_MAJOR >= 13
+    llvm::SplitModule(*m, n_parts, split_cb, false);
+    m.reset();
 #else
-        // NOTE: in LLVM > 10, the setFunctionAttributes() function is gone in favour of another
-        // function in another namespace, which however does not seem to work out of the box
-        // because (I think) it might be reading some non-existent command-line options. See:
-        // https://llvm.org/doxygen/CommandFlags_8cpp_source.html#l00552
-        // Here we are reproducing a trimmed-down version of the same function.
-        const auto cpu = m_jitter->get_target_cpu();
-        const auto features = m_jitter->get_target_features();
+    llvm::SplitModule(std::move(m), n_parts, split_cb, false);
+#endif
 
-        for (auto &f : module()) {
-            auto attrs = f.getAttributes();
-            llvm::AttrBuilder new_attrs;
+    // Optimise and codegen the partitions in parallel.
+    // NOTE: the data written by the tasks must be declared before
+    // the futures, so that it outlives them (the destructor of
+    // a future returned by std::async() blocks until the task completes).
+    std::vector<llvm_state::pass_timings_t> part_timings(bcs.size());
+    std::vector<llvm_compile_report> part_reports(bcs.size());
+    // NOTE: the optimisation time is measured as the wall-clock time
+    // from the start of the parallel section to the moment in which the
+    // last partition finishes its optimisation.
+    const auto par_start = std::chrono::steady_clock::now();
+    std::vector<std::chrono::steady_clock::time_point> opt_ends(bcs.size(), par_start);
+
+    // The task optimising and compiling the i-th partition.
+    auto task = [&bcs, &part_timings, &part_reports, &opt_ends, opt_level, ls_vectorize, vector_width,
+                 &pipeline](decltype(bcs.size()) i) {
+        const auto &bc = bcs[i];
+
+        // NOTE: each worker thread uses its own context
+        // and target machine.
+        llvm::LLVMContext ctx;
+
+        auto part = llvm::parseBitcodeFile(llvm::MemoryBufferRef(llvm::StringRef(bc.data(), bc.size()), ""), ctx);
+        if (!part) {
+            throw std::invalid_argument("Error parsing the bitcode of a module partition. The full error message:\n"
+                                        + llvm::toString(part.takeError()));
+        }
 
-            if (!cpu.empty() && !f.hasFnAttribute("target-cpu")) {
-                new_attrs.addAttribute("target-cpu", cpu);
-            }
+        auto tm = create_host_tm();
 
-            if (!features.empty()) {
-                auto old_features = f.getFnAttribute("target-features").getValueAsString();
+        optimise_module(**part, *tm, opt_level, ls_vectorize, vector_width, pipeline, &part_timings[i]);
+        opt_ends[i] = std::chrono::steady_clock::now();
+        part_reports[i].n_insts_post_opt = count_insts(**part);
 
-                if (old_features.empty()) {
-                    new_attrs.addAttribute("target-features", features);
-                } else {
-                    llvm::SmallString<256> appended(old_features);
-                    appended.push_back(',');
-                    appended.append(features);
-                    new_attrs.addAttribute("target-features", appended);
-                }
-            }
+        return emit_object(**part, *tm);
+    };
 
-            f.setAttributes(attrs.addAttributes(context(), llvm::AttributeList::FunctionIndex, new_attrs));
-        }
-#endif
+    std::vector<std::future<std::string>> futs;
+    futs.reserve(bcs.size());
 
-        if (detail::get_target_features().avx512f) {
-            // NOTE: currently LLVM forces 256-bit vector
-            // width when AVX-512 is available, due to clock
-            // frequency scaling concerns. It seems like for
-            // our purposes 512-bit vectors work fine,
-            // thus we force their use via a specific
-            // function attribute to be set on all the
-            // functions in the module.
-            for (auto &f : *m_module) {
-                f.addFnAttr("prefer-vector-width", "512");
-            }
+    try {
+        for (decltype(bcs.size()) i = 0; i < bcs.size(); ++i) {
+            futs.push_back(std::async(std::launch::async, task, i));
         }
-
-        // Init the module pass manager.
-        auto module_pm = std::make_unique<llvm::legacy::PassManager>();
-        // These are passes which set up target-specific info
-        // that are used by successive optimisation passes.
-        auto tliwp
-            = std::make_unique<llvm::TargetLibraryInfoWrapperPass>(llvm::TargetLibraryInfoImpl(*m_jitter->m_triple));
-        module_pm->add(tliwp.release());
-        module_pm->add(llvm::createTargetTransformInfoWrapperPass(m_jitter->get_target_ir_analysis()));
-
-        // NOTE: not sure what this does, presumably some target-specifc
-        // configuration.
-        module_pm->add(static_cast<llvm::LLVMTargetMachine &>(*m_jitter->m_tm).createPassConfig(*module_pm));
-
-        // Init the function pass manager.
-        auto f_pm = std::make_unique<llvm::legacy::FunctionPassManager>(m_module.get());
-        f_pm->add(llvm::createTargetTransformInfoWrapperPass(m_jitter->get_target_ir_analysis()));
-
-        // Add a pass to vectorize load/stores, if requested.
-        // This is useful to ensure that the
-        // pattern adopted in load_vector_from_memory() and
-        // store_vector_to_memory() is translated to
-        // vectorized store/load instructions.
-        if (m_ls_vectorize) {
-            f_pm->add(llvm::createLoadStoreVectorizerPass());
+    } catch (...) {
+        // NOTE: if the launch of a task fails, wait for
+        // the tasks already running before re-throwing.
+        for (auto &fut : futs) {
+            fut.wait();
         }
 
-        // We use the helper class PassManagerBuilder to populate the module
-        // pass manager with standard options.
-        llvm::PassManagerBuilder pm_builder;
-        // See here for the defaults:
-        // https://llvm.org/doxygen/PassManagerBuilder_8cpp_source.html
-        // NOTE: we used to have the SLP vectorizer on here, but
-        // we don't activate it any more in favour of explicit vectorization.
-        // NOTE: perhaps in the future we can make the autovectorizer an
-        // option like the fast math flag.
-        pm_builder.OptLevel = m_opt_level;
-        pm_builder.Inliner = llvm::createFunctionInliningPass(m_opt_level, 0, false);
-
-        m_jitter->m_tm->adjustPassManager(pm_builder);
-
-        // Populate both the function pass manager and the module pass manager.
-        pm_builder.populateFunctionPassManager(*f_pm);
-        pm_builder.populateModulePassManager(*module_pm);
-
-        // Run the function pass manager on all functions in the module.
-        f_pm->doInitialization();
-        for (auto &f : *m_module) {
-            f_pm->run(f);
+        throw;
+    }
+
+    // NOTE: wait for all the tasks to finish before
+    // re-throwing the first exception (if any).
+    for (auto &fut : futs) {
+        fut.wait();
+    }
+
+    std::vector<std::string> retval;
+    for (auto &fut : futs) {
+        retval.push_back(fut.get());
+    }
+
+    for (const auto &pt : part_timings) {
+        for (const auto &[name, t] : pt) {
+            add_pass_timing(timings, name, t);
         }
-        f_pm->doFinalization();
+    }
 
-        // Run the module passes.
-        module_pm->run(*m_module);
+    report.opt_time
+        += std::chrono::duration<double>(*std::max_element(opt_ends.begin(), opt_ends.end()) - par_start).count();
+
+    report.n_insts_post_opt = 0;
+    for (const auto &pr : part_reports) {
+        report.n_insts_post_opt += pr.n_insts_post_opt;
     }
+
+    return retval;
 }
 
+} // namespace
+
+} // namespace detail
+
 void llvm_state::compile()
 {
     check_uncompiled(__func__);
 
+    const auto start = std::chrono::steady_clock::now();
+
     // Store a snapshot of the IR before compiling.
+    // NOTE: if the optimisation is deferred, this
+    // is the IR before the optimisation. The snapshot
+    // never contains the multiversioned clones.
     m_ir_snapshot = get_ir();
 
-    // Store also the object code, if requested.
-    if (m_save_object_code) {
-        // Create a name model for the llvm temporary file machinery.
-        const auto model = (boost::filesystem::temp_directory_path() / "heyoka-%%-%%-%%-%%-%%.o").string();
-
-        // Create a unique file.
-        // NOTE: this will also open the file. fd is the file
-        // descriptor, res_path will be the full path to the file.
-        int fd;
-        llvm::SmallString<128> res_path;
-        const auto res = llvm::sys::fs::createUniqueFile(model, fd, res_path);
-
-        if (res) {
-            throw std::invalid_argument(
-                "The function to create a unique temporary file failed. The full error message:\n" + res.message());
-        }
+    // Add the multiversioned clones, if requested.
+    if (!m_mv_targets.empty()) {
+        detail::multiversion_module(*m_module, m_jitter->get_triple(), m_mv_targets);
+    }
 
-        // RAII helper to remove the unique file that was
-        // created above.
-        struct file_remover {
-            llvm::SmallString<128> &path;
+    // Fetch the number of function definitions and the names
+    // of the externally-visible ones.
+    std::vector<std::string> ext_names;
+    m_compile_report.n_funcs = 0;
+    for (const auto &f : *m_module) {
+        if (!f.isDeclaration()) {
+            ++m_compile_report.n_funcs;
 
-            ~file_remover()
-            {
-                boost::filesystem::remove(boost::filesystem::path{path.c_str()});
+            if (f.hasExternalLinkage()) {
+                ext_names.emplace_back(f.getName());
             }
-        } fr{res_path};
+        }
+    }
 
-        // Create a stream from the file descriptor.
-        // The 'false' parameter indicates not to close
-        // the file upon destruction of dest (we will be
-        // closing the file manually).
-        llvm::raw_fd_ostream dest(fd, false);
+    if (m_lazy) {
+        // Lazy mode: the (deferred) optimisation and the codegen
+        // are run on a function-by-function basis when each
+        // function is called for the first time.
+        std::function<void(llvm::Module &)> opt;
+        if (m_opt_requested) {
+            // NOTE: the per-pass timings are not recorded in lazy mode.
+            opt = [jitter = m_jitter.get(), opt_level = m_opt_level, ls_vectorize = m_ls_vectorize,
+                   vector_width = m_vector_width, pipeline = m_opt_pipeline](llvm::Module &md) {
+                jitter->with_tm([&](llvm::TargetMachine &tm) {
+                    detail::optimise_module(md, tm, opt_level, ls_vectorize, vector_width, pipeline, nullptr);
+                });
+            };
+        } else {
+            opt = [](llvm::Module &) {};
+        }
 
-        // Setup the machinery for dumping the object code.
-        llvm::legacy::PassManager pass;
+        m_jitter->add_module_lazy(std::move(m_module), std::move(opt));
+    } else if (m_parjit) {
+        // Parallel mode: optimise and codegen the partitions
+        // of the module concurrently, then add the resulting
+        // object files to the jit.
+        m_compile_report.n_insts_pre_opt = detail::count_insts(*m_module);
 
-        if (m_jitter->m_tm->addPassesToEmitFile(pass, dest, nullptr, llvm::CGFT_ObjectFile)) {
-            // Make sure to close the file before throwing.
-            // NOTE: the file will be removed by the fr object
-            // destructor.
-            llvm::sys::fs::closeFile(fd);
+        const auto objs
+            = detail::parallel_codegen(std::move(m_module), m_opt_requested ? m_opt_level : 0u, m_ls_vectorize,
+                                       m_vector_width, m_opt_pipeline, m_pass_timings, m_compile_report);
 
-            throw std::invalid_argument("The target machine can't emit a file of this type");
+        for (const auto &obj : objs) {
+            m_jitter->add_object(obj);
+        }
+    } else if (m_cache_dir.empty()) {
+        // Run the deferred optimisation, if needed.
+        if (m_opt_requested) {
+            optimise_impl();
+        }
+
+        // Store also the object code, if requested.
+        if (m_save_object_code) {
+            m_object_code = emit_object_code();
         }
 
-        // Dump the object code.
-        pass.run(*m_module);
+        m_jitter->add_module(std::move(m_module));
+    } else {
+        const auto obj_path = boost::filesystem::path{m_cache_dir} / (get_cache_key(m_ir_snapshot) + ".o");
+
+        // Try to fetch the object code from the cache.
+        auto obj = detail::obj_cache_fetch(obj_path);
 
-        // Close the file.
-        llvm::sys::fs::closeFile(fd);
+        if (obj.empty()) {
+            // Cache miss: run the optimisation (if requested)
+            // and the codegen, and store the result in the cache.
+            if (m_opt_requested) {
+                optimise_impl();
+            }
+
+            obj = emit_object_code();
 
-        // Re-open it for reading in binary mode.
-        std::ifstream ifile(res_path.c_str(), std::ios::binary);
-        if (!ifile.good()) {
-            throw std::invalid_argument("Could not open the temporary file '" + std::string(res_path.c_str())
-                                        + "' for writing");
+            detail::obj_cache_store(obj_path, obj);
         }
-        // Enable exceptions on ifile.
-        ifile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
 
-        // Dump into a stringstream.
-        std::ostringstream oss;
-        oss << ifile.rdbuf();
+        // Add the object code to the jit, bypassing
+        // the IR compile layer.
+        m_jitter->add_object(obj);
+
+        if (m_save_object_code) {
+            m_object_code = std::move(obj);
+        }
+
+        // NOTE: the module is not needed any more, reset it
+        // in order to signal that the state is now compiled.
+        m_module.reset();
+    }
 
-        // Assign the read data.
-        m_object_code = oss.str();
+    // NOTE: the jit compiles and links the code on the first lookup
+    // of a symbol. Force the materialisation of all the externally-visible
+    // functions (unless in lazy mode), so that the codegen and linking
+    // are accounted for in the compile report.
+    if (!m_lazy) {
+        for (const auto &name : ext_names) {
+            if (auto sym = m_jitter->lookup(name); !sym) {
+                throw std::invalid_argument("Could not materialise the symbol '" + name
+                                            + "' in the compiled module. The full error message:\n"
+                                            + llvm::toString(sym.takeError()));
+            }
+        }
     }
 
-    m_jitter->add_module(std::move(m_module));
+    m_compile_report.obj_size = m_jitter->m_obj_size.load();
+    m_compile_report.compile_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
 }
 
 bool llvm_state::is_compiled() const
@@ -1122,6 +2148,27 @@ std::uintptr_t llvm_state::jit_lookup(const std::string &name)
 {
     check_compiled(__func__);
 
+    // If multiversioning is enabled, look first for the clone
+    // of name for the first set of target features supported
+    // by the host.
+    // NOTE: symbols without clones (e.g., global variables)
+    // fall back to the original name.
+    if (!m_mv_targets.empty()) {
+        const auto host_features = m_jitter->get_target_features();
+
+        for (decltype(m_mv_targets.size()) i = 0; i < m_mv_targets.size(); ++i) {
+            if (detail::features_available(m_mv_targets[i], host_features)) {
+                if (auto sym = m_jitter->lookup(detail::mv_name(name, i))) {
+                    return static_cast<std::uintptr_t>((*sym).getAddress());
+                } else {
+                    llvm::consumeError(sym.takeError());
+                }
+
+                break;
+            }
+        }
+    }
+
     auto sym = m_jitter->lookup(name);
     if (!sym) {
         throw std::invalid_argument("Could not find the symbol '" + name + "' in the compiled module");
@@ -1147,6 +2194,20 @@ std::string llvm_state::get_ir() const
     }
 }
 
+// Fetch the object code of a compiled state. This requires
+// the 'save_object_code' option to be active.
+const std::string &llvm_state::get_object_code() const
+{
+    check_compiled(__func__);
+
+    if (!m_save_object_code || m_object_code.empty()) {
+        throw std::invalid_argument("The object code of an llvm_state is available only if the 'save_object_code' "
+                                    "keyword argument was set to true when constructing the llvm_state object");
+    }
+
+    return m_object_code;
+}
+
 void llvm_state::dump_object_code(const std::string &filename) const
 {
     const auto compiled = !m_module;
@@ -1171,18 +2232,265 @@ void llvm_state::dump_object_code(const std::string &filename) const
     } else {
         // The module has not been compiled yet, run the JIT
         // and dump the object code.
-        llvm::legacy::PassManager pass;
+        // NOTE: the codegen passes use the target machine,
+        // thus they must run with exclusive access to it.
+        const auto emitted = m_jitter->with_tm([this, &dest](llvm::TargetMachine &tm) {
+            llvm::legacy::PassManager pass;
+
+            if (tm.addPassesToEmitFile(pass, dest, nullptr, llvm::CGFT_ObjectFile)) {
+                return false;
+            }
+
+            pass.run(*m_module);
+
+            return true;
+        });
 
-        if (m_jitter->m_tm->addPassesToEmitFile(pass, dest, nullptr, llvm::CGFT_ObjectFile)) {
+        if (!emitted) {
             // Close and remove the file before throwing.
             dest.close();
             boost::filesystem::remove(boost::filesystem::path{filename});
 
             throw std::invalid_argument("The target machine can't emit a file of this type");
         }
+    }
+}
+
+void llvm_state::dump_static_library(const std::string &filename) const
+{
+    const auto compiled = !m_module;
+
+    if (compiled && !m_save_object_code) {
+        throw std::invalid_argument("Cannot dump a static library after compilation if the 'save_object_code' "
+                                    "keyword argument was not set to true when constructing the llvm_state object");
+    }
+
+    // Fetch the object code, either from the saved
+    // image or by running the codegen.
+    const auto obj = compiled ? m_object_code
+                              : m_jitter->with_tm([this](llvm::TargetMachine &tm) {
+                                    return detail::emit_object(*m_module, tm);
+                                });
+
+    // Determine the archive format from the target triple.
+    const auto &triple = m_jitter->get_triple();
+    const auto kind = triple.isOSDarwin()
+                          ? llvm::object::Archive::K_DARWIN
+                          : (triple.isOSWindows() ? llvm::object::Archive::K_COFF : llvm::object::Archive::K_GNU);
+
+    // NOTE: the archive contains a single member.
+    std::vector<llvm::NewArchiveMember> members;
+    members.emplace_back(llvm::MemoryBufferRef(obj, "heyoka.o"));
+
+    if (auto err = llvm::writeArchive(filename, members, true, kind, true, false)) {
+        throw std::invalid_argument("Could not write the static library '" + filename
+                                    + "'. The full error message:\n" + llvm::toString(std::move(err)));
+    }
+}
+
+namespace detail
+{
+
+namespace
+{
+
+// Helper to convert an LLVM type to the name
+// of the corresponding C type.
+std::string llvm_type_to_c(llvm::Type *t)
+{
+    assert(t != nullptr);
+
+    if (t->isVoidTy()) {
+        return "void";
+    } else if (t->isFloatTy()) {
+        return "float";
+    } else if (t->isDoubleTy()) {
+        return "double";
+    } else if (t->isX86_FP80Ty()) {
+        return "long double";
+    } else if (t->isFP128Ty()) {
+        return "__float128";
+    } else if (t->isIntegerTy()) {
+        return "int" + li_to_string(t->getIntegerBitWidth()) + "_t";
+    } else {
+        throw std::invalid_argument("Cannot convert the LLVM type '" + llvm_type_name(t) + "' to a C type");
+    }
+}
+
+} // namespace
+
+} // namespace detail
+
+void llvm_state::dump_c_header(const std::string &filename) const
+{
+    // If the state has been compiled, we need
+    // to recover the module from the IR snapshot.
+    llvm::LLVMContext tmp_ctx;
+    std::unique_ptr<llvm::Module> tmp_mod;
+
+    if (!m_module) {
+        if (m_ir_snapshot.empty()) {
+            throw std::invalid_argument("Cannot dump a C header for an llvm_state without IR");
+        }
+
+        llvm::SMDiagnostic err;
+        tmp_mod = llvm::parseIR(*llvm::MemoryBuffer::getMemBuffer(m_ir_snapshot), err, tmp_ctx);
+        if (!tmp_mod) {
+            std::string err_report;
+            llvm::raw_string_ostream ostr(err_report);
+
+            err.print("", ostr);
+
+            throw std::invalid_argument("Error parsing the IR while dumping a C header. The full error message:\n"
+                                        + ostr.str());
+        }
+    }
+
+    const auto &md = m_module ? *m_module : *tmp_mod;
+
+    std::ostringstream oss;
+    oss << "// Declarations of the functions contained in the module '" << m_module_name << "'.\n";
+    oss << "// NOTE: this file was generated automatically by heyoka.\n\n";
+    oss << "#include <stdint.h>\n\n";
+    oss << "#ifdef __cplusplus\nextern \"C\" {\n#define HEYOKA_RESTRICT\n";
+    oss << "#else\n#define HEYOKA_RESTRICT restrict\n#endif\n\n";
+
+    // NOTE: only the externally-visible function
+    // definitions are part of the public interface
+    // of the module.
+    for (const auto &f : md) {
+        if (f.isDeclaration() || !f.hasExternalLinkage() || f.getName().startswith("heyoka_")) {
+            continue;
+        }
+
+        oss << detail::llvm_type_to_c(f.getReturnType()) << ' ' << std::string(f.getName()) << '(';
+
+        for (auto it = f.arg_begin(); it != f.arg_end(); ++it) {
+            auto &arg = const_cast<llvm::Argument &>(*it);
+
+            if (it != f.arg_begin()) {
+                oss << ", ";
+            }
+
+            if (arg.getType()->isPointerTy()) {
+                oss << detail::llvm_type_to_c(detail::pointee_type(&arg)) << " *";
+                if (arg.hasNoAliasAttr()) {
+                    oss << "HEYOKA_RESTRICT ";
+                }
+            } else {
+                oss << detail::llvm_type_to_c(arg.getType()) << ' ';
+            }
+
+            if (arg.hasName()) {
+                oss << std::string(arg.getName());
+            } else {
+                oss << "arg_" << arg.getArgNo();
+            }
+        }
+
+        oss << ");\n";
+    }
+
+    oss << "\n#undef HEYOKA_RESTRICT\n\n#ifdef __cplusplus\n}\n#endif\n";
+
+    std::ofstream ofile(filename, std::ios::binary);
+    if (!ofile.good()) {
+        throw std::invalid_argument("Could not open the file '" + filename + "' for dumping a C header");
+    }
+    ofile.exceptions(std::ofstream::failbit | std::ofstream::badbit);
+
+    ofile << oss.str();
+}
+
+// Load into the state the compiled code contained in the file 'filename',
+// which can be either an object file or a static library (e.g., as produced by
+// dump_object_code() or dump_static_library()). The state must be uncompiled
+// and its module must be empty. After loading, the state will be compiled.
+// NOTE: loading the compiled code involves only the runtime linker of the jit
+// (i.e., no optimisation or codegen takes place). The signatures of the loaded
+// functions are not known, thus the compiled code can be fetched only
+// via jit_lookup().
+void llvm_state::load_object_file(const std::string &filename)
+{
+    check_uncompiled(__func__);
+
+    if (!m_module->empty() || !m_module->global_empty()) {
+        throw std::invalid_argument("An object file can be loaded only into an llvm_state with an empty module");
+    }
+
+    auto buf = llvm::MemoryBuffer::getFile(filename);
+    if (!buf) {
+        throw std::invalid_argument("Could not open the object file '" + filename
+                                    + "'. The full error message:\n" + buf.getError().message());
+    }
+
+    // Collect the object files.
+    std::vector<std::string> objs;
+
+    if (llvm::identify_magic((*buf)->getBuffer()) == llvm::file_magic::archive) {
+        auto ar = llvm::object::Archive::create((*buf)->getMemBufferRef());
+        if (!ar) {
+            throw std::invalid_argument("Could not parse the static library '" + filename
+                                        + "'. The full error message:\n" + llvm::toString(ar.takeError()));
+        }
+
+        llvm::Error err = llvm::Error::success();
+        for (const auto &child : (*ar)->children(err)) {
+            auto cbuf = child.getBuffer();
+            if (!cbuf) {
+                // NOTE: make sure err is checked before throwing.
+                llvm::consumeError(std::move(err));
+
+                throw std::invalid_argument("Could not read a member of the static library '" + filename
+                                            + "'. The full error message:\n" + llvm::toString(cbuf.takeError()));
+            }
+
+            objs.emplace_back(*cbuf);
+        }
+        if (err) {
+            throw std::invalid_argument("Could not read the members of the static library '" + filename
+                                        + "'. The full error message:\n" + llvm::toString(std::move(err)));
+        }
+    } else {
+        objs.emplace_back((*buf)->getBuffer());
+    }
+
+    load_objects(objs);
+}
+
+// Load into the state the object code obj (e.g., as returned by get_object_code()
+// on a compiled state). The requirements and the semantics are the same
+// as in load_object_file().
+void llvm_state::load_object_code(const std::string &obj)
+{
+    check_uncompiled(__func__);
 
-        pass.run(*m_module);
+    if (!m_module->empty() || !m_module->global_empty()) {
+        throw std::invalid_argument("Object code can be loaded only into an llvm_state with an empty module");
     }
+
+    if (obj.empty()) {
+        throw std::invalid_argument("Cannot load empty object code into an llvm_state");
+    }
+
+    load_objects({obj});
+}
+
+// Implementation detail of the loading functions: add
+// the object files objs to the jit and mark the state as compiled.
+void llvm_state::load_objects(const std::vector<std::string> &objs)
+{
+    for (const auto &obj : objs) {
+        m_jitter->add_object(obj);
+    }
+
+    if (m_save_object_code && objs.size() == 1u) {
+        m_object_code = objs[0];
+    }
+
+    // Mark the state as compiled.
+    m_ir_snapshot.clear();
+    m_module.reset();
 }
 
 // NOTE: in the fetch_* functions, check_compiled() is run
@@ -1244,6 +2552,142 @@ llvm_state::sfb_t<mppp::real128> llvm_state::fetch_function_batch_f128(const std
 
 #endif
 
+namespace detail
+{
+
+// Implementation of the process-wide cache of compiled
+// llvm_state objects. The cache stores weak references
+// to the jit objects of compiled states, so that the entries
+// expire when all the states sharing a jit are destroyed.
+struct llvm_state_mem_cache {
+    struct entry {
+        std::weak_ptr<llvm_state::jit> m_jitter;
+        std::string m_ir_snapshot;
+        std::string m_object_code;
+        decltype(llvm_state::m_sig_map) m_sig_map;
+    };
+
+    static std::mutex s_mutex;
+    static std::unordered_map<std::string, entry> s_map;
+
+    // Construct the full key from the user-supplied
+    // key and the configuration of the state s.
+    static std::string make_key(const llvm_state &s, const std::string &key)
+    {
+        std::ostringstream oss;
+        oss << key << '\n';
+        oss << s.m_module_name << '\n';
+        oss << s.m_opt_level << ' ' << s.m_use_fast_math << ' ' << s.m_ls_vectorize << ' ' << s.m_save_object_code
+            << ' ' << s.m_lazy << ' ' << s.m_vector_width << ' ' << s.m_shared_session << '\n';
+        oss << s.m_opt_pipeline;
+        for (const auto &t : s.m_mv_targets) {
+            oss << '\n' << t;
+        }
+
+        return llvm::toHex(llvm::SHA1::hash(llvm::arrayRefFromStringRef(oss.str())), true);
+    }
+
+    static bool lookup(llvm_state &s, const std::string &key)
+    {
+        assert(!s.is_compiled());
+
+        const auto full_key = make_key(s, key);
+
+        std::shared_ptr<llvm_state::jit> jitter;
+        entry e;
+
+        {
+            std::lock_guard lock(s_mutex);
+
+            const auto it = s_map.find(full_key);
+            if (it == s_map.end()) {
+                return false;
+            }
+
+            jitter = it->second.m_jitter.lock();
+            if (!jitter) {
+                // The entry has expired, remove it.
+                s_map.erase(it);
+                return false;
+            }
+
+            e = it->second;
+        }
+
+        // NOTE: the module and the builder refer to the context
+        // of the original jit, thus they must be destroyed
+        // before the original jit.
+        s.m_module.reset();
+        s.m_builder.reset();
+        s.m_named_values.clear();
+        s.m_jitter = std::move(jitter);
+        s.m_builder = std::make_unique<llvm::IRBuilder<>>(s.context());
+
+        s.m_ir_snapshot = std::move(e.m_ir_snapshot);
+        s.m_object_code = std::move(e.m_object_code);
+        s.m_sig_map = std::move(e.m_sig_map);
+
+        return true;
+    }
+
+    static void store(const llvm_state &s, const std::string &key)
+    {
+        assert(s.is_compiled());
+
+        const auto full_key = make_key(s, key);
+
+        std::lock_guard lock(s_mutex);
+
+        // Clean up the expired entries.
+        for (auto it = s_map.begin(); it != s_map.end();) {
+            if (it->second.m_jitter.expired()) {
+                it = s_map.erase(it);
+            } else {
+                ++it;
+            }
+        }
+
+        s_map.insert_or_assign(full_key, entry{s.m_jitter, s.m_ir_snapshot, s.m_object_code, s.m_sig_map});
+    }
+};
+
+std::mutex llvm_state_mem_cache::s_mutex;
+
+std::unordered_map<std::string, llvm_state_mem_cache::entry> llvm_state_mem_cache::s_map;
+
+// Try to fetch from the in-process cache a compiled state
+// corresponding to the key 'key' and to the configuration of s.
+// If the lookup is successful, s (which must not be compiled) will become
+// a compiled state sharing the jit with the cached state,
+// and true will be returned. Otherwise, false will be returned
+// and s will not be modified.
+bool llvm_state_mem_cache_lookup(llvm_state &s, const std::string &key)
+{
+    return llvm_state_mem_cache::lookup(s, key);
+}
+
+// Store the compiled state s in the in-process cache with key 'key'.
+void llvm_state_mem_cache_store(const llvm_state &s, const std::string &key)
+{
+    llvm_state_mem_cache::store(s, key);
+}
+
+} // namespace detail
+
+std::ostream &operator<<(std::ostream &os, const llvm_compile_report &r)
+{
+    std::ostringstream oss;
+
+    oss << "Optimisation time  : " << r.opt_time << "s\n";
+    oss << "Compile time       : " << r.compile_time << "s\n";
+    oss << "N of insts (pre)   : " << r.n_insts_pre_opt << '\n';
+    oss << "N of insts (post)  : " << r.n_insts_post_opt << '\n';
+    oss << "N of functions     : " << r.n_funcs << '\n';
+    oss << "Object size        : " << r.obj_size << " bytes\n";
+
+    return os << oss.str();
+}
+
 std::ostream &operator<<(std::ostream &os, const llvm_state &s)
 {
     std::ostringstream oss;
@@ -1253,8 +2697,24 @@ std::ostream &operator<<(std::ostream &os, const llvm_state &s)
     oss << "Compiled           : " << s.is_compiled() << '\n';
     oss << "Fast math          : " << s.m_use_fast_math << '\n';
     oss << "Optimisation level : " << s.m_opt_level << '\n';
+    oss << "Opt. pipeline      : " << s.m_opt_pipeline << '\n';
     oss << "LS vectorize       : " << s.m_ls_vectorize << '\n';
-    oss << "Target triple      : " << s.m_jitter->m_triple->str() << '\n';
+    oss << "Parallel JIT       : " << s.m_parjit << '\n';
+    oss << "Lazy compilation   : " << s.m_lazy << '\n';
+    oss << "Shared session     : " << s.m_shared_session << '\n';
+    oss << "Vector width       : " << (s.m_vector_width == 0u ? std::string{"auto"} : std::to_string(s.m_vector_width))
+        << '\n';
+    oss << "MV targets         : ";
+    if (s.m_mv_targets.empty()) {
+        oss << "none";
+    } else {
+        for (decltype(s.m_mv_targets.size()) i = 0; i < s.m_mv_targets.size(); ++i) {
+            oss << (i == 0u ? "" : " | ") << s.m_mv_targets[i];
+        }
+    }
+    oss << '\n';
+    oss << "Object cache       : " << (s.m_cache_dir.empty() ? std::string{"disabled"} : s.m_cache_dir) << '\n';
+    oss << "Target triple      : " << s.m_jitter->get_triple().str() << '\n';
     oss << "Target CPU         : " << s.m_jitter->get_target_cpu() << '\n';
     oss << "Target features    : " << s.m_jitter->get_target_features() << '\n';
     oss << "IR size            : " << s.get_ir().size() << '\n';
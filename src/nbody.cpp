@@ -149,15 +149,16 @@ std::vector<std::pair<expression, expression>> make_nbody_sys_fixed_masses(std::
             auto r_m3 = pow(diff_x * diff_x + diff_y * diff_y + diff_z * diff_z, expression{number{-3. / 2}});
 
             // Acceleration exerted by j on i.
-            // NOTE: Gconst * masses[j] will be contracted
-            // into a single number by expression's operator*().
+            // NOTE: if the masses are numbers, Gconst * masses[j]
+            // will be contracted into a single number by expression's operator*().
             x_acc[i].push_back(Gconst * masses[j] * (diff_x * r_m3));
             y_acc[i].push_back(Gconst * masses[j] * (diff_y * r_m3));
             z_acc[i].push_back(Gconst * masses[j] * (diff_z * r_m3));
 
             // Acceleration exerted by i on j.
             // NOTE: do the negation on the masses, which
-            // here are guaranteed to have numerical values.
+            // will be folded into the mass values if
+            // the masses are numbers.
             x_acc[j].push_back(Gconst * -masses[i] * (diff_x * r_m3));
             y_acc[j].push_back(Gconst * -masses[i] * (diff_y * r_m3));
             z_acc[j].push_back(Gconst * -masses[i] * (diff_z * r_m3));
@@ -0,0 +1,217 @@
+// Copyright 2020 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <heyoka/config.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <llvm/IR/Value.h>
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+#include <mp++/real128.hpp>
+
+#endif
+
+#include <heyoka/detail/string_conv.hpp>
+#include <heyoka/expression.hpp>
+#include <heyoka/llvm_state.hpp>
+#include <heyoka/number.hpp>
+#include <heyoka/param.hpp>
+
+namespace heyoka
+{
+
+param::param(std::uint32_t idx) : m_index(idx) {}
+
+param::param(const param &) = default;
+
+param::param(param &&) noexcept = default;
+
+param::~param() = default;
+
+param &param::operator=(const param &) = default;
+
+param &param::operator=(param &&) noexcept = default;
+
+std::uint32_t &param::idx()
+{
+    return m_index;
+}
+
+const std::uint32_t &param::idx() const
+{
+    return m_index;
+}
+
+void swap(param &p0, param &p1) noexcept
+{
+    std::swap(p0.idx(), p1.idx());
+}
+
+std::size_t hash(const param &p)
+{
+    return std::hash<std::uint32_t>{}(p.idx());
+}
+
+std::ostream &operator<<(std::ostream &os, const param &p)
+{
+    return os << "par[" << detail::li_to_string(p.idx()) << ']';
+}
+
+std::vector<std::string> get_variables(const param &)
+{
+    return {};
+}
+
+void rename_variables(param &, const std::unordered_map<std::string, std::string> &) {}
+
+bool operator==(const param &p0, const param &p1)
+{
+    return p0.idx() == p1.idx();
+}
+
+bool operator!=(const param &p0, const param &p1)
+{
+    return !(p0 == p1);
+}
+
+expression subs(const param &p, const std::unordered_map<std::string, expression> &)
+{
+    return expression{p};
+}
+
+expression diff(const param &, const std::string &)
+{
+    return expression{number{0.}};
+}
+
+[[noreturn]] double eval_dbl(const param &p, const std::unordered_map<std::string, double> &)
+{
+    throw std::invalid_argument("Cannot evaluate the parameter '" + detail::li_to_string(p.idx())
+                                + "': the evaluation of runtime parameters is not supported");
+}
+
+[[noreturn]] void eval_batch_dbl(std::vector<double> &, const param &p,
+                                 const std::unordered_map<std::string, std::vector<double>> &)
+{
+    throw std::invalid_argument("Cannot evaluate the parameter '" + detail::li_to_string(p.idx())
+                                + "': the evaluation of runtime parameters is not supported");
+}
+
+void update_connections(std::vector<std::vector<std::size_t>> &node_connections, const param &,
+                        std::size_t &node_counter)
+{
+    node_connections.push_back(std::vector<std::size_t>());
+    node_counter++;
+}
+
+[[noreturn]] void update_node_values_dbl(std::vector<double> &, const param &p,
+                                         const std::unordered_map<std::string, double> &,
+                                         const std::vector<std::vector<std::size_t>> &, std::size_t &)
+{
+    throw std::invalid_argument("Cannot update the node output for the parameter '" + detail::li_to_string(p.idx())
+                                + "': the evaluation of runtime parameters is not supported");
+}
+
+void update_grad_dbl(std::unordered_map<std::string, double> &, const param &,
+                     const std::unordered_map<std::string, double> &, const std::vector<double> &,
+                     const std::vector<std::vector<std::size_t>> &, std::size_t &node_counter, double)
+{
+    // NOTE: parameters are constants, nothing
+    // to accumulate in the gradient.
+    node_counter++;
+}
+
+[[noreturn]] llvm::Value *codegen_dbl(llvm_state &, const param &p)
+{
+    throw std::invalid_argument("Cannot generate the LLVM code for the parameter '" + detail::li_to_string(p.idx())
+                                + "': runtime parameters are supported only in Taylor integrators and jets");
+}
+
+[[noreturn]] llvm::Value *codegen_ldbl(llvm_state &s, const param &p)
+{
+    codegen_dbl(s, p);
+}
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+[[noreturn]] llvm::Value *codegen_f128(llvm_state &s, const param &p)
+{
+    codegen_dbl(s, p);
+}
+
+#endif
+
+std::vector<expression>::size_type taylor_decompose_in_place(param &&p, std::vector<expression> &u_vars_defs)
+{
+    // NOTE: a parameter is turned into a u variable of its own.
+    // In the computation of a Taylor jet, the order-0 derivative
+    // of such a u variable is loaded from the array of parameter values,
+    // and all the higher-order derivatives are zero. This way, the Taylor
+    // derivatives of the binary operators and of the functions
+    // need to deal only with numbers and u variables.
+    u_vars_defs.emplace_back(std::move(p));
+
+    return u_vars_defs.size() - 1u;
+}
+
+[[noreturn]] llvm::Value *taylor_u_init_dbl(llvm_state &, const param &, const std::vector<llvm::Value *> &,
+                                            std::uint32_t)
+{
+    throw std::invalid_argument("The Taylor initialization phase of a parameter is performed directly from the array "
+                                "of parameter values in the computation of a Taylor jet");
+}
+
+[[noreturn]] llvm::Value *taylor_u_init_ldbl(llvm_state &s, const param &p, const std::vector<llvm::Value *> &arr,
+                                             std::uint32_t batch_size)
+{
+    taylor_u_init_dbl(s, p, arr, batch_size);
+}
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+[[noreturn]] llvm::Value *taylor_u_init_f128(llvm_state &s, const param &p, const std::vector<llvm::Value *> &arr,
+                                             std::uint32_t batch_size)
+{
+    taylor_u_init_dbl(s, p, arr, batch_size);
+}
+
+#endif
+
+[[noreturn]] llvm::Value *taylor_c_u_init_dbl(llvm_state &, const param &, llvm::Value *, std::uint32_t)
+{
+    throw std::invalid_argument("The Taylor initialization phase of a parameter is performed directly from the array "
+                                "of parameter values in the computation of a Taylor jet");
+}
+
+[[noreturn]] llvm::Value *taylor_c_u_init_ldbl(llvm_state &s, const param &p, llvm::Value *diff_arr,
+                                               std::uint32_t batch_size)
+{
+    taylor_c_u_init_dbl(s, p, diff_arr, batch_size);
+}
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+[[noreturn]] llvm::Value *taylor_c_u_init_f128(llvm_state &s, const param &p, llvm::Value *diff_arr,
+                                               std::uint32_t batch_size)
+{
+    taylor_c_u_init_dbl(s, p, diff_arr, batch_size);
+}
+
+#endif
+
+} // namespace heyoka
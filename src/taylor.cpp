@@ -10,19 +10,25 @@
 
 #include <algorithm>
 #include <cassert>
+#include <chrono>
 #include <cmath>
 #include <cstddef>
 #include <cstdint>
 #include <deque>
+#include <functional>
+#include <istream>
 #include <iterator>
 #include <limits>
+#include <locale>
 #include <numeric>
 #include <optional>
+#include <ostream>
 #include <sstream>
 #include <stdexcept>
 #include <string>
 #include <tuple>
 #include <type_traits>
+#include <typeinfo>
 #include <unordered_map>
 #include <unordered_set>
 #include <utility>
@@ -32,14 +38,18 @@
 #include <boost/graph/adjacency_list.hpp>
 #include <boost/numeric/conversion/cast.hpp>
 
+#include <llvm/ADT/StringExtras.h>
 #include <llvm/IR/Attributes.h>
 #include <llvm/IR/BasicBlock.h>
+#include <llvm/IR/Constants.h>
 #include <llvm/IR/DerivedTypes.h>
 #include <llvm/IR/Function.h>
+#include <llvm/IR/GlobalVariable.h>
 #include <llvm/IR/Operator.h>
 #include <llvm/IR/Type.h>
 #include <llvm/IR/Value.h>
 #include <llvm/Support/Casting.h>
+#include <llvm/Support/SHA1.h>
 
 #if defined(HEYOKA_HAVE_REAL128)
 
@@ -47,14 +57,18 @@
 
 #endif
 
+#include <heyoka/binary_operator.hpp>
 #include <heyoka/detail/llvm_helpers.hpp>
 #include <heyoka/detail/math_wrappers.hpp>
 #include <heyoka/detail/sleef.hpp>
 #include <heyoka/detail/string_conv.hpp>
 #include <heyoka/detail/type_traits.hpp>
 #include <heyoka/expression.hpp>
+#include <heyoka/function.hpp>
 #include <heyoka/llvm_state.hpp>
+#include <heyoka/math_functions.hpp>
 #include <heyoka/number.hpp>
+#include <heyoka/param.hpp>
 #include <heyoka/taylor.hpp>
 #include <heyoka/variable.hpp>
 
@@ -86,13 +100,16 @@ namespace
 
 // Simplify a Taylor decomposition by removing
 // common subexpressions.
-std::vector<expression> taylor_decompose_cse(std::vector<expression> &v_ex, std::vector<expression>::size_type n_eq)
+// NOTE: n_ev is the number of event functions whose
+// definitions are appended at the end of the decomposition.
+std::vector<expression> taylor_decompose_cse(std::vector<expression> &v_ex, std::vector<expression>::size_type n_eq,
+                                             std::vector<expression>::size_type n_ev)
 {
     // A Taylor decomposition is supposed
     // to have n_eq variables at the beginning,
-    // n_eq variables at the end and possibly
-    // extra variables in the middle.
-    assert(v_ex.size() >= n_eq * 2u);
+    // n_eq variables (plus n_ev event functions) at the end
+    // and possibly extra variables in the middle.
+    assert(v_ex.size() >= n_eq * 2u + n_ev);
 
     using idx_t = std::vector<expression>::size_type;
 
@@ -115,7 +132,7 @@ std::vector<expression> taylor_decompose_cse(std::vector<expression> &v_ex, std:
         retval.emplace_back(std::move(v_ex[i]));
     }
 
-    for (auto i = n_eq; i < v_ex.size() - n_eq; ++i) {
+    for (auto i = n_eq; i < v_ex.size() - n_eq - n_ev; ++i) {
         auto &ex = v_ex[i];
 
         // Rename the u variables in ex.
@@ -149,11 +166,11 @@ std::vector<expression> taylor_decompose_cse(std::vector<expression> &v_ex, std:
         }
     }
 
-    // Handle the derivatives of the state variables at the
-    // end of the decomposition. We just need to ensure that
-    // the u variables in their definitions are renamed with
-    // the new indices.
-    for (auto i = v_ex.size() - n_eq; i < v_ex.size(); ++i) {
+    // Handle the derivatives of the state variables and the
+    // event functions at the end of the decomposition. We just need
+    // to ensure that the u variables in their definitions are renamed
+    // with the new indices.
+    for (auto i = v_ex.size() - n_eq - n_ev; i < v_ex.size(); ++i) {
         auto &ex = v_ex[i];
 
         rename_variables(ex, uvars_rename);
@@ -182,13 +199,20 @@ std::vector<expression> taylor_decompose_cse(std::vector<expression> &v_ex, std:
 // - make this extra sorting deactivatable with a kw arg,
 // - do the decomposition in breadth-first fashion directly,
 //   thus avoiding this extra sorting.
-auto taylor_sort_dc(std::vector<expression> &dc, std::vector<expression>::size_type n_eq)
+// NOTE: n_ev is the number of event functions whose
+// definitions are appended at the end of the decomposition.
+auto taylor_sort_dc(std::vector<expression> &dc, std::vector<expression>::size_type n_eq,
+                    std::vector<expression>::size_type n_ev)
 {
     // A Taylor decomposition is supposed
     // to have n_eq variables at the beginning,
-    // n_eq variables at the end and possibly
-    // extra variables in the middle
-    assert(dc.size() >= n_eq * 2u);
+    // n_eq variables (plus n_ev event functions) at the end
+    // and possibly extra variables in the middle
+    assert(dc.size() >= n_eq * 2u + n_ev);
+
+    // The number of trailing elements (derivatives
+    // of the state variables and event functions).
+    const auto n_tail = n_eq + n_ev;
 
     // The graph type that we will use for the topological sorting.
     using graph_t = boost::adjacency_list<boost::vecS,           // std::vector for list of adjacent vertices
@@ -215,7 +239,7 @@ auto taylor_sort_dc(std::vector<expression> &dc, std::vector<expression>::size_t
     }
 
     // Add the rest of the u variables.
-    for (decltype(n_eq) i = n_eq; i < dc.size() - n_eq; ++i) {
+    for (decltype(n_eq) i = n_eq; i < dc.size() - n_tail; ++i) {
         auto v = boost::add_vertex(g);
 
         // Fetch the list of variables in the current expression.
@@ -244,7 +268,7 @@ auto taylor_sort_dc(std::vector<expression> &dc, std::vector<expression>::size_t
         }
     }
 
-    assert(boost::num_vertices(g) - 1u == dc.size() - n_eq);
+    assert(boost::num_vertices(g) - 1u == dc.size() - n_tail);
 
     // Run the BF topological sort on the graph. This is Kahn's algorithm:
     // https://en.wikipedia.org/wiki/Topological_sorting
@@ -304,16 +328,16 @@ auto taylor_sort_dc(std::vector<expression> &dc, std::vector<expression>::size_t
 
     // Adjust v_idx: remove the index of the root node,
     // decrease by one all other indices, insert the final
-    // n_eq indices.
+    // n_tail indices.
     for (decltype(v_idx.size()) i = 0; i < v_idx.size() - 1u; ++i) {
         v_idx[i] = v_idx[i + 1u] - 1u;
     }
     v_idx.resize(boost::numeric_cast<decltype(v_idx.size())>(dc.size()));
-    std::iota(v_idx.data() + dc.size() - n_eq, v_idx.data() + dc.size(), dc.size() - n_eq);
+    std::iota(v_idx.data() + dc.size() - n_tail, v_idx.data() + dc.size(), dc.size() - n_tail);
 
     // Create the remapping dictionary.
     std::unordered_map<std::string, std::string> remap;
-    for (decltype(v_idx.size()) i = n_eq; i < v_idx.size() - n_eq; ++i) {
+    for (decltype(v_idx.size()) i = n_eq; i < v_idx.size() - n_tail; ++i) {
         if (v_idx[i] != i) {
             remap.emplace("u_" + li_to_string(v_idx[i]), "u_" + li_to_string(i));
         }
@@ -336,13 +360,18 @@ auto taylor_sort_dc(std::vector<expression> &dc, std::vector<expression>::size_t
 #if !defined(NDEBUG)
 
 // Helper to verify a Taylor decomposition.
-void verify_taylor_dec(const std::vector<expression> &orig, const std::vector<expression> &dc)
+// NOTE: orig contains the right-hand sides of the system
+// followed by the n_ev event functions.
+void verify_taylor_dec(const std::vector<expression> &orig, const std::vector<expression> &dc,
+                       std::vector<expression>::size_type n_ev)
 {
     using idx_t = std::vector<expression>::size_type;
 
-    const auto n_eq = orig.size();
+    assert(orig.size() >= n_ev);
+    const auto n_eq = orig.size() - n_ev;
+    const auto n_tail = orig.size();
 
-    assert(dc.size() >= n_eq * 2u);
+    assert(dc.size() >= n_eq * 2u + n_ev);
 
     // The first n_eq expressions of u variables
     // must be just variables.
@@ -350,20 +379,20 @@ void verify_taylor_dec(const std::vector<expression> &orig, const std::vector<ex
         assert(std::holds_alternative<variable>(dc[i].value()));
     }
 
-    // From n_eq to dc.size() - n_eq, the expressions
+    // From n_eq to dc.size() - n_tail, the expressions
     // must contain variables only in the u_n form,
     // where n < i.
-    for (auto i = n_eq; i < dc.size() - n_eq; ++i) {
+    for (auto i = n_eq; i < dc.size() - n_tail; ++i) {
         for (const auto &var : get_variables(dc[i])) {
             assert(var.rfind("u_", 0) == 0);
             assert(uname_to_index(var) < i);
         }
     }
 
-    // From dc.size() - n_eq to dc.size(), the expressions
+    // From dc.size() - n_tail to dc.size(), the expressions
     // must be either variables in the u_n form, where n < i,
     // or numbers.
-    for (auto i = dc.size() - n_eq; i < dc.size(); ++i) {
+    for (auto i = dc.size() - n_tail; i < dc.size(); ++i) {
         std::visit(
             [i](const auto &v) {
                 using type = detail::uncvref_t<decltype(v)>;
@@ -383,126 +412,29 @@ void verify_taylor_dec(const std::vector<expression> &orig, const std::vector<ex
     // For each u variable, expand its definition
     // in terms of state variables or other u variables,
     // and store it in subs_map.
-    for (idx_t i = 0; i < dc.size() - n_eq; ++i) {
+    for (idx_t i = 0; i < dc.size() - n_tail; ++i) {
         subs_map.emplace("u_" + li_to_string(i), subs(dc[i], subs_map));
     }
 
     // Reconstruct the right-hand sides of the system
-    // and compare them to the original ones.
-    for (auto i = dc.size() - n_eq; i < dc.size(); ++i) {
-        assert(subs(dc[i], subs_map) == orig[i - (dc.size() - n_eq)]);
+    // and the event functions, and compare them to the original ones.
+    for (auto i = dc.size() - n_tail; i < dc.size(); ++i) {
+        assert(subs(dc[i], subs_map) == orig[i - (dc.size() - n_tail)]);
     }
 }
 
 #endif
 
-} // namespace
-
-} // namespace detail
-
-// Taylor decomposition with automatic deduction
-// of variables.
-std::vector<expression> taylor_decompose(std::vector<expression> v_ex)
-{
-    if (v_ex.empty()) {
-        throw std::invalid_argument("Cannot decompose a system of zero equations");
-    }
-
-    // Determine the variables in the system of equations.
-    std::vector<std::string> vars;
-    for (const auto &ex : v_ex) {
-        auto ex_vars = get_variables(ex);
-        vars.insert(vars.end(), std::make_move_iterator(ex_vars.begin()), std::make_move_iterator(ex_vars.end()));
-        std::sort(vars.begin(), vars.end());
-        vars.erase(std::unique(vars.begin(), vars.end()), vars.end());
-    }
-
-    if (vars.size() != v_ex.size()) {
-        throw std::invalid_argument("The number of deduced variables for a Taylor decomposition ("
-                                    + std::to_string(vars.size()) + ") differs from the number of equations ("
-                                    + std::to_string(v_ex.size()) + ")");
-    }
-
-    // Cache the number of equations/variables
-    // for later use.
-    const auto n_eq = v_ex.size();
-
-    // Create the map for renaming the variables to u_i.
-    // The renaming will be done in alphabetical order.
-    std::unordered_map<std::string, std::string> repl_map;
-    for (decltype(vars.size()) i = 0; i < vars.size(); ++i) {
-        [[maybe_unused]] const auto eres = repl_map.emplace(vars[i], "u_" + detail::li_to_string(i));
-        assert(eres.second);
-    }
-
-#if !defined(NDEBUG)
-    // Store a copy of the original system for checking later.
-    const auto orig_v_ex = v_ex;
-#endif
-
-    // Rename the variables in the original equations.
-    for (auto &ex : v_ex) {
-        rename_variables(ex, repl_map);
-    }
-
-    // Init the vector containing the definitions
-    // of the u variables. It begins with a list
-    // of the original variables of the system.
-    std::vector<expression> u_vars_defs;
-    for (const auto &var : vars) {
-        u_vars_defs.emplace_back(variable{var});
-    }
-
-    // Create a copy of the original equations in terms of u variables.
-    // We will be reusing this below.
-    auto v_ex_copy = v_ex;
-
-    // Run the decomposition on each equation.
-    for (decltype(v_ex.size()) i = 0; i < v_ex.size(); ++i) {
-        // Decompose the current equation.
-        if (const auto dres = taylor_decompose_in_place(std::move(v_ex[i]), u_vars_defs)) {
-            // NOTE: if the equation was decomposed
-            // (that is, it is not constant or a single variable),
-            // we have to update the original definition
-            // of the equation in v_ex_copy
-            // so that it points to the u variable
-            // that now represents it.
-            v_ex_copy[i] = expression{variable{"u_" + detail::li_to_string(dres)}};
-        }
-    }
-
-    // Append the (possibly updated) definitions of the diff equations
-    // in terms of u variables.
-    for (auto &ex : v_ex_copy) {
-        u_vars_defs.emplace_back(std::move(ex));
-    }
-
-#if !defined(NDEBUG)
-    // Verify the decomposition.
-    detail::verify_taylor_dec(orig_v_ex, u_vars_defs);
-#endif
-
-    // Simplify the decomposition.
-    u_vars_defs = detail::taylor_decompose_cse(u_vars_defs, n_eq);
-
-#if !defined(NDEBUG)
-    // Verify the simplified decomposition.
-    detail::verify_taylor_dec(orig_v_ex, u_vars_defs);
-#endif
-
-    u_vars_defs = detail::taylor_sort_dc(u_vars_defs, n_eq);
-
-#if !defined(NDEBUG)
-    // Verify the reordered decomposition.
-    detail::verify_taylor_dec(orig_v_ex, u_vars_defs);
-#endif
-
-    return u_vars_defs;
-}
-
-// Taylor decomposition from lhs and rhs
-// of a system of equations.
-std::vector<expression> taylor_decompose(std::vector<std::pair<expression, expression>> sys)
+// Taylor decomposition of a system of equations given
+// as lhs/rhs pairs, augmented with the event functions evs.
+// The return value contains the Taylor decomposition of the
+// system (in the same format returned by taylor_decompose())
+// and the definitions of the event functions in terms of
+// u variables.
+// NOTE: the u variables needed to compute the event functions
+// are included in the decomposition of the system.
+std::pair<std::vector<expression>, std::vector<expression>>
+taylor_decompose_impl(std::vector<std::pair<expression, expression>> sys, std::vector<expression> evs)
 {
     if (sys.empty()) {
         throw std::invalid_argument("Cannot decompose a system of zero equations");
@@ -516,6 +448,9 @@ std::vector<expression> taylor_decompose(std::vector<std::pair<expression, expre
     //   appear in the lhs expressions.
     // Note that not all variables in the lhs
     // need to appear in the rhs.
+    // The event functions are subject to the same
+    // checks as the rhs expressions, and, in addition,
+    // they must depend on at least one variable.
 
     // This will eventually contain the list
     // of all variables in the system.
@@ -532,7 +467,7 @@ std::vector<expression> taylor_decompose(std::vector<std::pair<expression, expre
         // Infer the variable from the current lhs.
         std::visit(
             [&lhs, &lhs_vars, &lhs_vars_set](const auto &v) {
-                if constexpr (std::is_same_v<detail::uncvref_t<decltype(v)>, variable>) {
+                if constexpr (std::is_same_v<uncvref_t<decltype(v)>, variable>) {
                     // Check if this is a duplicate variable.
                     if (auto res = lhs_vars_set.emplace(v.name()); res.second) {
                         // Not a duplicate, add it to lhs_vars.
@@ -569,31 +504,61 @@ std::vector<expression> taylor_decompose(std::vector<std::pair<expression, expre
         }
     }
 
-    // Cache the number of equations/variables.
+    // Check the event functions.
+    for (const auto &ev : evs) {
+        const auto ev_vars = get_variables(ev);
+
+        if (ev_vars.empty()) {
+            std::ostringstream oss;
+            oss << ev;
+
+            throw std::invalid_argument("Error in the Taylor decomposition of the event function '" + oss.str()
+                                        + "': the event function does not depend on any variable");
+        }
+
+        for (const auto &var : ev_vars) {
+            if (lhs_vars_set.find(var) == lhs_vars_set.end()) {
+                throw std::invalid_argument("Error in the Taylor decomposition of an event function: the variable '"
+                                            + var
+                                            + "' appears in the event function but not in the left-hand side of the "
+                                              "system of equations");
+            }
+        }
+    }
+
+    // Cache the number of equations/variables
+    // and the number of event functions.
     const auto n_eq = sys.size();
     assert(n_eq == lhs_vars.size());
+    const auto n_ev = evs.size();
 
     // Create the map for renaming the variables to u_i.
     // The renaming will be done following the order of the lhs
     // variables.
     std::unordered_map<std::string, std::string> repl_map;
     for (decltype(lhs_vars.size()) i = 0; i < lhs_vars.size(); ++i) {
-        [[maybe_unused]] const auto eres = repl_map.emplace(lhs_vars[i], "u_" + detail::li_to_string(i));
+        [[maybe_unused]] const auto eres = repl_map.emplace(lhs_vars[i], "u_" + li_to_string(i));
         assert(eres.second);
     }
 
 #if !defined(NDEBUG)
-    // Store a copy of the original rhs for checking later.
+    // Store a copy of the original rhs and event
+    // functions for checking later.
     std::vector<expression> orig_rhs;
     for (const auto &[_, rhs_ex] : sys) {
         orig_rhs.push_back(rhs_ex);
     }
+    orig_rhs.insert(orig_rhs.end(), evs.begin(), evs.end());
 #endif
 
-    // Rename the variables in the original equations.
+    // Rename the variables in the original equations
+    // and in the event functions.
     for (auto &[_, rhs_ex] : sys) {
         rename_variables(rhs_ex, repl_map);
     }
+    for (auto &ev : evs) {
+        rename_variables(ev, repl_map);
+    }
 
     // Init the vector containing the definitions
     // of the u variables. It begins with a list
@@ -603,9 +568,10 @@ std::vector<expression> taylor_decompose(std::vector<std::pair<expression, expre
         u_vars_defs.emplace_back(variable{var});
     }
 
-    // Create a copy of the original equations in terms of u variables.
-    // We will be reusing this below.
+    // Create a copy of the original equations and event functions
+    // in terms of u variables. We will be reusing this below.
     auto sys_copy = sys;
+    auto evs_copy = evs;
 
     // Run the decomposition on each equation.
     for (decltype(sys.size()) i = 0; i < sys.size(); ++i) {
@@ -617,210 +583,1345 @@ std::vector<expression> taylor_decompose(std::vector<std::pair<expression, expre
             // of the equation in sys_copy
             // so that it points to the u variable
             // that now represents it.
-            sys_copy[i].second = expression{variable{"u_" + detail::li_to_string(dres)}};
+            sys_copy[i].second = expression{variable{"u_" + li_to_string(dres)}};
+        }
+    }
+
+    // Run the decomposition on each event function.
+    for (decltype(evs.size()) i = 0; i < evs.size(); ++i) {
+        if (const auto dres = taylor_decompose_in_place(std::move(evs[i]), u_vars_defs)) {
+            evs_copy[i] = expression{variable{"u_" + li_to_string(dres)}};
         }
     }
 
     // Append the (possibly updated) definitions of the diff equations
-    // in terms of u variables.
+    // and of the event functions in terms of u variables.
     for (auto &[_, rhs] : sys_copy) {
         u_vars_defs.emplace_back(std::move(rhs));
     }
+    for (auto &ev : evs_copy) {
+        u_vars_defs.emplace_back(std::move(ev));
+    }
 
 #if !defined(NDEBUG)
     // Verify the decomposition.
-    detail::verify_taylor_dec(orig_rhs, u_vars_defs);
+    verify_taylor_dec(orig_rhs, u_vars_defs, n_ev);
 #endif
 
     // Simplify the decomposition.
-    u_vars_defs = detail::taylor_decompose_cse(u_vars_defs, n_eq);
+    u_vars_defs = taylor_decompose_cse(u_vars_defs, n_eq, n_ev);
 
 #if !defined(NDEBUG)
     // Verify the simplified decomposition.
-    detail::verify_taylor_dec(orig_rhs, u_vars_defs);
+    verify_taylor_dec(orig_rhs, u_vars_defs, n_ev);
 #endif
 
-    u_vars_defs = detail::taylor_sort_dc(u_vars_defs, n_eq);
+    u_vars_defs = taylor_sort_dc(u_vars_defs, n_eq, n_ev);
 
 #if !defined(NDEBUG)
     // Verify the reordered decomposition.
-    detail::verify_taylor_dec(orig_rhs, u_vars_defs);
+    verify_taylor_dec(orig_rhs, u_vars_defs, n_ev);
 #endif
 
-    return u_vars_defs;
-}
+    // Split off the definitions of the event functions.
+    std::vector<expression> ev_dc;
+    for (auto i = u_vars_defs.size() - n_ev; i < u_vars_defs.size(); ++i) {
+        ev_dc.push_back(std::move(u_vars_defs[i]));
+    }
+    u_vars_defs.erase(u_vars_defs.begin()
+                          + boost::numeric_cast<std::vector<expression>::difference_type>(u_vars_defs.size() - n_ev),
+                      u_vars_defs.end());
 
-namespace detail
-{
+    return std::pair{std::move(u_vars_defs), std::move(ev_dc)};
+}
 
-template <typename T>
-template <typename U>
-void taylor_adaptive_impl<T>::finalise_ctor_impl(U sys, std::vector<T> state, T time, T tol, bool high_accuracy,
-                                                 bool compact_mode)
+// Taylor decomposition with automatic deduction
+// of variables, augmented with the event functions evs.
+std::pair<std::vector<expression>, std::vector<expression>> taylor_decompose_impl(std::vector<expression> v_ex,
+                                                                                  std::vector<expression> evs)
 {
-    // Assign the data members.
-    m_state = std::move(state);
-    m_time = time;
-
-    // Check input params.
-    if (std::any_of(m_state.begin(), m_state.end(), [](const auto &x) { return !detail::isfinite(x); })) {
-        throw std::invalid_argument(
-            "A non-finite value was detected in the initial state of an adaptive Taylor integrator");
+    if (v_ex.empty()) {
+        throw std::invalid_argument("Cannot decompose a system of zero equations");
     }
 
-    if (m_state.size() != sys.size()) {
-        throw std::invalid_argument("Inconsistent sizes detected in the initialization of an adaptive Taylor "
-                                    "integrator: the state vector has a dimension of "
-                                    + std::to_string(m_state.size()) + ", while the number of equations is "
-                                    + std::to_string(sys.size()));
+    // Determine the variables in the system of equations.
+    std::vector<std::string> vars;
+    for (const auto &ex : v_ex) {
+        auto ex_vars = get_variables(ex);
+        vars.insert(vars.end(), std::make_move_iterator(ex_vars.begin()), std::make_move_iterator(ex_vars.end()));
+        std::sort(vars.begin(), vars.end());
+        vars.erase(std::unique(vars.begin(), vars.end()), vars.end());
     }
 
-    if (!detail::isfinite(m_time)) {
-        throw std::invalid_argument("Cannot initialise an adaptive Taylor integrator with a non-finite initial time of "
-                                    + detail::li_to_string(m_time));
+    if (vars.size() != v_ex.size()) {
+        throw std::invalid_argument("The number of deduced variables for a Taylor decomposition ("
+                                    + std::to_string(vars.size()) + ") differs from the number of equations ("
+                                    + std::to_string(v_ex.size()) + ")");
     }
 
-    if (!detail::isfinite(tol) || tol <= 0) {
-        throw std::invalid_argument(
-            "The tolerance in an adaptive Taylor integrator must be finite and positive, but it is " + li_to_string(tol)
-            + " instead");
+    // Build the lhs/rhs pairs, following the alphabetical
+    // order of the variables.
+    std::vector<std::pair<expression, expression>> sys;
+    for (decltype(vars.size()) i = 0; i < vars.size(); ++i) {
+        sys.emplace_back(expression{variable{vars[i]}}, std::move(v_ex[i]));
     }
 
-    // Add the stepper function.
-    m_dc = taylor_add_adaptive_step<T>(m_llvm, "step", std::move(sys), tol, 1, high_accuracy, compact_mode);
+    return taylor_decompose_impl(std::move(sys), std::move(evs));
+}
 
-    // Run the jit.
-    m_llvm.compile();
+} // namespace
 
-    // Fetch the stepper.
-    m_step_f = reinterpret_cast<step_f_t>(m_llvm.jit_lookup("step"));
-}
+} // namespace detail
 
-template <typename T>
-taylor_adaptive_impl<T>::taylor_adaptive_impl(const taylor_adaptive_impl &other)
-    // NOTE: make a manual copy of all members, apart from the function pointer.
-    : m_state(other.m_state), m_time(other.m_time), m_llvm(other.m_llvm), m_dc(other.m_dc)
+// Taylor decomposition with automatic deduction
+// of variables.
+std::vector<expression> taylor_decompose(std::vector<expression> v_ex)
 {
-    m_step_f = reinterpret_cast<step_f_t>(m_llvm.jit_lookup("step"));
+    return detail::taylor_decompose_impl(std::move(v_ex), {}).first;
 }
 
-template <typename T>
-taylor_adaptive_impl<T>::taylor_adaptive_impl(taylor_adaptive_impl &&) noexcept = default;
+// Taylor decomposition from lhs and rhs
+// of a system of equations.
+std::vector<expression> taylor_decompose(std::vector<std::pair<expression, expression>> sys)
+{
+    return detail::taylor_decompose_impl(std::move(sys), {}).first;
+}
 
-template <typename T>
-taylor_adaptive_impl<T> &taylor_adaptive_impl<T>::operator=(const taylor_adaptive_impl &other)
+namespace detail
 {
-    if (this != &other) {
-        *this = taylor_adaptive_impl(other);
-    }
 
-    return *this;
-}
+namespace
+{
 
+// Forward declarations.
 template <typename T>
-taylor_adaptive_impl<T> &taylor_adaptive_impl<T>::operator=(taylor_adaptive_impl &&) noexcept = default;
-
+void taylor_add_adaptive_step_dc(llvm_state &, const std::string &, const std::vector<expression> &,
+                                 const std::vector<expression> &, std::uint32_t, T, std::uint32_t, bool, bool, bool,
+                                 const std::vector<T> & = {}, const std::vector<T> & = {}, bool = false,
+                                 const std::vector<T> & = {}, taylor_layout = taylor_layout::soa,
+                                 std::chrono::steady_clock::time_point * = nullptr);
 template <typename T>
-taylor_adaptive_impl<T>::~taylor_adaptive_impl() = default;
+void taylor_add_d_out_function(llvm_state &, std::uint32_t, std::uint32_t, std::uint32_t, bool, bool,
+                               taylor_layout = taylor_layout::soa);
 
-// Implementation detail to make a single integration timestep.
-// The magnitude of the timestep is automatically deduced, but it will
-// always be not greater than abs(max_delta_t). The propagation
-// is done forward in time if max_delta_t >= 0, backwards in
-// time otherwise.
-//
-// The function will return a pair, containing
-// a flag describing the outcome of the integration,
-// and the integration timestep that was used.
+// Determine the Taylor order of an adaptive stepper from the tolerance.
 template <typename T>
-std::tuple<taylor_outcome, T> taylor_adaptive_impl<T>::step_impl(T max_delta_t)
+std::uint32_t taylor_order_from_tol(T tol)
 {
-    // Check the current state before invoking the stepper.
-    if (std::any_of(m_state.cbegin(), m_state.cend(), [](const auto &x) { return !detail::isfinite(x); })) {
-        return std::tuple{taylor_outcome::err_nf_state, T(0)};
-    }
+    using std::ceil;
+    using std::log;
 
-    // Invoke the stepper.
-    auto h = max_delta_t;
-    m_step_f(m_state.data(), &h);
+    // Determine the order from the tolerance.
+    auto order_f = ceil(-log(tol) / 2 + 1);
+    if (!detail::isfinite(order_f)) {
+        throw std::invalid_argument(
+            "The computation of the Taylor order in an adaptive Taylor stepper produced a non-finite value");
+    }
+    // NOTE: min order is 2.
+    order_f = std::max(T(2), order_f);
 
-    // Update the time.
-    m_time += h;
+    // NOTE: static cast is safe because we know that T is at least
+    // a double-precision IEEE type.
+    if (order_f > static_cast<T>(std::numeric_limits<std::uint32_t>::max())) {
+        throw std::overflow_error("The computation of the Taylor order in an adaptive Taylor stepper resulted "
+                                  "in an overflow condition");
+    }
 
-    return std::tuple{h == max_delta_t ? taylor_outcome::time_limit : taylor_outcome::success, h};
+    return static_cast<std::uint32_t>(order_f);
 }
 
+// Validate the per-variable tolerances atol and rtol and the indices
+// tol_exclude of the variables excluded from the step-size control,
+// and return the per-variable tolerances to be used in the construction
+// of the stepper. If no per-variable tolerance and no excluded
+// variable is provided, two empty vectors are returned, which signals
+// to use the global tolerance tol for all variables.
+// NOTE: the excluded variables are marked with an infinite
+// absolute tolerance in the return value.
 template <typename T>
-std::tuple<taylor_outcome, T> taylor_adaptive_impl<T>::step()
+std::pair<std::vector<T>, std::vector<T>> taylor_setup_var_tols(std::uint32_t n_eq, T tol, std::vector<T> atol,
+                                                                std::vector<T> rtol,
+                                                                const std::vector<std::uint32_t> &tol_exclude)
 {
-    // NOTE: time limit +inf means integration forward in time
-    // and no time limit.
-    return step_impl(std::numeric_limits<T>::infinity());
-}
+    if (atol.empty() && rtol.empty() && tol_exclude.empty()) {
+        return {};
+    }
 
-template <typename T>
-std::tuple<taylor_outcome, T> taylor_adaptive_impl<T>::step_backward()
-{
-    return step_impl(-std::numeric_limits<T>::infinity());
-}
+    if (atol.empty()) {
+        atol.resize(n_eq, tol);
+    }
+    if (rtol.empty()) {
+        rtol.resize(n_eq, tol);
+    }
 
-template <typename T>
-std::tuple<taylor_outcome, T> taylor_adaptive_impl<T>::step(T max_delta_t)
-{
-    using std::isnan;
+    if (atol.size() != n_eq || rtol.size() != n_eq) {
+        throw std::invalid_argument("The vectors of absolute and relative tolerances in an adaptive Taylor integrator "
+                                    "must have a size equal to the number of equations ("
+                                    + std::to_string(n_eq) + "), but their sizes are " + std::to_string(atol.size())
+                                    + " and " + std::to_string(rtol.size()) + " instead");
+    }
 
-    if (isnan(max_delta_t)) {
-        throw std::invalid_argument(
-            "A NaN max_delta_t was passed to the step() function of an adaptive Taylor integrator");
+    for (std::uint32_t i = 0; i < n_eq; ++i) {
+        // NOTE: a zero absolute tolerance would result
+        // in a zero timestep for a zero state variable.
+        if (!detail::isfinite(atol[i]) || atol[i] <= 0) {
+            throw std::invalid_argument("The absolute tolerances in an adaptive Taylor integrator must be finite "
+                                        "and positive, but the absolute tolerance for the variable at index "
+                                        + std::to_string(i) + " is " + li_to_string(atol[i]));
+        }
+
+        if (!detail::isfinite(rtol[i]) || rtol[i] < 0) {
+            throw std::invalid_argument("The relative tolerances in an adaptive Taylor integrator must be finite "
+                                        "and non-negative, but the relative tolerance for the variable at index "
+                                        + std::to_string(i) + " is " + li_to_string(rtol[i]));
+        }
     }
 
-    return step_impl(max_delta_t);
+    for (auto idx : tol_exclude) {
+        if (idx >= n_eq) {
+            throw std::invalid_argument("Cannot exclude the variable at index " + std::to_string(idx)
+                                        + " from the step-size control of an adaptive Taylor integrator: the "
+                                          "number of equations is only "
+                                        + std::to_string(n_eq));
+        }
+
+        atol[idx] = std::numeric_limits<T>::infinity();
+    }
+
+    if (std::all_of(atol.begin(), atol.end(), [](const auto &x) { return !detail::isfinite(x); })) {
+        throw std::invalid_argument("At least one variable must be subject to the step-size control "
+                                    "of an adaptive Taylor integrator");
+    }
+
+    return {std::move(atol), std::move(rtol)};
 }
 
+// Helper to construct the key identifying an adaptive
+// stepper in the in-process cache of compiled states.
+// NOTE: the key must contain all the information
+// that goes into the construction of the stepper.
 template <typename T>
-std::tuple<taylor_outcome, T, T, std::size_t> taylor_adaptive_impl<T>::propagate_for(T delta_t, std::size_t max_steps)
+std::string taylor_mem_cache_key(const std::vector<expression> &dc, const std::vector<expression> &ev_dc,
+                                 std::uint32_t n_eq, T tol, std::uint32_t batch_size, bool high_accuracy,
+                                 bool compact_mode, const std::vector<T> &atol, const std::vector<T> &rtol,
+                                 bool variable_order, const std::vector<T> &lane_tols, taylor_layout layout)
 {
-    return propagate_until(m_time + delta_t, max_steps);
+    std::ostringstream oss;
+    oss.imbue(std::locale("C"));
+    // NOTE: make sure that the numerical constants in the
+    // decomposition are printed with enough digits to be
+    // represented exactly (36 digits are enough for all
+    // the supported floating-point types).
+    oss.precision(36);
+
+    oss << "taylor_adaptive_step\n";
+    oss << typeid(T).name() << '\n';
+    oss << n_eq << ' ' << li_to_string(tol) << ' ' << batch_size << ' ' << high_accuracy << ' ' << compact_mode
+        << '\n';
+    oss << "variable_order " << variable_order << '\n';
+    oss << "layout " << static_cast<int>(layout) << '\n';
+    oss << "lane_tols " << lane_tols.size() << '\n';
+    for (const auto &lt : lane_tols) {
+        oss << li_to_string(lt) << '\n';
+    }
+    oss << "var_tols " << atol.size() << '\n';
+    for (decltype(atol.size()) i = 0; i < atol.size(); ++i) {
+        oss << li_to_string(atol[i]) << ' ' << li_to_string(rtol[i]) << '\n';
+    }
+    for (const auto &ex : dc) {
+        oss << ex << '\n';
+    }
+    oss << "events " << ev_dc.size() << '\n';
+    for (const auto &ex : ev_dc) {
+        oss << ex << '\n';
+    }
+
+    return oss.str();
 }
 
+// Set up the compiled stepper and the dense output function in the state s
+// for the decomposition dc and the event functions ev_dc, either by loading
+// them from the object file object_file (if not empty), by fetching them from
+// the in-process cache or by building and compiling them from scratch.
+// NOTE: the stepper is always accompanied by the global constant
+// 'heyoka_stepper_key', which contains a hash of the cache key. This
+// allows to verify that a stepper loaded from an object file
+// (e.g., exported via llvm_state::dump_static_library()) matches
+// the system and the settings of the integrator.
+// The IR emission time and the cached flag will be recorded in rep.
 template <typename T>
-std::tuple<taylor_outcome, T, T, std::size_t> taylor_adaptive_impl<T>::propagate_until(T t, std::size_t max_steps)
+void taylor_setup_stepper(llvm_state &s, const std::vector<expression> &dc, const std::vector<expression> &ev_dc,
+                          std::uint32_t n_eq, T tol, std::uint32_t batch_size, bool high_accuracy, bool compact_mode,
+                          const std::vector<T> &atol, const std::vector<T> &rtol, bool variable_order,
+                          const std::vector<T> &lane_tols, taylor_layout layout, const std::string &object_file,
+                          taylor_compile_report &rep)
 {
-    if (!detail::isfinite(t)) {
-        throw std::invalid_argument(
-            "A non-finite time was passed to the propagate_until() function of an adaptive Taylor integrator");
-    }
+    const auto key = taylor_mem_cache_key(dc, ev_dc, n_eq, tol, batch_size, high_accuracy, compact_mode, atol, rtol,
+                                          variable_order, lane_tols, layout);
+    const auto key_hash = llvm::toHex(llvm::SHA1::hash(llvm::arrayRefFromStringRef(key)), true);
+
+    if (!object_file.empty()) {
+        s.load_object_file(object_file);
+
+        // NOTE: the key hash is stored as a null-terminated string.
+        const auto *stored_hash = reinterpret_cast<const char *>(s.jit_lookup("heyoka_stepper_key"));
+        if (key_hash != stored_hash) {
+            throw std::invalid_argument("The stepper contained in the object file '" + object_file
+                                        + "' is incompatible with the system and/or the settings of the integrator");
+        }
 
-    // Initial values for the counter,
-    // the min/max abs of the integration
-    // timesteps, and min/max Taylor orders.
-    std::size_t step_counter = 0;
-    T min_h = std::numeric_limits<T>::infinity(), max_h(0);
+        rep.cached = true;
 
-    if (t == m_time) {
-        return std::tuple{taylor_outcome::time_limit, min_h, max_h, step_counter};
+        return;
     }
 
-    if ((t > m_time && !detail::isfinite(t - m_time)) || (t < m_time && !detail::isfinite(m_time - t))) {
-        throw std::overflow_error("The time limit passed to the propagate_until() function is too large and it "
-                                  "results in an overflow condition");
+    if (llvm_state_mem_cache_lookup(s, key)) {
+        rep.cached = true;
+
+        return;
     }
 
-    if (t > m_time) {
-        while (true) {
-            const auto [res, h] = step_impl(t - m_time);
+    // Add the dense output function and the stepper function.
+    // NOTE: the dense output function must be added first, so that
+    // it is optimised together with the stepper.
+    // NOTE: the optimisation is run at the end of
+    // taylor_add_adaptive_step_dc() (unless deferred), thus the
+    // IR emission phase is timed up to the point where the
+    // optimisation starts.
+    const auto ir_start = std::chrono::steady_clock::now();
+    auto ir_end = ir_start;
+    taylor_add_d_out_function<T>(s, n_eq, taylor_order_from_tol(tol), batch_size, high_accuracy, compact_mode,
+                                 layout);
+    taylor_add_adaptive_step_dc<T>(s, "step", dc, ev_dc, n_eq, tol, batch_size, high_accuracy, compact_mode, true,
+                                   atol, rtol, variable_order, lane_tols, layout, &ir_end);
+    rep.ir_time = std::chrono::duration<double>(ir_end - ir_start).count();
+
+    // Add the key hash.
+    auto *key_arr = llvm::ConstantDataArray::getString(s.context(), key_hash);
+    new llvm::GlobalVariable(s.module(), key_arr->getType(), true, llvm::GlobalVariable::ExternalLinkage, key_arr,
+                             "heyoka_stepper_key");
 
-            if (res != taylor_outcome::success && res != taylor_outcome::time_limit) {
-                return std::tuple{res, min_h, max_h, step_counter};
-            }
+    // Run the jit.
+    s.compile();
+
+    // Store the compiled state in the cache.
+    llvm_state_mem_cache_store(s, key);
+}
+
+// Binary I/O primitives for the checkpoints of the integrators.
+// NOTE: the data is written in its native representation, as
+// a checkpoint is meant to be restored on the machine that wrote
+// it (the object code of the stepper is target-specific anyway).
+template <typename U>
+void ckpt_write(std::ostream &os, const U &x)
+{
+    static_assert(std::is_trivially_copyable_v<U>);
+
+    os.write(reinterpret_cast<const char *>(&x), sizeof(U));
+}
+
+template <typename U>
+U ckpt_read(std::istream &is)
+{
+    static_assert(std::is_trivially_copyable_v<U>);
+
+    U x;
+    if (!is.read(reinterpret_cast<char *>(&x), sizeof(U))) {
+        throw std::invalid_argument("The checkpoint of an adaptive Taylor integrator is truncated or corrupted");
+    }
+
+    return x;
+}
+
+// Write the n values starting at ptr, preceded by their number.
+template <typename U>
+void ckpt_write_arr(std::ostream &os, const U *ptr, std::size_t n)
+{
+    static_assert(std::is_trivially_copyable_v<U>);
+
+    ckpt_write(os, static_cast<std::uint64_t>(n));
+    os.write(reinterpret_cast<const char *>(ptr), static_cast<std::streamsize>(n * sizeof(U)));
+}
+
+template <typename U>
+void ckpt_write_vec(std::ostream &os, const std::vector<U> &v)
+{
+    ckpt_write_arr(os, v.data(), v.size());
+}
+
+template <typename U>
+std::vector<U> ckpt_read_vec(std::istream &is)
+{
+    static_assert(std::is_trivially_copyable_v<U>);
+
+    const auto n = ckpt_read<std::uint64_t>(is);
+    if (n > std::numeric_limits<std::size_t>::max() / sizeof(U)) {
+        throw std::invalid_argument("The checkpoint of an adaptive Taylor integrator is truncated or corrupted");
+    }
+
+    std::vector<U> retval(static_cast<typename std::vector<U>::size_type>(n));
+    if (!is.read(reinterpret_cast<char *>(retval.data()), static_cast<std::streamsize>(n * sizeof(U)))) {
+        throw std::invalid_argument("The checkpoint of an adaptive Taylor integrator is truncated or corrupted");
+    }
+
+    return retval;
+}
+
+void ckpt_write_str(std::ostream &os, const std::string &str)
+{
+    ckpt_write_arr(os, str.data(), str.size());
+}
+
+std::string ckpt_read_str(std::istream &is)
+{
+    const auto v = ckpt_read_vec<char>(is);
+
+    return std::string(v.begin(), v.end());
+}
+
+// The functions which can appear in the decomposition
+// stored in a checkpoint, with their number of arguments.
+// NOTE: functions are restored via their factory functions,
+// as their implementation details cannot be serialised.
+const std::unordered_map<std::string, std::size_t> ckpt_functions
+    = {{"sin", 1}, {"cos", 1}, {"log", 1}, {"exp", 1}, {"pow", 2}, {"sqrt", 1}};
+
+void ckpt_write_ex(std::ostream &os, const expression &ex)
+{
+    std::visit(
+        [&os](const auto &v) {
+            using type = uncvref_t<decltype(v)>;
+
+            if constexpr (std::is_same_v<type, number>) {
+                ckpt_write(os, std::uint8_t(0));
+                ckpt_write(os, static_cast<std::uint8_t>(v.value().index()));
+                std::visit([&os](const auto &x) { ckpt_write(os, x); }, v.value());
+            } else if constexpr (std::is_same_v<type, variable>) {
+                ckpt_write(os, std::uint8_t(1));
+                ckpt_write_str(os, v.name());
+            } else if constexpr (std::is_same_v<type, binary_operator>) {
+                ckpt_write(os, std::uint8_t(2));
+                ckpt_write(os, static_cast<std::uint8_t>(v.op()));
+                ckpt_write_ex(os, v.lhs());
+                ckpt_write_ex(os, v.rhs());
+            } else if constexpr (std::is_same_v<type, function>) {
+                const auto it = ckpt_functions.find(v.display_name());
+                if (it == ckpt_functions.end() || it->second != v.args().size()) {
+                    throw std::invalid_argument("The function '" + v.display_name()
+                                                + "' cannot be stored in the checkpoint of an adaptive Taylor "
+                                                  "integrator");
+                }
+
+                ckpt_write(os, std::uint8_t(3));
+                ckpt_write_str(os, v.display_name());
+                for (const auto &arg : v.args()) {
+                    ckpt_write_ex(os, arg);
+                }
+            } else {
+                static_assert(std::is_same_v<type, param>);
+
+                ckpt_write(os, std::uint8_t(4));
+                ckpt_write(os, v.idx());
+            }
+        },
+        ex.value());
+}
+
+expression ckpt_read_ex(std::istream &is)
+{
+    switch (ckpt_read<std::uint8_t>(is)) {
+        case 0:
+            switch (ckpt_read<std::uint8_t>(is)) {
+                case 0:
+                    return expression{number{ckpt_read<double>(is)}};
+                case 1:
+                    return expression{number{ckpt_read<long double>(is)}};
+#if defined(HEYOKA_HAVE_REAL128)
+                case 2:
+                    return expression{number{ckpt_read<mppp::real128>(is)}};
+#endif
+                default:
+                    break;
+            }
+            break;
+        case 1:
+            return expression{variable{ckpt_read_str(is)}};
+        case 2: {
+            const auto op = ckpt_read<std::uint8_t>(is);
+            if (op > static_cast<std::uint8_t>(binary_operator::type::div)) {
+                break;
+            }
+
+            auto lhs = ckpt_read_ex(is);
+            auto rhs = ckpt_read_ex(is);
+
+            return expression{binary_operator{static_cast<binary_operator::type>(op), std::move(lhs), std::move(rhs)}};
+        }
+        case 3: {
+            const auto name = ckpt_read_str(is);
+            const auto it = ckpt_functions.find(name);
+            if (it == ckpt_functions.end()) {
+                break;
+            }
+
+            std::vector<expression> args;
+            for (std::size_t i = 0; i < it->second; ++i) {
+                args.push_back(ckpt_read_ex(is));
+            }
+
+            if (name == "sin") {
+                return heyoka::sin(std::move(args[0]));
+            } else if (name == "cos") {
+                return heyoka::cos(std::move(args[0]));
+            } else if (name == "log") {
+                return heyoka::log(std::move(args[0]));
+            } else if (name == "exp") {
+                return heyoka::exp(std::move(args[0]));
+            } else if (name == "pow") {
+                return heyoka::pow(std::move(args[0]), std::move(args[1]));
+            } else {
+                assert(name == "sqrt");
+                return heyoka::sqrt(std::move(args[0]));
+            }
+        }
+        case 4:
+            return expression{param{ckpt_read<std::uint32_t>(is)}};
+        default:
+            break;
+    }
+
+    throw std::invalid_argument("The checkpoint of an adaptive Taylor integrator is truncated or corrupted");
+}
+
+void ckpt_write_dc(std::ostream &os, const std::vector<expression> &dc)
+{
+    ckpt_write(os, static_cast<std::uint64_t>(dc.size()));
+    for (const auto &ex : dc) {
+        ckpt_write_ex(os, ex);
+    }
+}
+
+std::vector<expression> ckpt_read_dc(std::istream &is)
+{
+    const auto n = ckpt_read<std::uint64_t>(is);
+
+    std::vector<expression> retval;
+    for (std::uint64_t i = 0; i < n; ++i) {
+        retval.push_back(ckpt_read_ex(is));
+    }
+
+    return retval;
+}
+
+// The header of a checkpoint: a magic string, the version of
+// the format, the floating-point type, the kind of integrator,
+// the target for which the object code was compiled and the settings
+// of the llvm_state s which compiled it.
+constexpr char ckpt_magic[] = "heyoka_taylor_checkpoint";
+constexpr std::uint32_t ckpt_version = 1;
+
+template <typename T>
+void ckpt_write_header(std::ostream &os, bool batch, const llvm_state &s)
+{
+    os.write(ckpt_magic, sizeof(ckpt_magic));
+    ckpt_write(os, ckpt_version);
+    ckpt_write_str(os, typeid(T).name());
+    ckpt_write(os, static_cast<std::uint8_t>(batch));
+    ckpt_write_str(os, s.target_triple());
+    ckpt_write_str(os, s.target_cpu());
+    ckpt_write_str(os, s.target_features());
+    ckpt_write(os, static_cast<std::uint32_t>(s.opt_level()));
+    ckpt_write(os, static_cast<std::uint8_t>(s.fast_math()));
+}
+
+// NOTE: the target recorded in the header is checked against the
+// target of the llvm_state s, as the object code cannot be run
+// on a different target (e.g., on a CPU lacking some of the
+// instruction set extensions). The settings of the llvm_state
+// which compiled the object code are returned.
+template <typename T>
+std::pair<unsigned, bool> ckpt_read_header(std::istream &is, bool batch, const llvm_state &s)
+{
+    char magic[sizeof(ckpt_magic)];
+    if (!is.read(magic, sizeof(magic)) || !std::equal(magic, magic + sizeof(magic), ckpt_magic)) {
+        throw std::invalid_argument("The data being restored is not the checkpoint of an adaptive Taylor integrator");
+    }
+
+    if (ckpt_read<std::uint32_t>(is) != ckpt_version) {
+        throw std::invalid_argument("Unsupported version of the checkpoint format of an adaptive Taylor integrator");
+    }
+
+    if (ckpt_read_str(is) != typeid(T).name() || ckpt_read<std::uint8_t>(is) != static_cast<std::uint8_t>(batch)) {
+        throw std::invalid_argument("The checkpoint was written by an adaptive Taylor integrator of a different "
+                                    "kind or with a different floating-point type");
+    }
+
+    const auto triple = ckpt_read_str(is);
+    const auto cpu = ckpt_read_str(is);
+    const auto features = ckpt_read_str(is);
+    if (triple != s.target_triple() || cpu != s.target_cpu() || features != s.target_features()) {
+        throw std::invalid_argument("The checkpoint of an adaptive Taylor integrator was written for the target '"
+                                    + triple + "' (CPU '" + cpu + "'), which does not match the current target '"
+                                    + s.target_triple() + "' (CPU '" + s.target_cpu()
+                                    + "') and/or its features");
+    }
+
+    const auto opt_level = ckpt_read<std::uint32_t>(is);
+    const auto fast_math = ckpt_read<std::uint8_t>(is);
+
+    return {opt_level, fast_math != 0u};
+}
+
+// Write/read the compile report of an integrator.
+inline void ckpt_write_report(std::ostream &os, const taylor_compile_report &r)
+{
+    ckpt_write(os, r.decomposition_time);
+    ckpt_write(os, r.ir_time);
+    ckpt_write(os, r.n_uvars);
+    ckpt_write(os, r.llvm.opt_time);
+    ckpt_write(os, r.llvm.compile_time);
+    ckpt_write(os, r.llvm.n_insts_pre_opt);
+    ckpt_write(os, r.llvm.n_insts_post_opt);
+    ckpt_write(os, r.llvm.n_funcs);
+    ckpt_write(os, r.llvm.obj_size);
+}
+
+inline taylor_compile_report ckpt_read_report(std::istream &is)
+{
+    taylor_compile_report r;
+
+    r.decomposition_time = ckpt_read<double>(is);
+    r.ir_time = ckpt_read<double>(is);
+    r.n_uvars = ckpt_read<std::uint32_t>(is);
+    r.llvm.opt_time = ckpt_read<double>(is);
+    r.llvm.compile_time = ckpt_read<double>(is);
+    r.llvm.n_insts_pre_opt = ckpt_read<std::uint64_t>(is);
+    r.llvm.n_insts_post_opt = ckpt_read<std::uint64_t>(is);
+    r.llvm.n_funcs = ckpt_read<std::uint64_t>(is);
+    r.llvm.obj_size = ckpt_read<std::uint64_t>(is);
+
+    // NOTE: the compiled code of a restored
+    // integrator is not compiled anew.
+    r.cached = true;
+
+    return r;
+}
+
+// Evaluate the polynomial p of degree n (whose coefficients are
+// stored in ascending order) at x via Horner's scheme. The value
+// of the derivative of the polynomial at x is returned as well.
+template <typename T>
+std::pair<T, T> taylor_poly_eval(const T *p, std::uint32_t n, T x)
+{
+    T ret = p[n], dret(0);
+
+    for (std::uint32_t i = 1; i <= n; ++i) {
+        dret = dret * x + ret;
+        ret = ret * x + p[n - i];
+    }
+
+    return std::pair{ret, dret};
+}
+
+// Count the sign changes in the coefficients of the
+// polynomial p of degree n (zero coefficients are skipped).
+template <typename T>
+std::uint32_t taylor_poly_sign_changes(const T *p, std::uint32_t n)
+{
+    std::uint32_t retval = 0;
+    int last_sign = 0;
+
+    for (std::uint32_t i = 0; i <= n; ++i) {
+        const int cur_sign = (p[i] > 0) - (p[i] < 0);
+
+        if (cur_sign != 0) {
+            retval += static_cast<std::uint32_t>(last_sign != 0 && cur_sign != last_sign);
+            last_sign = cur_sign;
+        }
+    }
+
+    return retval;
+}
+
+// Transform in place the polynomial p(x) of degree n into p(x + 1).
+template <typename T>
+void taylor_poly_shift1(T *p, std::uint32_t n)
+{
+    for (std::uint32_t i = 0; i < n; ++i) {
+        for (auto j = n; j > i; --j) {
+            p[j - 1u] += p[j];
+        }
+    }
+}
+
+// Locate the root of the polynomial p of degree n within
+// the interval [lb, ub], in which p changes sign. The root is
+// located via Newton's method, falling back to bisection if a Newton
+// iteration would step out of the bracket or not converge fast enough.
+template <typename T>
+T taylor_poly_refine_root(const T *p, std::uint32_t n, T lb, T ub)
+{
+    using std::abs;
+
+    const auto f_lb = taylor_poly_eval(p, n, lb).first;
+    const auto f_ub = taylor_poly_eval(p, n, ub).first;
+
+    // Orient the bracket so that p(xl) <= 0 and p(xh) >= 0.
+    const auto lb_neg = (f_lb != 0) ? (f_lb < 0) : (f_ub > 0);
+    auto xl = lb_neg ? lb : ub, xh = lb_neg ? ub : lb;
+
+    auto x = (lb + ub) / 2;
+    auto dx_old = abs(ub - lb), dx = dx_old;
+    auto [f, df] = taylor_poly_eval(p, n, x);
+
+    // NOTE: cap the number of iterations, just in case.
+    for (int i = 0; i < 100; ++i) {
+        if (((x - xh) * df - f) * ((x - xl) * df - f) > 0 || abs(2 * f) > abs(dx_old * df)) {
+            // Bisection.
+            dx_old = dx;
+            dx = (xh - xl) / 2;
+            x = xl + dx;
+
+            if (x == xl) {
+                return x;
+            }
+        } else {
+            // Newton.
+            dx_old = dx;
+            dx = f / df;
+            const auto tmp = x;
+            x -= dx;
+
+            if (x == tmp) {
+                return x;
+            }
+        }
+
+        // NOTE: the roots are searched in
+        // [0, 1], hence the absolute tolerance.
+        if (abs(dx) <= std::numeric_limits<T>::epsilon()) {
+            return x;
+        }
+
+        std::tie(f, df) = taylor_poly_eval(p, n, x);
+
+        if (f == 0) {
+            return x;
+        }
+
+        if (f < 0) {
+            xl = x;
+        } else {
+            xh = x;
+        }
+    }
+
+    return x;
+}
+
+// Find the roots of the polynomial p of degree n in the half-open
+// interval (0, 1], and write them into out (in no particular order).
+// The roots are isolated via the Vincent-Collins-Akritas bisection
+// method (based on Descartes' rule of signs) and then refined via
+// taylor_poly_refine_root(). ws and wl are workspaces.
+// NOTE: roots of even multiplicity (e.g., tangencies) are not reported,
+// as the polynomial does not change sign across them.
+template <typename T>
+void taylor_poly_roots_01(const T *p, std::uint32_t n, std::vector<T> &ws, std::vector<std::pair<T, T>> &wl,
+                          std::vector<T> &out)
+{
+    using std::abs;
+
+    out.clear();
+
+    // Quick exclusion test: in [0, 1], abs(p(x) - p(0))
+    // is bounded by the sum of the abs values of the
+    // coefficients of order 1 and higher.
+    T abs_sum(0);
+    for (std::uint32_t i = 1; i <= n; ++i) {
+        abs_sum += abs(p[i]);
+    }
+    if (abs(p[0]) > abs_sum) {
+        return;
+    }
+
+    // The root at x = 1 (if any) needs to be
+    // handled separately, as the isolation works
+    // on open intervals.
+    if (taylor_poly_eval(p, n, T(1)).first == 0) {
+        out.push_back(T(1));
+    }
+
+    using size_type = typename std::vector<T>::size_type;
+    const auto np1 = static_cast<size_type>(n) + 1u;
+
+    // The work list contains the intervals (lb, width) still to be
+    // examined. The polynomial p(lb + width * x) corresponding to each
+    // interval is stored in ws, after an initial scratch area
+    // of size n + 1.
+    wl.clear();
+    ws.resize(np1);
+    ws.insert(ws.end(), p, p + np1);
+    wl.emplace_back(T(0), T(1));
+
+    while (!wl.empty()) {
+        const auto [lb, w] = wl.back();
+        wl.pop_back();
+
+        const auto offset = ws.size() - np1;
+
+        // Descartes' rule of signs on (0, 1): count the sign changes
+        // in the coefficients of (x + 1)**n * q(1 / (x + 1)), where q is the
+        // polynomial corresponding to the current interval.
+        std::reverse_copy(ws.begin() + static_cast<std::ptrdiff_t>(offset), ws.end(), ws.begin());
+        taylor_poly_shift1(ws.data(), n);
+        const auto n_sc = taylor_poly_sign_changes(ws.data(), n);
+
+        if (n_sc == 0u) {
+            // No roots in the interval.
+            ws.resize(offset);
+            continue;
+        }
+
+        if (n_sc == 1u) {
+            // A single root in the interval.
+            out.push_back(taylor_poly_refine_root(p, n, lb, lb + w));
+            ws.resize(offset);
+            continue;
+        }
+
+        const auto hw = w / 2, mid = lb + hw;
+
+        if (hw < std::numeric_limits<T>::epsilon() || mid == lb) {
+            // The interval cannot be split further: report
+            // a root if p changes sign in it.
+            const auto f_lb = taylor_poly_eval(p, n, lb).first, f_ub = taylor_poly_eval(p, n, lb + w).first;
+            if ((f_lb < 0 && f_ub > 0) || (f_lb > 0 && f_ub < 0)) {
+                out.push_back(taylor_poly_refine_root(p, n, lb, lb + w));
+            }
+            ws.resize(offset);
+            continue;
+        }
+
+        // Bisect the interval. The polynomial for the left half
+        // is q(x / 2) (up to a positive factor), the polynomial
+        // for the right half is q((x + 1) / 2).
+        T fac(1);
+        for (size_type i = 0; i < np1; ++i) {
+            ws[offset + i] *= fac;
+            fac /= 2;
+        }
+        ws.resize(offset + 2u * np1);
+        std::copy(ws.begin() + static_cast<std::ptrdiff_t>(offset),
+                  ws.begin() + static_cast<std::ptrdiff_t>(offset + np1),
+                  ws.begin() + static_cast<std::ptrdiff_t>(offset + np1));
+        taylor_poly_shift1(ws.data() + offset + np1, n);
+
+        wl.emplace_back(lb, hw);
+        wl.emplace_back(mid, hw);
+
+        // Check if the midpoint is a root.
+        if (taylor_poly_eval(p, n, mid).first == 0) {
+            out.push_back(mid);
+        }
+    }
+}
+
+// Determine the direction of a zero crossing of an event function
+// from the derivative dp of the rescaled Taylor polynomial of the
+// event function at the crossing and the timestep h.
+template <typename T>
+event_direction taylor_ev_direction(T dp, T h)
+{
+    if (dp == 0) {
+        return event_direction::any;
+    }
+
+    // NOTE: the derivative with respect
+    // to time has the sign of dp * h.
+    return ((dp > 0) == (h > 0)) ? event_direction::positive : event_direction::negative;
+}
+
+// Estimate automatically the cooldown of a terminal event after a zero crossing.
+// p is the rescaled Taylor polynomial of degree n of the event function, dp
+// its derivative at the crossing and h the timestep. The estimate
+// is based on the uncertainty in the time of the zero crossing due to
+// the roundoff errors in the evaluation of p.
+template <typename T>
+T taylor_auto_cooldown(const T *p, std::uint32_t n, T dp, T h)
+{
+    using std::abs;
+
+    T abs_sum(0);
+    for (std::uint32_t i = 0; i <= n; ++i) {
+        abs_sum += abs(p[i]);
+    }
+
+    auto retval = 10 * std::numeric_limits<T>::epsilon() * abs_sum / abs(dp) * abs(h);
+
+    // NOTE: fall back to the magnitude of the timestep if the
+    // estimate is not finite (e.g., if the derivative is zero)
+    // or too large.
+    if (!detail::isfinite(retval) || retval > abs(h)) {
+        retval = abs(h);
+    }
+
+    return retval;
+}
+
+// Determine the number of runtime parameters needed by
+// the Taylor decomposition dc (that is, the largest parameter
+// index appearing in dc plus one).
+std::uint32_t taylor_dc_n_pars(const std::vector<expression> &dc)
+{
+    std::uint32_t retval = 0;
+
+    for (const auto &ex : dc) {
+        retval = std::max(retval, get_param_size(ex));
+    }
+
+    return retval;
+}
+
+} // namespace
+
+template <typename T>
+template <typename U>
+void taylor_adaptive_impl<T>::finalise_ctor_impl(U sys, std::vector<T> state, T time, T tol, bool high_accuracy,
+                                                 bool compact_mode, const std::string &object_file, bool dense_output,
+                                                 std::vector<T> pars, std::vector<t_event_impl<T>> tes,
+                                                 std::vector<nt_event_impl<T>> ntes, std::vector<T> atol,
+                                                 std::vector<T> rtol, const std::vector<std::uint32_t> &tol_exclude,
+                                                 bool variable_order)
+{
+    // Assign the data members.
+    m_state = std::move(state);
+    m_time = detail::dfloat<T>(time);
+    m_pars = std::move(pars);
+    m_tes = std::move(tes);
+    m_ntes = std::move(ntes);
+
+    // Check input params.
+    if (std::any_of(m_state.begin(), m_state.end(), [](const auto &x) { return !detail::isfinite(x); })) {
+        throw std::invalid_argument(
+            "A non-finite value was detected in the initial state of an adaptive Taylor integrator");
+    }
+
+    if (m_state.size() != sys.size()) {
+        throw std::invalid_argument("Inconsistent sizes detected in the initialization of an adaptive Taylor "
+                                    "integrator: the state vector has a dimension of "
+                                    + std::to_string(m_state.size()) + ", while the number of equations is "
+                                    + std::to_string(sys.size()));
+    }
+
+    if (!detail::isfinite(time)) {
+        throw std::invalid_argument("Cannot initialise an adaptive Taylor integrator with a non-finite initial time of "
+                                    + detail::li_to_string(time));
+    }
+
+    if (!detail::isfinite(tol) || tol <= 0) {
+        throw std::invalid_argument(
+            "The tolerance in an adaptive Taylor integrator must be finite and positive, but it is " + li_to_string(tol)
+            + " instead");
+    }
+
+    // Record the number of equations.
+    const auto n_eq = boost::numeric_cast<std::uint32_t>(sys.size());
+
+    // Validate the per-variable tolerances.
+    const auto [var_atol, var_rtol] = taylor_setup_var_tols(n_eq, tol, std::move(atol), std::move(rtol), tol_exclude);
+
+    // Record the number of events.
+    const auto n_ev = boost::numeric_cast<std::uint32_t>(m_tes.size() + m_ntes.size());
+
+    // Collect the event functions (terminal first).
+    std::vector<expression> evs;
+    for (const auto &te : m_tes) {
+        evs.push_back(te.get_expression());
+    }
+    for (const auto &nte : m_ntes) {
+        evs.push_back(nte.get_expression());
+    }
+
+    // Decompose the system of equations and the event functions.
+    const auto start = std::chrono::steady_clock::now();
+    auto [dc, ev_dc] = taylor_decompose_impl(std::move(sys), std::move(evs));
+    m_dc = std::move(dc);
+    m_compile_report.decomposition_time
+        = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    // NOTE: the last n_eq elements of the decomposition
+    // are the definitions of the derivatives.
+    assert(m_dc.size() >= n_eq);
+    assert(ev_dc.size() == n_ev);
+    m_compile_report.n_uvars = boost::numeric_cast<std::uint32_t>(m_dc.size() - n_eq);
+
+    // Set up the runtime parameters. The parameters
+    // for which no value was provided are set to zero.
+    const auto n_pars = taylor_dc_n_pars(m_dc);
+    if (m_pars.size() > n_pars) {
+        throw std::invalid_argument("Excessive number of parameter values passed to the constructor of an adaptive "
+                                    "Taylor integrator: "
+                                    + std::to_string(m_pars.size()) + " parameter values were passed, but the ODE "
+                                    + "system contains only " + std::to_string(n_pars) + " parameters");
+    }
+    m_pars.resize(n_pars, T(0));
+
+    // Set up the compiled stepper.
+    taylor_setup_stepper(m_llvm, m_dc, ev_dc, n_eq, tol, 1, high_accuracy, compact_mode, var_atol, var_rtol,
+                         variable_order, {}, taylor_layout::soa, object_file, m_compile_report);
+
+    // Fetch the stepper and the dense output function.
+    m_step_f = reinterpret_cast<step_f_t>(m_llvm.jit_lookup("step"));
+    m_d_out_f = reinterpret_cast<d_out_f_t>(m_llvm.jit_lookup("d_out"));
+
+    // Record the llvm report.
+    if (!m_compile_report.cached) {
+        m_compile_report.llvm = m_llvm.get_compile_report();
+    }
+
+    // Prepare the buffers for the dense output.
+    // NOTE: the Taylor coefficients are always needed
+    // for the detection of the events.
+    m_tol = tol;
+    m_order = taylor_order_from_tol(tol);
+    if (dense_output || n_ev > 0u) {
+        using tc_size_t = decltype(m_tc.size());
+        m_tc.resize(static_cast<tc_size_t>(m_order + 1u) * (static_cast<tc_size_t>(n_eq) + n_ev));
+    }
+    m_d_out.resize(m_state.size());
+
+    // Init the cooldowns of the terminal events.
+    m_te_cooldowns.resize(m_tes.size(), T(0));
+}
+
+template <typename T>
+taylor_adaptive_impl<T>::taylor_adaptive_impl(const taylor_adaptive_impl &other)
+    // NOTE: the compiled code is shared between other and the copy
+    // (see the copy constructor of llvm_state), thus the function
+    // pointer to the stepper can be copied as well.
+    // NOTE: if other has an external state buffer attached, the copy
+    // gets a copy of its content in the internal state vector.
+    : m_state(other.get_state_data(), other.get_state_data() + other.m_state.size()), m_time(other.m_time),
+      m_llvm(other.m_llvm), m_dc(other.m_dc), m_pars(other.m_pars), m_step_f(other.m_step_f),
+      m_compile_report(other.m_compile_report), m_tol(other.m_tol), m_order(other.m_order),
+      m_last_order(other.m_last_order), m_tc(other.m_tc), m_last_h(other.m_last_h),
+      m_d_out_f(other.m_d_out_f), m_d_out(other.m_d_out), m_tes(other.m_tes), m_ntes(other.m_ntes),
+      m_te_cooldowns(other.m_te_cooldowns), m_last_te_idx(other.m_last_te_idx), m_d_tes(other.m_d_tes),
+      m_d_ntes(other.m_d_ntes)
+{
+}
+
+template <typename T>
+taylor_adaptive_impl<T>::taylor_adaptive_impl(taylor_adaptive_impl &&) noexcept = default;
+
+template <typename T>
+taylor_adaptive_impl<T> &taylor_adaptive_impl<T>::operator=(const taylor_adaptive_impl &other)
+{
+    if (this != &other) {
+        *this = taylor_adaptive_impl(other);
+    }
+
+    return *this;
+}
+
+template <typename T>
+taylor_adaptive_impl<T> &taylor_adaptive_impl<T>::operator=(taylor_adaptive_impl &&) noexcept = default;
+
+template <typename T>
+taylor_adaptive_impl<T>::~taylor_adaptive_impl() = default;
+
+// Implementation detail to make a single integration timestep.
+// The magnitude of the timestep is automatically deduced, but it will
+// always be not greater than abs(max_delta_t). The propagation
+// is done forward in time if max_delta_t >= 0, backwards in
+// time otherwise.
+//
+// The function will return a pair, containing
+// a flag describing the outcome of the integration,
+// and the integration timestep that was used.
+template <typename T>
+std::tuple<taylor_outcome, T> taylor_adaptive_impl<T>::step_impl(T max_delta_t)
+{
+    using std::abs;
+
+    auto *state_ptr = get_state_data();
+
+    // Reset the index of the last triggered terminal event.
+    m_last_te_idx.reset();
+
+    // Invoke the stepper.
+    // NOTE: the Taylor coefficients are written
+    // only if dense output or events are enabled.
+    auto h = max_delta_t;
+    m_last_order = m_step_f(state_ptr, m_pars.data(), &h, m_tc.empty() ? nullptr : m_tc.data());
+
+    // NOTE: the stepper checks the current state, and it
+    // signals a non-finite state by returning a NaN timestep
+    // (leaving the state untouched).
+    {
+        using std::isnan;
+
+        if (isnan(h)) {
+            return std::tuple{taylor_outcome::err_nf_state, T(0)};
+        }
+    }
+
+    if (m_tes.empty() && m_ntes.empty()) {
+        // Update the time and the last timestep.
+        m_time = m_time + detail::dfloat<T>(h);
+        m_last_h = h;
+
+        return std::tuple{h == max_delta_t ? taylor_outcome::time_limit : taylor_outcome::success, h};
+    }
+
+    // Detect the zero crossings of the event functions.
+    detect_events(h);
+
+    // Fetch the earliest terminal event, if any.
+    std::optional<std::tuple<std::uint32_t, T, event_direction, T>> te;
+    if (const auto it = std::min_element(m_d_tes.begin(), m_d_tes.end(),
+                                         [](const auto &a, const auto &b) {
+                                             return abs(std::get<1>(a)) < abs(std::get<1>(b));
+                                         });
+        it != m_d_tes.end()) {
+        te = *it;
+    }
+
+    const auto orig_h = h;
+    const auto t0 = m_time;
+
+    if (te) {
+        // Truncate the timestep at the terminal event, and
+        // compute the state at the time of the event via
+        // the dense output.
+        h = std::get<1>(*te);
+        m_d_out_f(state_ptr, m_tc.data(), &h);
+    }
+
+    // Update the time and the last timestep.
+    m_time = m_time + detail::dfloat<T>(h);
+    m_last_h = h;
+
+    // Update the cooldowns.
+    for (auto &cd : m_te_cooldowns) {
+        if (cd > 0) {
+            cd -= abs(h);
+        }
+    }
+    if (te) {
+        m_te_cooldowns[std::get<0>(*te)] = std::get<3>(*te);
+    }
+
+    // Invoke the callbacks of the non-terminal events in chronological
+    // order, skipping those following the terminal event (if any).
+    for (const auto &[idx, tau, dir] : m_d_ntes) {
+        if (te && abs(tau) > abs(h)) {
+            break;
+        }
+
+        m_ntes[idx].get_callback()(*this, static_cast<T>(t0 + detail::dfloat<T>(tau)), dir);
+    }
+
+    if (te) {
+        const auto te_idx = std::get<0>(*te);
+
+        m_last_te_idx = te_idx;
+
+        if (const auto &cb = m_tes[te_idx].get_callback()) {
+            cb(*this, std::get<2>(*te));
+        }
+
+        return std::tuple{taylor_outcome::terminal_event, h};
+    }
+
+    return std::tuple{orig_h == max_delta_t ? taylor_outcome::time_limit : taylor_outcome::success, h};
+}
+
+// Detect the zero crossings of the event functions within
+// the timestep h, using the Taylor coefficients of the event
+// functions computed by the stepper. The crossings are stored
+// in m_d_tes/m_d_ntes (the latter in chronological order).
+template <typename T>
+void taylor_adaptive_impl<T>::detect_events(T h)
+{
+    using std::abs;
+
+    m_d_tes.clear();
+    m_d_ntes.clear();
+
+    if (h == 0) {
+        // NOTE: no zero crossings can
+        // happen in a zero timestep.
+        return;
+    }
+
+    const auto n_eq = m_state.size();
+    const auto n_tes = m_tes.size();
+    using tc_size_t = decltype(m_tc.size());
+
+    m_ev_poly.resize(static_cast<decltype(m_ev_poly.size())>(m_order) + 1u);
+
+    // Helper to compute the zero crossings of the event function at index
+    // ev_idx (terminal events first) in the [0, 1] interval of the rescaled
+    // time. The crossings are stored in m_ev_roots.
+    auto find_roots = [&](tc_size_t ev_idx) {
+        const auto *tc = m_tc.data() + (n_eq + ev_idx) * (static_cast<tc_size_t>(m_order) + 1u);
+
+        // Rescale the Taylor polynomial so that
+        // the timestep is mapped to [0, 1].
+        T h_pow(1);
+        for (std::uint32_t o = 0; o <= m_order; ++o) {
+            m_ev_poly[o] = tc[o] * h_pow;
+            h_pow *= h;
+        }
+
+        taylor_poly_roots_01(m_ev_poly.data(), m_order, m_ev_ws, m_ev_wl, m_ev_roots);
+    };
+
+    for (decltype(m_tes.size()) i = 0; i < n_tes; ++i) {
+        find_roots(i);
+
+        for (const auto &x : m_ev_roots) {
+            const auto tau = x * h;
+
+            // Ignore the zero crossings
+            // within the cooldown period.
+            if (m_te_cooldowns[i] > 0 && abs(tau) < m_te_cooldowns[i]) {
+                continue;
+            }
+
+            const auto dp = taylor_poly_eval(m_ev_poly.data(), m_order, x).second;
+            const auto dir = taylor_ev_direction(dp, h);
+            if (m_tes[i].get_direction() != event_direction::any && m_tes[i].get_direction() != dir) {
+                continue;
+            }
+
+            // NOTE: a negative (or NaN) cooldown means
+            // that the cooldown is estimated automatically.
+            auto cd = m_tes[i].get_cooldown();
+            if (!(cd >= 0)) {
+                cd = taylor_auto_cooldown(m_ev_poly.data(), m_order, dp, h);
+            }
+
+            m_d_tes.emplace_back(static_cast<std::uint32_t>(i), tau, dir, cd);
+        }
+    }
+
+    for (decltype(m_ntes.size()) i = 0; i < m_ntes.size(); ++i) {
+        find_roots(n_tes + i);
+
+        for (const auto &x : m_ev_roots) {
+            const auto dir = taylor_ev_direction(taylor_poly_eval(m_ev_poly.data(), m_order, x).second, h);
+            if (m_ntes[i].get_direction() != event_direction::any && m_ntes[i].get_direction() != dir) {
+                continue;
+            }
+
+            m_d_ntes.emplace_back(static_cast<std::uint32_t>(i), x * h, dir);
+        }
+    }
+
+    // Sort the non-terminal events chronologically.
+    std::sort(m_d_ntes.begin(), m_d_ntes.end(),
+              [](const auto &a, const auto &b) { return abs(std::get<1>(a)) < abs(std::get<1>(b)); });
+}
+
+template <typename T>
+std::tuple<taylor_outcome, T> taylor_adaptive_impl<T>::step()
+{
+    // NOTE: time limit +inf means integration forward in time
+    // and no time limit.
+    return step_impl(std::numeric_limits<T>::infinity());
+}
+
+template <typename T>
+std::tuple<taylor_outcome, T> taylor_adaptive_impl<T>::step_backward()
+{
+    return step_impl(-std::numeric_limits<T>::infinity());
+}
+
+template <typename T>
+std::tuple<taylor_outcome, T> taylor_adaptive_impl<T>::step(T max_delta_t)
+{
+    using std::isnan;
+
+    if (isnan(max_delta_t)) {
+        throw std::invalid_argument(
+            "A NaN max_delta_t was passed to the step() function of an adaptive Taylor integrator");
+    }
+
+    return step_impl(max_delta_t);
+}
+
+template <typename T>
+std::tuple<taylor_outcome, T, T, std::size_t> taylor_adaptive_impl<T>::propagate_for(T delta_t, std::size_t max_steps)
+{
+    if (!detail::isfinite(delta_t)) {
+        throw std::invalid_argument(
+            "A non-finite time interval was passed to the propagate_for() function of an adaptive Taylor integrator");
+    }
+
+    // NOTE: the final time is computed in double-length
+    // format, so that no rounding error is introduced here.
+    return propagate_until_impl(m_time + detail::dfloat<T>(delta_t), max_steps);
+}
+
+template <typename T>
+std::tuple<taylor_outcome, T, T, std::size_t> taylor_adaptive_impl<T>::propagate_until(T t, std::size_t max_steps)
+{
+    if (!detail::isfinite(t)) {
+        throw std::invalid_argument(
+            "A non-finite time was passed to the propagate_until() function of an adaptive Taylor integrator");
+    }
+
+    return propagate_until_impl(detail::dfloat<T>(t), max_steps);
+}
+
+template <typename T>
+std::tuple<taylor_outcome, T, T, std::size_t>
+taylor_adaptive_impl<T>::propagate_until_impl(const detail::dfloat<T> &t, std::size_t max_steps)
+{
+    // Initial values for the counter,
+    // the min/max abs of the integration
+    // timesteps, and min/max Taylor orders.
+    std::size_t step_counter = 0;
+    T min_h = std::numeric_limits<T>::infinity(), max_h(0);
+
+    if (t == m_time) {
+        return std::tuple{taylor_outcome::time_limit, min_h, max_h, step_counter};
+    }
+
+    if (!detail::isfinite(static_cast<T>(t - m_time))) {
+        throw std::overflow_error("The time limit passed to the propagate_until() function is too large and it "
+                                  "results in an overflow condition");
+    }
+
+    if (t > m_time) {
+        while (true) {
+            const auto [res, h] = step_impl(static_cast<T>(t - m_time));
+
+            if (res != taylor_outcome::success && res != taylor_outcome::time_limit
+                && res != taylor_outcome::terminal_event) {
+                return std::tuple{res, min_h, max_h, step_counter};
+            }
 
             // Update the number of steps
             // completed successfully.
             ++step_counter;
 
+            // Stop if a terminal event triggered. The (truncated)
+            // timestep is not used to update min_h/max_h.
+            if (res == taylor_outcome::terminal_event) {
+                return std::tuple{res, min_h, max_h, step_counter};
+            }
+
             // Break out if the time limit is reached,
             // *before* updating the min_h/max_h values.
-            if (m_time >= t) {
+            // NOTE: the rounding of t - m_time to a single-length timestep
+            // may leave a residual below the precision of T, hence we set
+            // the time to exactly t.
+            if (res == taylor_outcome::time_limit || m_time >= t) {
+                m_time = t;
                 break;
             }
 
@@ -836,15 +1937,21 @@ std::tuple<taylor_outcome, T, T, std::size_t> taylor_adaptive_impl<T>::propagate
         }
     } else {
         while (true) {
-            const auto [res, h] = step_impl(t - m_time);
+            const auto [res, h] = step_impl(static_cast<T>(t - m_time));
 
-            if (res != taylor_outcome::success && res != taylor_outcome::time_limit) {
+            if (res != taylor_outcome::success && res != taylor_outcome::time_limit
+                && res != taylor_outcome::terminal_event) {
                 return std::tuple{res, min_h, max_h, step_counter};
             }
 
             ++step_counter;
 
-            if (m_time <= t) {
+            if (res == taylor_outcome::terminal_event) {
+                return std::tuple{res, min_h, max_h, step_counter};
+            }
+
+            if (res == taylor_outcome::time_limit || m_time <= t) {
+                m_time = t;
                 break;
             }
 
@@ -869,7 +1976,21 @@ void taylor_adaptive_impl<T>::set_time(T t)
                                     + " passed to the set_time() function of an adaptive Taylor integrator");
     }
 
-    m_time = t;
+    m_time = detail::dfloat<T>(t);
+}
+
+template <typename T>
+void taylor_adaptive_impl<T>::set_dtime(T hi, T lo)
+{
+    if (!detail::isfinite(hi) || !detail::isfinite(lo)) {
+        throw std::invalid_argument("Non-finite time " + detail::li_to_string(hi) + " + " + detail::li_to_string(lo)
+                                    + " passed to the set_dtime() function of an adaptive Taylor integrator");
+    }
+
+    // NOTE: use the error-free transformation which does not
+    // require |hi| >= |lo|, as the arguments may be arbitrary.
+    const auto [t_hi, t_lo] = detail::eft_add_knuth(hi, lo);
+    m_time = detail::dfloat<T>(t_hi, t_lo);
 }
 
 template <typename T>
@@ -894,7 +2015,52 @@ void taylor_adaptive_impl<T>::set_state(const std::vector<T> &state)
     }
 
     // Do the copy.
-    std::copy(state.begin(), state.end(), m_state.begin());
+    std::copy(state.begin(), state.end(), get_state_data());
+}
+
+template <typename T>
+void taylor_adaptive_impl<T>::attach_state(T *ptr)
+{
+    if (ptr == nullptr) {
+        throw std::invalid_argument("Cannot attach a null external state buffer to an adaptive Taylor integrator");
+    }
+
+    m_ext_state = ptr;
+}
+
+template <typename T>
+void taylor_adaptive_impl<T>::detach_state()
+{
+    if (m_ext_state != nullptr) {
+        std::copy(m_ext_state, m_ext_state + m_state.size(), m_state.begin());
+        m_ext_state = nullptr;
+    }
+}
+
+// Compute the dense output at the time t, that is, evaluate the Taylor
+// polynomials of the last step at t. The result is accurate only
+// if t is within the last step.
+template <typename T>
+const std::vector<T> &taylor_adaptive_impl<T>::update_d_output(T t)
+{
+    if (m_tc.empty()) {
+        throw std::invalid_argument("Cannot compute the dense output of an adaptive Taylor integrator if dense "
+                                    "output was not enabled at construction");
+    }
+
+    if (!detail::isfinite(t)) {
+        throw std::invalid_argument("Cannot compute the dense output of an adaptive Taylor integrator at the "
+                                    "non-finite time "
+                                    + detail::li_to_string(t));
+    }
+
+    // NOTE: the Taylor polynomials are expanded around
+    // the time at the beginning of the last step.
+    const auto h = static_cast<T>(detail::dfloat<T>(t) - m_time) + m_last_h;
+
+    m_d_out_f(m_d_out.data(), m_tc.data(), &h);
+
+    return m_d_out;
 }
 
 template <typename T>
@@ -909,28 +2075,116 @@ const std::vector<expression> &taylor_adaptive_impl<T>::get_decomposition() cons
     return m_dc;
 }
 
+template <typename T>
+const taylor_compile_report &taylor_adaptive_impl<T>::get_compile_report() const
+{
+    return m_compile_report;
+}
+
+template <typename T>
+void taylor_adaptive_impl<T>::save(std::ostream &os) const
+{
+    if (!m_tes.empty() || !m_ntes.empty()) {
+        throw std::invalid_argument("Cannot write the checkpoint of an adaptive Taylor integrator with events");
+    }
+
+    // NOTE: fetch the object code first, so that nothing
+    // is written if it is not available.
+    const auto &obj = m_llvm.get_object_code();
+
+    ckpt_write_header<T>(os, false, m_llvm);
+
+    ckpt_write_arr(os, get_state_data(), m_state.size());
+    ckpt_write(os, m_time.hi);
+    ckpt_write(os, m_time.lo);
+    ckpt_write(os, m_tol);
+    ckpt_write(os, m_order);
+    ckpt_write(os, m_last_order);
+    ckpt_write_vec(os, m_pars);
+    ckpt_write_vec(os, m_tc);
+    ckpt_write(os, m_last_h);
+    ckpt_write_vec(os, m_d_out);
+    ckpt_write_dc(os, m_dc);
+    ckpt_write_report(os, m_compile_report);
+    ckpt_write_str(os, obj);
+
+    if (!os) {
+        throw std::invalid_argument("Error writing the checkpoint of an adaptive Taylor integrator");
+    }
+}
+
+template <typename T>
+taylor_adaptive_impl<T>::taylor_adaptive_impl(std::istream &is) : m_llvm{kw::save_object_code = true}
+{
+    const auto [opt_level, fast_math] = ckpt_read_header<T>(is, false, m_llvm);
+
+    m_state = ckpt_read_vec<T>(is);
+    const auto hi = ckpt_read<T>(is);
+    const auto lo = ckpt_read<T>(is);
+    m_time = dfloat<T>(hi, lo);
+    m_tol = ckpt_read<T>(is);
+    m_order = ckpt_read<std::uint32_t>(is);
+    m_last_order = ckpt_read<std::uint32_t>(is);
+    m_pars = ckpt_read_vec<T>(is);
+    m_tc = ckpt_read_vec<T>(is);
+    m_last_h = ckpt_read<T>(is);
+    m_d_out = ckpt_read_vec<T>(is);
+    m_dc = ckpt_read_dc(is);
+    m_compile_report = ckpt_read_report(is);
+    const auto obj = ckpt_read_str(is);
+
+    // Consistency checks.
+    const auto n_eq = m_state.size();
+    if (n_eq == 0u || m_dc.size() <= n_eq || m_compile_report.n_uvars != m_dc.size() - n_eq
+        || m_d_out.size() != n_eq || m_pars.size() != taylor_dc_n_pars(m_dc)
+        || m_order != taylor_order_from_tol(m_tol) || m_last_order > m_order
+        || (!m_tc.empty() && m_tc.size() != (static_cast<decltype(m_tc.size())>(m_order) + 1u) * n_eq)) {
+        throw std::invalid_argument("The checkpoint of an adaptive Taylor integrator is inconsistent");
+    }
+
+    // Load the compiled code into a state with
+    // the settings of the state which compiled it.
+    m_llvm = llvm_state{kw::save_object_code = true, kw::opt_level = opt_level, kw::fast_math = fast_math};
+    m_llvm.load_object_code(obj);
+    m_step_f = reinterpret_cast<step_f_t>(m_llvm.jit_lookup("step"));
+    m_d_out_f = reinterpret_cast<d_out_f_t>(m_llvm.jit_lookup("d_out"));
+}
+
 // Explicit instantiation of the implementation classes/functions.
 template class taylor_adaptive_impl<double>;
-template void taylor_adaptive_impl<double>::finalise_ctor_impl(std::vector<expression>, std::vector<double>, double,
-                                                               double, bool, bool);
-template void taylor_adaptive_impl<double>::finalise_ctor_impl(std::vector<std::pair<expression, expression>>,
-                                                               std::vector<double>, double, double, bool, bool);
+template void taylor_adaptive_impl<double>::finalise_ctor_impl(
+    std::vector<expression>, std::vector<double>, double, double, bool, bool, const std::string &, bool,
+    std::vector<double>, std::vector<t_event_impl<double>>, std::vector<nt_event_impl<double>>, std::vector<double>,
+    std::vector<double>, const std::vector<std::uint32_t> &, bool);
+template void taylor_adaptive_impl<double>::finalise_ctor_impl(
+    std::vector<std::pair<expression, expression>>, std::vector<double>, double, double, bool, bool,
+    const std::string &, bool, std::vector<double>, std::vector<t_event_impl<double>>,
+    std::vector<nt_event_impl<double>>, std::vector<double>, std::vector<double>, const std::vector<std::uint32_t> &,
+    bool);
 template class taylor_adaptive_impl<long double>;
-template void taylor_adaptive_impl<long double>::finalise_ctor_impl(std::vector<expression>, std::vector<long double>,
-                                                                    long double, long double, bool, bool);
-template void taylor_adaptive_impl<long double>::finalise_ctor_impl(std::vector<std::pair<expression, expression>>,
-                                                                    std::vector<long double>, long double, long double,
-                                                                    bool, bool);
+template void taylor_adaptive_impl<long double>::finalise_ctor_impl(
+    std::vector<expression>, std::vector<long double>, long double, long double, bool, bool, const std::string &, bool,
+    std::vector<long double>, std::vector<t_event_impl<long double>>, std::vector<nt_event_impl<long double>>,
+    std::vector<long double>, std::vector<long double>, const std::vector<std::uint32_t> &, bool);
+template void taylor_adaptive_impl<long double>::finalise_ctor_impl(
+    std::vector<std::pair<expression, expression>>, std::vector<long double>, long double, long double, bool, bool,
+    const std::string &, bool, std::vector<long double>, std::vector<t_event_impl<long double>>,
+    std::vector<nt_event_impl<long double>>, std::vector<long double>, std::vector<long double>,
+    const std::vector<std::uint32_t> &, bool);
 
 #if defined(HEYOKA_HAVE_REAL128)
 
 template class taylor_adaptive_impl<mppp::real128>;
-template void taylor_adaptive_impl<mppp::real128>::finalise_ctor_impl(std::vector<expression>,
-                                                                      std::vector<mppp::real128>, mppp::real128,
-                                                                      mppp::real128, bool, bool);
-template void taylor_adaptive_impl<mppp::real128>::finalise_ctor_impl(std::vector<std::pair<expression, expression>>,
-                                                                      std::vector<mppp::real128>, mppp::real128,
-                                                                      mppp::real128, bool, bool);
+template void taylor_adaptive_impl<mppp::real128>::finalise_ctor_impl(
+    std::vector<expression>, std::vector<mppp::real128>, mppp::real128, mppp::real128, bool, bool, const std::string &,
+    bool, std::vector<mppp::real128>, std::vector<t_event_impl<mppp::real128>>,
+    std::vector<nt_event_impl<mppp::real128>>, std::vector<mppp::real128>, std::vector<mppp::real128>,
+    const std::vector<std::uint32_t> &, bool);
+template void taylor_adaptive_impl<mppp::real128>::finalise_ctor_impl(
+    std::vector<std::pair<expression, expression>>, std::vector<mppp::real128>, mppp::real128, mppp::real128, bool,
+    bool, const std::string &, bool, std::vector<mppp::real128>, std::vector<t_event_impl<mppp::real128>>,
+    std::vector<nt_event_impl<mppp::real128>>, std::vector<mppp::real128>, std::vector<mppp::real128>,
+    const std::vector<std::uint32_t> &, bool);
 
 #endif
 
@@ -943,18 +2197,32 @@ template <typename T>
 template <typename U>
 void taylor_adaptive_batch_impl<T>::finalise_ctor_impl(U sys, std::vector<T> states, std::uint32_t batch_size,
                                                        std::vector<T> times, T tol, bool high_accuracy,
-                                                       bool compact_mode)
+                                                       bool compact_mode, const std::string &object_file,
+                                                       bool dense_output, std::vector<T> pars, std::vector<T> atol,
+                                                       std::vector<T> rtol,
+                                                       const std::vector<std::uint32_t> &tol_exclude,
+                                                       bool variable_order, std::vector<T> lane_tols,
+                                                       taylor_layout layout)
 {
     // Init the data members.
     m_batch_size = batch_size;
+    m_layout = layout;
     m_states = std::move(states);
     m_times = std::move(times);
+    m_pars = std::move(pars);
+    m_lane_tols = std::move(lane_tols);
 
     // Check input params.
     if (m_batch_size == 0u) {
         throw std::invalid_argument("The batch size in an adaptive Taylor integrator cannot be zero");
     }
 
+    if (m_layout != taylor_layout::soa && m_layout != taylor_layout::aos) {
+        throw std::invalid_argument("Invalid memory layout specified in the initialization of an adaptive batch "
+                                    "Taylor integrator: "
+                                    + std::to_string(static_cast<int>(m_layout)));
+    }
+
     if (std::any_of(m_states.begin(), m_states.end(), [](const auto &x) { return !detail::isfinite(x); })) {
         throw std::invalid_argument(
             "A non-finite value was detected in the initial states of an adaptive Taylor integrator");
@@ -981,9 +2249,38 @@ void taylor_adaptive_batch_impl<T>::finalise_ctor_impl(U sys, std::vector<T> sta
                                     + std::to_string(m_batch_size) + ")");
     }
 
-    if (std::any_of(m_times.begin(), m_times.end(), [](const auto &x) { return !detail::isfinite(x); })) {
-        throw std::invalid_argument(
-            "A non-finite initial time was detected in the initialisation of an adaptive Taylor integrator");
+    if (std::any_of(m_times.begin(), m_times.end(), [](const auto &x) { return !detail::isfinite(x); })) {
+        throw std::invalid_argument(
+            "A non-finite initial time was detected in the initialisation of an adaptive Taylor integrator");
+    }
+
+    m_times_lo.resize(m_batch_size, T(0));
+
+    // Validate the per-lane tolerances. If present,
+    // they supersede tol, which is replaced by their
+    // minimum (i.e., the Taylor order of the jet is the
+    // maximum among the orders of the batch elements).
+    if (!m_lane_tols.empty()) {
+        if (m_lane_tols.size() != m_batch_size) {
+            throw std::invalid_argument("Invalid size detected in the initialization of an adaptive Taylor "
+                                        "integrator: the per-lane tolerances vector has a size of "
+                                        + std::to_string(m_lane_tols.size())
+                                        + ", which is not equal to the batch size (" + std::to_string(m_batch_size)
+                                        + ")");
+        }
+
+        if (std::any_of(m_lane_tols.begin(), m_lane_tols.end(),
+                        [](const auto &x) { return !detail::isfinite(x) || x <= 0; })) {
+            throw std::invalid_argument("The per-lane tolerances in an adaptive Taylor integrator must be finite "
+                                        "and positive");
+        }
+
+        if (!atol.empty() || !rtol.empty() || !tol_exclude.empty()) {
+            throw std::invalid_argument("Per-lane tolerances cannot be combined with per-variable tolerances in an "
+                                        "adaptive Taylor integrator");
+        }
+
+        tol = *std::min_element(m_lane_tols.begin(), m_lane_tols.end());
     }
 
     if (!detail::isfinite(tol) || tol <= 0) {
@@ -992,28 +2289,94 @@ void taylor_adaptive_batch_impl<T>::finalise_ctor_impl(U sys, std::vector<T> sta
             + " instead");
     }
 
-    // Add the stepper function.
-    m_dc = taylor_add_adaptive_step<T>(m_llvm, "step", std::move(sys), tol, m_batch_size, high_accuracy, compact_mode);
+    // Record the number of equations.
+    const auto n_eq = boost::numeric_cast<std::uint32_t>(sys.size());
+
+    // Validate the per-variable tolerances.
+    const auto [var_atol, var_rtol] = taylor_setup_var_tols(n_eq, tol, std::move(atol), std::move(rtol), tol_exclude);
 
-    // Run the jit.
-    m_llvm.compile();
+    // Decompose the system of equations.
+    const auto start = std::chrono::steady_clock::now();
+    m_dc = taylor_decompose(std::move(sys));
+    m_compile_report.decomposition_time
+        = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    // NOTE: the last n_eq elements of the decomposition
+    // are the definitions of the derivatives.
+    assert(m_dc.size() >= n_eq);
+    m_compile_report.n_uvars = boost::numeric_cast<std::uint32_t>(m_dc.size() - n_eq);
+
+    // Set up the runtime parameters. The parameters
+    // for which no value was provided are set to zero.
+    const auto n_pars = taylor_dc_n_pars(m_dc);
+    if (m_pars.size() % m_batch_size != 0u) {
+        throw std::invalid_argument("Invalid size detected in the initialization of an adaptive Taylor "
+                                    "integrator: the parameter values vector has a size of "
+                                    + std::to_string(m_pars.size()) + ", which is not a multiple of the batch size ("
+                                    + std::to_string(m_batch_size) + ")");
+    }
+    if (m_pars.size() / m_batch_size > n_pars) {
+        throw std::invalid_argument("Excessive number of parameter values passed to the constructor of an adaptive "
+                                    "Taylor integrator: "
+                                    + std::to_string(m_pars.size() / m_batch_size)
+                                    + " parameter values were passed, but the ODE system contains only "
+                                    + std::to_string(n_pars) + " parameters");
+    }
+    m_pars.resize(static_cast<decltype(m_pars.size())>(n_pars) * m_batch_size, T(0));
+
+    // Set up the compiled stepper.
+    taylor_setup_stepper(m_llvm, m_dc, {}, n_eq, tol, m_batch_size, high_accuracy, compact_mode, var_atol,
+                         var_rtol, variable_order, m_lane_tols, m_layout, object_file, m_compile_report);
 
-    // Fetch the stepper.
+    // Fetch the stepper and the dense output function.
     m_step_f = reinterpret_cast<step_f_t>(m_llvm.jit_lookup("step"));
+    m_d_out_f = reinterpret_cast<d_out_f_t>(m_llvm.jit_lookup("d_out"));
+
+    // Record the llvm report.
+    if (!m_compile_report.cached) {
+        m_compile_report.llvm = m_llvm.get_compile_report();
+    }
+
+    // Prepare the buffers for the dense output.
+    m_tol = tol;
+    m_order = taylor_order_from_tol(tol);
+    m_lane_orders.resize(m_batch_size, m_order);
+    for (decltype(m_lane_tols.size()) i = 0; i < m_lane_tols.size(); ++i) {
+        m_lane_orders[i] = taylor_order_from_tol(m_lane_tols[i]);
+    }
+    if (dense_output) {
+        m_tc.resize(static_cast<decltype(m_tc.size())>(m_order + 1u) * n_eq * m_batch_size);
+    }
+    m_last_hs.resize(m_batch_size);
+    m_d_out.resize(m_states.size());
 
     // Prepare the temp vectors.
     m_pinf.resize(m_batch_size, std::numeric_limits<T>::infinity());
     m_minf.resize(m_batch_size, -std::numeric_limits<T>::infinity());
     m_delta_ts.resize(m_batch_size);
+    m_d_out_hs.resize(m_batch_size);
+    m_prop_max_delta_ts.resize(m_batch_size);
+    m_prop_step_res.resize(m_batch_size);
 }
 
 template <typename T>
 taylor_adaptive_batch_impl<T>::taylor_adaptive_batch_impl(const taylor_adaptive_batch_impl &other)
-    // NOTE: make a manual copy of all members, apart from the function pointers.
-    : m_batch_size(other.m_batch_size), m_states(other.m_states), m_times(other.m_times), m_llvm(other.m_llvm),
-      m_dc(other.m_dc), m_pinf(other.m_pinf), m_minf(other.m_minf), m_delta_ts(other.m_delta_ts)
+    // NOTE: the compiled code is shared between other and the copy
+    // (see the copy constructor of llvm_state), thus the function
+    // pointer to the stepper can be copied as well.
+    // NOTE: if other has an external state buffer attached, the copy
+    // gets a copy of its content in the internal state vectors.
+    : m_batch_size(other.m_batch_size), m_layout(other.m_layout),
+      m_states(other.get_states_data(), other.get_states_data() + other.m_states.size()), m_times(other.m_times),
+      m_times_lo(other.m_times_lo), m_llvm(other.m_llvm),
+      m_dc(other.m_dc), m_pars(other.m_pars), m_step_f(other.m_step_f), m_compile_report(other.m_compile_report),
+      m_tol(other.m_tol), m_lane_tols(other.m_lane_tols), m_order(other.m_order), m_lane_orders(other.m_lane_orders),
+      m_last_order(other.m_last_order), m_tc(other.m_tc), m_last_hs(other.m_last_hs),
+      m_d_out_f(other.m_d_out_f),
+      m_d_out(other.m_d_out), m_pinf(other.m_pinf), m_minf(other.m_minf), m_delta_ts(other.m_delta_ts),
+      m_d_out_hs(other.m_d_out_hs), m_prop_max_delta_ts(other.m_prop_max_delta_ts),
+      m_prop_step_res(other.m_prop_step_res)
 {
-    m_step_f = reinterpret_cast<step_f_t>(m_llvm.jit_lookup("step"));
 }
 
 template <typename T>
@@ -1065,15 +2428,32 @@ void taylor_adaptive_batch_impl<T>::step_impl(std::vector<std::tuple<taylor_outc
     std::copy(max_delta_ts.begin(), max_delta_ts.end(), m_delta_ts.begin());
 
     // Invoke the stepper.
-    m_step_f(m_states.data(), m_delta_ts.data());
+    // NOTE: the Taylor coefficients are written
+    // only if dense output is enabled.
+    m_last_order = m_step_f(get_states_data(), m_pars.data(), m_delta_ts.data(), m_tc.empty() ? nullptr : m_tc.data());
 
-    // Update the times and write out the result.
+    // Update the times and the last timesteps, and write out the result.
     for (std::uint32_t i = 0; i < m_batch_size; ++i) {
         // The timestep that was actually used for
         // this batch element.
         const auto h = m_delta_ts[i];
 
-        m_times[i] += h;
+        // NOTE: the stepper signals a non-finite state in a batch
+        // element by returning a NaN timestep (leaving
+        // the state of the batch element untouched).
+        {
+            using std::isnan;
+
+            if (isnan(h)) {
+                res[i] = std::tuple{taylor_outcome::err_nf_state, T(0)};
+                continue;
+            }
+        }
+
+        const auto new_t = get_dtime(i) + detail::dfloat<T>(h);
+        m_times[i] = new_t.hi;
+        m_times_lo[i] = new_t.lo;
+        m_last_hs[i] = h;
         res[i] = std::tuple{h == max_delta_ts[i] ? taylor_outcome::time_limit : taylor_outcome::success, h};
     }
 }
@@ -1090,6 +2470,298 @@ void taylor_adaptive_batch_impl<T>::step_backward(std::vector<std::tuple<taylor_
     return step_impl(res, m_minf);
 }
 
+// Implementation detail of the propagate functions. The batch elements
+// are propagated up to the times ts. The elements which reach their
+// final time (or which stop for any other reason) are masked out by
+// invoking the stepper with a max timestep of zero, while the other
+// elements keep on being propagated. After each invocation of the stepper,
+// cb is called with the per-element results of the step.
+template <typename T>
+template <typename F>
+void taylor_adaptive_batch_impl<T>::propagate_until_impl(
+    std::vector<std::tuple<taylor_outcome, T, T, std::size_t>> &res, const std::vector<detail::dfloat<T>> &ts,
+    std::size_t max_steps, const F &cb)
+{
+    assert(ts.size() == m_batch_size);
+
+    for (std::uint32_t i = 0; i < m_batch_size; ++i) {
+        if (!detail::isfinite(static_cast<T>(ts[i] - get_dtime(i)))) {
+            throw std::overflow_error("The time limit passed to the propagate_until() function is too large and it "
+                                      "results in an overflow condition");
+        }
+    }
+
+    // Init res. While the propagation is ongoing, the batch
+    // elements which are still active are flagged with the
+    // success outcome.
+    res.resize(m_batch_size);
+    for (std::uint32_t i = 0; i < m_batch_size; ++i) {
+        res[i] = std::tuple{ts[i] == get_dtime(i) ? taylor_outcome::time_limit : taylor_outcome::success,
+                            std::numeric_limits<T>::infinity(), T(0), std::size_t(0)};
+    }
+
+    for (std::size_t step_counter = 0;; ++step_counter) {
+        // Setup the max timesteps.
+        bool any_active = false;
+        for (std::uint32_t i = 0; i < m_batch_size; ++i) {
+            // NOTE: a max timestep of zero results in a null timestep
+            // (or in a NaN timestep if the state is not finite),
+            // so that the inactive batch elements are left untouched.
+            if (std::get<0>(res[i]) == taylor_outcome::success) {
+                m_prop_max_delta_ts[i] = static_cast<T>(ts[i] - get_dtime(i));
+                any_active = true;
+            } else {
+                m_prop_max_delta_ts[i] = 0;
+            }
+        }
+
+        if (!any_active) {
+            break;
+        }
+
+        // Check the max number of steps stopping criterion.
+        if (max_steps != 0u && step_counter == max_steps) {
+            for (auto &r : res) {
+                if (std::get<0>(r) == taylor_outcome::success) {
+                    std::get<0>(r) = taylor_outcome::step_limit;
+                }
+            }
+
+            break;
+        }
+
+        step_impl(m_prop_step_res, m_prop_max_delta_ts);
+
+        for (std::uint32_t i = 0; i < m_batch_size; ++i) {
+            auto &[oc, min_h, max_h, n_steps] = res[i];
+
+            if (oc != taylor_outcome::success) {
+                continue;
+            }
+
+            const auto [s_oc, h] = m_prop_step_res[i];
+
+            if (s_oc == taylor_outcome::err_nf_state) {
+                oc = taylor_outcome::err_nf_state;
+                continue;
+            }
+
+            ++n_steps;
+
+            if (s_oc == taylor_outcome::time_limit) {
+                // The final time was reached. The last
+                // timestep is not used to update min_h/max_h.
+                oc = taylor_outcome::time_limit;
+
+                // NOTE: the timestep was computed from the rounded
+                // difference between the final time and the current time,
+                // thus set the time exactly to the final time in order
+                // to discard the rounding residual.
+                m_times[i] = ts[i].hi;
+                m_times_lo[i] = ts[i].lo;
+            } else {
+                using std::abs;
+
+                min_h = std::min(min_h, abs(h));
+                max_h = std::max(max_h, abs(h));
+            }
+        }
+
+        cb(m_prop_step_res);
+    }
+}
+
+template <typename T>
+void taylor_adaptive_batch_impl<T>::propagate_until(std::vector<std::tuple<taylor_outcome, T, T, std::size_t>> &res,
+                                                    const std::vector<T> &ts, std::size_t max_steps)
+{
+    if (ts.size() != m_batch_size) {
+        throw std::invalid_argument("The vector of times passed to the propagate_until() function of an adaptive "
+                                    "batch Taylor integrator has a size of "
+                                    + std::to_string(ts.size()) + ", which is inconsistent with the batch size ("
+                                    + std::to_string(m_batch_size) + ")");
+    }
+
+    if (std::any_of(ts.begin(), ts.end(), [](const auto &x) { return !detail::isfinite(x); })) {
+        throw std::invalid_argument("A non-finite time was passed to the propagate_until() function of an adaptive "
+                                    "batch Taylor integrator");
+    }
+
+    std::vector<detail::dfloat<T>> d_ts;
+    d_ts.reserve(m_batch_size);
+    for (const auto &t : ts) {
+        d_ts.emplace_back(t);
+    }
+
+    propagate_until_impl(res, d_ts, max_steps, [](const auto &) {});
+}
+
+template <typename T>
+void taylor_adaptive_batch_impl<T>::propagate_for(std::vector<std::tuple<taylor_outcome, T, T, std::size_t>> &res,
+                                                  const std::vector<T> &delta_ts, std::size_t max_steps)
+{
+    if (delta_ts.size() != m_batch_size) {
+        throw std::invalid_argument("The vector of time intervals passed to the propagate_for() function of an "
+                                    "adaptive batch Taylor integrator has a size of "
+                                    + std::to_string(delta_ts.size()) + ", which is inconsistent with the batch size ("
+                                    + std::to_string(m_batch_size) + ")");
+    }
+
+    if (std::any_of(delta_ts.begin(), delta_ts.end(), [](const auto &x) { return !detail::isfinite(x); })) {
+        throw std::invalid_argument("A non-finite time interval was passed to the propagate_for() function of an "
+                                    "adaptive batch Taylor integrator");
+    }
+
+    std::vector<detail::dfloat<T>> ts;
+    ts.reserve(m_batch_size);
+    for (std::uint32_t i = 0; i < m_batch_size; ++i) {
+        ts.push_back(get_dtime(i) + detail::dfloat<T>(delta_ts[i]));
+    }
+
+    propagate_until_impl(res, ts, max_steps, [](const auto &) {});
+}
+
+template <typename T>
+std::vector<T>
+taylor_adaptive_batch_impl<T>::propagate_grid(std::vector<std::tuple<taylor_outcome, T, T, std::size_t>> &res,
+                                              const std::vector<T> &grid, std::size_t max_steps)
+{
+    if (m_tc.empty()) {
+        throw std::invalid_argument("Cannot invoke the propagate_grid() function of an adaptive batch Taylor "
+                                    "integrator if dense output was not enabled at construction");
+    }
+
+    if (grid.empty() || grid.size() % m_batch_size != 0u) {
+        throw std::invalid_argument("The time grid passed to the propagate_grid() function of an adaptive batch "
+                                    "Taylor integrator has a size of "
+                                    + std::to_string(grid.size())
+                                    + ", which is not a nonzero multiple of the batch size ("
+                                    + std::to_string(m_batch_size) + ")");
+    }
+
+    if (std::any_of(grid.begin(), grid.end(), [](const auto &x) { return !detail::isfinite(x); })) {
+        throw std::invalid_argument("A non-finite time was detected in the grid passed to the propagate_grid() "
+                                    "function of an adaptive batch Taylor integrator");
+    }
+
+    const auto n_points = grid.size() / m_batch_size;
+    const auto state_size = m_states.size();
+
+    // Check that, for each batch element, the grid
+    // is monotonic in the direction of integration
+    // (starting from the current time).
+    for (std::uint32_t i = 0; i < m_batch_size; ++i) {
+        const auto forward = grid[(n_points - 1u) * m_batch_size + i] >= m_times[i];
+
+        auto prev = m_times[i];
+        for (decltype(grid.size()) p = 0; p < n_points; ++p) {
+            const auto cur = grid[p * m_batch_size + i];
+
+            if (forward ? cur < prev : cur > prev) {
+                throw std::invalid_argument("The time grid passed to the propagate_grid() function of an adaptive "
+                                            "batch Taylor integrator must be monotonic in the direction of "
+                                            "integration for each batch element");
+            }
+
+            prev = cur;
+        }
+    }
+
+    // Prepare the return value. The states at the grid
+    // points which are not reached (e.g., because the max
+    // number of steps was hit) are left as NaNs.
+    std::vector<T> retval;
+    if (n_points > std::numeric_limits<decltype(retval.size())>::max() / state_size) {
+        throw std::overflow_error("Overflow detected in the creation of the return value of propagate_grid()");
+    }
+    retval.resize(n_points * state_size, std::numeric_limits<T>::quiet_NaN());
+
+    // Write out the state of the batch element i
+    // at the grid point p from the array src.
+    // NOTE: the output keeps the layout of the integrator.
+    auto write_state = [&](const T *src, decltype(grid.size()) p, std::uint32_t i) {
+        const auto n_eq = state_size / m_batch_size;
+        for (decltype(retval.size()) j = 0; j < n_eq; ++j) {
+            const auto idx = m_layout == taylor_layout::aos ? i * n_eq + j : j * m_batch_size + i;
+            retval[p * state_size + idx] = src[idx];
+        }
+    };
+
+    // The index of the next grid point,
+    // for each batch element.
+    std::vector<decltype(grid.size())> cur_idx(m_batch_size, 0);
+
+    // The grid points which coincide with
+    // the current time do not need any step.
+    for (std::uint32_t i = 0; i < m_batch_size; ++i) {
+        for (; cur_idx[i] < n_points && grid[cur_idx[i] * m_batch_size + i] == m_times[i]; ++cur_idx[i]) {
+            write_state(get_states_data(), cur_idx[i], i);
+        }
+    }
+
+    std::vector<detail::dfloat<T>> final_ts;
+    final_ts.reserve(m_batch_size);
+    for (std::uint32_t i = 0; i < m_batch_size; ++i) {
+        final_ts.emplace_back(grid[(n_points - 1u) * m_batch_size + i]);
+    }
+
+    // Helper to determine if the next grid point of the batch element i
+    // falls within the last step. The elements which were not active
+    // in the last step have either consumed the whole grid or
+    // stopped because of an error.
+    auto in_step = [&](const std::vector<std::tuple<taylor_outcome, T>> &step_res, std::uint32_t i) {
+        const auto oc = std::get<0>(res[i]);
+        if (cur_idx[i] == n_points || (oc != taylor_outcome::success && oc != taylor_outcome::time_limit)) {
+            return false;
+        }
+
+        const auto [s_oc, h] = step_res[i];
+        const auto gt = grid[cur_idx[i] * m_batch_size + i];
+
+        // NOTE: if the final time was reached, all
+        // the remaining grid points are within the step.
+        return s_oc == taylor_outcome::time_limit || (h > 0 && gt <= m_times[i]) || (h < 0 && gt >= m_times[i]);
+    };
+
+    // After each step, use the dense output to compute
+    // the states at the grid points within the step.
+    auto cb = [&](const std::vector<std::tuple<taylor_outcome, T>> &step_res) {
+        while (true) {
+            bool any_pending = false;
+
+            for (std::uint32_t i = 0; i < m_batch_size; ++i) {
+                if (in_step(step_res, i)) {
+                    // NOTE: the Taylor polynomials are expanded around
+                    // the times at the beginning of the last step.
+                    m_d_out_hs[i]
+                        = static_cast<T>(detail::dfloat<T>(grid[cur_idx[i] * m_batch_size + i]) - get_dtime(i))
+                          + std::get<1>(step_res[i]);
+                    any_pending = true;
+                } else {
+                    m_d_out_hs[i] = 0;
+                }
+            }
+
+            if (!any_pending) {
+                break;
+            }
+
+            m_d_out_f(m_d_out.data(), m_tc.data(), m_d_out_hs.data());
+
+            for (std::uint32_t i = 0; i < m_batch_size; ++i) {
+                if (in_step(step_res, i)) {
+                    write_state(m_d_out.data(), cur_idx[i], i);
+                    ++cur_idx[i];
+                }
+            }
+        }
+    };
+
+    propagate_until_impl(res, final_ts, max_steps, cb);
+
+    return retval;
+}
+
 template <typename T>
 void taylor_adaptive_batch_impl<T>::set_times(const std::vector<T> &t)
 {
@@ -1113,6 +2785,7 @@ void taylor_adaptive_batch_impl<T>::set_times(const std::vector<T> &t)
 
     // Do the copy.
     std::copy(t.begin(), t.end(), m_times.begin());
+    std::fill(m_times_lo.begin(), m_times_lo.end(), T(0));
 }
 
 template <typename T>
@@ -1138,7 +2811,135 @@ void taylor_adaptive_batch_impl<T>::set_states(const std::vector<T> &states)
     }
 
     // Do the copy.
-    std::copy(states.begin(), states.end(), m_states.begin());
+    std::copy(states.begin(), states.end(), get_states_data());
+}
+
+template <typename T>
+void taylor_adaptive_batch_impl<T>::set_lane_state(std::uint32_t idx, const std::vector<T> &state)
+{
+    if (idx >= m_batch_size) {
+        throw std::invalid_argument("Cannot set the state of the batch element at index " + std::to_string(idx)
+                                    + " in an adaptive batch Taylor integrator with a batch size of "
+                                    + std::to_string(m_batch_size));
+    }
+
+    const auto n_eq = m_states.size() / m_batch_size;
+
+    if (state.size() != n_eq) {
+        throw std::invalid_argument("The state vector passed to the set_lane_state() function of an adaptive batch "
+                                    "Taylor integrator has a size of "
+                                    + std::to_string(state.size())
+                                    + ", which is inconsistent with the number of variables ("
+                                    + std::to_string(n_eq) + ")");
+    }
+
+    if (std::any_of(state.begin(), state.end(), [](const T &x) { return !detail::isfinite(x); })) {
+        throw std::invalid_argument("A non-finite state vector was passed to the set_lane_state() function of an "
+                                    "adaptive batch Taylor integrator");
+    }
+
+    auto *s_ptr = get_states_data();
+    if (m_layout == taylor_layout::aos) {
+        std::copy(state.begin(), state.end(), s_ptr + idx * n_eq);
+    } else {
+        for (decltype(state.size()) i = 0; i < n_eq; ++i) {
+            s_ptr[i * m_batch_size + idx] = state[i];
+        }
+    }
+}
+
+template <typename T>
+void taylor_adaptive_batch_impl<T>::set_lane_time(std::uint32_t idx, T t)
+{
+    if (idx >= m_batch_size) {
+        throw std::invalid_argument("Cannot set the time of the batch element at index " + std::to_string(idx)
+                                    + " in an adaptive batch Taylor integrator with a batch size of "
+                                    + std::to_string(m_batch_size));
+    }
+
+    if (!detail::isfinite(t)) {
+        throw std::invalid_argument("Non-finite time " + detail::li_to_string(t)
+                                    + " passed to the set_lane_time() function of an adaptive batch Taylor "
+                                      "integrator");
+    }
+
+    m_times[idx] = t;
+    m_times_lo[idx] = 0;
+}
+
+template <typename T>
+void taylor_adaptive_batch_impl<T>::set_lane_dtime(std::uint32_t idx, T hi, T lo)
+{
+    if (idx >= m_batch_size) {
+        throw std::invalid_argument("Cannot set the time of the batch element at index " + std::to_string(idx)
+                                    + " in an adaptive batch Taylor integrator with a batch size of "
+                                    + std::to_string(m_batch_size));
+    }
+
+    if (!detail::isfinite(hi) || !detail::isfinite(lo)) {
+        throw std::invalid_argument("Non-finite time " + detail::li_to_string(hi) + " + " + detail::li_to_string(lo)
+                                    + " passed to the set_lane_dtime() function of an adaptive batch Taylor "
+                                      "integrator");
+    }
+
+    // NOTE: see set_dtime() in the scalar integrator.
+    const auto [t_hi, t_lo] = detail::eft_add_knuth(hi, lo);
+    m_times[idx] = t_hi;
+    m_times_lo[idx] = t_lo;
+}
+
+template <typename T>
+void taylor_adaptive_batch_impl<T>::attach_states(T *ptr)
+{
+    if (ptr == nullptr) {
+        throw std::invalid_argument(
+            "Cannot attach a null external state buffer to an adaptive batch Taylor integrator");
+    }
+
+    m_ext_states = ptr;
+}
+
+template <typename T>
+void taylor_adaptive_batch_impl<T>::detach_states()
+{
+    if (m_ext_states != nullptr) {
+        std::copy(m_ext_states, m_ext_states + m_states.size(), m_states.begin());
+        m_ext_states = nullptr;
+    }
+}
+
+// Compute the dense output at the times t, that is, evaluate the Taylor
+// polynomials of the last step at t for each batch element. The result
+// is accurate only if each time is within the corresponding last step.
+template <typename T>
+const std::vector<T> &taylor_adaptive_batch_impl<T>::update_d_output(const std::vector<T> &t)
+{
+    if (m_tc.empty()) {
+        throw std::invalid_argument("Cannot compute the dense output of an adaptive batch Taylor integrator if dense "
+                                    "output was not enabled at construction");
+    }
+
+    if (t.size() != m_batch_size) {
+        throw std::invalid_argument("The vector of times passed to the update_d_output() function of an adaptive "
+                                    "batch Taylor integrator has a size of "
+                                    + std::to_string(t.size()) + ", which is inconsistent with the batch size ("
+                                    + std::to_string(m_batch_size) + ")");
+    }
+
+    if (std::any_of(t.begin(), t.end(), [](const auto &x) { return !detail::isfinite(x); })) {
+        throw std::invalid_argument("Cannot compute the dense output of an adaptive batch Taylor integrator at "
+                                    "non-finite times");
+    }
+
+    // NOTE: the Taylor polynomials are expanded around
+    // the times at the beginning of the last step.
+    for (std::uint32_t i = 0; i < m_batch_size; ++i) {
+        m_d_out_hs[i] = static_cast<T>(detail::dfloat<T>(t[i]) - get_dtime(i)) + m_last_hs[i];
+    }
+
+    m_d_out_f(m_d_out.data(), m_tc.data(), m_d_out_hs.data());
+
+    return m_d_out;
 }
 
 template <typename T>
@@ -1153,36 +2954,138 @@ const std::vector<expression> &taylor_adaptive_batch_impl<T>::get_decomposition(
     return m_dc;
 }
 
+template <typename T>
+const taylor_compile_report &taylor_adaptive_batch_impl<T>::get_compile_report() const
+{
+    return m_compile_report;
+}
+
+template <typename T>
+void taylor_adaptive_batch_impl<T>::save(std::ostream &os) const
+{
+    // NOTE: fetch the object code first, so that nothing
+    // is written if it is not available.
+    const auto &obj = m_llvm.get_object_code();
+
+    ckpt_write_header<T>(os, true, m_llvm);
+
+    ckpt_write(os, m_batch_size);
+    ckpt_write(os, static_cast<std::int32_t>(m_layout));
+    ckpt_write_arr(os, get_states_data(), m_states.size());
+    ckpt_write_vec(os, m_times);
+    ckpt_write_vec(os, m_times_lo);
+    ckpt_write(os, m_tol);
+    ckpt_write_vec(os, m_lane_tols);
+    ckpt_write(os, m_order);
+    ckpt_write(os, m_last_order);
+    ckpt_write_vec(os, m_pars);
+    ckpt_write_vec(os, m_tc);
+    ckpt_write_vec(os, m_last_hs);
+    ckpt_write_vec(os, m_d_out);
+    ckpt_write_dc(os, m_dc);
+    ckpt_write_report(os, m_compile_report);
+    ckpt_write_str(os, obj);
+
+    if (!os) {
+        throw std::invalid_argument("Error writing the checkpoint of an adaptive batch Taylor integrator");
+    }
+}
+
+template <typename T>
+taylor_adaptive_batch_impl<T>::taylor_adaptive_batch_impl(std::istream &is) : m_llvm{kw::save_object_code = true}
+{
+    const auto [opt_level, fast_math] = ckpt_read_header<T>(is, true, m_llvm);
+
+    m_batch_size = ckpt_read<std::uint32_t>(is);
+    m_layout = static_cast<taylor_layout>(ckpt_read<std::int32_t>(is));
+    m_states = ckpt_read_vec<T>(is);
+    m_times = ckpt_read_vec<T>(is);
+    m_times_lo = ckpt_read_vec<T>(is);
+    m_tol = ckpt_read<T>(is);
+    m_lane_tols = ckpt_read_vec<T>(is);
+    m_order = ckpt_read<std::uint32_t>(is);
+    m_last_order = ckpt_read<std::uint32_t>(is);
+    m_pars = ckpt_read_vec<T>(is);
+    m_tc = ckpt_read_vec<T>(is);
+    m_last_hs = ckpt_read_vec<T>(is);
+    m_d_out = ckpt_read_vec<T>(is);
+    m_dc = ckpt_read_dc(is);
+    m_compile_report = ckpt_read_report(is);
+    const auto obj = ckpt_read_str(is);
+
+    // Consistency checks.
+    if (m_batch_size == 0u || (m_layout != taylor_layout::soa && m_layout != taylor_layout::aos) || m_states.empty()
+        || m_states.size() % m_batch_size != 0u) {
+        throw std::invalid_argument("The checkpoint of an adaptive batch Taylor integrator is inconsistent");
+    }
+    const auto n_eq = m_states.size() / m_batch_size;
+    if (m_dc.size() <= n_eq || m_compile_report.n_uvars != m_dc.size() - n_eq || m_times.size() != m_batch_size
+        || m_times_lo.size() != m_batch_size
+        || (!m_lane_tols.empty() && m_lane_tols.size() != m_batch_size)
+        || m_pars.size() != static_cast<decltype(m_pars.size())>(taylor_dc_n_pars(m_dc)) * m_batch_size
+        || m_order != taylor_order_from_tol(m_tol)
+        || m_last_order > m_order
+        || (!m_tc.empty() && m_tc.size() != (static_cast<decltype(m_tc.size())>(m_order) + 1u) * m_states.size())
+        || m_last_hs.size() != m_batch_size || m_d_out.size() != m_states.size()) {
+        throw std::invalid_argument("The checkpoint of an adaptive batch Taylor integrator is inconsistent");
+    }
+
+    // Rebuild the Taylor orders of the batch elements.
+    m_lane_orders.resize(m_batch_size, m_order);
+    for (decltype(m_lane_tols.size()) i = 0; i < m_lane_tols.size(); ++i) {
+        m_lane_orders[i] = taylor_order_from_tol(m_lane_tols[i]);
+    }
+
+    // Load the compiled code into a state with
+    // the settings of the state which compiled it.
+    m_llvm = llvm_state{kw::save_object_code = true, kw::opt_level = opt_level, kw::fast_math = fast_math};
+    m_llvm.load_object_code(obj);
+    m_step_f = reinterpret_cast<step_f_t>(m_llvm.jit_lookup("step"));
+    m_d_out_f = reinterpret_cast<d_out_f_t>(m_llvm.jit_lookup("d_out"));
+
+    // Prepare the temp vectors.
+    m_pinf.resize(m_batch_size, std::numeric_limits<T>::infinity());
+    m_minf.resize(m_batch_size, -std::numeric_limits<T>::infinity());
+    m_delta_ts.resize(m_batch_size);
+    m_d_out_hs.resize(m_batch_size);
+    m_prop_max_delta_ts.resize(m_batch_size);
+    m_prop_step_res.resize(m_batch_size);
+}
+
 // Explicit instantiation of the batch implementation classes.
 template class taylor_adaptive_batch_impl<double>;
-template void taylor_adaptive_batch_impl<double>::finalise_ctor_impl(std::vector<expression>, std::vector<double>,
-                                                                     std::uint32_t, std::vector<double>, double, bool,
-                                                                     bool);
-template void taylor_adaptive_batch_impl<double>::finalise_ctor_impl(std::vector<std::pair<expression, expression>>,
-                                                                     std::vector<double>, std::uint32_t,
-                                                                     std::vector<double>, double, bool, bool);
+template void taylor_adaptive_batch_impl<double>::finalise_ctor_impl(
+    std::vector<expression>, std::vector<double>, std::uint32_t, std::vector<double>, double, bool, bool,
+    const std::string &, bool, std::vector<double>, std::vector<double>, std::vector<double>,
+    const std::vector<std::uint32_t> &, bool, std::vector<double>, taylor_layout);
+template void taylor_adaptive_batch_impl<double>::finalise_ctor_impl(
+    std::vector<std::pair<expression, expression>>, std::vector<double>, std::uint32_t, std::vector<double>, double,
+    bool, bool, const std::string &, bool, std::vector<double>, std::vector<double>, std::vector<double>,
+    const std::vector<std::uint32_t> &, bool, std::vector<double>, taylor_layout);
 
 template class taylor_adaptive_batch_impl<long double>;
-template void taylor_adaptive_batch_impl<long double>::finalise_ctor_impl(std::vector<expression>,
-                                                                          std::vector<long double>, std::uint32_t,
-                                                                          std::vector<long double>, long double, bool,
-                                                                          bool);
-template void
-taylor_adaptive_batch_impl<long double>::finalise_ctor_impl(std::vector<std::pair<expression, expression>>,
-                                                            std::vector<long double>, std::uint32_t,
-                                                            std::vector<long double>, long double, bool, bool);
+template void taylor_adaptive_batch_impl<long double>::finalise_ctor_impl(
+    std::vector<expression>, std::vector<long double>, std::uint32_t, std::vector<long double>, long double, bool, bool,
+    const std::string &, bool, std::vector<long double>, std::vector<long double>, std::vector<long double>,
+    const std::vector<std::uint32_t> &, bool, std::vector<long double>, taylor_layout);
+template void taylor_adaptive_batch_impl<long double>::finalise_ctor_impl(
+    std::vector<std::pair<expression, expression>>, std::vector<long double>, std::uint32_t, std::vector<long double>,
+    long double, bool, bool, const std::string &, bool, std::vector<long double>, std::vector<long double>,
+    std::vector<long double>, const std::vector<std::uint32_t> &, bool, std::vector<long double>,
+    taylor_layout);
 
 #if defined(HEYOKA_HAVE_REAL128)
 
 template class taylor_adaptive_batch_impl<mppp::real128>;
-template void taylor_adaptive_batch_impl<mppp::real128>::finalise_ctor_impl(std::vector<expression>,
-                                                                            std::vector<mppp::real128>, std::uint32_t,
-                                                                            std::vector<mppp::real128>, mppp::real128,
-                                                                            bool, bool);
-template void
-taylor_adaptive_batch_impl<mppp::real128>::finalise_ctor_impl(std::vector<std::pair<expression, expression>>,
-                                                              std::vector<mppp::real128>, std::uint32_t,
-                                                              std::vector<mppp::real128>, mppp::real128, bool, bool);
+template void taylor_adaptive_batch_impl<mppp::real128>::finalise_ctor_impl(
+    std::vector<expression>, std::vector<mppp::real128>, std::uint32_t, std::vector<mppp::real128>, mppp::real128, bool,
+    bool, const std::string &, bool, std::vector<mppp::real128>, std::vector<mppp::real128>, std::vector<mppp::real128>,
+    const std::vector<std::uint32_t> &, bool, std::vector<mppp::real128>, taylor_layout);
+template void taylor_adaptive_batch_impl<mppp::real128>::finalise_ctor_impl(
+    std::vector<std::pair<expression, expression>>, std::vector<mppp::real128>, std::uint32_t,
+    std::vector<mppp::real128>, mppp::real128, bool, bool, const std::string &, bool, std::vector<mppp::real128>,
+    std::vector<mppp::real128>, std::vector<mppp::real128>, const std::vector<std::uint32_t> &, bool,
+    std::vector<mppp::real128>, taylor_layout);
 
 #endif
 
@@ -1239,6 +3142,24 @@ void taylor_c_store_diff(llvm_state &s, llvm::Value *diff_arr, std::uint32_t n_u
     builder.CreateStore(val, ptr);
 }
 
+// Load the value of the parameter at index p_idx from the array of parameter values par_ptr.
+// In batch mode, the parameter values are laid out as [p_idx][batch_idx].
+llvm::Value *taylor_load_param(llvm_state &s, llvm::Value *par_ptr, std::uint32_t p_idx, std::uint32_t batch_size)
+{
+    assert(batch_size > 0u);
+
+    // Overflow check.
+    if (p_idx > std::numeric_limits<std::uint32_t>::max() / batch_size) {
+        throw std::overflow_error("Overflow while loading a parameter value in a Taylor jet");
+    }
+
+    auto &builder = s.builder();
+
+    auto ptr = builder.CreateInBoundsGEP(par_ptr, {builder.getInt32(p_idx * batch_size)});
+
+    return load_vector_from_memory(builder, ptr, batch_size);
+}
+
 // RAII helper to temporarily disable most fast math flags that might
 // be set in an LLVM builder. On destruction, the original fast math
 // flags will be restored.
@@ -1357,9 +3278,14 @@ llvm::Value *taylor_c_compute_sv_diff(llvm_state &s, const expression &ex, llvm:
 // is the number of equations/variables in the ODE sys, dc its Taylor decomposition,
 // n_uvars the total number of u variables in the decomposition.
 // order is the max derivative order desired, batch_size the batch size.
-// order0 contains the zero order derivatives of the state variables.
+// order0 contains the zero order derivatives of the state variables,
+// par_ptr is a pointer to the array of parameter values.
+// ev_dc contains the definitions of the event functions in terms of u variables
+// (as returned by taylor_decompose_impl()), and it may be empty.
 //
-// The return value is the jet of derivatives of the state variables up to order 'order'.
+// The return value is the jet of derivatives of the state variables up to order 'order',
+// followed by the jet of derivatives of the event functions up to order 'order'. Both jets are
+// laid out as [order][idx].
 //
 // NOTE: at one point we had another version of this function which would return a variant
 // containing either the diff array for all uvars (compact mode) or a std::vector containing the jet
@@ -1367,23 +3293,62 @@ llvm::Value *taylor_c_compute_sv_diff(llvm_state &s, const expression &ex, llvm:
 // with computations later (e.g., in the determination of rho and in the Taylor polynomial
 // evaluation functions). This did not seem to make a difference, performance-wise, but it might
 // be useful to remember about this. See tree state @ 7476630eb5a1d6ac6204035093faecdd1f6d7da5.
+//
+// NOTE: in compact mode, the jet can be truncated at runtime at an order lower than 'order'
+// via vo_check. vo_check is invoked with the current order and the diff array
+// after the computation of the derivatives of the state variables at the current order,
+// and it must return a boolean value signalling whether the jet can be truncated at the current order.
+// The derivatives above the truncation order are then set to zero, and the truncation
+// order is written into vo_order.
 template <typename T>
-auto taylor_compute_jet(llvm_state &s, std::vector<llvm::Value *> order0, const std::vector<expression> &dc,
-                        std::uint32_t n_eq, std::uint32_t n_uvars, std::uint32_t order, std::uint32_t batch_size,
-                        bool compact_mode)
+auto taylor_compute_jet(llvm_state &s, std::vector<llvm::Value *> order0, llvm::Value *par_ptr,
+                        const std::vector<expression> &dc, const std::vector<expression> &ev_dc, std::uint32_t n_eq,
+                        std::uint32_t n_uvars, std::uint32_t order, std::uint32_t batch_size, bool compact_mode,
+                        const std::function<llvm::Value *(llvm::Value *, llvm::Value *)> &vo_check = {},
+                        llvm::Value **vo_order = nullptr)
 {
     assert(order0.size() == n_eq);
     assert(n_eq > 0u);
     assert(order > 0u);
+    assert(!vo_check || (compact_mode && vo_order != nullptr));
 
-    // Make sure we can represent a size of n_uvars * order + n_eq as a 32-bit
-    // unsigned integer. This is the total number of derivatives we will have to compute
-    // and store.
+    // NOTE: if there are event functions, we will need the derivatives
+    // of order 'order' of all the u variables (and not only of the
+    // state variables).
+    const auto with_events = !ev_dc.empty();
+
+    // Make sure we can represent a size of n_uvars * order + n_eq (or n_uvars * (order + 1)
+    // in the presence of event functions) as a 32-bit unsigned integer. This is the total
+    // number of derivatives we will have to compute and store.
     if (n_uvars > std::numeric_limits<std::uint32_t>::max() / order
-        || n_uvars * order > std::numeric_limits<std::uint32_t>::max() - n_eq) {
+        || n_uvars * order > std::numeric_limits<std::uint32_t>::max() - (with_events ? n_uvars : n_eq)) {
         throw std::overflow_error(
             "An overflow condition was detected in the computation of a jet of Taylor derivatives");
     }
+    const auto n_tot_diffs = n_uvars * order + (with_events ? n_uvars : n_eq);
+
+    // Helper to compute the derivative of order o of the event function
+    // ev (which is either a u variable or a number), given a function
+    // to fetch the derivatives of the u variables.
+    auto ev_diff = [&](const expression &ev, std::uint32_t o,
+                       const std::function<llvm::Value *(std::uint32_t, std::uint32_t)> &fetch) -> llvm::Value * {
+        return std::visit(
+            [&](const auto &v) -> llvm::Value * {
+                using type = uncvref_t<decltype(v)>;
+
+                if constexpr (std::is_same_v<type, variable>) {
+                    return fetch(uname_to_index(v.name()), o);
+                } else if constexpr (std::is_same_v<type, number>) {
+                    // A constant event function: the only nonzero
+                    // derivative is the order-0 one.
+                    return vector_splat(s.builder(), codegen<T>(s, (o == 0u) ? v : number{0.}), batch_size);
+                } else {
+                    assert(false);
+                    return nullptr;
+                }
+            },
+            ev.value());
+    };
 
     std::vector<llvm::Value *> retval;
 
@@ -1396,7 +3361,7 @@ auto taylor_compute_jet(llvm_state &s, std::vector<llvm::Value *> order0, const
         // 'order' of the state variables only.
         // NOTE: the array size is specified as a 64-bit integer in the
         // LLVM API.
-        auto array_type = llvm::ArrayType::get(order0[0]->getType(), n_uvars * order + n_eq);
+        auto array_type = llvm::ArrayType::get(order0[0]->getType(), n_tot_diffs);
         // NOTE: fetch a pointer to the first element of the array.
         auto diff_arr = builder.CreateInBoundsGEP(builder.CreateAlloca(array_type, 0, "diff_arr"),
                                                   {builder.getInt32(0), builder.getInt32(0)});
@@ -1407,33 +3372,109 @@ auto taylor_compute_jet(llvm_state &s, std::vector<llvm::Value *> order0, const
         }
 
         // Run the init for the other u variables.
+        // NOTE: the u variables defined as parameters are
+        // initialised directly from the array of parameter values.
         for (auto i = n_eq; i < n_uvars; ++i) {
-            auto val = taylor_c_u_init<T>(s, dc[i], diff_arr, batch_size);
+            auto val = std::holds_alternative<param>(dc[i].value())
+                           ? taylor_load_param(s, par_ptr, std::get<param>(dc[i].value()).idx(), batch_size)
+                           : taylor_c_u_init<T>(s, dc[i], diff_arr, batch_size);
             taylor_c_store_diff(s, diff_arr, n_uvars, builder.getInt32(0), i, val);
         }
 
+        // In variable-order mode, prepare the storage
+        // for the truncation order of the jet.
+        llvm::Value *vo_ord_ptr = nullptr, *vo_stop = nullptr;
+        if (vo_check) {
+            vo_ord_ptr = builder.CreateAlloca(builder.getInt32Ty());
+            builder.CreateStore(builder.getInt32(order), vo_ord_ptr);
+        }
+
+        // Helper to compute the derivatives of the u variables
+        // other than the state variables at the order cur_order.
+        auto compute_uvars_diffs = [&](llvm::Value *cur_order) {
+            for (auto i = n_eq; i < n_uvars; ++i) {
+                taylor_c_store_diff(s, diff_arr, n_uvars, cur_order, i,
+                                    taylor_c_diff<T>(s, dc[i], diff_arr, n_uvars, cur_order, i, batch_size));
+            }
+        };
+
+        // In variable-order mode, exit early
+        // from the loop if the jet is truncated.
+        std::function<llvm::Value *(llvm::Value *)> vo_cont;
+        if (vo_check) {
+            vo_cont = [&](llvm::Value *) { return builder.CreateNot(vo_stop); };
+        }
+
         // Compute all derivatives up to order 'order - 1'.
-        llvm_loop_u32(s, builder.getInt32(1), builder.getInt32(order), [&](llvm::Value *cur_order) {
-            // Begin with the state variables.
-            // NOTE: the derivatives of the state variables
-            // are at the end of the decomposition vector.
+        llvm_loop_u32(
+            s, builder.getInt32(1), builder.getInt32(order),
+            [&](llvm::Value *cur_order) {
+                // Begin with the state variables.
+                // NOTE: the derivatives of the state variables
+                // are at the end of the decomposition vector.
+                for (auto i = n_uvars; i < boost::numeric_cast<std::uint32_t>(dc.size()); ++i) {
+                    taylor_c_store_diff(
+                        s, diff_arr, n_uvars, cur_order, i - n_uvars,
+                        taylor_c_compute_sv_diff<T>(s, dc[i], diff_arr, n_uvars, cur_order, batch_size));
+                }
+
+                // Now the other u variables. In variable-order mode, they
+                // are not needed if the jet is truncated at cur_order
+                // (unless they are needed by the event functions).
+                if (vo_check) {
+                    vo_stop = vo_check(cur_order, diff_arr);
+                    builder.CreateStore(builder.CreateSelect(vo_stop, cur_order, builder.getInt32(order)),
+                                        vo_ord_ptr);
+                }
+
+                if (vo_check && !with_events) {
+                    llvm_if_then_else(
+                        s, vo_stop, []() {}, [&]() { compute_uvars_diffs(cur_order); });
+                } else {
+                    compute_uvars_diffs(cur_order);
+                }
+            },
+            vo_cont);
+
+        auto compute_last_diffs = [&]() {
+            // Compute the last-order derivatives for the state variables.
             for (auto i = n_uvars; i < boost::numeric_cast<std::uint32_t>(dc.size()); ++i) {
-                taylor_c_store_diff(s, diff_arr, n_uvars, cur_order, i - n_uvars,
-                                    taylor_c_compute_sv_diff<T>(s, dc[i], diff_arr, n_uvars, cur_order, batch_size));
+                taylor_c_store_diff(
+                    s, diff_arr, n_uvars, builder.getInt32(order), i - n_uvars,
+                    taylor_c_compute_sv_diff<T>(s, dc[i], diff_arr, n_uvars, builder.getInt32(order), batch_size));
             }
 
-            // Now the other u variables.
-            for (auto i = n_eq; i < n_uvars; ++i) {
-                taylor_c_store_diff(s, diff_arr, n_uvars, cur_order, i,
-                                    taylor_c_diff<T>(s, dc[i], diff_arr, n_uvars, cur_order, i, batch_size));
+            // Compute the last-order derivatives for the other
+            // u variables, if needed by the event functions.
+            if (with_events) {
+                compute_uvars_diffs(builder.getInt32(order));
             }
-        });
-
-        // Compute the last-order derivatives for the state variables.
-        for (auto i = n_uvars; i < boost::numeric_cast<std::uint32_t>(dc.size()); ++i) {
-            taylor_c_store_diff(
-                s, diff_arr, n_uvars, builder.getInt32(order), i - n_uvars,
-                taylor_c_compute_sv_diff<T>(s, dc[i], diff_arr, n_uvars, builder.getInt32(order), batch_size));
+        };
+
+        if (vo_check) {
+            auto *ord = builder.CreateLoad(vo_ord_ptr);
+            *vo_order = ord;
+
+            llvm_if_then_else(s, builder.CreateICmpEQ(ord, builder.getInt32(order)), compute_last_diffs, [&]() {
+                // The jet was truncated: zero out the derivatives above
+                // the truncation order, so that the Taylor polynomials
+                // (and the Taylor coefficients returned to the caller)
+                // are consistent with the truncated jet.
+                auto *zero = vector_splat(builder, codegen<T>(s, number{0.}), batch_size);
+
+                llvm_loop_u32(s, builder.CreateAdd(ord, builder.getInt32(1)), builder.getInt32(order),
+                              [&](llvm::Value *o) {
+                                  for (std::uint32_t i = 0; i < n_uvars; ++i) {
+                                      taylor_c_store_diff(s, diff_arr, n_uvars, o, i, zero);
+                                  }
+                              });
+
+                for (std::uint32_t i = 0; i < (with_events ? n_uvars : n_eq); ++i) {
+                    taylor_c_store_diff(s, diff_arr, n_uvars, builder.getInt32(order), i, zero);
+                }
+            });
+        } else {
+            compute_last_diffs();
         }
 
         // Build the return value.
@@ -1444,14 +3485,30 @@ auto taylor_compute_jet(llvm_state &s, std::vector<llvm::Value *> order0, const
             }
         }
 
+        const auto c_fetch = [&](std::uint32_t u_idx, std::uint32_t o) -> llvm::Value * {
+            return taylor_c_load_diff(s, diff_arr, n_uvars, builder.getInt32(o), builder.getInt32(u_idx));
+        };
+        for (std::uint32_t o = 0; o <= order; ++o) {
+            for (const auto &ev : ev_dc) {
+                retval.push_back(ev_diff(ev, o, c_fetch));
+            }
+        }
+
         return retval;
     } else {
         // Init the derivatives array with the order 0 of the state variables.
         auto diff_arr(std::move(order0));
 
         // Compute the order-0 derivatives of the other u variables.
+        // NOTE: the u variables defined as parameters are
+        // initialised directly from the array of parameter values.
         for (auto i = n_eq; i < n_uvars; ++i) {
-            diff_arr.push_back(taylor_u_init<T>(s, dc[i], diff_arr, batch_size));
+            if (std::holds_alternative<param>(dc[i].value())) {
+                diff_arr.push_back(
+                    taylor_load_param(s, par_ptr, std::get<param>(dc[i].value()).idx(), batch_size));
+            } else {
+                diff_arr.push_back(taylor_u_init<T>(s, dc[i], diff_arr, batch_size));
+            }
         }
 
         // Compute the derivatives order by order, starting from 1 to order excluded.
@@ -1476,7 +3533,15 @@ auto taylor_compute_jet(llvm_state &s, std::vector<llvm::Value *> order0, const
             diff_arr.push_back(taylor_compute_sv_diff<T>(s, dc[i], diff_arr, n_uvars, order, batch_size));
         }
 
-        assert(diff_arr.size() == static_cast<decltype(diff_arr.size())>(n_uvars) * order + n_eq);
+        // Compute the last-order derivatives for the other
+        // u variables, if needed by the event functions.
+        if (with_events) {
+            for (auto i = n_eq; i < n_uvars; ++i) {
+                diff_arr.push_back(taylor_diff<T>(s, dc[i], diff_arr, n_uvars, order, i, batch_size));
+            }
+        }
+
+        assert(diff_arr.size() == n_tot_diffs);
 
         // Extract the derivatives of the state variables from diff_arr.
         for (std::uint32_t o = 0; o <= order; ++o) {
@@ -1485,19 +3550,34 @@ auto taylor_compute_jet(llvm_state &s, std::vector<llvm::Value *> order0, const
             }
         }
 
+        // Extract the derivatives of the event functions.
+        const auto fetch = [&](std::uint32_t u_idx, std::uint32_t o) -> llvm::Value * {
+            return taylor_fetch_diff(diff_arr, u_idx, o, n_uvars);
+        };
+        for (std::uint32_t o = 0; o <= order; ++o) {
+            for (const auto &ev : ev_dc) {
+                retval.push_back(ev_diff(ev, o, fetch));
+            }
+        }
+
         return retval;
     }
 }
 
 // Given an input pointer 'in', load the first n * batch_size values in it as n vectors
-// with size batch_size.
+// with size batch_size. In the aos layout, the values of the batch elements
+// are aos_stride elements apart from each other, and the values of the
+// n variables of a batch element are contiguous.
 template <typename T>
-auto taylor_load_values(llvm_state &s, llvm::Value *in, std::uint32_t n, std::uint32_t batch_size)
+auto taylor_load_values(llvm_state &s, llvm::Value *in, std::uint32_t n, std::uint32_t batch_size,
+                        taylor_layout layout = taylor_layout::soa, std::uint32_t aos_stride = 0)
 {
     assert(batch_size > 0u);
+    assert(layout == taylor_layout::soa || aos_stride >= n);
 
     // Overflow check.
-    if (n > std::numeric_limits<std::uint32_t>::max() / batch_size) {
+    if (n > std::numeric_limits<std::uint32_t>::max() / batch_size
+        || (layout == taylor_layout::aos && aos_stride > std::numeric_limits<std::uint32_t>::max() / batch_size)) {
         throw std::overflow_error("Overflow while loading Taylor values");
     }
 
@@ -1505,11 +3585,18 @@ auto taylor_load_values(llvm_state &s, llvm::Value *in, std::uint32_t n, std::ui
 
     std::vector<llvm::Value *> retval;
     for (std::uint32_t i = 0; i < n; ++i) {
-        // Fetch the pointer from in.
-        auto ptr = builder.CreateInBoundsGEP(in, {builder.getInt32(i * batch_size)});
+        if (layout == taylor_layout::aos) {
+            // Gather the batch elements of the i-th variable.
+            retval.push_back(
+                load_vector_from_memory(builder, builder.CreateInBoundsGEP(in, {builder.getInt32(i)}), batch_size,
+                                        aos_stride));
+        } else {
+            // Fetch the pointer from in.
+            auto ptr = builder.CreateInBoundsGEP(in, {builder.getInt32(i * batch_size)});
 
-        // Load the value in vector mode.
-        retval.push_back(load_vector_from_memory(builder, ptr, batch_size));
+            // Load the value in vector mode.
+            retval.push_back(load_vector_from_memory(builder, ptr, batch_size));
+        }
     }
 
     return retval;
@@ -1525,7 +3612,7 @@ auto taylor_load_values(llvm_state &s, llvm::Value *in, std::uint32_t n, std::ui
 // NOTE: document this eventually.
 template <typename T, typename U>
 auto taylor_add_jet_impl(llvm_state &s, const std::string &name, U sys, std::uint32_t order, std::uint32_t batch_size,
-                         bool high_accuracy, bool compact_mode)
+                         bool high_accuracy, bool compact_mode, taylor_layout layout)
 {
     if (s.is_compiled()) {
         throw std::invalid_argument("A function for the computation of the jet of Taylor derivatives cannot be added "
@@ -1540,6 +3627,10 @@ auto taylor_add_jet_impl(llvm_state &s, const std::string &name, U sys, std::uin
         throw std::invalid_argument("The batch size of a Taylor jet cannot be zero");
     }
 
+    if (layout != taylor_layout::soa && layout != taylor_layout::aos) {
+        throw std::invalid_argument("Invalid memory layout specified for a Taylor jet");
+    }
+
     // NOTE: in high accuracy mode we need
     // to disable fast math flags in the builder.
     std::optional<fm_disabler> fmd;
@@ -1550,6 +3641,19 @@ auto taylor_add_jet_impl(llvm_state &s, const std::string &name, U sys, std::uin
     // Record the number of equations/variables.
     const auto n_eq = boost::numeric_cast<std::uint32_t>(sys.size());
 
+    // NOTE: overflow checking. We need to be able to index into the jet array (size n_eq * (order + 1) * batch_size)
+    // using uint32_t.
+    if (order == std::numeric_limits<std::uint32_t>::max()
+        || (order + 1u) > std::numeric_limits<std::uint32_t>::max() / batch_size
+        || n_eq > std::numeric_limits<std::uint32_t>::max() / ((order + 1u) * batch_size)) {
+        throw std::overflow_error("An overflow condition was detected while adding a Taylor jet");
+    }
+
+    // NOTE: in the aos layout, the jet of a batch element
+    // is stored contiguously as [order][var_idx], hence
+    // the distance between consecutive batch elements.
+    const auto aos_stride = static_cast<std::uint32_t>(n_eq * (order + 1u));
+
     // Decompose the system of equations.
     auto dc = taylor_decompose(std::move(sys));
 
@@ -1557,8 +3661,9 @@ auto taylor_add_jet_impl(llvm_state &s, const std::string &name, U sys, std::uin
     assert(dc.size() > n_eq);
     const auto n_uvars = boost::numeric_cast<std::uint32_t>(dc.size() - n_eq);
 
-    // Prepare the function prototype. The only argument is a float pointer to in/out array.
-    std::vector<llvm::Type *> fargs{llvm::PointerType::getUnqual(to_llvm_type<T>(s.context()))};
+    // Prepare the function prototype. The arguments are a float pointer to the in/out array
+    // and a float pointer to the (read-only) array of parameter values.
+    std::vector<llvm::Type *> fargs(2, llvm::PointerType::getUnqual(to_llvm_type<T>(s.context())));
     // The function does not return anything.
     auto *ft = llvm::FunctionType::get(s.builder().getVoidTy(), fargs, false);
     assert(ft != nullptr);
@@ -1570,29 +3675,28 @@ auto taylor_add_jet_impl(llvm_state &s, const std::string &name, U sys, std::uin
             + "'");
     }
 
-    // Set the name of the function argument.
+    // Set the names/attributes of the function arguments.
     auto in_out = f->args().begin();
     in_out->setName("in_out");
 
+    auto par_ptr = in_out + 1;
+    par_ptr->setName("par_ptr");
+    par_ptr->addAttr(llvm::Attribute::NoCapture);
+    par_ptr->addAttr(llvm::Attribute::ReadOnly);
+
     // Create a new basic block to start insertion into.
     auto *bb = llvm::BasicBlock::Create(s.context(), "entry", f);
     assert(bb != nullptr);
     s.builder().SetInsertPoint(bb);
 
     // Load the order zero derivatives from the input pointer.
-    auto order0_arr = taylor_load_values<T>(s, in_out, n_eq, batch_size);
+    auto order0_arr = taylor_load_values<T>(s, in_out, n_eq, batch_size, layout, aos_stride);
 
     // Compute the jet of derivatives.
-    auto diff_arr = taylor_compute_jet<T>(s, std::move(order0_arr), dc, n_eq, n_uvars, order, batch_size, compact_mode);
+    auto diff_arr = taylor_compute_jet<T>(s, std::move(order0_arr), par_ptr, dc, {}, n_eq, n_uvars, order, batch_size,
+                                          compact_mode);
 
     // Write the derivatives to in_out.
-    // NOTE: overflow checking. We need to be able to index into the jet array (size n_eq * (order + 1) * batch_size)
-    // using uint32_t.
-    if (order == std::numeric_limits<std::uint32_t>::max()
-        || (order + 1u) > std::numeric_limits<std::uint32_t>::max() / batch_size
-        || n_eq > std::numeric_limits<std::uint32_t>::max() / ((order + 1u) * batch_size)) {
-        throw std::overflow_error("An overflow condition was detected while adding a Taylor jet");
-    }
     for (decltype(diff_arr.size()) cur_order = 1; cur_order <= order; ++cur_order) {
         for (std::uint32_t j = 0; j < n_eq; ++j) {
             // Index in the jet of derivatives.
@@ -1601,10 +3705,16 @@ auto taylor_add_jet_impl(llvm_state &s, const std::string &name, U sys, std::uin
             const auto val = diff_arr[arr_idx];
 
             // Index in the output array.
-            const auto out_idx = n_eq * batch_size * cur_order + j * batch_size;
+            const auto out_idx = layout == taylor_layout::aos ? n_eq * cur_order + j
+                                                              : n_eq * batch_size * cur_order + j * batch_size;
             auto out_ptr
                 = s.builder().CreateInBoundsGEP(in_out, {s.builder().getInt32(static_cast<std::uint32_t>(out_idx))});
-            store_vector_to_memory(s.builder(), out_ptr, val);
+            if (layout == taylor_layout::aos) {
+                // Scatter the batch elements.
+                store_vector_to_memory(s.builder(), out_ptr, val, aos_stride);
+            } else {
+                store_vector_to_memory(s.builder(), out_ptr, val);
+            }
         }
     }
 
@@ -1626,54 +3736,59 @@ auto taylor_add_jet_impl(llvm_state &s, const std::string &name, U sys, std::uin
 
 std::vector<expression> taylor_add_jet_dbl(llvm_state &s, const std::string &name, std::vector<expression> sys,
                                            std::uint32_t order, std::uint32_t batch_size, bool high_accuracy,
-                                           bool compact_mode)
+                                           bool compact_mode, taylor_layout layout)
 {
-    return detail::taylor_add_jet_impl<double>(s, name, std::move(sys), order, batch_size, high_accuracy, compact_mode);
+    return detail::taylor_add_jet_impl<double>(s, name, std::move(sys), order, batch_size, high_accuracy, compact_mode,
+                                               layout);
 }
 
 std::vector<expression> taylor_add_jet_ldbl(llvm_state &s, const std::string &name, std::vector<expression> sys,
                                             std::uint32_t order, std::uint32_t batch_size, bool high_accuracy,
-                                            bool compact_mode)
+                                            bool compact_mode, taylor_layout layout)
 {
     return detail::taylor_add_jet_impl<long double>(s, name, std::move(sys), order, batch_size, high_accuracy,
-                                                    compact_mode);
+                                                    compact_mode, layout);
 }
 
 #if defined(HEYOKA_HAVE_REAL128)
 
 std::vector<expression> taylor_add_jet_f128(llvm_state &s, const std::string &name, std::vector<expression> sys,
                                             std::uint32_t order, std::uint32_t batch_size, bool high_accuracy,
-                                            bool compact_mode)
+                                            bool compact_mode, taylor_layout layout)
 {
     return detail::taylor_add_jet_impl<mppp::real128>(s, name, std::move(sys), order, batch_size, high_accuracy,
-                                                      compact_mode);
+                                                      compact_mode, layout);
 }
 
 #endif
 
 std::vector<expression> taylor_add_jet_dbl(llvm_state &s, const std::string &name,
                                            std::vector<std::pair<expression, expression>> sys, std::uint32_t order,
-                                           std::uint32_t batch_size, bool high_accuracy, bool compact_mode)
+                                           std::uint32_t batch_size, bool high_accuracy, bool compact_mode,
+                                           taylor_layout layout)
 {
-    return detail::taylor_add_jet_impl<double>(s, name, std::move(sys), order, batch_size, high_accuracy, compact_mode);
+    return detail::taylor_add_jet_impl<double>(s, name, std::move(sys), order, batch_size, high_accuracy, compact_mode,
+                                               layout);
 }
 
 std::vector<expression> taylor_add_jet_ldbl(llvm_state &s, const std::string &name,
                                             std::vector<std::pair<expression, expression>> sys, std::uint32_t order,
-                                            std::uint32_t batch_size, bool high_accuracy, bool compact_mode)
+                                            std::uint32_t batch_size, bool high_accuracy, bool compact_mode,
+                                           taylor_layout layout)
 {
     return detail::taylor_add_jet_impl<long double>(s, name, std::move(sys), order, batch_size, high_accuracy,
-                                                    compact_mode);
+                                                    compact_mode, layout);
 }
 
 #if defined(HEYOKA_HAVE_REAL128)
 
 std::vector<expression> taylor_add_jet_f128(llvm_state &s, const std::string &name,
                                             std::vector<std::pair<expression, expression>> sys, std::uint32_t order,
-                                            std::uint32_t batch_size, bool high_accuracy, bool compact_mode)
+                                            std::uint32_t batch_size, bool high_accuracy, bool compact_mode,
+                                           taylor_layout layout)
 {
     return detail::taylor_add_jet_impl<mppp::real128>(s, name, std::move(sys), order, batch_size, high_accuracy,
-                                                      compact_mode);
+                                                      compact_mode, layout);
 }
 
 #endif
@@ -1804,6 +3919,34 @@ llvm::Value *taylor_step_min(llvm_state &s, llvm::Value *x_v, llvm::Value *y_v)
 #endif
 }
 
+// Helper to compute, in the Taylor stepper implementation, a mask
+// signalling which batch elements of the state vector vals
+// contain only finite values.
+llvm::Value *taylor_step_finite_mask(llvm_state &s, const std::vector<llvm::Value *> &vals)
+{
+    assert(!vals.empty());
+
+    auto &builder = s.builder();
+
+    // NOTE: the fast math flags must be disabled here, otherwise
+    // the comparisons below may be assumed to be always true.
+    fm_disabler fmd(s);
+
+    auto *vec_t = vals[0]->getType();
+    auto *inf_v = llvm::ConstantFP::getInfinity(vec_t);
+
+    llvm::Value *retval = nullptr;
+    for (auto *val : vals) {
+        // NOTE: |x| < inf is false if x is infinity or NaN.
+        auto *abs_v = llvm_invoke_intrinsic(s, "llvm.fabs", {vec_t}, {val});
+        auto *cur = builder.CreateFCmpOLT(abs_v, inf_v);
+
+        retval = retval == nullptr ? cur : builder.CreateAnd(retval, cur);
+    }
+
+    return retval;
+}
+
 // Helper to compute pow(x_v, y_v) in the Taylor stepper implementation.
 llvm::Value *taylor_step_pow(llvm_state &s, llvm::Value *x_v, llvm::Value *y_v)
 {
@@ -1955,13 +4098,45 @@ std::vector<llvm::Value *> taylor_run_ceval(llvm_state &s, const std::vector<std
 // NOTE: document this eventually.
 // NOTE: this is not an issue in the Taylor integrators, where we are certain that only 1 stepper
 // is ever added to the LLVM state.
-template <typename T, typename U>
-auto taylor_add_adaptive_step_impl(llvm_state &s, const std::string &name, U sys, T tol, std::uint32_t batch_size,
-                                   bool high_accuracy, bool compact_mode)
+// NOTE: this is the implementation of the stepper construction
+// for an already-decomposed system of n_eq equations.
+// NOTE: if tc_arg is true, the stepper will have a third argument,
+// a pointer to an array into which the Taylor coefficients of the
+// step will be written (if the pointer is not null). The Taylor
+// coefficients of the event functions in ev_dc (if any) will be written
+// after the Taylor coefficients of the state variables.
+// NOTE: if the state of a batch element is not finite, the stepper
+// leaves it untouched and writes NaN as the timestep.
+// NOTE: atol and rtol are the per-variable tolerances, as returned
+// by taylor_setup_var_tols(). If they are empty, the step size is determined
+// from the infinity norms of the state vector and of the derivatives. Otherwise,
+// each variable x_i is weighted by max(atol_i, rtol_i * |x_i|) / tol
+// (i.e., the weighted infinity norm is used), and the variables with
+// an infinite absolute tolerance are ignored. In both cases, the Taylor
+// order is determined by tol.
+// NOTE: if variable_order is true (which requires compact mode), the computation
+// of the jet stops at the lowest order k (with 2 <= k < order) such that the magnitudes of the
+// terms of orders k - 1 and k of the Taylor series, evaluated at twice the max timestep,
+// are within the tolerance for all batch elements. In such case, the step is taken with the max
+// timestep using the Taylor polynomials of order k, and the coefficients of higher order are set
+// to zero. This is useful when the timestep is limited by the caller (e.g., when approaching
+// the final time of a propagation), as the Taylor order determined by tol is optimal
+// (in terms of computational cost per unit of time) only for unconstrained steps.
+// NOTE: if tc_arg is true, the stepper returns the Taylor order used in the step.
+// NOTE: if lane_tols is not empty, it contains the tolerances of the batch elements, and tol
+// must be the minimum among them. The jet is computed at the order determined by tol, while
+// the timestep of each batch element is determined via the Taylor order corresponding to its
+// own tolerance, and the coefficients above such order are set to zero
+// before the evaluation of the Taylor polynomials.
+template <typename T>
+void taylor_add_adaptive_step_dc(llvm_state &s, const std::string &name, const std::vector<expression> &dc,
+                                 const std::vector<expression> &ev_dc, std::uint32_t n_eq, T tol,
+                                 std::uint32_t batch_size, bool high_accuracy, bool compact_mode, bool tc_arg,
+                                 const std::vector<T> &atol, const std::vector<T> &rtol, bool variable_order,
+                                 const std::vector<T> &lane_tols, taylor_layout layout,
+                                 std::chrono::steady_clock::time_point *ir_end)
 {
-    using std::ceil;
     using std::exp;
-    using std::log;
 
     if (s.is_compiled()) {
         throw std::invalid_argument("An adaptive Taylor stepper cannot be added to an llvm_state after compilation");
@@ -1977,22 +4152,39 @@ auto taylor_add_adaptive_step_impl(llvm_state &s, const std::string &name, U sys
             + " instead");
     }
 
-    // Determine the order from the tolerance.
-    auto order_f = ceil(-log(tol) / 2 + 1);
-    if (!detail::isfinite(order_f)) {
-        throw std::invalid_argument(
-            "The computation of the Taylor order in an adaptive Taylor stepper produced a non-finite value");
+    if (variable_order && !compact_mode) {
+        throw std::invalid_argument("A variable-order adaptive Taylor stepper requires compact mode");
     }
-    // NOTE: min order is 2.
-    order_f = std::max(T(2), order_f);
 
-    // NOTE: static cast is safe because we know that T is at least
-    // a double-precision IEEE type.
-    if (order_f > static_cast<T>(std::numeric_limits<std::uint32_t>::max())) {
-        throw std::overflow_error("The computation of the Taylor order in an adaptive Taylor stepper resulted "
-                                  "in an overflow condition");
+    if (layout != taylor_layout::soa && layout != taylor_layout::aos) {
+        throw std::invalid_argument("Invalid memory layout selected for an adaptive Taylor stepper: "
+                                    + std::to_string(static_cast<int>(layout)));
     }
-    const auto order = static_cast<std::uint32_t>(order_f);
+
+    // NOTE: the Taylor coefficients of the event functions
+    // can be retrieved only via the tc argument.
+    assert(tc_arg || ev_dc.empty());
+
+    assert(atol.size() == rtol.size());
+    assert(atol.empty() || atol.size() == n_eq);
+    const auto var_tols = !atol.empty();
+
+    // Determine the order from the tolerance.
+    const auto order = taylor_order_from_tol(tol);
+
+    // Determine the orders of the batch elements.
+    // NOTE: per-lane tolerances and per-variable
+    // tolerances are mutually exclusive.
+    assert(lane_tols.empty() || (lane_tols.size() == batch_size && !var_tols));
+    assert(lane_tols.empty() || *std::min_element(lane_tols.begin(), lane_tols.end()) == tol);
+    std::vector<std::uint32_t> lane_orders(batch_size, order);
+    for (decltype(lane_tols.size()) j = 0; j < lane_tols.size(); ++j) {
+        lane_orders[j] = taylor_order_from_tol(lane_tols[j]);
+    }
+    const auto min_lane_order = *std::min_element(lane_orders.begin(), lane_orders.end());
+
+    // Record the number of event functions.
+    const auto n_ev = boost::numeric_cast<std::uint32_t>(ev_dc.size());
 
     // NOTE: in high accuracy mode we need
     // to disable fast math flags in the builder.
@@ -2001,12 +4193,6 @@ auto taylor_add_adaptive_step_impl(llvm_state &s, const std::string &name, U sys
         fmd.emplace(s);
     }
 
-    // Record the number of equations/variables.
-    const auto n_eq = boost::numeric_cast<std::uint32_t>(sys.size());
-
-    // Decompose the system of equations.
-    auto dc = taylor_decompose(std::move(sys));
-
     // Compute the number of u variables.
     assert(dc.size() > n_eq);
     const auto n_uvars = boost::numeric_cast<std::uint32_t>(dc.size() - n_eq);
@@ -2015,11 +4201,15 @@ auto taylor_add_adaptive_step_impl(llvm_state &s, const std::string &name, U sys
 
     // Prepare the function prototype. The arguments are:
     // - pointer to the current state vector (read & write),
-    // - pointer to the array of max timesteps (read & write).
+    // - pointer to the parameter values (read only),
+    // - pointer to the array of max timesteps (read & write),
+    // - pointer to the output array of Taylor coefficients
+    //   (write only, may be null, present only if tc_arg is true).
     // These pointers cannot overlap.
-    std::vector<llvm::Type *> fargs(2, llvm::PointerType::getUnqual(to_llvm_type<T>(s.context())));
-    // The function does not return anything.
-    auto *ft = llvm::FunctionType::get(builder.getVoidTy(), fargs, false);
+    std::vector<llvm::Type *> fargs(tc_arg ? 4 : 3, llvm::PointerType::getUnqual(to_llvm_type<T>(s.context())));
+    // The function returns the Taylor order used in the step
+    // if tc_arg is true, otherwise it does not return anything.
+    auto *ft = llvm::FunctionType::get(tc_arg ? builder.getInt32Ty() : builder.getVoidTy(), fargs, false);
     assert(ft != nullptr);
     // Now create the function.
     auto *f = llvm::Function::Create(ft, llvm::Function::ExternalLinkage, name, &s.module());
@@ -2034,62 +4224,237 @@ auto taylor_add_adaptive_step_impl(llvm_state &s, const std::string &name, U sys
     state_ptr->addAttr(llvm::Attribute::NoCapture);
     state_ptr->addAttr(llvm::Attribute::NoAlias);
 
-    auto h_ptr = state_ptr + 1;
+    auto par_ptr = state_ptr + 1;
+    par_ptr->setName("par_ptr");
+    par_ptr->addAttr(llvm::Attribute::NoCapture);
+    par_ptr->addAttr(llvm::Attribute::NoAlias);
+    par_ptr->addAttr(llvm::Attribute::ReadOnly);
+
+    auto h_ptr = par_ptr + 1;
     h_ptr->setName("h_ptr");
     h_ptr->addAttr(llvm::Attribute::NoCapture);
     h_ptr->addAttr(llvm::Attribute::NoAlias);
 
+    if (tc_arg) {
+        auto tc_ptr = h_ptr + 1;
+        tc_ptr->setName("tc_ptr");
+        tc_ptr->addAttr(llvm::Attribute::NoCapture);
+        tc_ptr->addAttr(llvm::Attribute::NoAlias);
+        tc_ptr->addAttr(llvm::Attribute::WriteOnly);
+    }
+
     // Create a new basic block to start insertion into.
     auto *bb = llvm::BasicBlock::Create(s.context(), "entry", f);
     assert(bb != nullptr);
     builder.SetInsertPoint(bb);
 
     // Load the order zero derivatives from the input pointer.
-    auto order0_arr = taylor_load_values<T>(s, state_ptr, n_eq, batch_size);
+    // NOTE: in the aos layout, the state vector is laid out
+    // as [batch_idx][var_idx] and it is gathered/scattered in place.
+    auto order0_arr = taylor_load_values<T>(s, state_ptr, n_eq, batch_size, layout, n_eq);
+
+    // Compute the norm infinity of the state vector
+    // or, with per-variable tolerances, the error weights
+    // of the variables subject to the step-size control.
+    llvm::Value *max_abs_state = nullptr;
+    std::vector<std::pair<std::uint32_t, llvm::Value *>> err_ws;
+    if (var_tols) {
+        for (std::uint32_t i = 0; i < n_eq; ++i) {
+            if (!isfinite(atol[i])) {
+                // Excluded variable.
+                continue;
+            }
 
-    // Compute the norm infinity of the state vector.
-    auto max_abs_state = vector_splat(builder, codegen<T>(s, number{0.}), batch_size);
-    for (std::uint32_t i = 0; i < n_eq; ++i) {
-        max_abs_state = taylor_step_maxabs(s, max_abs_state, order0_arr[i]);
+            // NOTE: the tolerances are normalised by tol,
+            // which is accounted for by the Taylor order.
+            auto *err_w = vector_splat(builder, codegen<T>(s, number{atol[i] / tol}), batch_size);
+            if (rtol[i] != 0) {
+                auto *rtol_v = vector_splat(builder, codegen<T>(s, number{rtol[i] / tol}), batch_size);
+                err_w = taylor_step_maxabs(s, err_w, builder.CreateFMul(rtol_v, order0_arr[i]));
+            }
+
+            err_ws.emplace_back(i, err_w);
+        }
+
+        assert(!err_ws.empty());
+    } else {
+        max_abs_state = vector_splat(builder, codegen<T>(s, number{0.}), batch_size);
+        for (std::uint32_t i = 0; i < n_eq; ++i) {
+            max_abs_state = taylor_step_maxabs(s, max_abs_state, order0_arr[i]);
+        }
+    }
+
+    // Determine which batch elements have a finite state. This check
+    // is done here, rather than by the caller, so that the state
+    // vector is read only once per step.
+    auto *finite_mask = taylor_step_finite_mask(s, order0_arr);
+
+    // Load the max timesteps.
+    auto max_h_vec = load_vector_from_memory(builder, h_ptr, batch_size);
+
+    // Helper to create a vector whose elements are the
+    // values of f(lane_order) for each batch element.
+    auto lane_vector = [&](const auto &f) {
+        std::vector<llvm::Value *> vals;
+        for (std::uint32_t j = 0; j < batch_size; ++j) {
+            vals.push_back(codegen<T>(s, number{f(j)}));
+        }
+
+        return scalars_to_vector(builder, vals);
+    };
+
+    // Helper to create a mask selecting the batch elements for which f(lane_order) is true.
+    auto lane_mask = [&](const auto &f) {
+        std::vector<llvm::Value *> vals;
+        for (auto o : lane_orders) {
+            vals.push_back(builder.getInt1(f(o)));
+        }
+
+        return scalars_to_vector(builder, vals);
+    };
+
+    auto tol_v = lane_vector([&](std::uint32_t j) { return lane_tols.empty() ? tol : lane_tols[j]; });
+
+    // In variable-order mode, set up the check for the truncation of the jet.
+    std::function<llvm::Value *(llvm::Value *, llvm::Value *)> vo_check;
+    llvm::Value *vo_order = nullptr;
+    if (variable_order) {
+        auto *vec_t = max_h_vec->getType();
+        auto *two_h = builder.CreateFMul(vector_splat(builder, codegen<T>(s, number{2.}), batch_size),
+                                         llvm_invoke_intrinsic(s, "llvm.fabs", {vec_t}, {max_h_vec}));
+
+        // The tolerance threshold for the magnitudes of the terms of the Taylor series.
+        // NOTE: in the absence of per-variable tolerances, this is
+        // tol * max(1, norm infinity of the state vector),
+        // consistently with the absolute/relative tolerance modes.
+        llvm::Value *thr = nullptr;
+        if (!var_tols) {
+            auto *one = vector_splat(builder, codegen<T>(s, number{1.}), batch_size);
+            thr = builder.CreateFMul(tol_v, taylor_step_maxabs(s, one, max_abs_state));
+        }
+
+        // Storage for (2 * max_h)**cur_order and for the
+        // result of the check at the previous order.
+        auto *pw_ptr = builder.CreateAlloca(vec_t);
+        builder.CreateStore(vector_splat(builder, codegen<T>(s, number{1.}), batch_size), pw_ptr);
+        auto *prev_ok_ptr = builder.CreateAlloca(builder.getInt1Ty());
+        builder.CreateStore(builder.getFalse(), prev_ok_ptr);
+
+        vo_check = [&, vec_t, two_h, thr, pw_ptr, prev_ok_ptr](llvm::Value *cur_order, llvm::Value *c_diff_arr) {
+            auto *pw = builder.CreateFMul(builder.CreateLoad(pw_ptr), two_h);
+            builder.CreateStore(pw, pw_ptr);
+
+            // Check the terms of order cur_order.
+            llvm::Value *ok = nullptr;
+            if (var_tols) {
+                for (const auto &[i, err_w] : err_ws) {
+                    auto *d = taylor_c_load_diff(s, c_diff_arr, n_uvars, cur_order, builder.getInt32(i));
+                    auto *cur = builder.CreateFCmpOLE(
+                        builder.CreateFMul(llvm_invoke_intrinsic(s, "llvm.fabs", {vec_t}, {d}), pw),
+                        builder.CreateFMul(tol_v, err_w));
+
+                    ok = ok == nullptr ? cur : builder.CreateAnd(ok, cur);
+                }
+            } else {
+                auto *max_abs_d = vector_splat(builder, codegen<T>(s, number{0.}), batch_size);
+                for (std::uint32_t i = 0; i < n_eq; ++i) {
+                    max_abs_d = taylor_step_maxabs(
+                        s, max_abs_d, taylor_c_load_diff(s, c_diff_arr, n_uvars, cur_order, builder.getInt32(i)));
+                }
+
+                ok = builder.CreateFCmpOLE(builder.CreateFMul(max_abs_d, pw), thr);
+            }
+
+            // Reduce over the batch elements.
+            auto ok_scalars = vector_to_scalars(builder, ok);
+            auto *all_ok = ok_scalars[0];
+            for (decltype(ok_scalars.size()) j = 1; j < ok_scalars.size(); ++j) {
+                all_ok = builder.CreateAnd(all_ok, ok_scalars[j]);
+            }
+
+            // The jet can be truncated at cur_order if the checks
+            // at both cur_order and cur_order - 1 succeeded.
+            auto *retval = builder.CreateAnd(builder.CreateLoad(prev_ok_ptr), all_ok);
+            builder.CreateStore(all_ok, prev_ok_ptr);
+
+            return retval;
+        };
     }
 
     // Compute the jet of derivatives at the given order.
-    auto diff_arr = taylor_compute_jet<T>(s, std::move(order0_arr), dc, n_eq, n_uvars, order, batch_size, compact_mode);
+    auto diff_arr = taylor_compute_jet<T>(s, std::move(order0_arr), par_ptr, dc, ev_dc, n_eq, n_uvars, order,
+                                          batch_size, compact_mode, vo_check, &vo_order);
     using da_size_t = decltype(diff_arr.size());
 
-    // Determine the norm infinity of the derivatives
-    // at orders order and order - 1.
-    auto max_abs_diff_o = vector_splat(builder, codegen<T>(s, number{0.}), batch_size);
-    auto max_abs_diff_om1 = vector_splat(builder, codegen<T>(s, number{0.}), batch_size);
-    for (std::uint32_t i = 0; i < n_eq; ++i) {
-        max_abs_diff_o = taylor_step_maxabs(s, max_abs_diff_o, diff_arr[static_cast<da_size_t>(order) * n_eq + i]);
-        max_abs_diff_om1
-            = taylor_step_maxabs(s, max_abs_diff_om1, diff_arr[static_cast<da_size_t>(order - 1u) * n_eq + i]);
-    }
+    // Helper to fetch the derivatives of the state variable i at the
+    // order lane_order - k for each batch element.
+    std::vector<std::uint32_t> distinct_orders(lane_orders);
+    std::sort(distinct_orders.begin(), distinct_orders.end());
+    distinct_orders.erase(std::unique(distinct_orders.begin(), distinct_orders.end()), distinct_orders.end());
+    auto lane_diff = [&](std::uint32_t k, std::uint32_t i) {
+        auto *retval = diff_arr[static_cast<da_size_t>(distinct_orders.back() - k) * n_eq + i];
+        for (auto it = distinct_orders.rbegin() + 1; it != distinct_orders.rend(); ++it) {
+            const auto o = *it;
+            retval = builder.CreateSelect(lane_mask([o](std::uint32_t lo) { return lo == o; }),
+                                          diff_arr[static_cast<da_size_t>(o - k) * n_eq + i], retval);
+        }
+
+        return retval;
+    };
+
+    llvm::Value *ratio_o = nullptr, *ratio_om1 = nullptr;
+    if (var_tols) {
+        // Determine the minimum of the ratios between the error weights and
+        // the absolute values of the derivatives at orders order and order - 1.
+        // This is the inverse of the weighted infinity norm of the derivatives.
+        for (const auto &[i, err_w] : err_ws) {
+            auto *cur_o = builder.CreateFDiv(err_w, lane_diff(0, i));
+            auto *cur_om1 = builder.CreateFDiv(err_w, lane_diff(1, i));
+
+            if (ratio_o == nullptr) {
+                ratio_o = llvm_invoke_intrinsic(s, "llvm.fabs", {cur_o->getType()}, {cur_o});
+                ratio_om1 = llvm_invoke_intrinsic(s, "llvm.fabs", {cur_om1->getType()}, {cur_om1});
+            } else {
+                ratio_o = taylor_step_minabs(s, ratio_o, cur_o);
+                ratio_om1 = taylor_step_minabs(s, ratio_om1, cur_om1);
+            }
+        }
+    } else {
+        // Determine the norm infinity of the derivatives
+        // at orders order and order - 1.
+        auto max_abs_diff_o = vector_splat(builder, codegen<T>(s, number{0.}), batch_size);
+        auto max_abs_diff_om1 = vector_splat(builder, codegen<T>(s, number{0.}), batch_size);
+        for (std::uint32_t i = 0; i < n_eq; ++i) {
+            max_abs_diff_o = taylor_step_maxabs(s, max_abs_diff_o, lane_diff(0, i));
+            max_abs_diff_om1 = taylor_step_maxabs(s, max_abs_diff_om1, lane_diff(1, i));
+        }
+
+        // Determine if we are in absolute or relative tolerance mode.
+        auto abs_or_rel = builder.CreateFCmpOLE(builder.CreateFMul(tol_v, max_abs_state), tol_v);
 
-    // Determine if we are in absolute or relative tolerance mode.
-    auto tol_v = vector_splat(builder, codegen<T>(s, number{tol}), batch_size);
-    auto abs_or_rel = builder.CreateFCmpOLE(builder.CreateFMul(tol_v, max_abs_state), tol_v);
+        auto num_rho = builder.CreateSelect(abs_or_rel, vector_splat(builder, codegen<T>(s, number{1.}), batch_size),
+                                            max_abs_state);
+        ratio_o = builder.CreateFDiv(num_rho, max_abs_diff_o);
+        ratio_om1 = builder.CreateFDiv(num_rho, max_abs_diff_om1);
+    }
 
     // Estimate rho at orders order - 1 and order.
-    auto num_rho
-        = builder.CreateSelect(abs_or_rel, vector_splat(builder, codegen<T>(s, number{1.}), batch_size), max_abs_state);
-    auto rho_o = taylor_step_pow(s, builder.CreateFDiv(num_rho, max_abs_diff_o),
-                                 vector_splat(builder, codegen<T>(s, number{T(1) / order}), batch_size));
-    auto rho_om1 = taylor_step_pow(s, builder.CreateFDiv(num_rho, max_abs_diff_om1),
-                                   vector_splat(builder, codegen<T>(s, number{T(1) / (order - 1u)}), batch_size));
+    auto rho_o = taylor_step_pow(s, ratio_o, lane_vector([&](std::uint32_t j) { return T(1) / lane_orders[j]; }));
+    auto rho_om1
+        = taylor_step_pow(s, ratio_om1, lane_vector([&](std::uint32_t j) { return T(1) / (lane_orders[j] - 1u); }));
 
     // Take the minimum.
     auto rho_m = taylor_step_min(s, rho_o, rho_om1);
 
     // Copmute the safety factor.
-    const auto rhofac = 1 / (exp(T(1)) * exp(T(1))) * exp((T(-7) / T(10)) / (order - 1u));
+    auto *rhofac_v = lane_vector([&](std::uint32_t j) {
+        return 1 / (exp(T(1)) * exp(T(1))) * exp((T(-7) / T(10)) / (lane_orders[j] - 1u));
+    });
 
     // Determine the step size.
-    auto h = builder.CreateFMul(rho_m, vector_splat(builder, codegen<T>(s, number{rhofac}), batch_size));
+    auto h = builder.CreateFMul(rho_m, rhofac_v);
 
     // Ensure that the step size does not exceed the limit.
-    auto max_h_vec = load_vector_from_memory(builder, h_ptr, batch_size);
     h = taylor_step_minabs(s, h, max_h_vec);
 
     // Handle backwards propagation.
@@ -2098,6 +4463,13 @@ auto taylor_add_adaptive_step_impl(llvm_state &s, const std::string &name, U sys
                                       vector_splat(builder, codegen<T>(s, number{1.}), batch_size));
     h = builder.CreateFMul(h_fac, h);
 
+    // If the jet was truncated, the max timestep is used.
+    // NOTE: in such case, the rho estimates above are computed
+    // from zero derivatives and thus they must be ignored.
+    if (variable_order) {
+        h = builder.CreateSelect(builder.CreateICmpNE(vo_order, builder.getInt32(order)), max_h_vec, h);
+    }
+
     // Build the Taylor polynomials that need to be evaluated for the propagation.
     std::vector<std::vector<llvm::Value *>> cf_vecs;
     for (std::uint32_t var_idx = 0; var_idx < n_eq; ++var_idx) {
@@ -2106,6 +4478,14 @@ auto taylor_add_adaptive_step_impl(llvm_state &s, const std::string &name, U sys
 
         for (std::uint32_t o = 0; o <= order; ++o) {
             cf_vec.push_back(diff_arr[static_cast<da_size_t>(o) * n_eq + var_idx]);
+
+            // Truncate the Taylor series of the batch
+            // elements whose order is less than o.
+            if (o > min_lane_order) {
+                cf_vec.back() = builder.CreateSelect(lane_mask([o](std::uint32_t lo) { return o <= lo; }),
+                                                     cf_vec.back(),
+                                                     vector_splat(builder, codegen<T>(s, number{0.}), batch_size));
+            }
         }
     }
 
@@ -2113,20 +4493,87 @@ auto taylor_add_adaptive_step_impl(llvm_state &s, const std::string &name, U sys
     auto new_states
         = high_accuracy ? taylor_run_ceval<T>(s, cf_vecs, h, batch_size) : taylor_run_multihorner(s, cf_vecs, h);
 
+    // The batch elements with a non-finite state are left untouched,
+    // and their timesteps are set to NaN in order to signal
+    // the error condition to the caller.
+    {
+        // NOTE: disable the fast math flags, as the values
+        // being selected may be non-finite.
+        fm_disabler fmd_nf(s);
+
+        for (std::uint32_t var_idx = 0; var_idx < n_eq; ++var_idx) {
+            new_states[var_idx] = builder.CreateSelect(finite_mask, new_states[var_idx], diff_arr[var_idx]);
+        }
+
+        h = builder.CreateSelect(finite_mask, h, llvm::ConstantFP::getNaN(h->getType()));
+    }
+
     // Store the new state.
     for (std::uint32_t var_idx = 0; var_idx < n_eq; ++var_idx) {
         if (var_idx > std::numeric_limits<std::uint32_t>::max() / batch_size) {
             throw std::overflow_error("Overflow error in an adaptive Taylor stepper: too many variables");
         }
-        store_vector_to_memory(builder, builder.CreateInBoundsGEP(state_ptr, builder.getInt32(var_idx * batch_size)),
-                               new_states[var_idx]);
+        if (layout == taylor_layout::aos) {
+            store_vector_to_memory(builder, builder.CreateInBoundsGEP(state_ptr, builder.getInt32(var_idx)),
+                                   new_states[var_idx], n_eq);
+        } else {
+            store_vector_to_memory(builder,
+                                   builder.CreateInBoundsGEP(state_ptr, builder.getInt32(var_idx * batch_size)),
+                                   new_states[var_idx]);
+        }
     }
 
     // Store the timesteps that were used.
     store_vector_to_memory(builder, h_ptr, h);
 
+    // Write the Taylor coefficients, if requested.
+    if (tc_arg) {
+        // NOTE: the layout of the output array is
+        // [var_idx][order][batch_idx], where the event
+        // functions are indexed after the state variables.
+        if (order == std::numeric_limits<std::uint32_t>::max()
+            || (order + 1u) > std::numeric_limits<std::uint32_t>::max() / batch_size
+            || n_ev > std::numeric_limits<std::uint32_t>::max() - n_eq
+            || n_eq + n_ev > std::numeric_limits<std::uint32_t>::max() / ((order + 1u) * batch_size)) {
+            throw std::overflow_error("An overflow condition was detected while adding an adaptive Taylor stepper");
+        }
+
+        auto tc_ptr = h_ptr + 1;
+        auto *null_ptr = llvm::ConstantPointerNull::get(llvm::cast<llvm::PointerType>(tc_ptr->getType()));
+
+        llvm_if_then_else(
+            s, builder.CreateICmpNE(tc_ptr, null_ptr),
+            [&]() {
+                for (std::uint32_t var_idx = 0; var_idx < n_eq; ++var_idx) {
+                    for (std::uint32_t o = 0; o <= order; ++o) {
+                        store_vector_to_memory(
+                            builder,
+                            builder.CreateInBoundsGEP(tc_ptr,
+                                                      builder.getInt32((var_idx * (order + 1u) + o) * batch_size)),
+                            cf_vecs[var_idx][o]);
+                    }
+                }
+
+                for (std::uint32_t ev_idx = 0; ev_idx < n_ev; ++ev_idx) {
+                    for (std::uint32_t o = 0; o <= order; ++o) {
+                        store_vector_to_memory(
+                            builder,
+                            builder.CreateInBoundsGEP(
+                                tc_ptr, builder.getInt32(((n_eq + ev_idx) * (order + 1u) + o) * batch_size)),
+                            diff_arr[static_cast<da_size_t>(order + 1u) * n_eq + static_cast<da_size_t>(o) * n_ev
+                                     + ev_idx]);
+                    }
+                }
+            },
+            []() {});
+    }
+
     // Create the return value.
-    builder.CreateRetVoid();
+    if (tc_arg) {
+        builder.CreateRet(variable_order ? vo_order : builder.getInt32(order));
+    } else {
+        builder.CreateRetVoid();
+    }
 
     // Verify the function.
     s.verify_function(name);
@@ -2154,8 +4601,138 @@ auto taylor_add_adaptive_step_impl(llvm_state &s, const std::string &name, U sys
         lsf.emplace(s);
     }
 
+    // Record the end of the IR emission, if requested.
+    if (ir_end != nullptr) {
+        *ir_end = std::chrono::steady_clock::now();
+    }
+
     // Run the optimisation pass.
     s.optimise();
+}
+
+// Add to s a function for the dense output of an adaptive stepper with
+// n_eq equations. The function will evaluate the Taylor polynomials
+// of a step (computed by the stepper) at arbitrary timesteps. The arguments are:
+// - pointer to the output array (write only, laid out according to layout),
+// - pointer to the array of Taylor coefficients, laid out as
+//   [var_idx][order][batch_idx] (read only),
+// - pointer to the array of timesteps (read only).
+// These pointers cannot overlap.
+// NOTE: the optimisation pass is not run here, the function is meant to
+// be added to the state before the stepper (which runs the optimisation).
+template <typename T>
+void taylor_add_d_out_function(llvm_state &s, std::uint32_t n_eq, std::uint32_t order, std::uint32_t batch_size,
+                               bool high_accuracy, bool compact_mode, taylor_layout layout)
+{
+    assert(n_eq > 0u);
+    assert(order > 0u);
+    assert(batch_size > 0u);
+
+    // Overflow checking: we need to be able to index into the
+    // array of coefficients using uint32_t.
+    if (order == std::numeric_limits<std::uint32_t>::max()
+        || (order + 1u) > std::numeric_limits<std::uint32_t>::max() / batch_size
+        || n_eq > std::numeric_limits<std::uint32_t>::max() / ((order + 1u) * batch_size)) {
+        throw std::overflow_error("An overflow condition was detected while adding a dense output function");
+    }
+
+    // NOTE: in high accuracy mode we need
+    // to disable fast math flags in the builder.
+    std::optional<fm_disabler> fmd;
+    if (high_accuracy) {
+        fmd.emplace(s);
+    }
+
+    auto &builder = s.builder();
+
+    // Prepare the function prototype.
+    std::vector<llvm::Type *> fargs(3, llvm::PointerType::getUnqual(to_llvm_type<T>(s.context())));
+    auto *ft = llvm::FunctionType::get(builder.getVoidTy(), fargs, false);
+    assert(ft != nullptr);
+    auto *f = llvm::Function::Create(ft, llvm::Function::ExternalLinkage, "d_out", &s.module());
+    if (f == nullptr) {
+        throw std::invalid_argument("Unable to create a dense output function");
+    }
+
+    // Set the names/attributes of the function arguments.
+    auto out_ptr = f->args().begin();
+    out_ptr->setName("out_ptr");
+    out_ptr->addAttr(llvm::Attribute::NoCapture);
+    out_ptr->addAttr(llvm::Attribute::NoAlias);
+    out_ptr->addAttr(llvm::Attribute::WriteOnly);
+
+    auto tc_ptr = out_ptr + 1;
+    tc_ptr->setName("tc_ptr");
+    tc_ptr->addAttr(llvm::Attribute::NoCapture);
+    tc_ptr->addAttr(llvm::Attribute::NoAlias);
+    tc_ptr->addAttr(llvm::Attribute::ReadOnly);
+
+    auto h_ptr = out_ptr + 2;
+    h_ptr->setName("h_ptr");
+    h_ptr->addAttr(llvm::Attribute::NoCapture);
+    h_ptr->addAttr(llvm::Attribute::NoAlias);
+    h_ptr->addAttr(llvm::Attribute::ReadOnly);
+
+    // Create a new basic block to start insertion into.
+    auto *bb = llvm::BasicBlock::Create(s.context(), "entry", f);
+    assert(bb != nullptr);
+    builder.SetInsertPoint(bb);
+
+    // Load the timesteps.
+    auto h = load_vector_from_memory(builder, h_ptr, batch_size);
+
+    // Evaluate the Taylor polynomial of the variable at index var_idx,
+    // and write the result into the output array.
+    auto eval_var = [&](llvm::Value *var_idx) {
+        std::vector<llvm::Value *> cf_vec;
+        for (std::uint32_t o = 0; o <= order; ++o) {
+            auto cf_idx = builder.CreateMul(builder.CreateAdd(builder.CreateMul(var_idx, builder.getInt32(order + 1u)),
+                                                              builder.getInt32(o)),
+                                            builder.getInt32(batch_size));
+            cf_vec.push_back(load_vector_from_memory(builder, builder.CreateInBoundsGEP(tc_ptr, {cf_idx}), batch_size));
+        }
+
+        auto res = high_accuracy ? taylor_run_ceval<T>(s, {cf_vec}, h, batch_size)[0]
+                                 : taylor_run_multihorner(s, {cf_vec}, h)[0];
+
+        if (layout == taylor_layout::aos) {
+            store_vector_to_memory(builder, builder.CreateInBoundsGEP(out_ptr, {var_idx}), res, n_eq);
+        } else {
+            store_vector_to_memory(
+                builder, builder.CreateInBoundsGEP(out_ptr, {builder.CreateMul(var_idx, builder.getInt32(batch_size))}),
+                res);
+        }
+    };
+
+    if (compact_mode) {
+        // NOTE: in compact mode, loop over the variables
+        // in order to keep the size of the function small.
+        llvm_loop_u32(s, builder.getInt32(0), builder.getInt32(n_eq), eval_var);
+    } else {
+        for (std::uint32_t var_idx = 0; var_idx < n_eq; ++var_idx) {
+            eval_var(builder.getInt32(var_idx));
+        }
+    }
+
+    // Create the return value.
+    builder.CreateRetVoid();
+
+    // Verify the function.
+    s.verify_function("d_out");
+}
+
+template <typename T, typename U>
+auto taylor_add_adaptive_step_impl(llvm_state &s, const std::string &name, U sys, T tol, std::uint32_t batch_size,
+                                   bool high_accuracy, bool compact_mode)
+{
+    // Record the number of equations/variables.
+    const auto n_eq = boost::numeric_cast<std::uint32_t>(sys.size());
+
+    // Decompose the system of equations.
+    auto dc = taylor_decompose(std::move(sys));
+
+    // Add the stepper.
+    taylor_add_adaptive_step_dc<T>(s, name, dc, {}, n_eq, tol, batch_size, high_accuracy, compact_mode, false);
 
     return dc;
 }
@@ -2222,4 +4799,18 @@ std::vector<expression> taylor_add_adaptive_step_f128(llvm_state &s, const std::
 
 #endif
 
+std::ostream &operator<<(std::ostream &os, const taylor_compile_report &r)
+{
+    std::ostringstream oss;
+    oss << std::boolalpha;
+
+    oss << "Decomposition time : " << r.decomposition_time << "s\n";
+    oss << "IR emission time   : " << r.ir_time << "s\n";
+    oss << "N of u variables   : " << r.n_uvars << '\n';
+    oss << "Cached             : " << r.cached << '\n';
+    oss << r.llvm;
+
+    return os << oss.str();
+}
+
 } // namespace heyoka
@@ -0,0 +1,241 @@
+// Copyright 2020 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <heyoka/config.hpp>
+
+#include <cstddef>
+#include <limits>
+#include <stdexcept>
+#include <tuple>
+#include <vector>
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+#include <mp++/real128.hpp>
+
+#endif
+
+#include <heyoka/ensemble_propagate.hpp>
+#include <heyoka/expression.hpp>
+#include <heyoka/math_functions.hpp>
+#include <heyoka/number.hpp>
+#include <heyoka/param.hpp>
+#include <heyoka/taylor.hpp>
+
+#include "catch.hpp"
+#include "test_utils.hpp"
+
+using namespace heyoka;
+using namespace heyoka_test;
+
+const auto fp_types = std::tuple<double, long double
+#if defined(HEYOKA_HAVE_REAL128)
+                                 ,
+                                 mppp::real128
+#endif
+                                 >{};
+
+TEST_CASE("ensemble propagate")
+{
+    auto tester = [](auto fp_x) {
+        using fp_t = decltype(fp_x);
+
+        auto [x, v] = make_vars("x", "v");
+
+        const std::vector sys{prime(x) = v, prime(v) = -par[0] * sin(x)};
+
+        // The initial conditions of the instances.
+        const std::size_t n_iter = 11;
+        std::vector<fp_t> states, pars;
+        for (std::size_t i = 0; i < n_iter; ++i) {
+            states.push_back(fp_t(0.05) + fp_t(i) / 100);
+            states.push_back(fp_t(0.025));
+            pars.push_back(fp_t(9) + fp_t(i) / 10);
+        }
+
+        // Check the results against the propagation of the instances one by one.
+        auto check_res = [&](const ensemble_res_t<fp_t> &res, bool cm) {
+            const auto &[f_states, stats] = res;
+
+            REQUIRE(f_states.size() == n_iter * 2u);
+            REQUIRE(stats.size() == n_iter);
+
+            for (std::size_t i = 0; i < n_iter; ++i) {
+                taylor_adaptive<fp_t> ta{sys,
+                                         {states[2u * i], states[2u * i + 1u]},
+                                         kw::compact_mode = cm,
+                                         kw::pars = std::vector<fp_t>{pars[i]}};
+                ta.propagate_until(fp_t(3));
+
+                REQUIRE(std::get<0>(stats[i]) == taylor_outcome::time_limit);
+                REQUIRE(std::get<3>(stats[i]) > 0u);
+                REQUIRE(f_states[2u * i] == approximately(ta.get_state()[0], fp_t(1000)));
+                REQUIRE(f_states[2u * i + 1u] == approximately(ta.get_state()[1], fp_t(1000)));
+            }
+        };
+
+        for (auto cm : {false, true}) {
+            taylor_adaptive<fp_t> ta{sys, {fp_t(0), fp_t(0)}, kw::compact_mode = cm};
+            taylor_adaptive_batch<fp_t> tab{
+                sys, {fp_t(0), fp_t(0), fp_t(0), fp_t(0), fp_t(0), fp_t(0)}, 3, kw::compact_mode = cm};
+
+            // Arrays of initial conditions.
+            for (auto n_threads : {0u, 1u, 3u}) {
+                check_res(ensemble_propagate_until(ta, fp_t(3), states, pars, n_threads), cm);
+                check_res(ensemble_propagate_until(tab, fp_t(3), states, pars, n_threads), cm);
+            }
+
+            // Generator.
+            auto gen = [&states, &pars](std::size_t i, fp_t *s, fp_t *p) {
+                s[0] = states[2u * i];
+                s[1] = states[2u * i + 1u];
+                p[0] = pars[i];
+            };
+            check_res(ensemble_propagate_until(ta, fp_t(3), n_iter, gen), cm);
+            check_res(ensemble_propagate_until(tab, fp_t(3), n_iter, gen), cm);
+
+            // Empty ensemble.
+            REQUIRE(std::get<1>(ensemble_propagate_until(tab, fp_t(3), 0, gen)).empty());
+
+            // The instances start from the double-length time of ta.
+            {
+                auto ta_d = ta;
+                ta_d.set_dtime(fp_t(1), std::numeric_limits<fp_t>::epsilon() / 4);
+
+                const auto res = ensemble_propagate_until(ta_d, fp_t(3), states, pars, 1u);
+
+                auto ta_ref = ta_d;
+                ta_ref.set_state({states[0], states[1]});
+                ta_ref.get_pars_data()[0] = pars[0];
+                ta_ref.propagate_until(fp_t(3));
+
+                REQUIRE(std::get<0>(res)[0] == ta_ref.get_state()[0]);
+                REQUIRE(std::get<0>(res)[1] == ta_ref.get_state()[1]);
+            }
+
+            // Error checking.
+            REQUIRE_THROWS_AS(ensemble_propagate_until(ta, fp_t(3), std::vector<fp_t>{fp_t(1)}, pars),
+                              std::invalid_argument);
+            REQUIRE_THROWS_AS(ensemble_propagate_until(tab, fp_t(3), states, std::vector<fp_t>{fp_t(1)}),
+                              std::invalid_argument);
+            REQUIRE_THROWS_AS(ensemble_propagate_until(ta, std::numeric_limits<fp_t>::infinity(), states, pars),
+                              std::invalid_argument);
+            REQUIRE_THROWS_AS(ensemble_propagate_until(ta, fp_t(3), n_iter, ensemble_generator_t<fp_t>{}),
+                              std::invalid_argument);
+
+            // Exceptions thrown by the generator are propagated.
+            REQUIRE_THROWS_AS(ensemble_propagate_until(tab, fp_t(3), n_iter,
+                                                       [](std::size_t i, fp_t *, fp_t *) {
+                                                           if (i == 5u) {
+                                                               throw std::runtime_error("");
+                                                           }
+                                                       }),
+                              std::runtime_error);
+
+            tab.set_times({fp_t(0), fp_t(1), fp_t(0)});
+            REQUIRE_THROWS_AS(ensemble_propagate_until(tab, fp_t(3), states, pars), std::invalid_argument);
+
+            // The batch elements must be at the same double-length time.
+            tab.set_times({fp_t(1), fp_t(1), fp_t(1)});
+            tab.set_lane_dtime(1, fp_t(1), std::numeric_limits<fp_t>::epsilon() / 4);
+            REQUIRE_THROWS_AS(ensemble_propagate_until(tab, fp_t(3), states, pars), std::invalid_argument);
+
+            // The instances start from the double-length time of tab.
+            for (auto j = 0u; j < 3u; ++j) {
+                tab.set_lane_dtime(j, fp_t(1), std::numeric_limits<fp_t>::epsilon() / 4);
+            }
+            const auto res = ensemble_propagate_until(tab, fp_t(3), states, pars, 1u);
+
+            taylor_adaptive<fp_t> ta_ref{
+                sys, {states[0], states[1]}, kw::compact_mode = cm, kw::pars = std::vector<fp_t>{pars[0]}};
+            ta_ref.set_dtime(fp_t(1), std::numeric_limits<fp_t>::epsilon() / 4);
+            ta_ref.propagate_until(fp_t(3));
+
+            REQUIRE(std::get<0>(res)[0] == approximately(ta_ref.get_state()[0], fp_t(1000)));
+            REQUIRE(std::get<0>(res)[1] == approximately(ta_ref.get_state()[1], fp_t(1000)));
+        }
+    };
+
+    tuple_for_each(fp_types, tester);
+}
+
+TEST_CASE("ensemble propagate lane refill")
+{
+    auto tester = [](auto fp_x) {
+        using fp_t = decltype(fp_x);
+
+        auto [x, v] = make_vars("x", "v");
+
+        const std::vector sys{prime(x) = v, prime(v) = -par[0] * sin(x)};
+
+        // Instances with widely different frequencies, so that
+        // some of them stop early because of the step limit.
+        const std::size_t n_iter = 23, max_steps = 100;
+        std::vector<fp_t> states, pars;
+        for (std::size_t i = 0; i < n_iter; ++i) {
+            states.push_back(fp_t(0.05) + fp_t(i) / 100);
+            states.push_back(fp_t(0.025));
+
+            fp_t p(1);
+            for (std::size_t j = 0; j < i % 7u; ++j) {
+                p *= 10;
+            }
+            pars.push_back(p);
+        }
+
+        for (auto cm : {false, true}) {
+            for (auto layout : {taylor_layout::soa, taylor_layout::aos}) {
+                taylor_adaptive_batch<fp_t> tab{sys, std::vector<fp_t>(8u, fp_t(0)), 4, kw::compact_mode = cm,
+                                                kw::layout = layout};
+
+                for (auto n_threads : {1u, 2u}) {
+                    const auto [f_states, stats]
+                        = ensemble_propagate_until(tab, fp_t(3), states, pars, n_threads, max_steps);
+
+                    std::size_t n_tl = 0, n_sl = 0;
+                    for (std::size_t i = 0; i < n_iter; ++i) {
+                        taylor_adaptive<fp_t> ta{sys,
+                                                 {states[2u * i], states[2u * i + 1u]},
+                                                 kw::compact_mode = cm,
+                                                 kw::pars = std::vector<fp_t>{pars[i]}};
+
+                        if (std::get<0>(stats[i]) == taylor_outcome::step_limit) {
+                            ++n_sl;
+
+                            REQUIRE(std::get<3>(stats[i]) == max_steps);
+                            ta.propagate_until(fp_t(3), max_steps);
+                        } else {
+                            ++n_tl;
+
+                            REQUIRE(std::get<0>(stats[i]) == taylor_outcome::time_limit);
+                            REQUIRE(std::get<3>(stats[i]) <= max_steps);
+                            ta.propagate_until(fp_t(3));
+                        }
+
+                        REQUIRE(f_states[2u * i] == approximately(ta.get_state()[0], fp_t(1000)));
+                        REQUIRE(f_states[2u * i + 1u] == approximately(ta.get_state()[1], fp_t(1000)));
+                    }
+
+                    REQUIRE(n_tl > 0u);
+                    REQUIRE(n_sl > 0u);
+                }
+
+                // A final time equal to the initial
+                // time completes all the instances immediately.
+                const auto [f_states, stats] = ensemble_propagate_until(tab, fp_t(0), states, pars);
+                REQUIRE(f_states == states);
+                for (const auto &st : stats) {
+                    REQUIRE(std::get<0>(st) == taylor_outcome::time_limit);
+                    REQUIRE(std::get<3>(st) == 0u);
+                }
+            }
+        }
+    };
+
+    tuple_for_each(fp_types, tester);
+}
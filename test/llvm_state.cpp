@@ -6,10 +6,23 @@
 // Public License v. 2.0. If a copy of the MPL was not distributed
 // with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
 
+#include <cmath>
+#include <fstream>
 #include <iostream>
+#include <iterator>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <llvm/ADT/SmallString.h>
+#include <llvm/Support/FileSystem.h>
 
 #include <heyoka/expression.hpp>
 #include <heyoka/llvm_state.hpp>
+#include <heyoka/math_functions.hpp>
+#include <heyoka/number.hpp>
 #include <heyoka/taylor.hpp>
 
 #include "catch.hpp"
@@ -26,3 +39,436 @@ TEST_CASE("basic")
 
     std::cout << s.get_ir() << '\n';
 }
+
+TEST_CASE("object cache")
+{
+    llvm::SmallString<128> cdir;
+    REQUIRE(!llvm::sys::fs::createUniqueDirectory("heyoka_test_cache", cdir));
+    const auto cache_dir = std::string(cdir.c_str());
+
+    auto [x, y] = make_vars("x", "y");
+
+    auto count_objs = [&cache_dir]() {
+        std::error_code ec;
+        auto n = 0;
+        for (llvm::sys::fs::directory_iterator it(cache_dir, ec), end; it != end && !ec; it.increment(ec)) {
+            ++n;
+        }
+        return n;
+    };
+
+    // Cache miss.
+    {
+        llvm_state s{kw::cache_dir = cache_dir, kw::save_object_code = true};
+        REQUIRE(s.cache_dir() == cache_dir);
+        s.add_function_dbl("f", x * y + 1_dbl);
+        s.compile();
+
+        REQUIRE(count_objs() == 1);
+
+        auto f = s.fetch_function_dbl("f");
+        double args[] = {2, 3};
+        REQUIRE(f(args) == 7);
+    }
+
+    // Cache hit.
+    {
+        llvm_state s{kw::cache_dir = cache_dir, kw::save_object_code = true};
+        s.add_function_dbl("f", x * y + 1_dbl);
+        s.compile();
+
+        REQUIRE(count_objs() == 1);
+
+        auto f = s.fetch_function_dbl("f");
+        double args[] = {2, 3};
+        REQUIRE(f(args) == 7);
+
+        // Copies must also work.
+        auto s2 = s;
+        auto f2 = s2.fetch_function_dbl("f");
+        REQUIRE(f2(args) == 7);
+    }
+
+    // Different settings must result in a different object.
+    {
+        llvm_state s{kw::cache_dir = cache_dir, kw::opt_level = 2u};
+        s.add_function_dbl("f", x * y + 1_dbl);
+        s.compile();
+
+        REQUIRE(count_objs() == 2);
+    }
+
+    // Taylor integrator.
+    for (auto i = 0; i < 2; ++i) {
+        taylor_adaptive<double> ta{{prime(x) = y, prime(y) = -x}, {0., 1.}, kw::tol = 1e-10, kw::cache_dir = cache_dir};
+        ta.propagate_until(1.);
+
+        REQUIRE(count_objs() == 3);
+        REQUIRE(std::abs(ta.get_state()[0] - std::sin(1.)) < 1e-8);
+    }
+
+    llvm::sys::fs::remove_directories(cache_dir);
+}
+
+TEST_CASE("copy semantics")
+{
+    auto [x, y] = make_vars("x", "y");
+
+    llvm_state s;
+    s.add_function_dbl("f", x * y + 1_dbl);
+
+    // Copy of an uncompiled state.
+    auto s2 = s;
+    REQUIRE(!s2.is_compiled());
+    REQUIRE(s2.get_ir() == s.get_ir());
+
+    s.compile();
+
+    double args[] = {2, 3};
+
+    // Copy of a compiled state, which must remain
+    // usable after the destruction of the original.
+    std::optional<llvm_state> s3;
+    {
+        auto s4 = s;
+        REQUIRE(s4.is_compiled());
+        REQUIRE(s4.get_ir() == s.get_ir());
+
+        s3.emplace(s4);
+    }
+    s = llvm_state{};
+
+    REQUIRE(s3->fetch_function_dbl("f")(args) == 7);
+
+    s2.compile();
+    REQUIRE(s2.fetch_function_dbl("f")(args) == 7);
+}
+
+TEST_CASE("parjit")
+{
+    auto [x, y] = make_vars("x", "y");
+
+    REQUIRE_THROWS_AS((llvm_state{kw::parjit = true, kw::save_object_code = true}), std::invalid_argument);
+    REQUIRE_THROWS_AS((llvm_state{kw::parjit = true, kw::cache_dir = "foo"}), std::invalid_argument);
+
+    llvm_state s{kw::parjit = true};
+    REQUIRE(s.parjit());
+
+    s.add_function_dbl("f", x * y + 1_dbl);
+    s.add_function_dbl("g", x / y - 1_dbl);
+    s.add_function_dbl("h", x * x + y * y);
+    taylor_add_jet_dbl(s, "jet", {prime(x) = y, prime(y) = (1_dbl - x * x) * y - x}, 21, 1, false, true);
+
+    s.compile();
+
+    // NOTE: the optimisation time is a wall-clock time
+    // also in parjit mode, thus it cannot exceed the compile time.
+    REQUIRE(s.get_compile_report().opt_time > 0);
+    REQUIRE(s.get_compile_report().opt_time <= s.get_compile_report().compile_time);
+
+    double args[] = {2, 4};
+    REQUIRE(s.fetch_function_dbl("f")(args) == 9);
+    REQUIRE(s.fetch_function_dbl("g")(args) == -.5);
+    REQUIRE(s.fetch_function_dbl("h")(args) == 20);
+
+    // Integrator in compact mode.
+    taylor_adaptive<double> ta0{
+        {prime(x) = y, prime(y) = (1_dbl - x * x) * y - x}, {0., 1.}, kw::compact_mode = true, kw::parjit = true};
+    taylor_adaptive<double> ta1{
+        {prime(x) = y, prime(y) = (1_dbl - x * x) * y - x}, {0., 1.}, kw::compact_mode = true};
+
+    ta0.propagate_until(10.);
+    ta1.propagate_until(10.);
+
+    REQUIRE(std::abs(ta0.get_state()[0] - ta1.get_state()[0]) < 1e-10);
+    REQUIRE(std::abs(ta0.get_state()[1] - ta1.get_state()[1]) < 1e-10);
+}
+
+TEST_CASE("lazy")
+{
+    auto [x, y] = make_vars("x", "y");
+
+    REQUIRE_THROWS_AS((llvm_state{kw::lazy = true, kw::save_object_code = true}), std::invalid_argument);
+    REQUIRE_THROWS_AS((llvm_state{kw::lazy = true, kw::cache_dir = "foo"}), std::invalid_argument);
+    REQUIRE_THROWS_AS((llvm_state{kw::lazy = true, kw::parjit = true}), std::invalid_argument);
+
+    for (auto opt_level : {0u, 3u}) {
+        llvm_state s{kw::lazy = true, kw::opt_level = opt_level};
+        REQUIRE(s.lazy());
+
+        s.add_function_dbl("f", x * y + 1_dbl);
+        s.add_function_dbl("g", x / y - 1_dbl);
+        s.add_function_dbl("h", x * x + y * y);
+        taylor_add_jet_dbl(s, "jet", {prime(x) = y, prime(y) = (1_dbl - x * x) * y - x}, 21, 1, false, true);
+
+        s.compile();
+
+        double args[] = {2, 4};
+        REQUIRE(s.fetch_function_dbl("f")(args) == 9);
+        REQUIRE(s.fetch_function_dbl("h")(args) == 20);
+
+        // Copies share the lazily-compiled code.
+        auto s2 = s;
+        REQUIRE(s2.lazy());
+        REQUIRE(s2.fetch_function_dbl("g")(args) == -.5);
+        REQUIRE(s2.fetch_function_dbl("f")(args) == 9);
+    }
+
+    // Integrator in compact mode.
+    taylor_adaptive<double> ta0{
+        {prime(x) = y, prime(y) = (1_dbl - x * x) * y - x}, {0., 1.}, kw::compact_mode = true, kw::lazy = true};
+    taylor_adaptive<double> ta1{{prime(x) = y, prime(y) = (1_dbl - x * x) * y - x}, {0., 1.}, kw::compact_mode = true};
+
+    ta0.propagate_until(10.);
+    ta1.propagate_until(10.);
+
+    REQUIRE(std::abs(ta0.get_state()[0] - ta1.get_state()[0]) < 1e-10);
+    REQUIRE(std::abs(ta0.get_state()[1] - ta1.get_state()[1]) < 1e-10);
+}
+
+TEST_CASE("shared session")
+{
+    auto [x, y] = make_vars("x", "y");
+
+    REQUIRE(!llvm_state{}.shared_session());
+
+    // Functions with the same name in different
+    // states sharing the session do not clash.
+    std::vector<llvm_state> states;
+    for (auto i = 0; i < 10; ++i) {
+        llvm_state s{kw::shared_session = true, kw::lazy = (i % 2 == 0)};
+        REQUIRE(s.shared_session());
+
+        s.add_function_dbl("f", x * y + expression{number{static_cast<double>(i)}});
+        s.compile();
+
+        states.push_back(std::move(s));
+    }
+
+    double args[] = {2, 4};
+    for (auto i = 0; i < 10; ++i) {
+        REQUIRE(states[static_cast<unsigned>(i)].fetch_function_dbl("f")(args) == 8 + i);
+    }
+
+    // Destroy some of the states, the others must be unaffected.
+    states.erase(states.begin(), states.begin() + 5);
+    for (auto i = 0; i < 5; ++i) {
+        REQUIRE(states[static_cast<unsigned>(i)].fetch_function_dbl("f")(args) == 13 + i);
+    }
+
+    // Copies of uncompiled states share the session too.
+    llvm_state s{kw::shared_session = true};
+    s.add_function_dbl("g", x / y);
+    auto s2 = s;
+    REQUIRE(s2.shared_session());
+    s2.compile();
+    REQUIRE(s2.fetch_function_dbl("g")(args) == .5);
+
+    // Concurrent creation and compilation.
+    std::vector<std::thread> threads;
+    std::vector<double> res(8);
+    for (auto i = 0u; i < 8u; ++i) {
+        threads.emplace_back([i, &res, x = x, y = y]() {
+            llvm_state s{kw::shared_session = true};
+            s.add_function_dbl("f", x * x + y);
+            s.compile();
+
+            double args[] = {static_cast<double>(i), 1};
+            res[i] = s.fetch_function_dbl("f")(args);
+        });
+    }
+    for (auto &t : threads) {
+        t.join();
+    }
+    for (auto i = 0u; i < 8u; ++i) {
+        REQUIRE(res[i] == i * i + 1.);
+    }
+
+    // Integrators.
+    taylor_adaptive<double> ta0{
+        {prime(x) = y, prime(y) = (1_dbl - x * x) * y - x}, {0., 1.}, kw::shared_session = true};
+    taylor_adaptive<double> ta1{{prime(x) = y, prime(y) = (1_dbl - x * x) * y - x}, {0., 1.}};
+
+    ta0.propagate_until(10.);
+    ta1.propagate_until(10.);
+
+    REQUIRE(ta0.get_state() == ta1.get_state());
+}
+
+TEST_CASE("multiversioning")
+{
+    // NOTE: the target features used below
+    // are available only on x86.
+    if (!detail::get_target_features().sse2) {
+        return;
+    }
+
+    auto [x, y] = make_vars("x", "y");
+
+    REQUIRE_THROWS_AS((llvm_state{kw::mv_targets = std::vector<std::string>{"+avx2", ""}}), std::invalid_argument);
+
+    const std::vector<std::string> targets{"+avx512f,+avx2,+fma,+avx,+sse4.1,+sse2", "+avx2,+fma,+avx,+sse4.1,+sse2",
+                                           "+sse2"};
+
+    for (auto vw : {0u, 256u}) {
+        llvm_state s{kw::mv_targets = targets, kw::vector_width = vw};
+        REQUIRE(s.mv_targets() == targets);
+        REQUIRE(s.vector_width() == vw);
+
+        s.add_function_dbl("f", x * y + 1_dbl);
+        taylor_add_jet_dbl(s, "jet", {prime(x) = y, prime(y) = cos(x) - sin(y)}, 5, 4, false, false);
+
+        s.compile();
+
+        // The clones are not part of the IR snapshot.
+        REQUIRE(s.get_ir().find("f.mv0") == std::string::npos);
+
+        // All the clones must be available.
+        double args[] = {2, 3};
+        for (auto i = 0; i < 3; ++i) {
+            REQUIRE(reinterpret_cast<llvm_state::sf_t<double>>(s.jit_lookup("f.mv" + std::to_string(i)))(args) == 7);
+        }
+
+        // Dispatch to the best clone.
+        REQUIRE(s.fetch_function_dbl("f")(args) == 7);
+
+        // Check that all the clones of the jet compute the same result.
+        std::vector<double> jet0(2u * 6u * 4u), jet1;
+        for (auto i = 0u; i < 8u; ++i) {
+            jet0[i] = 0.1 * (i + 1u);
+        }
+        jet1 = jet0;
+        reinterpret_cast<void (*)(double *, const double *)>(s.jit_lookup("jet"))(jet0.data(), nullptr);
+        reinterpret_cast<void (*)(double *, const double *)>(s.jit_lookup("jet.mv2"))(jet1.data(), nullptr);
+        for (decltype(jet0.size()) i = 0; i < jet0.size(); ++i) {
+            REQUIRE(std::abs(jet0[i] - jet1[i]) <= 1e-14 * std::abs(jet0[i]));
+        }
+    }
+
+    // Integrator.
+    taylor_adaptive<double> ta0{
+        {prime(x) = y, prime(y) = cos(x) - sin(y)}, {0., 1.}, kw::compact_mode = true, kw::mv_targets = targets};
+    taylor_adaptive<double> ta1{{prime(x) = y, prime(y) = cos(x) - sin(y)}, {0., 1.}, kw::compact_mode = true};
+
+    ta0.propagate_until(10.);
+    ta1.propagate_until(10.);
+
+    REQUIRE(std::abs(ta0.get_state()[0] - ta1.get_state()[0]) < 1e-10);
+    REQUIRE(std::abs(ta0.get_state()[1] - ta1.get_state()[1]) < 1e-10);
+}
+
+TEST_CASE("opt pipeline")
+{
+    auto [x, y] = make_vars("x", "y");
+
+    REQUIRE(llvm_state{}.opt_pipeline() == "default");
+    REQUIRE_THROWS_AS((llvm_state{kw::opt_pipeline = "foobar"}), std::invalid_argument);
+    REQUIRE_THROWS_AS((llvm_state{kw::opt_pipeline = ""}), std::invalid_argument);
+
+    for (const auto *pl : {"default", "fast_compile", "vectorize", "function(instcombine,simplifycfg)"}) {
+        for (auto ls_vectorize : {false, true}) {
+            llvm_state s{kw::opt_pipeline = pl, kw::ls_vectorize = ls_vectorize};
+            REQUIRE(s.opt_pipeline() == pl);
+
+            s.add_function_dbl("f", x * y + 1_dbl);
+            taylor_add_jet_dbl(s, "jet", {prime(x) = y, prime(y) = (1_dbl - x * x) * y - x}, 21, 4, false, true);
+
+            // The timings of the optimisation passes must be available.
+            REQUIRE(!s.get_pass_timings().empty());
+            for (const auto &[name, t] : s.get_pass_timings()) {
+                REQUIRE(!name.empty());
+                REQUIRE(t >= 0);
+            }
+
+            s.compile();
+
+            double args[] = {2, 3};
+            REQUIRE(s.fetch_function_dbl("f")(args) == 7);
+        }
+    }
+
+    // No optimisation, no timings.
+    {
+        llvm_state s{kw::opt_level = 0u};
+        s.add_function_dbl("f", x * y + 1_dbl);
+        REQUIRE(s.get_pass_timings().empty());
+    }
+
+    // Integrator.
+    taylor_adaptive<double> ta0{
+        {prime(x) = y, prime(y) = (1_dbl - x * x) * y - x}, {0., 1.}, kw::opt_pipeline = "fast_compile"};
+    taylor_adaptive<double> ta1{{prime(x) = y, prime(y) = (1_dbl - x * x) * y - x}, {0., 1.}};
+
+    REQUIRE(!ta0.get_llvm_state().get_pass_timings().empty());
+
+    ta0.propagate_until(10.);
+    ta1.propagate_until(10.);
+
+    REQUIRE(std::abs(ta0.get_state()[0] - ta1.get_state()[0]) < 1e-10);
+    REQUIRE(std::abs(ta0.get_state()[1] - ta1.get_state()[1]) < 1e-10);
+}
+
+TEST_CASE("static library")
+{
+    auto [x, y] = make_vars("x", "y");
+
+    llvm::SmallString<128> lib_path, hdr_path;
+    REQUIRE(!llvm::sys::fs::createTemporaryFile("heyoka_test", "a", lib_path));
+    REQUIRE(!llvm::sys::fs::createTemporaryFile("heyoka_test", "h", hdr_path));
+    const auto lib_file = std::string(lib_path.c_str()), hdr_file = std::string(hdr_path.c_str());
+
+    for (auto compiled : {false, true}) {
+        llvm_state s{kw::save_object_code = true};
+        s.add_function_dbl("f", x * y + 1_dbl);
+        taylor_add_jet_dbl(s, "jet", {prime(x) = y, prime(y) = -x}, 5, 1, false, false);
+
+        if (compiled) {
+            s.compile();
+        }
+
+        s.dump_static_library(lib_file);
+        s.dump_c_header(hdr_file);
+
+        std::ifstream ifile(hdr_file);
+        const std::string hdr{std::istreambuf_iterator<char>(ifile), std::istreambuf_iterator<char>()};
+        REQUIRE(hdr.find("double f(") != std::string::npos);
+        REQUIRE(hdr.find("void jet(double *") != std::string::npos);
+        REQUIRE(hdr.find("extern \"C\"") != std::string::npos);
+
+        // Load the library into a new state.
+        llvm_state s2;
+        s2.load_object_file(lib_file);
+
+        // NOTE: the signatures of the functions are not available
+        // in the loaded state, use jit_lookup() directly.
+        double args[] = {2, 3};
+        REQUIRE(reinterpret_cast<llvm_state::sf_t<double>>(s2.jit_lookup("f"))(args) == 7);
+        REQUIRE_THROWS_AS(s2.fetch_function_dbl("f"), std::invalid_argument);
+
+        // The state is now compiled.
+        REQUIRE_THROWS_AS(s2.load_object_file(lib_file), std::invalid_argument);
+        REQUIRE_THROWS_AS(s2.add_function_dbl("g", x), std::invalid_argument);
+    }
+
+    // Dumping after compilation requires save_object_code.
+    {
+        llvm_state s;
+        s.add_function_dbl("f", x * y + 1_dbl);
+        s.compile();
+
+        REQUIRE_THROWS_AS(s.dump_static_library(lib_file), std::invalid_argument);
+    }
+
+    // Loading requires an empty module.
+    {
+        llvm_state s;
+        s.add_function_dbl("f", x * y + 1_dbl);
+
+        REQUIRE_THROWS_AS(s.load_object_file(lib_file), std::invalid_argument);
+    }
+
+    REQUIRE_THROWS_AS(llvm_state{}.load_object_file("/this/file/does/not/exist"), std::invalid_argument);
+
+    llvm::sys::fs::remove(lib_file);
+    llvm::sys::fs::remove(hdr_file);
+}
@@ -0,0 +1,1339 @@
+// Copyright 2020 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <heyoka/config.hpp>
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+#include <mp++/real128.hpp>
+
+#endif
+
+#include <llvm/ADT/SmallString.h>
+#include <llvm/Support/FileSystem.h>
+
+#include <heyoka/detail/dfloat.hpp>
+#include <heyoka/expression.hpp>
+#include <heyoka/math_functions.hpp>
+#include <heyoka/number.hpp>
+#include <heyoka/taylor.hpp>
+
+#include "catch.hpp"
+#include "test_utils.hpp"
+
+using namespace heyoka;
+using namespace heyoka_test;
+
+const auto fp_types = std::tuple<double, long double
+#if defined(HEYOKA_HAVE_REAL128)
+                                 ,
+                                 mppp::real128
+#endif
+                                 >{};
+
+TEST_CASE("mem cache")
+{
+    auto tester = [](auto fp_x) {
+        using fp_t = decltype(fp_x);
+
+        auto [x, v] = make_vars("x", "v");
+
+        for (auto cm : {false, true}) {
+            taylor_adaptive<fp_t> ta0{
+                {prime(x) = v, prime(v) = -9.8_dbl * sin(x)}, {fp_t(0.05), fp_t(0.025)}, kw::compact_mode = cm};
+            taylor_adaptive<fp_t> ta1{
+                {prime(x) = v, prime(v) = -9.8_dbl * sin(x)}, {fp_t(0.05), fp_t(0.025)}, kw::compact_mode = cm};
+
+            // Different constant, must not re-use the cached stepper.
+            taylor_adaptive<fp_t> ta2{
+                {prime(x) = v, prime(v) = -9.7_dbl * sin(x)}, {fp_t(0.05), fp_t(0.025)}, kw::compact_mode = cm};
+
+            // Different tolerance, must not re-use the cached stepper.
+            taylor_adaptive<fp_t> ta3{{prime(x) = v, prime(v) = -9.8_dbl * sin(x)},
+                                      {fp_t(0.05), fp_t(0.025)},
+                                      kw::compact_mode = cm,
+                                      kw::tol = fp_t(1e-6)};
+
+            ta0.propagate_until(fp_t(10));
+            ta1.propagate_until(fp_t(10));
+            ta2.propagate_until(fp_t(10));
+            ta3.propagate_until(fp_t(10));
+
+            REQUIRE(ta0.get_state() == ta1.get_state());
+            REQUIRE(ta0.get_state() != ta2.get_state());
+            REQUIRE(ta0.get_state() != ta3.get_state());
+
+            // Check that the cached stepper is still valid
+            // after the destruction of the original integrator.
+            {
+                taylor_adaptive_batch<fp_t> tab0{{prime(x) = v, prime(v) = -9.8_dbl * sin(x)},
+                                                 {fp_t(0.05), fp_t(0.06), fp_t(0.025), fp_t(0.026)},
+                                                 2,
+                                                 kw::compact_mode = cm};
+            }
+
+            taylor_adaptive_batch<fp_t> tab1{{prime(x) = v, prime(v) = -9.8_dbl * sin(x)},
+                                             {fp_t(0.05), fp_t(0.06), fp_t(0.025), fp_t(0.026)},
+                                             2,
+                                             kw::compact_mode = cm};
+            std::vector<std::tuple<taylor_outcome, fp_t>> res;
+            tab1.step(res);
+            REQUIRE(std::get<0>(res[0]) == taylor_outcome::success);
+            REQUIRE(std::get<0>(res[1]) == taylor_outcome::success);
+        }
+
+        // Concurrent construction.
+        std::vector<std::thread> threads;
+        std::vector<std::vector<fp_t>> states(8);
+        for (auto i = 0u; i < 8u; ++i) {
+            threads.emplace_back([i, &states, x = x, v = v]() {
+                taylor_adaptive<fp_t> ta{{prime(x) = v, prime(v) = -9.8_dbl * sin(x)}, {fp_t(0.05), fp_t(0.025)}};
+                ta.propagate_until(fp_t(10));
+                states[i] = ta.get_state();
+            });
+        }
+        for (auto &t : threads) {
+            t.join();
+        }
+        for (auto i = 1u; i < 8u; ++i) {
+            REQUIRE(states[i] == states[0]);
+        }
+    };
+
+    tuple_for_each(fp_types, tester);
+}
+
+TEST_CASE("copy semantics")
+{
+    auto tester = [](auto fp_x) {
+        using fp_t = decltype(fp_x);
+
+        auto [x, v] = make_vars("x", "v");
+
+        auto ta0 = std::make_unique<taylor_adaptive<fp_t>>(
+            std::vector{prime(x) = v, prime(v) = -9.8_dbl * sin(x)}, std::vector{fp_t(0.05), fp_t(0.025)});
+
+        auto ta1 = *ta0;
+        REQUIRE(ta1.get_state() == ta0->get_state());
+        REQUIRE(ta1.get_time() == ta0->get_time());
+        REQUIRE(ta1.get_decomposition() == ta0->get_decomposition());
+
+        ta0->propagate_until(fp_t(10));
+
+        // The copy must be independent from the original.
+        REQUIRE(ta1.get_time() == 0);
+
+        auto st0 = ta0->get_state();
+        ta0.reset();
+
+        // The copy must remain usable after the destruction
+        // of the original.
+        ta1.propagate_until(fp_t(10));
+        REQUIRE(ta1.get_state() == st0);
+
+        taylor_adaptive_batch<fp_t> tab0{{prime(x) = v, prime(v) = -9.8_dbl * sin(x)},
+                                         {fp_t(0.05), fp_t(0.06), fp_t(0.025), fp_t(0.026)},
+                                         2};
+        auto tab1 = tab0;
+
+        std::vector<std::tuple<taylor_outcome, fp_t>> res;
+        tab0.step(res);
+        REQUIRE(tab1.get_times() == std::vector{fp_t(0), fp_t(0)});
+
+        tab1.step(res);
+        REQUIRE(tab1.get_states() == tab0.get_states());
+        REQUIRE(std::get<0>(res[0]) == taylor_outcome::success);
+        REQUIRE(std::get<0>(res[1]) == taylor_outcome::success);
+    };
+
+    tuple_for_each(fp_types, tester);
+}
+
+TEST_CASE("object file")
+{
+    auto tester = [](auto fp_x) {
+        using fp_t = decltype(fp_x);
+
+        auto [x, v] = make_vars("x", "v");
+
+        llvm::SmallString<128> lib_path;
+        REQUIRE(!llvm::sys::fs::createTemporaryFile("heyoka_test", "a", lib_path));
+        const auto lib_file = std::string(lib_path.c_str());
+
+        for (auto cm : {false, true}) {
+            // Export the stepper.
+            {
+                taylor_adaptive<fp_t> ta{{prime(x) = v, prime(v) = -9.8_dbl * sin(x)},
+                                         {fp_t(0.05), fp_t(0.025)},
+                                         kw::compact_mode = cm,
+                                         kw::save_object_code = true};
+                ta.get_llvm_state().dump_static_library(lib_file);
+            }
+
+            taylor_adaptive<fp_t> ta0{
+                {prime(x) = v, prime(v) = -9.8_dbl * sin(x)}, {fp_t(0.05), fp_t(0.025)}, kw::compact_mode = cm};
+            taylor_adaptive<fp_t> ta1{{prime(x) = v, prime(v) = -9.8_dbl * sin(x)},
+                                      {fp_t(0.05), fp_t(0.025)},
+                                      kw::compact_mode = cm,
+                                      kw::object_file = lib_file};
+
+            ta0.propagate_until(fp_t(10));
+            ta1.propagate_until(fp_t(10));
+
+            REQUIRE(ta0.get_state() == ta1.get_state());
+
+            // Copies must work as well.
+            auto ta2 = ta1;
+            ta2.propagate_until(fp_t(20));
+            ta0.propagate_until(fp_t(20));
+            REQUIRE(ta0.get_state() == ta2.get_state());
+
+            // Mismatched system.
+            REQUIRE_THROWS_AS((taylor_adaptive<fp_t>{{prime(x) = v, prime(v) = -9.7_dbl * sin(x)},
+                                                     {fp_t(0.05), fp_t(0.025)},
+                                                     kw::compact_mode = cm,
+                                                     kw::object_file = lib_file}),
+                              std::invalid_argument);
+
+            // Mismatched settings.
+            REQUIRE_THROWS_AS((taylor_adaptive<fp_t>{{prime(x) = v, prime(v) = -9.8_dbl * sin(x)},
+                                                     {fp_t(0.05), fp_t(0.025)},
+                                                     kw::compact_mode = !cm,
+                                                     kw::object_file = lib_file}),
+                              std::invalid_argument);
+
+            // Batch mode.
+            {
+                taylor_adaptive_batch<fp_t> tab{{prime(x) = v, prime(v) = -9.8_dbl * sin(x)},
+                                                {fp_t(0.05), fp_t(0.06), fp_t(0.025), fp_t(0.026)},
+                                                2,
+                                                kw::compact_mode = cm,
+                                                kw::save_object_code = true};
+                tab.get_llvm_state().dump_static_library(lib_file);
+            }
+
+            taylor_adaptive_batch<fp_t> tab0{{prime(x) = v, prime(v) = -9.8_dbl * sin(x)},
+                                             {fp_t(0.05), fp_t(0.06), fp_t(0.025), fp_t(0.026)},
+                                             2,
+                                             kw::compact_mode = cm};
+            taylor_adaptive_batch<fp_t> tab1{{prime(x) = v, prime(v) = -9.8_dbl * sin(x)},
+                                             {fp_t(0.05), fp_t(0.06), fp_t(0.025), fp_t(0.026)},
+                                             2,
+                                             kw::compact_mode = cm,
+                                             kw::object_file = lib_file};
+
+            std::vector<std::tuple<taylor_outcome, fp_t>> res;
+            tab0.step(res);
+            tab1.step(res);
+            REQUIRE(tab0.get_states() == tab1.get_states());
+        }
+
+        llvm::sys::fs::remove(lib_file);
+    };
+
+    tuple_for_each(fp_types, tester);
+}
+
+TEST_CASE("compile report")
+{
+    auto tester = [](auto fp_x) {
+        using fp_t = decltype(fp_x);
+
+        auto [x, v] = make_vars("x", "v");
+
+        for (auto cm : {false, true}) {
+            // NOTE: use a system which is not used elsewhere,
+            // so that the stepper is not in the in-process cache.
+            taylor_adaptive<fp_t> ta0{
+                {prime(x) = v, prime(v) = -9.123_dbl * sin(x)}, {fp_t(0.05), fp_t(0.025)}, kw::compact_mode = cm};
+
+            const auto &r0 = ta0.get_compile_report();
+            std::cout << r0 << '\n';
+
+            REQUIRE(!r0.cached);
+            REQUIRE(r0.decomposition_time >= 0);
+            REQUIRE(r0.ir_time > 0);
+            REQUIRE(r0.n_uvars == ta0.get_decomposition().size() - 2u);
+            REQUIRE(r0.llvm.opt_time > 0);
+            REQUIRE(r0.llvm.compile_time > 0);
+            REQUIRE(r0.llvm.n_insts_pre_opt > 0u);
+            REQUIRE(r0.llvm.n_insts_post_opt > 0u);
+            REQUIRE(r0.llvm.n_funcs > 0u);
+            REQUIRE(r0.llvm.obj_size > 0u);
+
+            // Copies preserve the report.
+            auto ta1 = ta0;
+            REQUIRE(ta1.get_compile_report().llvm.obj_size == r0.llvm.obj_size);
+
+            // A second integrator for the same system
+            // fetches the stepper from the in-process cache.
+            taylor_adaptive<fp_t> ta2{
+                {prime(x) = v, prime(v) = -9.123_dbl * sin(x)}, {fp_t(0.05), fp_t(0.025)}, kw::compact_mode = cm};
+
+            const auto &r2 = ta2.get_compile_report();
+            REQUIRE(r2.cached);
+            REQUIRE(r2.n_uvars == r0.n_uvars);
+            REQUIRE(r2.llvm.obj_size == 0u);
+
+            taylor_adaptive_batch<fp_t> tab{{prime(x) = v, prime(v) = -9.123_dbl * sin(x)},
+                                            {fp_t(0.05), fp_t(0.06), fp_t(0.025), fp_t(0.026)},
+                                            2,
+                                            kw::compact_mode = cm};
+            REQUIRE(!tab.get_compile_report().cached);
+            REQUIRE(tab.get_compile_report().llvm.obj_size > 0u);
+        }
+    };
+
+    tuple_for_each(fp_types, tester);
+}
+
+TEST_CASE("dense output")
+{
+    auto tester = [](auto fp_x) {
+        using fp_t = decltype(fp_x);
+
+        auto [x, v] = make_vars("x", "v");
+
+        for (auto cm : {false, true}) {
+            // Dense output not enabled.
+            taylor_adaptive<fp_t> ta_nd{
+                {prime(x) = v, prime(v) = -9.8_dbl * sin(x)}, {fp_t(0.05), fp_t(0.025)}, kw::compact_mode = cm};
+            REQUIRE(ta_nd.get_tc().empty());
+            ta_nd.step();
+            REQUIRE_THROWS_AS(ta_nd.update_d_output(fp_t(0)), std::invalid_argument);
+
+            taylor_adaptive<fp_t> ta{{prime(x) = v, prime(v) = -9.8_dbl * sin(x)},
+                                     {fp_t(0.05), fp_t(0.025)},
+                                     kw::compact_mode = cm,
+                                     kw::dense_output = true};
+            REQUIRE(ta.get_tc().size() == 2u * (ta.get_order() + 1u));
+            REQUIRE(ta.get_d_output().size() == 2u);
+
+            const auto [oc, h] = ta.step();
+            REQUIRE(oc == taylor_outcome::success);
+
+            // The order-0 coefficients are the initial state.
+            REQUIRE(ta.get_tc()[0] == fp_t(0.05));
+            REQUIRE(ta.get_tc()[ta.get_order() + 1u] == fp_t(0.025));
+
+            REQUIRE_THROWS_AS(ta.update_d_output(std::numeric_limits<fp_t>::infinity()), std::invalid_argument);
+
+            // Check the dense output at the beginning and at the end of the step.
+            ta.update_d_output(fp_t(0));
+            REQUIRE(ta.get_d_output()[0] == approximately(fp_t(0.05)));
+            REQUIRE(ta.get_d_output()[1] == approximately(fp_t(0.025)));
+
+            ta.update_d_output(ta.get_time());
+            REQUIRE(ta.get_d_output()[0] == approximately(ta.get_state()[0]));
+            REQUIRE(ta.get_d_output()[1] == approximately(ta.get_state()[1]));
+
+            // Check the dense output within the step
+            // against a clamped integration.
+            taylor_adaptive<fp_t> ta2{
+                {prime(x) = v, prime(v) = -9.8_dbl * sin(x)}, {fp_t(0.05), fp_t(0.025)}, kw::compact_mode = cm};
+            ta2.propagate_until(h / 3);
+
+            const auto &d_out = ta.update_d_output(h / 3);
+            REQUIRE(d_out[0] == approximately(ta2.get_state()[0], fp_t(1000)));
+            REQUIRE(d_out[1] == approximately(ta2.get_state()[1], fp_t(1000)));
+
+            // Copies preserve the coefficients.
+            auto ta3 = ta;
+            REQUIRE(ta3.get_tc() == ta.get_tc());
+            REQUIRE(ta3.update_d_output(h / 3) == ta.update_d_output(h / 3));
+
+            // Batch mode.
+            taylor_adaptive_batch<fp_t> tab{{prime(x) = v, prime(v) = -9.8_dbl * sin(x)},
+                                            {fp_t(0.05), fp_t(0.06), fp_t(0.025), fp_t(0.026)},
+                                            2,
+                                            kw::compact_mode = cm,
+                                            kw::dense_output = true};
+            REQUIRE(tab.get_tc().size() == 4u * (tab.get_order() + 1u));
+
+            std::vector<std::tuple<taylor_outcome, fp_t>> res;
+            tab.step(res);
+
+            REQUIRE_THROWS_AS(tab.update_d_output({fp_t(0)}), std::invalid_argument);
+
+            tab.update_d_output({fp_t(0), fp_t(0)});
+            REQUIRE(tab.get_d_output()[0] == approximately(fp_t(0.05)));
+            REQUIRE(tab.get_d_output()[1] == approximately(fp_t(0.06)));
+            REQUIRE(tab.get_d_output()[2] == approximately(fp_t(0.025)));
+            REQUIRE(tab.get_d_output()[3] == approximately(fp_t(0.026)));
+
+            tab.update_d_output(tab.get_times());
+            for (auto i = 0u; i < 4u; ++i) {
+                REQUIRE(tab.get_d_output()[i] == approximately(tab.get_states()[i]));
+            }
+        }
+    };
+
+    tuple_for_each(fp_types, tester);
+}
+
+TEST_CASE("events")
+{
+    auto tester = [](auto fp_x) {
+        using fp_t = decltype(fp_x);
+        using std::abs;
+
+        auto [x, v] = make_vars("x", "v");
+
+        const auto sys = std::vector{prime(x) = v, prime(v) = -9.8_dbl * sin(x)};
+        const auto eps = std::numeric_limits<fp_t>::epsilon();
+
+        // Error handling.
+        REQUIRE_THROWS_AS(t_event<fp_t>(x, kw::direction = event_direction{2}), std::invalid_argument);
+        REQUIRE_THROWS_AS(nt_event<fp_t>(x, typename nt_event<fp_t>::callback_t{}), std::invalid_argument);
+        REQUIRE_THROWS_AS((taylor_adaptive<fp_t>{sys,
+                                                 {fp_t(0.05), fp_t(0)},
+                                                 kw::t_events = std::vector{t_event<fp_t>("y"_var)}}),
+                          std::invalid_argument);
+        REQUIRE_THROWS_AS(
+            (taylor_adaptive<fp_t>{sys, {fp_t(0.05), fp_t(0)}, kw::t_events = std::vector{t_event<fp_t>(1_dbl)}}),
+            std::invalid_argument);
+
+        for (auto cm : {false, true}) {
+            // Non-terminal events: the zero crossings of x.
+            std::vector<fp_t> c_times;
+            std::vector<event_direction> c_dirs;
+            auto cb = [&c_times, &c_dirs, eps](auto &ta, fp_t t, event_direction d) {
+                // The state at the time of the crossing
+                // is available via the dense output.
+                REQUIRE(abs(ta.update_d_output(t)[0]) < eps * 1000);
+
+                c_times.push_back(t);
+                c_dirs.push_back(d);
+            };
+
+            std::vector<fp_t> pos_times;
+            auto pos_cb = [&pos_times](auto &, fp_t t, event_direction d) {
+                REQUIRE(d == event_direction::positive);
+                pos_times.push_back(t);
+            };
+
+            taylor_adaptive<fp_t> ta{sys,
+                                     {fp_t(0.05), fp_t(0)},
+                                     kw::compact_mode = cm,
+                                     kw::nt_events = std::vector{nt_event<fp_t>(x, cb),
+                                                                 nt_event<fp_t>(x, pos_cb,
+                                                                                kw::direction
+                                                                                = event_direction::positive)}};
+
+            // The Taylor coefficients of the event functions
+            // follow those of the state variables.
+            REQUIRE(ta.get_tc().size() == 4u * (ta.get_order() + 1u));
+            REQUIRE(ta.get_nt_events().size() == 2u);
+
+            const auto oc = std::get<0>(ta.propagate_until(fp_t(10)));
+            REQUIRE(oc == taylor_outcome::time_limit);
+
+            // The period of the pendulum is ~2, thus
+            // we expect ~10 zero crossings.
+            REQUIRE(c_times.size() == 10u);
+            REQUIRE(pos_times.size() == 5u);
+            for (decltype(c_times.size()) i = 0; i < c_times.size(); ++i) {
+                REQUIRE(c_dirs[i] == (i % 2u == 0u ? event_direction::negative : event_direction::positive));
+
+                if (i > 0u) {
+                    // The crossings are in chronological order
+                    // and equally spaced.
+                    REQUIRE(c_times[i] - c_times[i - 1u]
+                            == approximately(fp_t(2) * c_times[0], fp_t(10000)));
+                }
+                if (i % 2u == 1u) {
+                    REQUIRE(pos_times[i / 2u] == c_times[i]);
+                }
+            }
+
+            // Terminal event: the zero crossings of v.
+            unsigned n_cb = 0;
+            taylor_adaptive<fp_t> ta_t{
+                sys,
+                {fp_t(0.05), fp_t(0)},
+                kw::compact_mode = cm,
+                kw::t_events = std::vector{t_event<fp_t>(
+                    v, kw::callback = [&n_cb](auto &, event_direction d) {
+                        REQUIRE(d != event_direction::any);
+                        ++n_cb;
+                    })}};
+
+            REQUIRE(!ta_t.get_last_te_idx());
+            REQUIRE(ta_t.get_t_events().size() == 1u);
+
+            // NOTE: the initial zero crossing at t = 0 is not detected.
+            auto [oc_t, min_h, max_h, n_steps] = ta_t.propagate_until(fp_t(10));
+            REQUIRE(oc_t == taylor_outcome::terminal_event);
+            REQUIRE(n_steps > 0u);
+            REQUIRE(ta_t.get_last_te_idx() == 0u);
+            REQUIRE(n_cb == 1u);
+
+            // The integration stopped at the half-period.
+            const auto t_half = ta_t.get_time();
+            REQUIRE(t_half == approximately(fp_t(2) * c_times[0], fp_t(10000)));
+            REQUIRE(abs(ta_t.get_state()[1]) < eps * 1000);
+            REQUIRE(ta_t.get_state()[0] == approximately(fp_t(-0.05), fp_t(10000)));
+
+            // Resume the integration: thanks to the cooldown, the
+            // event does not trigger again immediately.
+            oc_t = std::get<0>(ta_t.propagate_until(fp_t(10)));
+            REQUIRE(oc_t == taylor_outcome::terminal_event);
+            REQUIRE(n_cb == 2u);
+            REQUIRE(ta_t.get_time() == approximately(fp_t(2) * t_half, fp_t(10000)));
+            REQUIRE(ta_t.get_state()[0] == approximately(fp_t(0.05), fp_t(10000)));
+
+            // Copies preserve the events.
+            auto ta_t2 = ta_t;
+            REQUIRE(ta_t2.get_last_te_idx() == 0u);
+            REQUIRE(std::get<0>(ta_t2.propagate_until(fp_t(10))) == taylor_outcome::terminal_event);
+            REQUIRE(n_cb == 3u);
+            REQUIRE(ta_t2.get_time() == approximately(fp_t(3) * t_half, fp_t(10000)));
+        }
+    };
+
+    tuple_for_each(fp_types, tester);
+}
+
+TEST_CASE("batch propagate")
+{
+    auto tester = [](auto fp_x) {
+        using fp_t = decltype(fp_x);
+
+        auto [x, v] = make_vars("x", "v");
+
+        const std::vector sys{prime(x) = v, prime(v) = -9.8_dbl * sin(x)};
+
+        for (auto cm : {false, true}) {
+            taylor_adaptive_batch<fp_t> tab{
+                sys, {fp_t(0.05), fp_t(0.06), fp_t(0.025), fp_t(0.026)}, 2, kw::compact_mode = cm};
+
+            std::vector<std::tuple<taylor_outcome, fp_t, fp_t, std::size_t>> res;
+
+            REQUIRE_THROWS_AS(tab.propagate_until(res, {fp_t(1)}), std::invalid_argument);
+            REQUIRE_THROWS_AS(tab.propagate_until(res, {fp_t(1), std::numeric_limits<fp_t>::infinity()}),
+                              std::invalid_argument);
+            REQUIRE_THROWS_AS(tab.propagate_for(res, {fp_t(1)}), std::invalid_argument);
+            REQUIRE_THROWS_AS(tab.propagate_grid(res, {fp_t(1), fp_t(1)}), std::invalid_argument);
+
+            // The two batch elements have different final times,
+            // one of them backwards in time.
+            tab.propagate_until(res, {fp_t(2), fp_t(-1)});
+            REQUIRE(res.size() == 2u);
+            REQUIRE(tab.get_times()[0] == approximately(fp_t(2)));
+            REQUIRE(tab.get_times()[1] == approximately(fp_t(-1)));
+
+            for (const auto &[oc, min_h, max_h, n_steps] : res) {
+                REQUIRE(oc == taylor_outcome::time_limit);
+                REQUIRE(min_h > 0);
+                REQUIRE(max_h >= min_h);
+                REQUIRE(n_steps > 0u);
+            }
+
+            // Compare to scalar integrations.
+            taylor_adaptive<fp_t> ta0{sys, {fp_t(0.05), fp_t(0.025)}, kw::compact_mode = cm};
+            taylor_adaptive<fp_t> ta1{sys, {fp_t(0.06), fp_t(0.026)}, kw::compact_mode = cm};
+            ta0.propagate_until(fp_t(2));
+            ta1.propagate_until(fp_t(-1));
+
+            REQUIRE(tab.get_states()[0] == approximately(ta0.get_state()[0], fp_t(1000)));
+            REQUIRE(tab.get_states()[1] == approximately(ta1.get_state()[0], fp_t(1000)));
+            REQUIRE(tab.get_states()[2] == approximately(ta0.get_state()[1], fp_t(1000)));
+            REQUIRE(tab.get_states()[3] == approximately(ta1.get_state()[1], fp_t(1000)));
+
+            // propagate_for(), with an element which does not move.
+            tab.propagate_for(res, {fp_t(0), fp_t(1)});
+            REQUIRE(std::get<0>(res[0]) == taylor_outcome::time_limit);
+            REQUIRE(std::get<3>(res[0]) == 0u);
+            REQUIRE(std::get<3>(res[1]) > 0u);
+            REQUIRE(tab.get_times()[0] == approximately(fp_t(2)));
+            REQUIRE(tab.get_times()[1] == approximately(fp_t(0)));
+
+            // Step limit.
+            tab.propagate_for(res, {fp_t(10), fp_t(10)}, 2);
+            for (const auto &r : res) {
+                REQUIRE(std::get<0>(r) == taylor_outcome::step_limit);
+                REQUIRE(std::get<3>(r) == 2u);
+            }
+
+            // Non-finite state in one element.
+            tab.get_states_data()[1] = std::numeric_limits<fp_t>::quiet_NaN();
+            tab.propagate_for(res, {fp_t(1), fp_t(1)});
+            REQUIRE(std::get<0>(res[0]) == taylor_outcome::time_limit);
+            REQUIRE(std::get<0>(res[1]) == taylor_outcome::err_nf_state);
+            REQUIRE(std::get<3>(res[1]) == 0u);
+
+            // propagate_grid().
+            taylor_adaptive_batch<fp_t> tab_d{sys,
+                                              {fp_t(0.05), fp_t(0.06), fp_t(0.025), fp_t(0.026)},
+                                              2,
+                                              kw::compact_mode = cm,
+                                              kw::dense_output = true};
+
+            // Non-monotonic grid.
+            REQUIRE_THROWS_AS(tab_d.propagate_grid(res, {fp_t(1), fp_t(1), fp_t(0.5), fp_t(2)}),
+                              std::invalid_argument);
+
+            const std::vector<fp_t> grid{fp_t(0), fp_t(0), fp_t(0.5), fp_t(-0.5), fp_t(1), fp_t(-1), fp_t(1.5),
+                                         fp_t(-1)};
+            const auto out = tab_d.propagate_grid(res, grid);
+            REQUIRE(out.size() == 16u);
+
+            for (const auto &r : res) {
+                REQUIRE(std::get<0>(r) == taylor_outcome::time_limit);
+            }
+
+            // The first grid point is the initial state.
+            REQUIRE(out[0] == fp_t(0.05));
+            REQUIRE(out[1] == fp_t(0.06));
+            REQUIRE(out[2] == fp_t(0.025));
+            REQUIRE(out[3] == fp_t(0.026));
+
+            for (auto p = 1u; p < 4u; ++p) {
+                taylor_adaptive<fp_t> ta_0{sys, {fp_t(0.05), fp_t(0.025)}, kw::compact_mode = cm};
+                taylor_adaptive<fp_t> ta_1{sys, {fp_t(0.06), fp_t(0.026)}, kw::compact_mode = cm};
+                ta_0.propagate_until(grid[p * 2u]);
+                ta_1.propagate_until(grid[p * 2u + 1u]);
+
+                REQUIRE(out[p * 4u] == approximately(ta_0.get_state()[0], fp_t(1000)));
+                REQUIRE(out[p * 4u + 1u] == approximately(ta_1.get_state()[0], fp_t(1000)));
+                REQUIRE(out[p * 4u + 2u] == approximately(ta_0.get_state()[1], fp_t(1000)));
+                REQUIRE(out[p * 4u + 3u] == approximately(ta_1.get_state()[1], fp_t(1000)));
+            }
+        }
+    };
+
+    tuple_for_each(fp_types, tester);
+}
+
+TEST_CASE("external state")
+{
+    auto tester = [](auto fp_x) {
+        using fp_t = decltype(fp_x);
+
+        auto [x, v] = make_vars("x", "v");
+
+        const std::vector sys{prime(x) = v, prime(v) = -9.8_dbl * sin(x)};
+
+        for (auto cm : {false, true}) {
+            taylor_adaptive<fp_t> ta{sys, {fp_t(0.05), fp_t(0.025)}, kw::compact_mode = cm};
+            REQUIRE(ta.get_dim() == 2u);
+            REQUIRE(!ta.has_ext_state());
+
+            REQUIRE_THROWS_AS(ta.attach_state(nullptr), std::invalid_argument);
+
+            // Two objects in a caller-owned array.
+            std::vector<fp_t> buf{fp_t(0.05), fp_t(0.025), fp_t(0.06), fp_t(0.026)};
+
+            ta.attach_state(buf.data());
+            REQUIRE(ta.has_ext_state());
+            REQUIRE(ta.get_state_data() == buf.data());
+            REQUIRE_THROWS_AS(ta.get_state(), std::invalid_argument);
+
+            ta.propagate_until(fp_t(1));
+
+            // Re-target to the second object.
+            ta.set_time(fp_t(0));
+            ta.attach_state(buf.data() + 2);
+            ta.propagate_until(fp_t(1));
+
+            taylor_adaptive<fp_t> ta0{sys, {fp_t(0.05), fp_t(0.025)}, kw::compact_mode = cm};
+            taylor_adaptive<fp_t> ta1{sys, {fp_t(0.06), fp_t(0.026)}, kw::compact_mode = cm};
+            ta0.propagate_until(fp_t(1));
+            ta1.propagate_until(fp_t(1));
+
+            REQUIRE(buf[0] == ta0.get_state()[0]);
+            REQUIRE(buf[1] == ta0.get_state()[1]);
+            REQUIRE(buf[2] == ta1.get_state()[0]);
+            REQUIRE(buf[3] == ta1.get_state()[1]);
+
+            // set_state() writes into the external buffer.
+            ta.set_state({fp_t(1), fp_t(2)});
+            REQUIRE(buf[2] == 1);
+            REQUIRE(buf[3] == 2);
+
+            // Copies get the content of the external buffer.
+            auto ta2 = ta;
+            REQUIRE(!ta2.has_ext_state());
+            REQUIRE(ta2.get_state() == std::vector<fp_t>{fp_t(1), fp_t(2)});
+
+            ta.detach_state();
+            REQUIRE(!ta.has_ext_state());
+            REQUIRE(ta.get_state() == std::vector<fp_t>{fp_t(1), fp_t(2)});
+
+            // Batch mode.
+            taylor_adaptive_batch<fp_t> tab{
+                sys, {fp_t(0.05), fp_t(0.06), fp_t(0.025), fp_t(0.026)}, 2, kw::compact_mode = cm};
+            REQUIRE(tab.get_dim() == 2u);
+            REQUIRE_THROWS_AS(tab.attach_states(nullptr), std::invalid_argument);
+
+            std::vector<fp_t> bbuf{fp_t(0.05), fp_t(0.06), fp_t(0.025), fp_t(0.026)};
+            tab.attach_states(bbuf.data());
+            REQUIRE(tab.has_ext_states());
+            REQUIRE_THROWS_AS(tab.get_states(), std::invalid_argument);
+
+            std::vector<std::tuple<taylor_outcome, fp_t, fp_t, std::size_t>> res;
+            tab.propagate_until(res, {fp_t(1), fp_t(1)});
+
+            REQUIRE(bbuf[0] == approximately(ta0.get_state()[0], fp_t(1000)));
+            REQUIRE(bbuf[1] == approximately(ta1.get_state()[0], fp_t(1000)));
+            REQUIRE(bbuf[2] == approximately(ta0.get_state()[1], fp_t(1000)));
+            REQUIRE(bbuf[3] == approximately(ta1.get_state()[1], fp_t(1000)));
+
+            tab.detach_states();
+            REQUIRE(tab.get_states() == bbuf);
+        }
+    };
+
+    tuple_for_each(fp_types, tester);
+}
+
+TEST_CASE("non-finite state")
+{
+    auto tester = [](auto fp_x) {
+        using fp_t = decltype(fp_x);
+
+        auto [x, v] = make_vars("x", "v");
+
+        const std::vector sys{prime(x) = v, prime(v) = -9.8_dbl * sin(x)};
+
+        const auto inf = std::numeric_limits<fp_t>::infinity(), nan = std::numeric_limits<fp_t>::quiet_NaN();
+
+        for (auto cm : {false, true}) {
+            for (auto ha : {false, true}) {
+                taylor_adaptive<fp_t> ta{
+                    sys, {fp_t(0.05), fp_t(0.025)}, kw::compact_mode = cm, kw::high_accuracy = ha};
+
+                ta.get_state_data()[1] = inf;
+
+                auto [oc, h] = ta.step();
+                REQUIRE(oc == taylor_outcome::err_nf_state);
+                REQUIRE(h == 0);
+                REQUIRE(ta.get_time() == 0);
+                REQUIRE(ta.get_state()[0] == fp_t(0.05));
+                REQUIRE(ta.get_state()[1] == inf);
+
+                ta.get_state_data()[1] = nan;
+                REQUIRE(std::get<0>(ta.step()) == taylor_outcome::err_nf_state);
+                REQUIRE(std::get<0>(ta.propagate_until(fp_t(1))) == taylor_outcome::err_nf_state);
+                REQUIRE(ta.get_time() == 0);
+
+                // Per-element detection in batch mode.
+                taylor_adaptive_batch<fp_t> tab{sys,
+                                                {fp_t(0.05), fp_t(0.06), fp_t(0.025), fp_t(0.026)},
+                                                2,
+                                                kw::compact_mode = cm,
+                                                kw::high_accuracy = ha};
+                tab.get_states_data()[1] = nan;
+
+                std::vector<std::tuple<taylor_outcome, fp_t>> res;
+                tab.step(res);
+
+                REQUIRE(std::get<0>(res[0]) == taylor_outcome::success);
+                REQUIRE(std::get<1>(res[0]) > 0);
+                REQUIRE(std::get<0>(res[1]) == taylor_outcome::err_nf_state);
+                REQUIRE(std::get<1>(res[1]) == 0);
+
+                REQUIRE(tab.get_times()[0] > 0);
+                REQUIRE(tab.get_times()[1] == 0);
+                REQUIRE(tab.get_states()[3] == fp_t(0.026));
+            }
+        }
+    };
+
+    tuple_for_each(fp_types, tester);
+}
+
+TEST_CASE("double-length time")
+{
+    auto tester = [](auto fp_x) {
+        using fp_t = decltype(fp_x);
+
+        auto [x, v] = make_vars("x", "v");
+
+        const std::vector sys{prime(x) = v, prime(v) = -x};
+
+        taylor_adaptive<fp_t> ta{sys, {fp_t(0), fp_t(1)}};
+        taylor_adaptive_batch<fp_t> tab{sys, {fp_t(0), fp_t(0), fp_t(1), fp_t(1)}, 2};
+
+        std::vector<std::tuple<taylor_outcome, fp_t, fp_t, std::size_t>> res;
+
+        // Accumulate many timesteps which are not
+        // exactly representable. The time must match
+        // the double-length sum of the timesteps.
+        detail::dfloat<fp_t> ref;
+        for (auto i = 0; i < 10000; ++i) {
+            REQUIRE(std::get<0>(ta.propagate_for(fp_t(0.1))) == taylor_outcome::time_limit);
+            tab.propagate_for(res, {fp_t(0.1), fp_t(0.1)});
+            REQUIRE(std::get<0>(res[0]) == taylor_outcome::time_limit);
+            REQUIRE(std::get<0>(res[1]) == taylor_outcome::time_limit);
+
+            ref = ref + detail::dfloat<fp_t>(fp_t(0.1));
+        }
+
+        REQUIRE(ta.get_dtime().first == ref.hi);
+        REQUIRE(ta.get_dtime().second == ref.lo);
+        REQUIRE(ta.get_time() == 1000);
+
+        for (auto i = 0u; i < 2u; ++i) {
+            REQUIRE(tab.get_dtimes().first[i] == ref.hi);
+            REQUIRE(tab.get_dtimes().second[i] == ref.lo);
+            REQUIRE(tab.get_times()[i] == 1000);
+        }
+
+        // Setting the time resets the low part.
+        ta.set_time(fp_t(1));
+        REQUIRE(ta.get_dtime().second == 0);
+        tab.set_times({fp_t(1), fp_t(2)});
+        REQUIRE(tab.get_dtimes().second[0] == 0);
+        REQUIRE(tab.get_dtimes().second[1] == 0);
+
+        // Setting the time in double-length format.
+        ta.set_dtime(ref.hi, ref.lo);
+        REQUIRE(ta.get_dtime().first == ref.hi);
+        REQUIRE(ta.get_dtime().second == ref.lo);
+        ta.set_dtime(fp_t(1), fp_t(2));
+        REQUIRE(ta.get_dtime().first == 3);
+        REQUIRE(ta.get_dtime().second == 0);
+        REQUIRE_THROWS_AS(ta.set_dtime(fp_t(1), std::numeric_limits<fp_t>::quiet_NaN()), std::invalid_argument);
+    };
+
+    tuple_for_each(fp_types, tester);
+}
+
+TEST_CASE("per-variable tolerances")
+{
+    auto tester = [](auto fp_x) {
+        using std::cos;
+        using std::sin;
+
+        using fp_t = decltype(fp_x);
+
+        auto [x, v, q] = make_vars("x", "v", "q");
+
+        // A harmonic oscillator with a large-scale quadrature.
+        const std::vector sys{prime(x) = v, prime(v) = -x, prime(q) = 1e6_dbl * x};
+        const std::vector init{fp_t(1), fp_t(0), fp_t(0)};
+
+        const auto eps = std::numeric_limits<fp_t>::epsilon();
+
+        // Error checking.
+        REQUIRE_THROWS_AS((taylor_adaptive<fp_t>{sys, init, kw::atol = std::vector<fp_t>{eps}}),
+                          std::invalid_argument);
+        REQUIRE_THROWS_AS((taylor_adaptive<fp_t>{sys, init, kw::atol = std::vector<fp_t>{eps, fp_t(0), eps}}),
+                          std::invalid_argument);
+        REQUIRE_THROWS_AS((taylor_adaptive<fp_t>{sys, init, kw::rtol = std::vector<fp_t>{eps, fp_t(-1), eps}}),
+                          std::invalid_argument);
+        REQUIRE_THROWS_AS((taylor_adaptive<fp_t>{sys, init, kw::tol_exclude = std::vector<std::uint32_t>{3}}),
+                          std::invalid_argument);
+        REQUIRE_THROWS_AS((taylor_adaptive<fp_t>{sys, init, kw::tol_exclude = std::vector<std::uint32_t>{0, 1, 2}}),
+                          std::invalid_argument);
+
+        // Uniform per-variable tolerances.
+        taylor_adaptive<fp_t> ta{sys, init, kw::atol = std::vector<fp_t>(3u, eps)};
+        const auto n_steps = std::get<3>(ta.propagate_until(fp_t(10)));
+        REQUIRE(ta.get_state()[0] == approximately(cos(fp_t(10)), fp_t(1000)));
+        REQUIRE(ta.get_state()[2] == approximately(fp_t(1e6) * sin(fp_t(10)), fp_t(1000)));
+
+        // Looser tolerances on the quadrature.
+        taylor_adaptive<fp_t> ta_loose{sys, init, kw::atol = std::vector<fp_t>{eps, eps, fp_t(1)},
+                                       kw::rtol = std::vector<fp_t>{eps, eps, fp_t(1e-6)}};
+        const auto n_steps_loose = std::get<3>(ta_loose.propagate_until(fp_t(10)));
+        REQUIRE(n_steps_loose < n_steps);
+        REQUIRE(ta_loose.get_state()[0] == approximately(cos(fp_t(10)), fp_t(1000)));
+
+        // Exclude the quadrature from the step-size control.
+        taylor_adaptive<fp_t> ta_excl{sys, init, kw::tol_exclude = std::vector<std::uint32_t>{2}};
+        const auto n_steps_excl = std::get<3>(ta_excl.propagate_until(fp_t(10)));
+        REQUIRE(n_steps_excl < n_steps);
+        REQUIRE(ta_excl.get_state()[0] == approximately(cos(fp_t(10)), fp_t(1000)));
+
+        // Batch mode.
+        taylor_adaptive_batch<fp_t> tab{sys,
+                                        {fp_t(1), fp_t(1), fp_t(0), fp_t(0), fp_t(0), fp_t(0)},
+                                        2,
+                                        kw::tol_exclude = std::vector<std::uint32_t>{2}};
+        std::vector<std::tuple<taylor_outcome, fp_t, fp_t, std::size_t>> res;
+        tab.propagate_until(res, {fp_t(10), fp_t(10)});
+        REQUIRE(std::get<3>(res[0]) < n_steps);
+        REQUIRE(tab.get_states()[0] == approximately(cos(fp_t(10)), fp_t(1000)));
+        REQUIRE(tab.get_states()[1] == approximately(cos(fp_t(10)), fp_t(1000)));
+    };
+
+    tuple_for_each(fp_types, tester);
+}
+
+TEST_CASE("variable order")
+{
+    auto tester = [](auto fp_x) {
+        using std::cos;
+        using std::sin;
+
+        using fp_t = decltype(fp_x);
+
+        auto [x, v] = make_vars("x", "v");
+
+        const std::vector sys{prime(x) = v, prime(v) = -x};
+
+        // Variable order requires compact mode.
+        REQUIRE_THROWS_AS((taylor_adaptive<fp_t>{sys, {fp_t(1), fp_t(0)}, kw::variable_order = true}),
+                          std::invalid_argument);
+
+        for (auto ha : {false, true}) {
+            taylor_adaptive<fp_t> ta{sys,
+                                     {fp_t(1), fp_t(0)},
+                                     kw::compact_mode = true,
+                                     kw::high_accuracy = ha,
+                                     kw::variable_order = true,
+                                     kw::dense_output = true};
+            taylor_adaptive<fp_t> ta_fixed{
+                sys, {fp_t(1), fp_t(0)}, kw::compact_mode = true, kw::high_accuracy = ha, kw::dense_output = true};
+
+            REQUIRE(ta.get_last_order() == 0u);
+
+            // A short step is taken with a lower order.
+            auto [oc, h] = ta.step(fp_t(1e-3));
+            REQUIRE(oc == taylor_outcome::time_limit);
+            REQUIRE(h == fp_t(1e-3));
+            REQUIRE(ta.get_last_order() >= 2u);
+            REQUIRE(ta.get_last_order() < ta.get_order());
+
+            ta_fixed.step(fp_t(1e-3));
+            REQUIRE(ta_fixed.get_last_order() == ta_fixed.get_order());
+            REQUIRE(ta.get_state()[0] == approximately(ta_fixed.get_state()[0], fp_t(100)));
+            REQUIRE(ta.get_state()[1] == approximately(ta_fixed.get_state()[1], fp_t(100)));
+
+            // The Taylor coefficients above the truncation order are zero.
+            for (auto o = ta.get_last_order() + 1u; o <= ta.get_order(); ++o) {
+                REQUIRE(ta.get_tc()[o] == 0);
+                REQUIRE(ta.get_tc()[ta.get_order() + 1u + o] == 0);
+            }
+
+            // Unconstrained steps use the full order.
+            ta.step();
+            REQUIRE(ta.get_last_order() == ta.get_order());
+
+            // Propagation over a grid of closely-spaced points.
+            taylor_adaptive<fp_t> ta_grid{sys, {fp_t(1), fp_t(0)}, kw::compact_mode = true, kw::high_accuracy = ha,
+                                          kw::variable_order = true};
+            for (auto i = 1; i <= 1000; ++i) {
+                REQUIRE(std::get<0>(ta_grid.propagate_until(fp_t(i) / 1000)) == taylor_outcome::time_limit);
+                REQUIRE(ta_grid.get_last_order() < ta_grid.get_order());
+            }
+            REQUIRE(ta_grid.get_state()[0] == approximately(cos(fp_t(1)), fp_t(1000)));
+            REQUIRE(ta_grid.get_state()[1] == approximately(-sin(fp_t(1)), fp_t(1000)));
+
+            // Batch mode.
+            taylor_adaptive_batch<fp_t> tab{sys,
+                                            {fp_t(1), fp_t(1), fp_t(0), fp_t(0)},
+                                            2,
+                                            kw::compact_mode = true,
+                                            kw::high_accuracy = ha,
+                                            kw::variable_order = true};
+
+            std::vector<std::tuple<taylor_outcome, fp_t>> res;
+            tab.step(res, {fp_t(1e-3), fp_t(-1e-3)});
+            REQUIRE(std::get<0>(res[0]) == taylor_outcome::time_limit);
+            REQUIRE(std::get<0>(res[1]) == taylor_outcome::time_limit);
+            REQUIRE(tab.get_last_order() < tab.get_order());
+            REQUIRE(tab.get_states()[0] == approximately(cos(fp_t(1e-3)), fp_t(100)));
+            REQUIRE(tab.get_states()[1] == approximately(cos(fp_t(1e-3)), fp_t(100)));
+            REQUIRE(tab.get_states()[2] == approximately(-sin(fp_t(1e-3)), fp_t(100)));
+            REQUIRE(tab.get_states()[3] == approximately(sin(fp_t(1e-3)), fp_t(100)));
+
+            // The full order is used if any batch element needs it.
+            tab.step(res, {fp_t(1e-3), fp_t(10)});
+            REQUIRE(tab.get_last_order() == tab.get_order());
+        }
+    };
+
+    tuple_for_each(fp_types, tester);
+}
+
+TEST_CASE("per-lane tolerances")
+{
+    auto tester = [](auto fp_x) {
+        using std::abs;
+        using std::cos;
+
+        using fp_t = decltype(fp_x);
+
+        auto [x, v] = make_vars("x", "v");
+
+        const std::vector sys{prime(x) = v, prime(v) = -x};
+
+        const std::vector init_states{fp_t(1), fp_t(1), fp_t(0), fp_t(0)};
+
+        // Invalid per-lane tolerances.
+        REQUIRE_THROWS_AS((taylor_adaptive_batch<fp_t>{sys, init_states, 2, kw::lane_tols = std::vector{fp_t(1e-4)}}),
+                          std::invalid_argument);
+        REQUIRE_THROWS_AS(
+            (taylor_adaptive_batch<fp_t>{sys, init_states, 2, kw::lane_tols = std::vector{fp_t(1e-4), fp_t(0)}}),
+            std::invalid_argument);
+        REQUIRE_THROWS_AS((taylor_adaptive_batch<fp_t>{sys, init_states, 2,
+                                                       kw::lane_tols = std::vector{fp_t(1e-4), fp_t(1e-8)},
+                                                       kw::atol = std::vector{fp_t(1e-4), fp_t(1e-4)}}),
+                          std::invalid_argument);
+
+        for (auto cm : {false, true}) {
+            for (auto ha : {false, true}) {
+                const auto eps = std::numeric_limits<fp_t>::epsilon();
+
+                // A coarse and a fine batch element.
+                taylor_adaptive_batch<fp_t> tab{sys,
+                                                init_states,
+                                                2,
+                                                kw::compact_mode = cm,
+                                                kw::high_accuracy = ha,
+                                                kw::dense_output = true,
+                                                kw::lane_tols = std::vector{fp_t(1e-4), eps}};
+
+                taylor_adaptive<fp_t> ta_coarse{
+                    sys, {fp_t(1), fp_t(0)}, kw::compact_mode = cm, kw::high_accuracy = ha, kw::tol = fp_t(1e-4)};
+                taylor_adaptive<fp_t> ta_fine{
+                    sys, {fp_t(1), fp_t(0)}, kw::compact_mode = cm, kw::high_accuracy = ha, kw::tol = eps};
+
+                REQUIRE(tab.get_lane_tols() == std::vector{fp_t(1e-4), eps});
+                REQUIRE(tab.get_lane_orders() == std::vector{ta_coarse.get_order(), ta_fine.get_order()});
+                REQUIRE(tab.get_order() == ta_fine.get_order());
+
+                // Each batch element behaves as a scalar integrator
+                // with the corresponding tolerance.
+                std::vector<std::tuple<taylor_outcome, fp_t>> res;
+                tab.step(res);
+                const auto h_coarse = std::get<1>(ta_coarse.step());
+                const auto h_fine = std::get<1>(ta_fine.step());
+
+                REQUIRE(std::get<1>(res[0]) == approximately(h_coarse, fp_t(100)));
+                REQUIRE(std::get<1>(res[1]) == approximately(h_fine, fp_t(100)));
+                REQUIRE(h_coarse < h_fine);
+                REQUIRE(tab.get_states()[0] == approximately(ta_coarse.get_state()[0], fp_t(100)));
+                REQUIRE(tab.get_states()[1] == approximately(ta_fine.get_state()[0], fp_t(100)));
+                REQUIRE(tab.get_states()[2] == approximately(ta_coarse.get_state()[1], fp_t(100)));
+                REQUIRE(tab.get_states()[3] == approximately(ta_fine.get_state()[1], fp_t(100)));
+
+                // The Taylor series of the coarse batch element
+                // are truncated at its order.
+                const auto order = tab.get_order();
+                for (std::uint32_t o = tab.get_lane_orders()[0] + 1u; o <= order; ++o) {
+                    REQUIRE(tab.get_tc()[o * 2u] == 0);
+                    REQUIRE(tab.get_tc()[((order + 1u) + o) * 2u] == 0);
+                }
+
+                // Propagation.
+                std::vector<std::tuple<taylor_outcome, fp_t, fp_t, std::size_t>> p_res;
+                tab.set_times({fp_t(0), fp_t(0)});
+                tab.set_states(init_states);
+                tab.propagate_until(p_res, {fp_t(10), fp_t(10)});
+                REQUIRE(std::get<0>(p_res[0]) == taylor_outcome::time_limit);
+                REQUIRE(std::get<0>(p_res[1]) == taylor_outcome::time_limit);
+                REQUIRE(abs(tab.get_states()[0] - cos(fp_t(10))) < fp_t(1e-2));
+                REQUIRE(tab.get_states()[1] == approximately(cos(fp_t(10)), fp_t(1000)));
+            }
+        }
+    };
+
+    tuple_for_each(fp_types, tester);
+}
+
+TEST_CASE("lane setters")
+{
+    auto tester = [](auto fp_x) {
+        using fp_t = decltype(fp_x);
+
+        auto [x, v] = make_vars("x", "v");
+
+        taylor_adaptive_batch<fp_t> tab{{prime(x) = v, prime(v) = -x}, {fp_t(1), fp_t(2), fp_t(3), fp_t(4)}, 2};
+
+        tab.set_lane_state(1, {fp_t(5), fp_t(6)});
+        REQUIRE(tab.get_states() == std::vector{fp_t(1), fp_t(5), fp_t(3), fp_t(6)});
+
+        tab.set_lane_time(0, fp_t(7));
+        REQUIRE(tab.get_times() == std::vector{fp_t(7), fp_t(0)});
+
+        REQUIRE_THROWS_AS(tab.set_lane_state(2, {fp_t(5), fp_t(6)}), std::invalid_argument);
+        REQUIRE_THROWS_AS(tab.set_lane_state(0, {fp_t(5)}), std::invalid_argument);
+        REQUIRE_THROWS_AS(tab.set_lane_state(0, {fp_t(5), std::numeric_limits<fp_t>::infinity()}),
+                          std::invalid_argument);
+        REQUIRE_THROWS_AS(tab.set_lane_time(2, fp_t(0)), std::invalid_argument);
+        REQUIRE_THROWS_AS(tab.set_lane_time(0, std::numeric_limits<fp_t>::quiet_NaN()), std::invalid_argument);
+
+        // The other batch elements are left untouched.
+        REQUIRE(tab.get_states() == std::vector{fp_t(1), fp_t(5), fp_t(3), fp_t(6)});
+        REQUIRE(tab.get_times() == std::vector{fp_t(7), fp_t(0)});
+
+        // Double-length lane time.
+        const auto eps = std::numeric_limits<fp_t>::epsilon();
+        tab.set_lane_dtime(1, fp_t(8), eps);
+        REQUIRE(tab.get_dtimes().first == std::vector{fp_t(7), fp_t(8)});
+        REQUIRE(tab.get_dtimes().second == std::vector{fp_t(0), eps});
+        REQUIRE_THROWS_AS(tab.set_lane_dtime(2, fp_t(0), fp_t(0)), std::invalid_argument);
+        REQUIRE_THROWS_AS(tab.set_lane_dtime(0, fp_t(0), std::numeric_limits<fp_t>::infinity()),
+                          std::invalid_argument);
+    };
+
+    tuple_for_each(fp_types, tester);
+}
+
+TEST_CASE("aos layout")
+{
+    auto tester = [](auto fp_x) {
+        using fp_t = decltype(fp_x);
+
+        auto [x, v] = make_vars("x", "v");
+
+        const std::vector sys{prime(x) = v, prime(v) = -par[0] * x};
+
+        for (auto cm : {false, true}) {
+            REQUIRE_THROWS_AS((taylor_adaptive_batch<fp_t>{sys,
+                                                           {fp_t(1), fp_t(0.5), fp_t(0), fp_t(0.1)},
+                                                           2,
+                                                           kw::compact_mode = cm,
+                                                           kw::layout = static_cast<taylor_layout>(42)}),
+                              std::invalid_argument);
+
+            // NOTE: the parameters are laid out as [par_idx][batch_idx]
+            // in both layouts.
+            taylor_adaptive_batch<fp_t> tab_soa{sys,
+                                                {fp_t(1), fp_t(0.5), fp_t(0), fp_t(0.1)},
+                                                2,
+                                                kw::compact_mode = cm,
+                                                kw::dense_output = true,
+                                                kw::pars = std::vector<fp_t>{fp_t(1), fp_t(4)}};
+            taylor_adaptive_batch<fp_t> tab_aos{sys,
+                                                {fp_t(1), fp_t(0), fp_t(0.5), fp_t(0.1)},
+                                                2,
+                                                kw::compact_mode = cm,
+                                                kw::dense_output = true,
+                                                kw::pars = std::vector<fp_t>{fp_t(1), fp_t(4)},
+                                                kw::layout = taylor_layout::aos};
+
+            REQUIRE(tab_soa.get_layout() == taylor_layout::soa);
+            REQUIRE(tab_aos.get_layout() == taylor_layout::aos);
+
+            // Check that the aos buffer is the
+            // transpose of the soa buffer.
+            auto check_transpose = [](const std::vector<fp_t> &soa, const std::vector<fp_t> &aos) {
+                REQUIRE(soa.size() == aos.size());
+
+                for (std::size_t i = 0; i < 2u; ++i) {
+                    for (std::size_t j = 0; j < 2u; ++j) {
+                        REQUIRE(aos[j * 2u + i] == approximately(soa[i * 2u + j]));
+                    }
+                }
+            };
+
+            std::vector<std::tuple<taylor_outcome, fp_t>> res_soa, res_aos;
+            for (auto i = 0; i < 5; ++i) {
+                tab_soa.step(res_soa);
+                tab_aos.step(res_aos);
+
+                for (std::size_t j = 0; j < 2u; ++j) {
+                    REQUIRE(std::get<0>(res_aos[j]) == std::get<0>(res_soa[j]));
+                    REQUIRE(std::get<1>(res_aos[j]) == approximately(std::get<1>(res_soa[j])));
+                }
+
+                check_transpose(tab_soa.get_states(), tab_aos.get_states());
+            }
+
+            // The Taylor coefficients are laid out as
+            // [var_idx][order][batch_idx] in both layouts.
+            REQUIRE(tab_aos.get_tc().size() == tab_soa.get_tc().size());
+
+            // Dense output.
+            const std::vector t_d{tab_soa.get_times()[0] - std::get<1>(res_soa[0]) / 2,
+                                  tab_soa.get_times()[1] - std::get<1>(res_soa[1]) / 2};
+            check_transpose(tab_soa.update_d_output(t_d), tab_aos.update_d_output(t_d));
+
+            // Setting the state of a batch element.
+            tab_soa.set_lane_state(1, {fp_t(2), fp_t(3)});
+            tab_aos.set_lane_state(1, {fp_t(2), fp_t(3)});
+            REQUIRE(tab_aos.get_states()[2] == 2);
+            REQUIRE(tab_aos.get_states()[3] == 3);
+            check_transpose(tab_soa.get_states(), tab_aos.get_states());
+
+            // Grid propagation.
+            std::vector<std::tuple<taylor_outcome, fp_t, fp_t, std::size_t>> pres;
+            const std::vector grid{tab_soa.get_times()[0],          tab_soa.get_times()[1],
+                                   tab_soa.get_times()[0] + fp_t(1), tab_soa.get_times()[1] + fp_t(1)};
+            const auto out_soa = tab_soa.propagate_grid(pres, grid);
+            const auto out_aos = tab_aos.propagate_grid(pres, grid);
+            REQUIRE(out_soa.size() == 8u);
+            check_transpose({out_soa.begin(), out_soa.begin() + 4}, {out_aos.begin(), out_aos.begin() + 4});
+            check_transpose({out_soa.begin() + 4, out_soa.end()}, {out_aos.begin() + 4, out_aos.end()});
+        }
+    };
+
+    tuple_for_each(fp_types, tester);
+}
+
+TEST_CASE("checkpoint")
+{
+    auto tester = [](auto fp_x) {
+        using fp_t = decltype(fp_x);
+
+        auto [x, v] = make_vars("x", "v");
+
+        const std::vector sys{prime(x) = v, prime(v) = -par[0] * sin(x)};
+
+        for (auto cm : {false, true}) {
+            // The object code is not available.
+            {
+                taylor_adaptive<fp_t> ta{sys, {fp_t(0.05), fp_t(0.025)}, kw::compact_mode = cm};
+
+                std::stringstream ss;
+                REQUIRE_THROWS_AS(ta.save(ss), std::invalid_argument);
+                REQUIRE(ss.str().empty());
+            }
+
+            // Events are not supported.
+            {
+                taylor_adaptive<fp_t> ta{sys,
+                                         {fp_t(0.05), fp_t(0.025)},
+                                         kw::compact_mode = cm,
+                                         kw::save_object_code = true,
+                                         kw::t_events = std::vector{t_event<fp_t>(v)}};
+
+                std::stringstream ss;
+                REQUIRE_THROWS_AS(ta.save(ss), std::invalid_argument);
+            }
+
+            taylor_adaptive<fp_t> ta{sys,
+                                     {fp_t(0.05), fp_t(0.025)},
+                                     kw::compact_mode = cm,
+                                     kw::save_object_code = true,
+                                     kw::dense_output = true,
+                                     kw::tol = fp_t(1E-9),
+                                     kw::opt_level = 2u,
+                                     kw::fast_math = false,
+                                     kw::pars = std::vector<fp_t>{fp_t(2)}};
+
+            for (auto i = 0; i < 10; ++i) {
+                ta.step();
+            }
+
+            std::stringstream ss;
+            ta.save(ss);
+
+            taylor_adaptive<fp_t> ta_r{ss};
+
+            REQUIRE(ta_r.get_state() == ta.get_state());
+            REQUIRE(ta_r.get_dtime() == ta.get_dtime());
+            REQUIRE(ta_r.get_tol() == fp_t(1E-9));
+            REQUIRE(ta_r.get_order() == ta.get_order());
+            REQUIRE(ta_r.get_pars() == ta.get_pars());
+            REQUIRE(ta_r.get_tc() == ta.get_tc());
+            REQUIRE(ta_r.get_decomposition() == ta.get_decomposition());
+            REQUIRE(ta_r.get_compile_report().cached);
+
+            // The compile report and the settings of the
+            // llvm_state are those of the original integrator.
+            REQUIRE(ta_r.get_compile_report().n_uvars == ta.get_compile_report().n_uvars);
+            REQUIRE(ta_r.get_compile_report().ir_time == ta.get_compile_report().ir_time);
+            REQUIRE(ta_r.get_compile_report().llvm.obj_size == ta.get_compile_report().llvm.obj_size);
+            REQUIRE(ta_r.get_llvm_state().opt_level() == 2u);
+            REQUIRE(!ta_r.get_llvm_state().fast_math());
+            REQUIRE(ta_r.get_llvm_state().target_cpu() == ta.get_llvm_state().target_cpu());
+
+            // The restored integrator continues
+            // exactly like the original one.
+            for (auto i = 0; i < 10; ++i) {
+                REQUIRE(ta_r.step() == ta.step());
+            }
+            REQUIRE(ta_r.get_state() == ta.get_state());
+            REQUIRE(ta_r.get_dtime() == ta.get_dtime());
+
+            // A restored integrator can be checkpointed as well.
+            std::stringstream ss2;
+            ta_r.save(ss2);
+            taylor_adaptive<fp_t> ta_r2{ss2};
+            REQUIRE(ta_r2.get_state() == ta.get_state());
+
+            // Invalid checkpoints.
+            std::stringstream ss_trunc(ss2.str().substr(0, ss2.str().size() / 2u));
+            REQUIRE_THROWS_AS(taylor_adaptive<fp_t>{ss_trunc}, std::invalid_argument);
+
+            std::stringstream ss_bad("not a checkpoint");
+            REQUIRE_THROWS_AS(taylor_adaptive<fp_t>{ss_bad}, std::invalid_argument);
+
+            std::stringstream ss_batch(ss2.str());
+            REQUIRE_THROWS_AS(taylor_adaptive_batch<fp_t>{ss_batch}, std::invalid_argument);
+
+            // Checkpoints written for a different target.
+            // NOTE: the description of the target is stored
+            // in the header, before the object code.
+            auto alter_str = [&ss2](const std::string &orig, std::string::size_type from) {
+                auto str = ss2.str();
+                const auto pos = str.find(orig, from);
+                REQUIRE(pos != std::string::npos);
+                str[pos] = str[pos] == 'x' ? 'y' : 'x';
+                return std::pair{str, pos};
+            };
+
+            const auto &s_r = ta_r.get_llvm_state();
+            const auto [str_triple, pos_triple] = alter_str(s_r.target_triple(), 0);
+            std::stringstream ss_triple(str_triple);
+            REQUIRE_THROWS_AS(taylor_adaptive<fp_t>{ss_triple}, std::invalid_argument);
+
+            if (!s_r.target_cpu().empty()) {
+                std::stringstream ss_cpu(
+                    alter_str(s_r.target_cpu(), pos_triple + s_r.target_triple().size()).first);
+                REQUIRE_THROWS_AS(taylor_adaptive<fp_t>{ss_cpu}, std::invalid_argument);
+            }
+
+            // Batch mode.
+            taylor_adaptive_batch<fp_t> tab{sys,
+                                            {fp_t(0.05), fp_t(0.06), fp_t(0.025), fp_t(0.026)},
+                                            2,
+                                            kw::compact_mode = cm,
+                                            kw::save_object_code = true,
+                                            kw::layout = taylor_layout::aos,
+                                            kw::pars = std::vector<fp_t>{fp_t(2), fp_t(3)}};
+
+            std::vector<std::tuple<taylor_outcome, fp_t>> res, res_r;
+            for (auto i = 0; i < 10; ++i) {
+                tab.step(res);
+            }
+
+            std::stringstream ss_b;
+            tab.save(ss_b);
+
+            taylor_adaptive_batch<fp_t> tab_r{ss_b};
+
+            REQUIRE(tab_r.get_batch_size() == 2u);
+            REQUIRE(tab_r.get_layout() == taylor_layout::aos);
+            REQUIRE(tab_r.get_states() == tab.get_states());
+            REQUIRE(tab_r.get_dtimes() == tab.get_dtimes());
+            REQUIRE(tab_r.get_pars() == tab.get_pars());
+            REQUIRE(tab_r.get_decomposition() == tab.get_decomposition());
+
+            for (auto i = 0; i < 10; ++i) {
+                tab.step(res);
+                tab_r.step(res_r);
+                REQUIRE(res_r == res);
+            }
+            REQUIRE(tab_r.get_states() == tab.get_states());
+            REQUIRE(tab_r.get_dtimes() == tab.get_dtimes());
+        }
+    };
+
+    tuple_for_each(fp_types, tester);
+}
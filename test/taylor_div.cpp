@@ -52,8 +52,8 @@ void compare_batch_scalar(std::initializer_list<U> sys, unsigned opt_level, bool
 
     s.compile();
 
-    auto jptr_batch = reinterpret_cast<void (*)(T *)>(s.jit_lookup("jet_batch"));
-    auto jptr_scalar = reinterpret_cast<void (*)(T *)>(s.jit_lookup("jet_scalar"));
+    auto jptr_batch = reinterpret_cast<void (*)(T *, const T *)>(s.jit_lookup("jet_batch"));
+    auto jptr_scalar = reinterpret_cast<void (*)(T *, const T *)>(s.jit_lookup("jet_scalar"));
 
     std::vector<T> jet_batch;
     jet_batch.resize(8 * batch_size);
@@ -63,7 +63,7 @@ void compare_batch_scalar(std::initializer_list<U> sys, unsigned opt_level, bool
     std::vector<T> jet_scalar;
     jet_scalar.resize(8);
 
-    jptr_batch(jet_batch.data());
+    jptr_batch(jet_batch.data(), nullptr);
 
     for (auto batch_idx = 0u; batch_idx < batch_size; ++batch_idx) {
         // Assign the initial values of x and y.
@@ -71,7 +71,7 @@ void compare_batch_scalar(std::initializer_list<U> sys, unsigned opt_level, bool
             jet_scalar[i] = jet_batch[i * batch_size + batch_idx];
         }
 
-        jptr_scalar(jet_scalar.data());
+        jptr_scalar(jet_scalar.data(), nullptr);
 
         for (auto i = 2u; i < 8u; ++i) {
             REQUIRE(jet_scalar[i] == approximately(jet_batch[i * batch_size + batch_idx], T(1e3)));
@@ -98,12 +98,12 @@ TEST_CASE("taylor div")
 
             s.compile();
 
-            auto jptr = reinterpret_cast<void (*)(fp_t *)>(s.jit_lookup("jet"));
+            auto jptr = reinterpret_cast<void (*)(fp_t *, const fp_t *)>(s.jit_lookup("jet"));
 
             std::vector<fp_t> jet{fp_t{2}, fp_t{3}};
             jet.resize(4);
 
-            jptr(jet.data());
+            jptr(jet.data(), nullptr);
 
             REQUIRE(jet[0] == 2);
             REQUIRE(jet[1] == 3);
@@ -120,12 +120,12 @@ TEST_CASE("taylor div")
 
             s.compile();
 
-            auto jptr = reinterpret_cast<void (*)(fp_t *)>(s.jit_lookup("jet"));
+            auto jptr = reinterpret_cast<void (*)(fp_t *, const fp_t *)>(s.jit_lookup("jet"));
 
             std::vector<fp_t> jet{fp_t{2}, fp_t{3}};
             jet.resize(6);
 
-            jptr(jet.data());
+            jptr(jet.data(), nullptr);
 
             REQUIRE(jet[0] == 2);
             REQUIRE(jet[1] == 3);
@@ -144,12 +144,12 @@ TEST_CASE("taylor div")
 
             s.compile();
 
-            auto jptr = reinterpret_cast<void (*)(fp_t *)>(s.jit_lookup("jet"));
+            auto jptr = reinterpret_cast<void (*)(fp_t *, const fp_t *)>(s.jit_lookup("jet"));
 
             std::vector<fp_t> jet{fp_t{2}, fp_t{-1}, fp_t{3}, fp_t{5}};
             jet.resize(8);
 
-            jptr(jet.data());
+            jptr(jet.data(), nullptr);
 
             REQUIRE(jet[0] == 2);
             REQUIRE(jet[1] == -1);
@@ -173,12 +173,12 @@ TEST_CASE("taylor div")
 
             s.compile();
 
-            auto jptr = reinterpret_cast<void (*)(fp_t *)>(s.jit_lookup("jet"));
+            auto jptr = reinterpret_cast<void (*)(fp_t *, const fp_t *)>(s.jit_lookup("jet"));
 
             std::vector<fp_t> jet{fp_t{2}, fp_t{-1}, fp_t{3}, fp_t{5}};
             jet.resize(12);
 
-            jptr(jet.data());
+            jptr(jet.data(), nullptr);
 
             REQUIRE(jet[0] == 2);
             REQUIRE(jet[1] == -1);
@@ -208,12 +208,12 @@ TEST_CASE("taylor div")
 
             s.compile();
 
-            auto jptr = reinterpret_cast<void (*)(fp_t *)>(s.jit_lookup("jet"));
+            auto jptr = reinterpret_cast<void (*)(fp_t *, const fp_t *)>(s.jit_lookup("jet"));
 
             std::vector<fp_t> jet{fp_t{2}, fp_t{1}, fp_t{-6}, fp_t{3}, fp_t{-4}, fp_t{2}};
             jet.resize(24);
 
-            jptr(jet.data());
+            jptr(jet.data(), nullptr);
 
             REQUIRE(jet[0] == 2);
             REQUIRE(jet[1] == 1);
@@ -260,12 +260,12 @@ TEST_CASE("taylor div")
 
             s.compile();
 
-            auto jptr = reinterpret_cast<void (*)(fp_t *)>(s.jit_lookup("jet"));
+            auto jptr = reinterpret_cast<void (*)(fp_t *, const fp_t *)>(s.jit_lookup("jet"));
 
             std::vector<fp_t> jet{fp_t{2}, fp_t{3}};
             jet.resize(4);
 
-            jptr(jet.data());
+            jptr(jet.data(), nullptr);
 
             REQUIRE(jet[0] == 2);
             REQUIRE(jet[1] == 3);
@@ -280,12 +280,12 @@ TEST_CASE("taylor div")
 
             s.compile();
 
-            auto jptr = reinterpret_cast<void (*)(fp_t *)>(s.jit_lookup("jet"));
+            auto jptr = reinterpret_cast<void (*)(fp_t *, const fp_t *)>(s.jit_lookup("jet"));
 
             std::vector<fp_t> jet{fp_t{2}, fp_t{3}};
             jet.resize(6);
 
-            jptr(jet.data());
+            jptr(jet.data(), nullptr);
 
             REQUIRE(jet[0] == 2);
             REQUIRE(jet[1] == 3);
@@ -302,12 +302,12 @@ TEST_CASE("taylor div")
 
             s.compile();
 
-            auto jptr = reinterpret_cast<void (*)(fp_t *)>(s.jit_lookup("jet"));
+            auto jptr = reinterpret_cast<void (*)(fp_t *, const fp_t *)>(s.jit_lookup("jet"));
 
             std::vector<fp_t> jet{fp_t{2}, fp_t{1}, fp_t{3}, fp_t{-4}};
             jet.resize(8);
 
-            jptr(jet.data());
+            jptr(jet.data(), nullptr);
 
             REQUIRE(jet[0] == 2);
             REQUIRE(jet[1] == 1);
@@ -329,12 +329,12 @@ TEST_CASE("taylor div")
 
             s.compile();
 
-            auto jptr = reinterpret_cast<void (*)(fp_t *)>(s.jit_lookup("jet"));
+            auto jptr = reinterpret_cast<void (*)(fp_t *, const fp_t *)>(s.jit_lookup("jet"));
 
             std::vector<fp_t> jet{fp_t{2}, fp_t{1}, fp_t{3}, fp_t{-4}};
             jet.resize(12);
 
-            jptr(jet.data());
+            jptr(jet.data(), nullptr);
 
             REQUIRE(jet[0] == 2);
 
@@ -356,12 +356,12 @@ TEST_CASE("taylor div")
 
             s.compile();
 
-            auto jptr = reinterpret_cast<void (*)(fp_t *)>(s.jit_lookup("jet"));
+            auto jptr = reinterpret_cast<void (*)(fp_t *, const fp_t *)>(s.jit_lookup("jet"));
 
             std::vector<fp_t> jet{fp_t{2}, fp_t{1}, fp_t{-5}, fp_t{3}, fp_t{-4}, fp_t{2}};
             jet.resize(24);
 
-            jptr(jet.data());
+            jptr(jet.data(), nullptr);
 
             REQUIRE(jet[0] == 2);
             REQUIRE(jet[1] == 1);
@@ -406,12 +406,12 @@ TEST_CASE("taylor div")
 
             s.compile();
 
-            auto jptr = reinterpret_cast<void (*)(fp_t *)>(s.jit_lookup("jet"));
+            auto jptr = reinterpret_cast<void (*)(fp_t *, const fp_t *)>(s.jit_lookup("jet"));
 
             std::vector<fp_t> jet{fp_t{2}, fp_t{3}};
             jet.resize(4);
 
-            jptr(jet.data());
+            jptr(jet.data(), nullptr);
 
             REQUIRE(jet[0] == 2);
             REQUIRE(jet[1] == 3);
@@ -426,12 +426,12 @@ TEST_CASE("taylor div")
 
             s.compile();
 
-            auto jptr = reinterpret_cast<void (*)(fp_t *)>(s.jit_lookup("jet"));
+            auto jptr = reinterpret_cast<void (*)(fp_t *, const fp_t *)>(s.jit_lookup("jet"));
 
             std::vector<fp_t> jet{fp_t{2}, fp_t{3}};
             jet.resize(6);
 
-            jptr(jet.data());
+            jptr(jet.data(), nullptr);
 
             REQUIRE(jet[0] == 2);
             REQUIRE(jet[1] == 3);
@@ -448,12 +448,12 @@ TEST_CASE("taylor div")
 
             s.compile();
 
-            auto jptr = reinterpret_cast<void (*)(fp_t *)>(s.jit_lookup("jet"));
+            auto jptr = reinterpret_cast<void (*)(fp_t *, const fp_t *)>(s.jit_lookup("jet"));
 
             std::vector<fp_t> jet{fp_t{2}, fp_t{-4}, fp_t{3}, fp_t{5}};
             jet.resize(8);
 
-            jptr(jet.data());
+            jptr(jet.data(), nullptr);
 
             REQUIRE(jet[0] == 2);
             REQUIRE(jet[1] == -4);
@@ -475,12 +475,12 @@ TEST_CASE("taylor div")
 
             s.compile();
 
-            auto jptr = reinterpret_cast<void (*)(fp_t *)>(s.jit_lookup("jet"));
+            auto jptr = reinterpret_cast<void (*)(fp_t *, const fp_t *)>(s.jit_lookup("jet"));
 
             std::vector<fp_t> jet{fp_t{2}, fp_t{-4}, fp_t{3}, fp_t{5}};
             jet.resize(12);
 
-            jptr(jet.data());
+            jptr(jet.data(), nullptr);
 
             REQUIRE(jet[0] == 2);
             REQUIRE(jet[1] == -4);
@@ -508,12 +508,12 @@ TEST_CASE("taylor div")
 
             s.compile();
 
-            auto jptr = reinterpret_cast<void (*)(fp_t *)>(s.jit_lookup("jet"));
+            auto jptr = reinterpret_cast<void (*)(fp_t *, const fp_t *)>(s.jit_lookup("jet"));
 
             std::vector<fp_t> jet{fp_t{2}, fp_t{-4}, fp_t{1}, fp_t{3}, fp_t{5}, fp_t{-2}};
             jet.resize(24);
 
-            jptr(jet.data());
+            jptr(jet.data(), nullptr);
 
             REQUIRE(jet[0] == 2);
             REQUIRE(jet[1] == -4);
@@ -566,12 +566,12 @@ TEST_CASE("taylor div")
 
             s.compile();
 
-            auto jptr = reinterpret_cast<void (*)(fp_t *)>(s.jit_lookup("jet"));
+            auto jptr = reinterpret_cast<void (*)(fp_t *, const fp_t *)>(s.jit_lookup("jet"));
 
             std::vector<fp_t> jet{fp_t{2}, fp_t{3}};
             jet.resize(4);
 
-            jptr(jet.data());
+            jptr(jet.data(), nullptr);
 
             REQUIRE(jet[0] == 2);
             REQUIRE(jet[1] == 3);
@@ -586,12 +586,12 @@ TEST_CASE("taylor div")
 
             s.compile();
 
-            auto jptr = reinterpret_cast<void (*)(fp_t *)>(s.jit_lookup("jet"));
+            auto jptr = reinterpret_cast<void (*)(fp_t *, const fp_t *)>(s.jit_lookup("jet"));
 
             std::vector<fp_t> jet{fp_t{2}, fp_t{3}};
             jet.resize(6);
 
-            jptr(jet.data());
+            jptr(jet.data(), nullptr);
 
             REQUIRE(jet[0] == 2);
             REQUIRE(jet[1] == 3);
@@ -608,12 +608,12 @@ TEST_CASE("taylor div")
 
             s.compile();
 
-            auto jptr = reinterpret_cast<void (*)(fp_t *)>(s.jit_lookup("jet"));
+            auto jptr = reinterpret_cast<void (*)(fp_t *, const fp_t *)>(s.jit_lookup("jet"));
 
             std::vector<fp_t> jet{fp_t{2}, fp_t{-5}, fp_t{3}, fp_t{4}};
             jet.resize(8);
 
-            jptr(jet.data());
+            jptr(jet.data(), nullptr);
 
             REQUIRE(jet[0] == 2);
             REQUIRE(jet[1] == -5);
@@ -635,12 +635,12 @@ TEST_CASE("taylor div")
 
             s.compile();
 
-            auto jptr = reinterpret_cast<void (*)(fp_t *)>(s.jit_lookup("jet"));
+            auto jptr = reinterpret_cast<void (*)(fp_t *, const fp_t *)>(s.jit_lookup("jet"));
 
             std::vector<fp_t> jet{fp_t{2}, fp_t{-5}, fp_t{3}, fp_t{4}};
             jet.resize(12);
 
-            jptr(jet.data());
+            jptr(jet.data(), nullptr);
 
             REQUIRE(jet[0] == 2);
             REQUIRE(jet[1] == -5);
@@ -668,12 +668,12 @@ TEST_CASE("taylor div")
 
             s.compile();
 
-            auto jptr = reinterpret_cast<void (*)(fp_t *)>(s.jit_lookup("jet"));
+            auto jptr = reinterpret_cast<void (*)(fp_t *, const fp_t *)>(s.jit_lookup("jet"));
 
             std::vector<fp_t> jet{fp_t{2}, fp_t{-5}, fp_t{1}, fp_t{3}, fp_t{4}, fp_t{-2}};
             jet.resize(24);
 
-            jptr(jet.data());
+            jptr(jet.data(), nullptr);
 
             REQUIRE(jet[0] == 2);
             REQUIRE(jet[1] == -5);
@@ -52,8 +52,8 @@ void compare_batch_scalar(std::initializer_list<U> sys, unsigned opt_level, bool
 
         s.compile();
 
-        auto jptr_batch = reinterpret_cast<void (*)(T *)>(s.jit_lookup("jet_batch"));
-        auto jptr_scalar = reinterpret_cast<void (*)(T *)>(s.jit_lookup("jet_scalar"));
+        auto jptr_batch = reinterpret_cast<void (*)(T *, const T *)>(s.jit_lookup("jet_batch"));
+        auto jptr_scalar = reinterpret_cast<void (*)(T *, const T *)>(s.jit_lookup("jet_scalar"));
 
         std::vector<T> jet_batch;
         jet_batch.resize(8 * batch_size);
@@ -63,7 +63,7 @@ void compare_batch_scalar(std::initializer_list<U> sys, unsigned opt_level, bool
         std::vector<T> jet_scalar;
         jet_scalar.resize(8);
 
-        jptr_batch(jet_batch.data());
+        jptr_batch(jet_batch.data(), nullptr);
 
         for (auto batch_idx = 0u; batch_idx < batch_size; ++batch_idx) {
             // Assign the initial values of x and y.
@@ -71,7 +71,7 @@ void compare_batch_scalar(std::initializer_list<U> sys, unsigned opt_level, bool
                 jet_scalar[i] = jet_batch[i * batch_size + batch_idx];
             }
 
-            jptr_scalar(jet_scalar.data());
+            jptr_scalar(jet_scalar.data(), nullptr);
 
             for (auto i = 2u; i < 8u; ++i) {
                 REQUIRE(jet_scalar[i] == approximately(jet_batch[i * batch_size + batch_idx]));
@@ -100,12 +100,12 @@ TEST_CASE("taylor exp")
 
             s.compile();
 
-            auto jptr = reinterpret_cast<void (*)(fp_t *)>(s.jit_lookup("jet"));
+            auto jptr = reinterpret_cast<void (*)(fp_t *, const fp_t *)>(s.jit_lookup("jet"));
 
             std::vector<fp_t> jet{fp_t{2}, fp_t{3}};
             jet.resize(4);
 
-            jptr(jet.data());
+            jptr(jet.data(), nullptr);
 
             REQUIRE(jet[0] == 2);
             REQUIRE(jet[1] == 3);
@@ -121,12 +121,12 @@ TEST_CASE("taylor exp")
 
             s.compile();
 
-            auto jptr = reinterpret_cast<void (*)(fp_t *)>(s.jit_lookup("jet"));
+            auto jptr = reinterpret_cast<void (*)(fp_t *, const fp_t *)>(s.jit_lookup("jet"));
 
             std::vector<fp_t> jet{fp_t{2}, fp_t{-2}, fp_t{3}, fp_t{-3}};
             jet.resize(8);
 
-            jptr(jet.data());
+            jptr(jet.data(), nullptr);
 
             REQUIRE(jet[0] == 2);
             REQUIRE(jet[1] == -2);
@@ -149,12 +149,12 @@ TEST_CASE("taylor exp")
 
             s.compile();
 
-            auto jptr = reinterpret_cast<void (*)(fp_t *)>(s.jit_lookup("jet"));
+            auto jptr = reinterpret_cast<void (*)(fp_t *, const fp_t *)>(s.jit_lookup("jet"));
 
             std::vector<fp_t> jet{fp_t{2}, fp_t{3}};
             jet.resize(6);
 
-            jptr(jet.data());
+            jptr(jet.data(), nullptr);
 
             REQUIRE(jet[0] == 2);
             REQUIRE(jet[1] == 3);
@@ -172,12 +172,12 @@ TEST_CASE("taylor exp")
 
             s.compile();
 
-            auto jptr = reinterpret_cast<void (*)(fp_t *)>(s.jit_lookup("jet"));
+            auto jptr = reinterpret_cast<void (*)(fp_t *, const fp_t *)>(s.jit_lookup("jet"));
 
             std::vector<fp_t> jet{fp_t{2}, fp_t{-2}, fp_t{3}, fp_t{-3}};
             jet.resize(12);
 
-            jptr(jet.data());
+            jptr(jet.data(), nullptr);
 
             REQUIRE(jet[0] == 2);
             REQUIRE(jet[1] == -2);
@@ -206,12 +206,12 @@ TEST_CASE("taylor exp")
 
             s.compile();
 
-            auto jptr = reinterpret_cast<void (*)(fp_t *)>(s.jit_lookup("jet"));
+            auto jptr = reinterpret_cast<void (*)(fp_t *, const fp_t *)>(s.jit_lookup("jet"));
 
             std::vector<fp_t> jet{fp_t{2}, fp_t{-2}, fp_t{1}, fp_t{3}, fp_t{-3}, fp_t{0}};
             jet.resize(24);
 
-            jptr(jet.data());
+            jptr(jet.data(), nullptr);
 
             REQUIRE(jet[0] == 2);
             REQUIRE(jet[1] == -2);
@@ -257,12 +257,12 @@ TEST_CASE("taylor exp")
 
             s.compile();
 
-            auto jptr = reinterpret_cast<void (*)(fp_t *)>(s.jit_lookup("jet"));
+            auto jptr = reinterpret_cast<void (*)(fp_t *, const fp_t *)>(s.jit_lookup("jet"));
 
             std::vector<fp_t> jet{fp_t{2}, fp_t{3}};
             jet.resize(4);
 
-            jptr(jet.data());
+            jptr(jet.data(), nullptr);
 
             REQUIRE(jet[0] == 2);
             REQUIRE(jet[1] == 3);
@@ -277,12 +277,12 @@ TEST_CASE("taylor exp")
 
             s.compile();
 
-            auto jptr = reinterpret_cast<void (*)(fp_t *)>(s.jit_lookup("jet"));
+            auto jptr = reinterpret_cast<void (*)(fp_t *, const fp_t *)>(s.jit_lookup("jet"));
 
             std::vector<fp_t> jet{fp_t{2}, fp_t{4}, fp_t{3}, fp_t{5}};
             jet.resize(8);
 
-            jptr(jet.data());
+            jptr(jet.data(), nullptr);
 
             REQUIRE(jet[0] == 2);
             REQUIRE(jet[1] == 4);
@@ -304,12 +304,12 @@ TEST_CASE("taylor exp")
 
             s.compile();
 
-            auto jptr = reinterpret_cast<void (*)(fp_t *)>(s.jit_lookup("jet"));
+            auto jptr = reinterpret_cast<void (*)(fp_t *, const fp_t *)>(s.jit_lookup("jet"));
 
             std::vector<fp_t> jet{fp_t{2}, fp_t{3}};
             jet.resize(6);
 
-            jptr(jet.data());
+            jptr(jet.data(), nullptr);
 
             REQUIRE(jet[0] == 2);
             REQUIRE(jet[1] == 3);
@@ -326,12 +326,12 @@ TEST_CASE("taylor exp")
 
             s.compile();
 
-            auto jptr = reinterpret_cast<void (*)(fp_t *)>(s.jit_lookup("jet"));
+            auto jptr = reinterpret_cast<void (*)(fp_t *, const fp_t *)>(s.jit_lookup("jet"));
 
             std::vector<fp_t> jet{fp_t{2}, fp_t{4}, fp_t{3}, fp_t{5}};
             jet.resize(12);
 
-            jptr(jet.data());
+            jptr(jet.data(), nullptr);
 
             REQUIRE(jet[0] == 2);
             REQUIRE(jet[1] == 4);
@@ -359,12 +359,12 @@ TEST_CASE("taylor exp")
 
             s.compile();
 
-            auto jptr = reinterpret_cast<void (*)(fp_t *)>(s.jit_lookup("jet"));
+            auto jptr = reinterpret_cast<void (*)(fp_t *, const fp_t *)>(s.jit_lookup("jet"));
 
             std::vector<fp_t> jet{fp_t{2}, fp_t{4}, fp_t{3}, fp_t{3}, fp_t{5}, fp_t{6}};
             jet.resize(24);
 
-            jptr(jet.data());
+            jptr(jet.data(), nullptr);
 
             REQUIRE(jet[0] == 2);
             REQUIRE(jet[1] == 4);
@@ -0,0 +1,267 @@
+// Copyright 2020 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <heyoka/config.hpp>
+
+#include <cmath>
+#include <sstream>
+#include <stdexcept>
+#include <tuple>
+#include <vector>
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+#include <mp++/real128.hpp>
+
+#endif
+
+#include <heyoka/expression.hpp>
+#include <heyoka/llvm_state.hpp>
+#include <heyoka/math_functions.hpp>
+#include <heyoka/nbody.hpp>
+#include <heyoka/number.hpp>
+#include <heyoka/param.hpp>
+#include <heyoka/taylor.hpp>
+
+#include "catch.hpp"
+#include "test_utils.hpp"
+
+using namespace heyoka;
+using namespace heyoka_test;
+
+const auto fp_types = std::tuple<double, long double
+#if defined(HEYOKA_HAVE_REAL128)
+                                 ,
+                                 mppp::real128
+#endif
+                                 >{};
+
+TEST_CASE("param basic")
+{
+    auto x = "x"_var;
+
+    REQUIRE(par[0] == par[0]);
+    REQUIRE(par[0] != par[1]);
+    REQUIRE(par[0] != 0_dbl);
+    REQUIRE(hash(par[42]) == hash(par[42]));
+
+    std::ostringstream oss;
+    oss << par[42];
+    REQUIRE(oss.str() == "par[42]");
+
+    REQUIRE(get_variables(par[1] * x).size() == 1u);
+    REQUIRE(diff(par[1], "x") == 0_dbl);
+    REQUIRE(subs(par[1], {{"x", 1_dbl}}) == par[1]);
+
+    REQUIRE(get_param_size(x) == 0u);
+    REQUIRE(get_param_size(par[0]) == 1u);
+    REQUIRE(get_param_size(par[3] * x + sin(par[1])) == 4u);
+
+    REQUIRE_THROWS_AS(eval_dbl(par[0], {}), std::invalid_argument);
+
+    // Runtime parameters as N-body masses.
+    auto nbody_sys = make_nbody_sys(2, kw::masses = std::vector<expression>{par[0], par[1]});
+    REQUIRE(nbody_sys.size() == 12u);
+    for (const auto &[_, rhs] : nbody_sys) {
+        REQUIRE(get_param_size(rhs) <= 2u);
+    }
+
+    // A parameter in the decomposition is turned into a u variable.
+    auto dc = taylor_decompose({prime(x) = par[0] * x});
+    REQUIRE(dc.size() == 4u);
+    REQUIRE(dc[1] == par[0]);
+}
+
+TEST_CASE("taylor param jet")
+{
+    auto tester = [](auto fp_x, unsigned opt_level, bool high_accuracy, bool compact_mode) {
+        using fp_t = decltype(fp_x);
+
+        auto x = "x"_var, y = "y"_var;
+
+        // Scalar mode.
+        {
+            llvm_state s{kw::opt_level = opt_level};
+
+            taylor_add_jet<fp_t>(s, "jet", {prime(x) = par[0] * x, prime(y) = par[1]}, 2, 1, high_accuracy,
+                                 compact_mode);
+
+            s.compile();
+
+            auto jptr = reinterpret_cast<void (*)(fp_t *, const fp_t *)>(s.jit_lookup("jet"));
+
+            std::vector<fp_t> jet{fp_t{2}, fp_t{3}}, pars{fp_t{-4}, fp_t{5}};
+            jet.resize(6);
+
+            jptr(jet.data(), pars.data());
+
+            REQUIRE(jet[0] == 2);
+            REQUIRE(jet[1] == 3);
+            REQUIRE(jet[2] == approximately(fp_t{-8}));
+            REQUIRE(jet[3] == 5);
+            REQUIRE(jet[4] == approximately(fp_t{16}));
+            REQUIRE(jet[5] == 0);
+        }
+
+        // Batch mode.
+        {
+            llvm_state s{kw::opt_level = opt_level};
+
+            taylor_add_jet<fp_t>(s, "jet", {prime(x) = par[0] * x, prime(y) = par[1]}, 2, 2, high_accuracy,
+                                 compact_mode);
+
+            s.compile();
+
+            auto jptr = reinterpret_cast<void (*)(fp_t *, const fp_t *)>(s.jit_lookup("jet"));
+
+            std::vector<fp_t> jet{fp_t{2}, fp_t{-2}, fp_t{3}, fp_t{-3}},
+                pars{fp_t{-4}, fp_t{4}, fp_t{5}, fp_t{-5}};
+            jet.resize(12);
+
+            jptr(jet.data(), pars.data());
+
+            REQUIRE(jet[0] == 2);
+            REQUIRE(jet[1] == -2);
+            REQUIRE(jet[2] == 3);
+            REQUIRE(jet[3] == -3);
+
+            REQUIRE(jet[4] == approximately(fp_t{-8}));
+            REQUIRE(jet[5] == approximately(fp_t{-8}));
+            REQUIRE(jet[6] == 5);
+            REQUIRE(jet[7] == -5);
+
+            REQUIRE(jet[8] == approximately(fp_t{16}));
+            REQUIRE(jet[9] == approximately(fp_t{-16}));
+            REQUIRE(jet[10] == 0);
+            REQUIRE(jet[11] == 0);
+        }
+
+        // Batch mode, aos layout. The jet of each batch
+        // element is contiguous, the parameters are still
+        // laid out as [par_idx][batch_idx].
+        {
+            llvm_state s{kw::opt_level = opt_level};
+
+            taylor_add_jet<fp_t>(s, "jet", {prime(x) = par[0] * x, prime(y) = par[1]}, 2, 2, high_accuracy,
+                                 compact_mode, taylor_layout::aos);
+
+            s.compile();
+
+            auto jptr = reinterpret_cast<void (*)(fp_t *, const fp_t *)>(s.jit_lookup("jet"));
+
+            std::vector<fp_t> jet(12), pars{fp_t{-4}, fp_t{4}, fp_t{5}, fp_t{-5}};
+            jet[0] = 2;
+            jet[1] = 3;
+            jet[6] = -2;
+            jet[7] = -3;
+
+            jptr(jet.data(), pars.data());
+
+            REQUIRE(jet[0] == 2);
+            REQUIRE(jet[1] == 3);
+            REQUIRE(jet[2] == approximately(fp_t{-8}));
+            REQUIRE(jet[3] == 5);
+            REQUIRE(jet[4] == approximately(fp_t{16}));
+            REQUIRE(jet[5] == 0);
+
+            REQUIRE(jet[6] == -2);
+            REQUIRE(jet[7] == -3);
+            REQUIRE(jet[8] == approximately(fp_t{-8}));
+            REQUIRE(jet[9] == -5);
+            REQUIRE(jet[10] == approximately(fp_t{-16}));
+            REQUIRE(jet[11] == 0);
+        }
+    };
+
+    for (auto cm : {false, true}) {
+        for (auto f : {false, true}) {
+            tuple_for_each(fp_types, [&tester, f, cm](auto x) { tester(x, 0, f, cm); });
+            tuple_for_each(fp_types, [&tester, f, cm](auto x) { tester(x, 3, f, cm); });
+        }
+    }
+}
+
+TEST_CASE("taylor param adaptive")
+{
+    auto tester = [](auto fp_x) {
+        using std::cos;
+
+        using fp_t = decltype(fp_x);
+
+        auto [x, v] = make_vars("x", "v");
+
+        for (auto cm : {false, true}) {
+            // Too many parameter values.
+            REQUIRE_THROWS_AS((taylor_adaptive<fp_t>{{prime(x) = v, prime(v) = -par[0] * x},
+                                                     {fp_t(1), fp_t(0)},
+                                                     kw::compact_mode = cm,
+                                                     kw::pars = std::vector<fp_t>{fp_t(1), fp_t(2)}}),
+                              std::invalid_argument);
+
+            // The parameters default to zero.
+            taylor_adaptive<fp_t> ta0{
+                {prime(x) = v, prime(v) = -par[0] * x}, {fp_t(1), fp_t(0)}, kw::compact_mode = cm};
+            REQUIRE(ta0.get_pars() == std::vector<fp_t>{fp_t(0)});
+
+            // Harmonic oscillator with angular frequency sqrt(par[0]).
+            taylor_adaptive<fp_t> ta{{prime(x) = v, prime(v) = -par[0] * x},
+                                     {fp_t(1), fp_t(0)},
+                                     kw::compact_mode = cm,
+                                     kw::pars = std::vector<fp_t>{fp_t(4)}};
+
+            REQUIRE(ta.get_state().size() == 2u);
+
+            ta.propagate_until(fp_t(1));
+            REQUIRE(ta.get_state()[0] == approximately(cos(fp_t(2)), fp_t(1000)));
+
+            // Change the parameter value and propagate again,
+            // without recompiling.
+            ta.get_pars_data()[0] = fp_t(1);
+            ta.set_time(fp_t(0));
+            ta.set_state({fp_t(1), fp_t(0)});
+
+            ta.propagate_until(fp_t(1));
+            REQUIRE(ta.get_state()[0] == approximately(cos(fp_t(1)), fp_t(1000)));
+
+            // Copies keep the parameter values.
+            auto ta_copy = ta;
+            REQUIRE(ta_copy.get_pars() == ta.get_pars());
+
+            // Batch mode.
+            REQUIRE_THROWS_AS((taylor_adaptive_batch<fp_t>{{prime(x) = v, prime(v) = -par[0] * x},
+                                                           {fp_t(1), fp_t(1), fp_t(0), fp_t(0)},
+                                                           2,
+                                                           kw::compact_mode = cm,
+                                                           kw::pars = std::vector<fp_t>{fp_t(1)}}),
+                              std::invalid_argument);
+
+            taylor_adaptive_batch<fp_t> tab{{prime(x) = v, prime(v) = -par[0] * x},
+                                            {fp_t(1), fp_t(1), fp_t(0), fp_t(0)},
+                                            2,
+                                            kw::compact_mode = cm,
+                                            kw::pars = std::vector<fp_t>{fp_t(4), fp_t(1)}};
+
+            std::vector<std::tuple<taylor_outcome, fp_t>> res;
+            for (auto i = 0; i < 1000; ++i) {
+                const auto &times = tab.get_times();
+                if (times[0] == 1 && times[1] == 1) {
+                    break;
+                }
+
+                tab.step(res, {fp_t(1) - times[0], fp_t(1) - times[1]});
+            }
+
+            REQUIRE(tab.get_times()[0] == 1);
+            REQUIRE(tab.get_times()[1] == 1);
+            REQUIRE(tab.get_states()[0] == approximately(cos(fp_t(2)), fp_t(1000)));
+            REQUIRE(tab.get_states()[1] == approximately(cos(fp_t(1)), fp_t(1000)));
+        }
+    };
+
+    tuple_for_each(fp_types, tester);
+}